@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <kobj/GlobalThread.h>
+#include <kobj/Sm.h>
+#include <services/Storage.h>
+#include <stream/IStringStream.h>
+#include <util/Math.h>
+#include <util/Util.h>
+#include <cstring>
+
+using namespace nre;
+
+/**
+ * A workload generator for the storage service, similar to fio. It starts <threads> workers that
+ * are distributed over the CPUs. Each one has its own session at the drive and keeps up to <qd>
+ * requests of <bs> bytes in flight until it has done <ios> requests. The requests go either
+ * sequentially through the region of the drive that belongs to the worker or to random blocks in
+ * that region. <rwmix> is the percentage of reads; writes destroy the content of the drive and
+ * are therefore only done if "allow-write" is given.
+ * At the end, it prints one line with key=value pairs, so that the results can be parsed and
+ * tracked easily.
+ */
+
+/**
+ * A latency histogram with 8 buckets per power of two, i.e. the error of the percentiles is at
+ * most 12.5%.
+ */
+class Histogram {
+    static const uint SUB_SHIFT     = 3;
+    static const size_t BUCKETS     = 64 << SUB_SHIFT;
+
+public:
+    explicit Histogram() : _counts(), _total() {
+    }
+
+    uint64_t total() const {
+        return _total;
+    }
+    void record(uint64_t value) {
+        _counts[index(value)]++;
+        _total++;
+    }
+    void add(const Histogram &h) {
+        for(size_t i = 0; i < BUCKETS; ++i)
+            _counts[i] += h._counts[i];
+        _total += h._total;
+    }
+
+    /**
+     * @param permille the percentile in 1/1000
+     * @return an upper bound for the value that <permille> 1/1000 of the values don't exceed
+     */
+    uint64_t percentile(uint permille) const {
+        uint64_t limit = (_total * permille + 999) / 1000;
+        uint64_t sum = 0;
+        for(size_t i = 0; i < BUCKETS; ++i) {
+            sum += _counts[i];
+            if(sum >= limit && sum > 0)
+                return upper(i);
+        }
+        return 0;
+    }
+
+private:
+    static size_t index(uint64_t value) {
+        if(value < (1 << SUB_SHIFT))
+            return value;
+        uint shift = 63 - __builtin_clzll(value) - SUB_SHIFT;
+        return ((shift + 1) << SUB_SHIFT) + ((value >> shift) & ((1 << SUB_SHIFT) - 1));
+    }
+    static uint64_t upper(size_t idx) {
+        if(idx < (1 << SUB_SHIFT))
+            return idx;
+        uint shift = (idx >> SUB_SHIFT) - 1;
+        uint64_t sub = idx & ((1 << SUB_SHIFT) - 1);
+        return (((1ULL << SUB_SHIFT) + sub + 1) << shift) - 1;
+    }
+
+    uint64_t _counts[BUCKETS];
+    uint64_t _total;
+};
+
+struct Worker {
+    explicit Worker(size_t id, size_t drive, size_t bufsize, size_t qd)
+        : id(id), buf(bufsize, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+          sess("storage", buf, drive), start(new uint64_t[qd]), hist(), rng(id * 2654435761U + 1),
+          first(), count(), next(), errors(), begin(), end(), done(0) {
+    }
+    ~Worker() {
+        delete[] start;
+    }
+
+    uint64_t random() {
+        // xorshift64
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    }
+
+    size_t id;
+    DataSpace buf;
+    StorageSession sess;
+    uint64_t *start;
+    Histogram hist;
+    uint64_t rng;
+    // our region of the drive in blocks
+    Storage::sector_type first;
+    Storage::sector_type count;
+    Storage::sector_type next;
+    size_t errors;
+    uint64_t begin;
+    uint64_t end;
+    Sm done;
+};
+
+static size_t drive         = 0;
+static bool randpat         = false;
+static uint rwmix           = 100;
+static size_t bs            = 4096;
+static size_t qd            = 1;
+static size_t threads       = 1;
+static size_t ios           = 10000;
+static bool allow_write     = false;
+static size_t blocksecs;
+
+static void issue(Worker *w, size_t slot) {
+    Storage::sector_type block;
+    if(randpat)
+        block = w->first + w->random() % w->count;
+    else {
+        block = w->first + w->next;
+        w->next = (w->next + 1) % w->count;
+    }
+    bool read = w->random() % 100 < rwmix;
+    w->start[slot] = Util::tsc();
+    if(read)
+        w->sess.read(slot, block * blocksecs, blocksecs, slot * bs);
+    else
+        w->sess.write(slot, block * blocksecs, blocksecs, slot * bs);
+}
+
+static void worker_thread(void*) {
+    Worker *w = Thread::current()->get_tls<Worker*>(Thread::TLS_PARAM);
+    size_t issued = 0, completed = 0;
+    w->begin = Util::tsc();
+    for(; issued < Math::min(qd, ios); ++issued)
+        issue(w, issued);
+    while(completed < issued) {
+        Storage::Packet *pk = w->sess.consumer().get();
+        if(!pk)
+            break;
+        size_t slot = pk->tag;
+        if(pk->status != 0)
+            w->errors++;
+        w->sess.consumer().next();
+        w->hist.record(Util::tsc() - w->start[slot]);
+        completed++;
+        if(issued < ios) {
+            issue(w, slot);
+            issued++;
+        }
+    }
+    w->end = Util::tsc();
+    w->done.up();
+}
+
+static size_t read_arg(const char *arg, size_t prefix) {
+    return IStringStream::read_from<size_t>(String(arg + prefix, strlen(arg + prefix)));
+}
+
+static double to_us(uint64_t cycles) {
+    return static_cast<double>(cycles) * 1000 / Hip::get().freq_tsc;
+}
+
+int main(int argc, char *argv[]) {
+    for(int i = 1; i < argc; ++i) {
+        if(strncmp(argv[i], "drive=", 6) == 0)
+            drive = read_arg(argv[i], 6);
+        else if(strcmp(argv[i], "pattern=rand") == 0)
+            randpat = true;
+        else if(strcmp(argv[i], "pattern=seq") == 0)
+            randpat = false;
+        else if(strncmp(argv[i], "rwmix=", 6) == 0)
+            rwmix = Math::min<size_t>(read_arg(argv[i], 6), 100);
+        else if(strncmp(argv[i], "bs=", 3) == 0)
+            bs = read_arg(argv[i], 3);
+        else if(strncmp(argv[i], "qd=", 3) == 0)
+            qd = Math::max<size_t>(read_arg(argv[i], 3), 1);
+        else if(strncmp(argv[i], "threads=", 8) == 0)
+            threads = Math::max<size_t>(read_arg(argv[i], 8), 1);
+        else if(strncmp(argv[i], "ios=", 4) == 0)
+            ios = read_arg(argv[i], 4);
+        else if(strcmp(argv[i], "allow-write") == 0)
+            allow_write = true;
+    }
+    if(rwmix < 100 && !allow_write) {
+        Serial::get() << "diskbench: writes destroy the content of the drive; "
+                      << "please add allow-write\n";
+        return 1;
+    }
+
+    Worker **workers = new Worker*[threads];
+    for(size_t i = 0; i < threads; ++i)
+        workers[i] = new Worker(i, drive, qd * bs, qd);
+
+    // limit the queue depth to what the drive supports with all sessions together
+    const Storage::Parameter &params = workers[0]->sess.get_params();
+    if(bs < params.sector_size || bs % params.sector_size != 0) {
+        Serial::get() << "diskbench: bs has to be a multiple of " << params.sector_size << "\n";
+        return 1;
+    }
+    qd = Math::min<size_t>(qd, params.max_requests / threads);
+    if(qd == 0) {
+        Serial::get() << "diskbench: drive supports only " << params.max_requests
+                      << " parallel requests\n";
+        return 1;
+    }
+    blocksecs = bs / params.sector_size;
+
+    // give every worker its own region of the drive
+    Storage::sector_type blocks = params.sectors / blocksecs;
+    for(size_t i = 0; i < threads; ++i) {
+        workers[i]->count = Math::max<Storage::sector_type>(blocks / threads, 1);
+        workers[i]->first = (i * workers[i]->count) % Math::max<Storage::sector_type>(blocks, 1);
+    }
+
+    for(size_t i = 0; i < threads; ++i) {
+        Reference<GlobalThread> gt = GlobalThread::create(worker_thread, i % CPU::count(),
+                                                          "diskbench-worker");
+        gt->set_tls<Worker*>(Thread::TLS_PARAM, workers[i]);
+        gt->start();
+    }
+
+    Histogram hist;
+    size_t errors = 0;
+    uint64_t begin = ~0ULL, end = 0;
+    for(size_t i = 0; i < threads; ++i) {
+        workers[i]->done.down();
+        hist.add(workers[i]->hist);
+        errors += workers[i]->errors;
+        begin = Math::min(begin, workers[i]->begin);
+        end = Math::max(end, workers[i]->end);
+    }
+
+    double secs = to_us(end - begin) / 1000000;
+    uint64_t total = hist.total();
+    Serial::get() << "diskbench: drive=" << drive << " name=" << params.name
+                  << " pattern=" << (randpat ? "rand" : "seq") << " rwmix=" << rwmix
+                  << " bs=" << bs << " qd=" << qd << " threads=" << threads
+                  << " ios=" << total << " errors=" << errors
+                  << " iops=" << fmt(total / secs, "", 0, 0)
+                  << " mbps=" << fmt(total * bs / secs / 1000000, "", 0, 1)
+                  << " p50_us=" << fmt(to_us(hist.percentile(500)), "", 0, 1)
+                  << " p99_us=" << fmt(to_us(hist.percentile(990)), "", 0, 1)
+                  << " p999_us=" << fmt(to_us(hist.percentile(999)), "", 0, 1) << "\n";
+
+    for(size_t i = 0; i < threads; ++i)
+        delete workers[i];
+    delete[] workers;
+    return 0;
+}
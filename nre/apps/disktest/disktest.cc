@@ -105,6 +105,38 @@ static void read_invalid_sector(StorageSession &disk, Storage::Parameter &params
     }
 }
 
+static void read_write_overlay(StorageSession &disk, Storage::Parameter &params, DataSpace &buffer,
+                               size_t d) {
+    size_t secsize = params.sector_size;
+    if(params.sectors < 2 || secsize * 5 > buffer.size())
+        return;
+
+    WVPRINT("Testing RAM overlay for drive " << d);
+    StorageSession overlay("storage", buffer, d, Storage::OVERLAY_RAM);
+    uint8_t *bytes = reinterpret_cast<uint8_t*>(buffer.virt());
+
+    // read the original content of sector 0 and 1
+    clear_buffer(buffer);
+    disk.read(tag, 0, 2, 0);
+    wait_for(disk, tag++);
+
+    // write sector 1 via the overlay
+    prepare_buffer(buffer, secsize * 2, secsize);
+    overlay.write(tag, 1, 1, secsize * 2);
+    wait_for(overlay, tag++);
+
+    // sector 0 has to come from the base drive and sector 1 from the overlay
+    overlay.read(tag, 0, 2, secsize * 3);
+    wait_for(overlay, tag++);
+    WVPASSEQ(memcmp(bytes, bytes + secsize * 3, secsize), 0);
+    check_buffer(buffer, secsize * 4, secsize);
+
+    // the base drive is unchanged
+    disk.read(tag, 1, 1, secsize * 2);
+    wait_for(disk, tag++);
+    WVPASSEQ(memcmp(bytes + secsize, bytes + secsize * 2, secsize), 0);
+}
+
 static void runtest(DataSpace &buffer, size_t d) {
     try {
         StorageSession disk("storage", buffer, d);
@@ -123,8 +155,10 @@ static void runtest(DataSpace &buffer, size_t d) {
             }
             read_atapi(disk, params, buffer);
         }
-        else
+        else {
             read_write_ata(disk, params, buffer);
+            read_write_overlay(disk, params, buffer, d);
+        }
 
         WVPRINT("Testing flush cache");
         disk.flush(tag);
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <ipc/Service.h>
+#include <ipc/PtClientSession.h>
+#include <subsystem/ChildManager.h>
+#include <kobj/GlobalThread.h>
+#include <kobj/LocalThread.h>
+#include <kobj/Ports.h>
+#include <kobj/Pt.h>
+#include <kobj/Sm.h>
+#include <utcb/UtcbFrame.h>
+#include <util/Profiler.h>
+#include <CPU.h>
+
+using namespace nre;
+
+/**
+ * The IPC benchmark suite. It measures portal calls in the same Pd with different payloads,
+ * capability delegations and translations, calls from nested UtcbFrames, cross-CPU signaling,
+ * cross-Pd calls and the creation and destruction of sessions. For each benchmark, it prints one
+ * line of the form
+ * ipcbench: name=<name> count=<n> min=<c> avg=<c> p50=<c> p90=<c> p99=<c> p999=<c> max=<c>
+ * with all values in cycles, followed by a log2-histogram of the measurements. tools/autotest.sh
+ * compares the medians against a stored baseline.
+ */
+
+class BenchService;
+
+enum {
+    CMD_PING,
+    CMD_QUIT,
+};
+
+static const size_t tries           = 10000;
+static const size_t session_tries   = 1000;
+static const Ports::port_t PORT_BASE = 0x100;
+static const size_t MAX_ITEMS       = 16;
+static BenchService *srv;
+
+static void report(const char *name, size_t arg, AvgProfiler &prof) {
+    // percentile() sorts the results, so that we can walk through them for the histogram below
+    Serial::get() << "ipcbench: name=" << name;
+    if(arg != static_cast<size_t>(-1))
+        Serial::get() << "-" << arg;
+    Serial::get() << " count=" << prof.count() << " min=" << prof.min() << " avg=" << prof.avg()
+                  << " p50=" << prof.median() << " p90=" << prof.percentile(900)
+                  << " p99=" << prof.percentile(990) << " p999=" << prof.percentile(999)
+                  << " max=" << prof.max() << "\n";
+
+    size_t i = 0;
+    while(i < prof.count()) {
+        uint bucket = prof.result(i) ? 63 - __builtin_clzll(prof.result(i)) : 0;
+        AvgProfiler::time_t limit = 1ULL << (bucket + 1);
+        size_t start = i;
+        while(i < prof.count() && prof.result(i) < limit)
+            i++;
+        Serial::get() << "ipcbench-hist:   " << fmt(bucket ? limit / 2 : 0, 10) << " .. "
+                      << fmt(limit - 1, 10) << ": " << fmt(i - start, 8) << "\n";
+    }
+}
+
+static void report(const char *name, AvgProfiler &prof) {
+    report(name, static_cast<size_t>(-1), prof);
+}
+
+PORTAL static void portal_echo(void*) {
+    // we don't touch the UTCB, i.e. the words are sent back unchanged
+}
+
+PORTAL static void portal_delegate(void*) {
+    UtcbFrameRef uf;
+    try {
+        size_t n;
+        uf >> n;
+        uf.finish_input();
+        for(size_t i = 0; i < Math::min(n, MAX_ITEMS); ++i)
+            uf.delegate(CapRange(PORT_BASE + i, 1, Crd::IO_ALL));
+    }
+    catch(const Exception&) {
+        uf.clear();
+    }
+}
+
+PORTAL static void portal_translate(void*) {
+    UtcbFrameRef uf;
+    try {
+        size_t n;
+        uf >> n;
+        for(size_t i = 0; i < n; ++i)
+            uf.get_translated(0);
+        uf.finish_input();
+    }
+    catch(const Exception&) {
+        uf.clear();
+    }
+}
+
+static void bench_payload(Pt &pt) {
+    static const size_t words[] = {0, 1, 2, 4, 8, 16, 32, 64, 128};
+    for(size_t w = 0; w < ARRAY_SIZE(words); ++w) {
+        AvgProfiler prof(tries);
+        UtcbFrame uf;
+        for(size_t i = 0; i < tries; ++i) {
+            prof.start();
+            for(size_t x = 0; x < words[w]; ++x)
+                uf << x;
+            pt.call(uf);
+            uf.clear();
+            prof.stop();
+        }
+        report("call-words", words[w], prof);
+    }
+}
+
+static void bench_delegate(Pt &pt) {
+    for(size_t n = 1; n <= MAX_ITEMS; n *= 2) {
+        AvgProfiler prof(tries);
+        UtcbFrame uf;
+        uf.delegation_window(Crd(0, 31, Crd::IO_ALL));
+        for(size_t i = 0; i < tries; ++i) {
+            prof.start();
+            uf << n;
+            pt.call(uf);
+            uf.clear();
+            prof.stop();
+        }
+        report("delegate", n, prof);
+    }
+}
+
+static void bench_translate(Pt &pt) {
+    for(size_t n = 1; n <= MAX_ITEMS; n *= 2) {
+        AvgProfiler prof(tries);
+        UtcbFrame uf;
+        for(size_t i = 0; i < tries; ++i) {
+            prof.start();
+            uf << n;
+            for(size_t x = 0; x < n; ++x)
+                uf.translate(pt.sel());
+            pt.call(uf);
+            uf.clear();
+            prof.stop();
+        }
+        report("translate", n, prof);
+    }
+}
+
+static void nested_call(Pt &pt, size_t depth, AvgProfiler &prof) {
+    UtcbFrame uf;
+    if(depth > 0) {
+        // occupy some space in each frame, as a caller would do
+        uf << 1 << 2 << 3 << 4;
+        nested_call(pt, depth - 1, prof);
+        return;
+    }
+    for(size_t i = 0; i < tries; ++i) {
+        prof.start();
+        pt.call(uf);
+        prof.stop();
+    }
+}
+
+static void bench_nesting(Pt &pt) {
+    static const size_t depths[] = {0, 1, 2, 4, 8};
+    for(size_t d = 0; d < ARRAY_SIZE(depths); ++d) {
+        AvgProfiler prof(tries);
+        nested_call(pt, depths[d], prof);
+        report("utcb-nest", depths[d], prof);
+    }
+}
+
+static Sm *ping;
+static Sm *pong;
+
+static void pong_thread(void*) {
+    for(size_t i = 0; i < tries; ++i) {
+        ping->down();
+        pong->up();
+    }
+}
+
+static void bench_xcpu() {
+    if(CPU::count() < 2)
+        return;
+    ping = new Sm(0);
+    pong = new Sm(0);
+    cpu_t other = (CPU::current().log_id() + 1) % CPU::count();
+    Reference<GlobalThread> gt = GlobalThread::create(pong_thread, other, "ipcbench-pong");
+    gt->start();
+    AvgProfiler prof(tries);
+    for(size_t i = 0; i < tries; ++i) {
+        prof.start();
+        ping->up();
+        pong->down();
+        prof.stop();
+    }
+    gt->join();
+    report("sm-xcpu", prof);
+    delete pong;
+    delete ping;
+}
+
+class BenchSession : public ServiceSession {
+public:
+    explicit BenchSession(Service *s, size_t id, portal_func func) : ServiceSession(s, id, func) {
+    }
+    virtual ~BenchSession();
+};
+
+class BenchService : public Service {
+public:
+    explicit BenchService(portal_func func)
+        : Service("ipcbench", CPUSet(CPUSet::ALL), func), quit(false) {
+    }
+
+    bool quit;
+
+private:
+    virtual ServiceSession *create_session(size_t id, const String&, portal_func func) {
+        return new BenchSession(this, id, func);
+    }
+};
+
+BenchSession::~BenchSession() {
+    if(srv->quit)
+        srv->stop();
+}
+
+PORTAL static void portal_service(void*) {
+    UtcbFrameRef uf;
+    try {
+        int cmd;
+        uf >> cmd;
+        uf.finish_input();
+        if(cmd == CMD_QUIT)
+            srv->quit = true;
+    }
+    catch(const Exception&) {
+        uf.clear();
+    }
+}
+
+static int bench_server(int, char *[]) {
+    srv = new BenchService(portal_service);
+    srv->start();
+    delete srv;
+    return 0;
+}
+
+static int bench_client(int, char *[]) {
+    {
+        AvgProfiler prof(session_tries);
+        for(size_t i = 0; i < session_tries; ++i) {
+            prof.start();
+            {
+                PtClientSession sess("ipcbench");
+            }
+            prof.stop();
+        }
+        report("session", prof);
+    }
+
+    PtClientSession sess("ipcbench");
+    Pt &pt = sess.pt();
+    {
+        AvgProfiler prof(tries);
+        UtcbFrame uf;
+        for(size_t i = 0; i < tries; ++i) {
+            prof.start();
+            uf << CMD_PING;
+            pt.call(uf);
+            uf.clear();
+            prof.stop();
+        }
+        report("call-xpd", prof);
+    }
+
+    UtcbFrame uf;
+    uf << CMD_QUIT;
+    pt.call(uf);
+    return 0;
+}
+
+static void bench_xpd() {
+    ChildManager *mng = new ChildManager();
+    Hip::mem_iterator self = Hip::get().mem_begin();
+    // map the memory of the module
+    DataSpace ds(self->size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::R, self->addr);
+    {
+        ChildConfig cfg(0, "ipcbench-server provides=ipcbench");
+        cfg.entry(reinterpret_cast<uintptr_t>(bench_server));
+        mng->load(ds.virt(), self->size, cfg);
+    }
+    {
+        ChildConfig cfg(0, "ipcbench-client");
+        cfg.entry(reinterpret_cast<uintptr_t>(bench_client));
+        mng->load(ds.virt(), self->size, cfg);
+    }
+    while(mng->count() > 0)
+        mng->dead_sm().down();
+    delete mng;
+}
+
+int main() {
+    Ports ports(PORT_BASE, MAX_ITEMS);
+    Reference<LocalThread> ec = LocalThread::create(CPU::current().log_id());
+    UtcbFrameRef ecuf(ec->utcb());
+    ecuf.accept_translates();
+
+    {
+        Pt pt(ec, portal_echo);
+        bench_payload(pt);
+        bench_nesting(pt);
+    }
+    {
+        Pt pt(ec, portal_delegate);
+        bench_delegate(pt);
+    }
+    {
+        Pt pt(ec, portal_translate);
+        bench_translate(pt);
+    }
+    bench_xcpu();
+    bench_xpd();
+    return 0;
+}
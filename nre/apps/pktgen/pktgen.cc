@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <kobj/GlobalThread.h>
+#include <kobj/Sm.h>
+#include <services/Network.h>
+#include <stream/IStringStream.h>
+#include <util/Math.h>
+#include <util/Util.h>
+#include <Logging.h>
+#include <RCU.h>
+#include <cstring>
+
+using namespace nre;
+
+/**
+ * A packet generator to measure the overhead of the network service. It should be used together
+ * with the software NIC of the network service ("loopback" or "nullnic" on its command line).
+ * For 1 to <sessions> parallel sessions, each session sends <count> frames of <size> bytes. With
+ * the loopback NIC, the frames come back to the sender, which counts them. To not lose frames
+ * because of full rings, each session has at most a ring full of frames in flight.
+ */
+
+static const size_t MIN_SIZE    = sizeof(Network::EthernetHeader);
+static const size_t MAX_SIZE    = 1514;
+static const size_t RING_SIZE   = 32 * 1024;
+
+static size_t size              = 64;
+static size_t count             = 100000;
+static size_t max_sessions      = 1;
+static bool reflect;
+
+struct Generator {
+    explicit Generator(size_t id)
+        : sess("network", 0, RING_SIZE, RING_SIZE), credits(window()), done(0), id(id),
+          received(0), frame() {
+        Network::NIC nic = sess.get_info();
+        // the frames go to the NIC and come from a locally administered address per session
+        Network::EthernetHeader *hdr = reinterpret_cast<Network::EthernetHeader*>(frame);
+        for(size_t i = 0; i < 6; ++i)
+            hdr->mac_dst[i] = nic.mac.raw() >> (i * 8);
+        memset(hdr->mac_src, 0, sizeof(hdr->mac_src));
+        hdr->mac_src[0] = 0x02;
+        hdr->mac_src[5] = id + 1;
+        hdr->proto = 0xB588;
+        for(size_t i = sizeof(*hdr); i < size; ++i)
+            frame[i] = i;
+    }
+
+    static size_t window() {
+        // a frame takes its length plus the length-word, rounded up to words
+        size_t words = (size + 2 * sizeof(size_t) - 1) / sizeof(size_t);
+        return (RING_SIZE / sizeof(size_t)) / words - 2;
+    }
+
+    NetworkSession sess;
+    Sm credits;
+    Sm done;
+    size_t id;
+    size_t received;
+    uint8_t frame[MAX_SIZE];
+};
+
+static void send(Generator *gen) {
+    if(reflect)
+        gen->credits.down();
+    while(!gen->sess.send(gen->frame, size))
+        Util::pause();
+}
+
+static void sender_thread(void*) {
+    Generator *gen = Thread::current()->get_tls<Generator*>(Thread::TLS_PARAM);
+    for(size_t i = 0; i < count; ++i)
+        send(gen);
+    gen->done.up();
+}
+
+static void receiver_thread(void*) {
+    Generator *gen = Thread::current()->get_tls<Generator*>(Thread::TLS_PARAM);
+    while(1) {
+        uint8_t *packet;
+        size_t len = gen->sess.consumer().get(packet);
+        if(!len)
+            break;
+        // ignore frames that have been flooded to us because the switch didn't know the
+        // destination yet
+        const Network::EthernetHeader *hdr = reinterpret_cast<Network::EthernetHeader*>(packet);
+        bool ours = memcmp(hdr->mac_dst, gen->frame + 6, 6) == 0;
+        gen->sess.consumer().next();
+        if(ours) {
+            gen->credits.up();
+            if(++gen->received == count + 1)
+                gen->done.up();
+        }
+    }
+    gen->done.up();
+}
+
+static void run(size_t sessions) {
+    Generator **gens = new Generator*[sessions];
+    for(size_t i = 0; i < sessions; ++i) {
+        gens[i] = new Generator(i);
+        cpu_t cpu = i % CPU::count();
+        if(reflect) {
+            Reference<GlobalThread> gt = GlobalThread::create(receiver_thread, cpu, "pktgen-rx");
+            gt->set_tls<Generator*>(Thread::TLS_PARAM, gens[i]);
+            gt->start();
+            // let the switch learn where we are before we start measuring
+            send(gens[i]);
+        }
+    }
+    // wait until the first frame is back (it might have been flooded)
+    for(size_t i = 0; reflect && i < sessions; ++i) {
+        while(ACCESS_ONCE(gens[i]->received) == 0)
+            Util::pause();
+    }
+
+    uint64_t start = Util::tsc();
+    for(size_t i = 0; i < sessions; ++i) {
+        Reference<GlobalThread> gt = GlobalThread::create(sender_thread, i % CPU::count(),
+                                                          "pktgen-tx");
+        gt->set_tls<Generator*>(Thread::TLS_PARAM, gens[i]);
+        gt->start();
+    }
+    // the sender signals that it is finished and the receiver that all frames are back
+    for(size_t i = 0; i < sessions; ++i) {
+        gens[i]->done.down();
+        if(reflect)
+            gens[i]->done.down();
+    }
+    uint64_t cycles = Util::tsc() - start;
+
+    uint64_t packets = static_cast<uint64_t>(count) * sessions;
+    uint64_t pps = packets * Hip::get().freq_tsc * 1000 / Math::max<uint64_t>(cycles, 1);
+    Serial::get() << "pktgen: " << sessions << " session(s), " << packets << " packets of "
+                  << size << " bytes in " << cycles << " cycles: " << pps << " packets/s, "
+                  << (cycles / packets) << " cycles/packet\n";
+
+    for(size_t i = 0; i < sessions; ++i) {
+        // stop the receiver and wait until it is done
+        if(reflect) {
+            gens[i]->sess.consumer().stop();
+            gens[i]->done.down();
+        }
+        delete gens[i];
+    }
+    delete[] gens;
+}
+
+int main(int argc, char *argv[]) {
+    for(int i = 1; i < argc; ++i) {
+        if(strncmp(argv[i], "size=", 5) == 0)
+            size = IStringStream::read_from<size_t>(String(argv[i] + 5, strlen(argv[i] + 5)));
+        else if(strncmp(argv[i], "count=", 6) == 0)
+            count = IStringStream::read_from<size_t>(String(argv[i] + 6, strlen(argv[i] + 6)));
+        else if(strncmp(argv[i], "sessions=", 9) == 0) {
+            max_sessions = IStringStream::read_from<size_t>(
+                String(argv[i] + 9, strlen(argv[i] + 9)));
+        }
+    }
+    size = Math::max(MIN_SIZE, Math::min(MAX_SIZE, size));
+
+    {
+        NetworkSession probe("network", 0);
+        Network::NIC nic = probe.get_info();
+        reflect = strcmp(nic.name, "null") != 0;
+        if(reflect && strcmp(nic.name, "loopback") != 0)
+            Serial::get() << "pktgen: Warning: NIC " << nic.name << " is no software NIC\n";
+    }
+
+    for(size_t s = 1; s <= max_sessions; ++s)
+        run(s);
+    return 0;
+}
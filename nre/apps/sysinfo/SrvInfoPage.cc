@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <stream/VGAStream.h>
+#include <util/Util.h>
+
+#include "SysInfoPage.h"
+
+using namespace nre;
+
+SrvInfoPage::Entry *SrvInfoPage::find(const String &name) {
+    for(size_t i = 0; i < _count; ++i) {
+        if(_srvs[i].name == name)
+            return _srvs + i;
+    }
+    return nullptr;
+}
+
+void SrvInfoPage::refresh_services() {
+    for(size_t i = 0; i < _count; ++i)
+        _srvs[i].seen = false;
+
+    String name;
+    for(size_t idx = 0; _sysinfo.get_service(idx, name); ++idx) {
+        Entry *e = find(name);
+        if(!e && _count < MAX_SERVICES) {
+            DataSpace *ds = nullptr;
+            try {
+                ds = _sysinfo.get_service_stats(name);
+            }
+            catch(const Exception&) {
+                // the service might have been unregistered in the meantime
+            }
+            // the service might not have registered its statistics yet; try again next time
+            if(!ds)
+                continue;
+            e = _srvs + _count++;
+            e->name = name;
+            e->ds = ds;
+            for(size_t cmd = 0; cmd < ServiceStats::MAX_CMDS; ++cmd) {
+                e->last[cmd] = e->stats()->command(cmd).count();
+                e->rate[cmd] = 0;
+            }
+        }
+        if(e)
+            e->seen = true;
+    }
+
+    // forget the services that are gone
+    for(size_t i = 0; i < _count; ) {
+        if(!_srvs[i].seen) {
+            delete _srvs[i].ds;
+            _srvs[i] = _srvs[--_count];
+        }
+        else
+            ++i;
+    }
+
+    // determine the requests per second since the last update
+    uint64_t now = Util::tsc();
+    uint64_t elapsed = Math::max<uint64_t>(now - _last_tsc, 1);
+    _last_tsc = now;
+    for(size_t i = 0; i < _count; ++i) {
+        for(size_t cmd = 0; cmd < ServiceStats::MAX_CMDS; ++cmd) {
+            uint64_t count = _srvs[i].stats()->command(cmd).count();
+            _srvs[i].rate[cmd] = (count - _srvs[i].last[cmd]) * Hip::get().freq_tsc * 1000 / elapsed;
+            _srvs[i].last[cmd] = count;
+        }
+    }
+}
+
+void SrvInfoPage::refresh_console(bool update) {
+    ScopedLock<UserSm> guard(&_sm);
+    if(update)
+        refresh_services();
+
+    VGAStream cs(_cons, 0);
+    cs.clear(0);
+
+    // display header
+    cs << fmt("Service", MAX_NAME_LEN) << fmt("Cmd", 4) << fmt("Requests", MAX_CNT_LEN)
+       << fmt("Req/s", MAX_LAT_LEN) << fmt("Avg us", MAX_LAT_LEN) << fmt("P50 us", MAX_LAT_LEN)
+       << fmt("P99 us", MAX_LAT_LEN) << fmt("Max us", MAX_LAT_LEN) << "\n";
+    for(uint i = 0; i < VGAStream::COLS; i++)
+        cs << '-';
+
+    size_t row = 0, shown = 0;
+    for(size_t i = 0; i < _count && shown < ROWS; ++i) {
+        const Entry &e = _srvs[i];
+        const ServiceStats *stats = e.stats();
+        size_t namelen = Math::min<size_t>(e.name.length(), MAX_NAME_LEN);
+
+        // one line for each command that has been used
+        for(size_t cmd = 0; cmd < ServiceStats::MAX_CMDS && shown < ROWS; ++cmd) {
+            const ServiceStats::Command &c = stats->command(cmd);
+            uint64_t count = c.count();
+            if(count == 0 || row++ < _top)
+                continue;
+
+            cs << fmt(e.name.str(), MAX_NAME_LEN, namelen);
+            if(cmd == ServiceStats::MAX_CMDS - 1)
+                cs << fmt(">=", 3) << cmd;
+            else
+                cs << fmt(cmd, 4);
+            cs << fmt(count, MAX_CNT_LEN) << fmt(e.rate[cmd], MAX_LAT_LEN)
+               << fmt(to_us(c.cycles / count), MAX_LAT_LEN, 1)
+               << fmt(to_us(c.percentile(50)), MAX_LAT_LEN, 1)
+               << fmt(to_us(c.percentile(99)), MAX_LAT_LEN, 1)
+               << fmt(to_us(c.max), MAX_LAT_LEN, 1) << "\n";
+            shown++;
+        }
+
+        // and one for each ring
+        const ServiceStats::Ring *r;
+        for(size_t idx = 0; (r = stats->ring(idx)) != nullptr && shown < ROWS; ++idx) {
+            if(row++ < _top)
+                continue;
+
+            cs << fmt(e.name.str(), MAX_NAME_LEN, namelen) << "  ring "
+               << fmt(r->name, ServiceStats::MAX_RING_NAME_LEN) << ": " << fmt(r->level, 6)
+               << " of " << fmt(r->size, 6) << ", max " << fmt(r->max_level, 6)
+               << ", full " << fmt(r->full, 8) << "\n";
+            shown++;
+        }
+    }
+    display_footer(cs, 2);
+}
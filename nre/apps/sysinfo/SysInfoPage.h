@@ -18,6 +18,7 @@
 
 #include <services/Console.h>
 #include <services/SysInfo.h>
+#include <ipc/ServiceStats.h>
 #include <stream/VGAStream.h>
 
 class SysInfoPage {
@@ -26,9 +27,11 @@ public:
     static const size_t ROWS            = nre::VGAStream::ROWS - 3;
 
     explicit SysInfoPage(nre::ConsoleSession &cons, nre::SysInfoSession &sysinfo)
-        : _left(0), _top(0), _cons(cons), _sysinfo(sysinfo), _sm() {
+        : _left(0), _top(0), _cons(cons), _sysinfo(sysinfo), _sm(), _snapds(), _snap() {
     }
     virtual ~SysInfoPage() {
+        delete _snap;
+        delete _snapds;
     }
 
     size_t left() const {
@@ -51,26 +54,62 @@ public:
 
 protected:
     void display_footer(nre::VGAStream &cs, size_t i) {
+        static const char *tabs[] = {"Scs", "Pds", "Services"};
+        const size_t width = nre::VGAStream::COLS / ARRAY_SIZE(tabs);
         cs.pos(0, nre::VGAStream::ROWS - 1);
-        cs.color(i == 0 ? 0x17 : 0x71);
-        cs << nre::fmt("Scs", nre::VGAStream::COLS / 2);
-        cs.color(i == 1 ? 0x17 : 0x71);
-        cs << nre::fmt("Pds", nre::VGAStream::COLS / 2);
+        for(size_t t = 0; t < ARRAY_SIZE(tabs); ++t) {
+            cs.color(i == t ? 0x17 : 0x71);
+            // let the last one fill the rest of the line
+            cs << nre::fmt(tabs[t], t == ARRAY_SIZE(tabs) - 1
+                           ? nre::VGAStream::COLS - width * t : width);
+        }
+    }
+
+    /**
+     * Updates the copy of the system snapshot from the dataspace shared with root, if <update>
+     * is true. The dataspace is requested on the first call; afterwards, no IPC is required,
+     * unless root has no timer to refresh it periodically. In this case, we request it again
+     * when it is outdated, so that root refreshes it.
+     *
+     * @param update whether to update the copy
+     * @return the copy
+     */
+    const nre::SysInfo::Snapshot &snapshot(bool update) {
+        if(!_snapds) {
+            _snapds = _sysinfo.get_snapshot();
+            _snap = new nre::SysInfo::Snapshot();
+            update = true;
+        }
+        if(update) {
+            const nre::SysInfo::Snapshot *shared =
+                reinterpret_cast<const nre::SysInfo::Snapshot*>(_snapds->virt());
+            // give root's periodic refresh some slack before we ask for it
+            if(shared->outdated(nre::Util::tsc(), 2)) {
+                delete _snapds;
+                _snapds = _sysinfo.get_snapshot();
+                shared = reinterpret_cast<const nre::SysInfo::Snapshot*>(_snapds->virt());
+            }
+            shared->read(*_snap);
+        }
+        return *_snap;
     }
 
     const char *getname(const nre::String &name, size_t &len) {
+        return getname(name.str(), name.length(), len);
+    }
+    const char *getname(const char *name, size_t length, size_t &len) {
         // don't display the path to the program (might be long) and cut off arguments
-        size_t lastslash = 0, end = name.length();
-        for(size_t i = 0; i < name.length(); ++i) {
-            if(name.str()[i] == '/')
+        size_t lastslash = 0, end = length;
+        for(size_t i = 0; i < length; ++i) {
+            if(name[i] == '/')
                 lastslash = i + 1;
-            else if(name.str()[i] == ' ') {
+            else if(name[i] == ' ') {
                 end = i;
                 break;
             }
         }
         len = end - lastslash;
-        return name.str() + lastslash;
+        return name + lastslash;
     }
 
     size_t _left;
@@ -78,6 +117,8 @@ protected:
     nre::ConsoleSession &_cons;
     nre::SysInfoSession &_sysinfo;
     nre::UserSm _sm;
+    nre::DataSpace *_snapds;
+    nre::SysInfo::Snapshot *_snap;
 };
 
 class ScInfoPage : public SysInfoPage {
@@ -101,3 +142,38 @@ public:
     }
     virtual void refresh_console(bool update);
 };
+
+class SrvInfoPage : public SysInfoPage {
+    static const size_t MAX_SERVICES    = 32;
+    static const size_t MAX_CNT_LEN     = 11;
+    static const size_t MAX_LAT_LEN     = 9;
+
+    struct Entry {
+        nre::String name;
+        nre::DataSpace *ds;
+        bool seen;
+        uint64_t last[nre::ServiceStats::MAX_CMDS];
+        uint64_t rate[nre::ServiceStats::MAX_CMDS];
+
+        const nre::ServiceStats *stats() const {
+            return reinterpret_cast<const nre::ServiceStats*>(ds->virt());
+        }
+    };
+
+public:
+    explicit SrvInfoPage(nre::ConsoleSession &cons, nre::SysInfoSession &sysinfo)
+        : SysInfoPage(cons, sysinfo), _srvs(), _count(0), _last_tsc(nre::Util::tsc()) {
+    }
+    virtual void refresh_console(bool update);
+
+private:
+    void refresh_services();
+    Entry *find(const nre::String &name);
+    double to_us(uint64_t cycles) const {
+        return static_cast<double>(cycles) * 1000 / nre::Hip::get().freq_tsc;
+    }
+
+    Entry _srvs[MAX_SERVICES];
+    size_t _count;
+    uint64_t _last_tsc;
+};
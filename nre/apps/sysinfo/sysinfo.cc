@@ -29,7 +29,8 @@ static ConsoleSession cons("console", 0, "SysInfo");
 static size_t page = 0;
 static SysInfoPage *pages[] = {
     new ScInfoPage(cons, sysinfo),
-    new PdInfoPage(cons, sysinfo)
+    new PdInfoPage(cons, sysinfo),
+    new SrvInfoPage(cons, sysinfo)
 };
 
 static void input_thread(void*) {
@@ -86,12 +87,12 @@ static void input_thread(void*) {
 static void refresh_thread() {
     TimerSession timer("timer");
     Clock clock(1000);
-    while(1) {
-        timevalue_t next = clock.source_time(1000);
+    // refresh every second. the timer service re-arms the timer for us without drift
+    timer.init_timers(1);
+    timer.arm(0, clock.source_time(), clock.source_freq());
+    while(timer.expiries().get() != nullptr) {
+        timer.expiries().next();
         pages[page]->refresh_console(true);
-
-        // wait a second
-        timer.wait_until(next);
     }
 }
 
@@ -15,8 +15,11 @@
  */
 
 #include <mem/DataSpace.h>
+#include <mem/DataSpacePool.h>
+#include <mem/PagePool.h>
 #include <util/Profiler.h>
 #include <util/Util.h>
+#include <cstring>
 
 #include "DataSpaceTest.h"
 
@@ -26,11 +29,34 @@ using namespace nre::test;
 static const size_t DS_SIZE     = ExecEnv::PAGE_SIZE;
 static const size_t MAP_COUNT   = 10000;
 
+static const size_t POOL_COUNT  = 1000;
+static const size_t POOL_DEPTH  = 8;
+static const size_t SWITCH_MIN  = ExecEnv::PAGE_SIZE;
+static const size_t SWITCH_MAX  = 16 * 1024 * 1024;
+static const size_t SWITCH_COUNT = 16;
+static const size_t ZERO_COUNT  = 16;
+
 static void test_ds();
+static void test_dspool();
+static void test_dsswitch();
+static void test_pagepool();
+static void test_dszero();
 
 const TestCase dstest = {
     "DataSpace performance", test_ds
 };
+const TestCase dspooltest = {
+    "DataSpacePool", test_dspool
+};
+const TestCase dsswitchtest = {
+    "DataSpace switch", test_dsswitch
+};
+const TestCase pagepooltest = {
+    "PagePool", test_pagepool
+};
+const TestCase dszerotest = {
+    "DataSpace zeroing", test_dszero
+};
 static uint64_t alloc_times[MAP_COUNT];
 static uint64_t delete_times[MAP_COUNT];
 
@@ -85,3 +111,178 @@ static void test_ds() {
     WVPERF(alloc_avg, "cycles");
     WVPERF(delete_avg, "cycles");
 }
+
+static void test_dspool() {
+    DataSpacePool pool;
+    DataSpace *ds[POOL_DEPTH];
+
+    // sizes are rounded up to the size classes
+    ds[0] = pool.alloc(1);
+    WVPASSEQ(ds[0]->size(), ExecEnv::PAGE_SIZE);
+    ds[1] = pool.alloc(ExecEnv::PAGE_SIZE * 3);
+    WVPASSEQ(ds[1]->size(), ExecEnv::PAGE_SIZE * 4);
+    memset(reinterpret_cast<void*>(ds[1]->virt()), 0x12, ds[1]->size());
+    pool.free(ds[1]);
+    pool.free(ds[0]);
+    size_t cached = pool.cached();
+    WVPASS(cached >= 2);
+
+    // the same dataspace is handed out again
+    DataSpace *again = pool.alloc(ExecEnv::PAGE_SIZE * 4);
+    WVPASSEQPTR(again, ds[1]);
+    WVPASSEQ(*reinterpret_cast<uint*>(again->virt()), 0x12121212U);
+    pool.free(again);
+
+    // compare the costs of short-lived buffers with and without pool
+    AvgProfiler plain(POOL_COUNT), pooled(POOL_COUNT);
+    for(size_t i = 0; i < POOL_COUNT; ++i) {
+        plain.start();
+        for(size_t j = 0; j < POOL_DEPTH; ++j)
+            ds[j] = new DataSpace(DS_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+        for(size_t j = 0; j < POOL_DEPTH; ++j)
+            delete ds[j];
+        plain.stop();
+
+        pooled.start();
+        for(size_t j = 0; j < POOL_DEPTH; ++j)
+            ds[j] = pool.alloc(DS_SIZE);
+        for(size_t j = 0; j < POOL_DEPTH; ++j)
+            pool.free(ds[j]);
+        pooled.stop();
+    }
+    WVPRINT("Creating and destroying " << POOL_DEPTH << " dataspaces:");
+    WVPERF(plain.avg(), " cycles");
+    WVPRINT("With DataSpacePool:");
+    WVPERF(pooled.avg(), " cycles");
+
+    pool.flush();
+    WVPASSEQ(pool.cached(), static_cast<size_t>(0));
+}
+
+static void touch(const DataSpace &ds, uint value) {
+    uint *addr = reinterpret_cast<uint*>(ds.virt());
+    uint *end = reinterpret_cast<uint*>(ds.virt() + ds.size());
+    for(; addr < end; addr += ExecEnv::PAGE_SIZE / sizeof(uint))
+        *addr = value;
+}
+
+static void test_dsswitch() {
+    {
+        DataSpace ds1(SWITCH_MIN, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+        DataSpace ds2(SWITCH_MIN, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+        uint *mem1 = reinterpret_cast<uint*>(ds1.virt());
+        uint *mem2 = reinterpret_cast<uint*>(ds2.virt());
+
+        // by default, the contents are exchanged
+        *mem1 = 1;
+        *mem2 = 2;
+        ds1.switch_to(ds2);
+        WVPASSEQ(*mem1, 2U);
+        WVPASSEQ(*mem2, 1U);
+
+        // with SWITCH_COPY, the source keeps its content
+        ds1.switch_to(ds2, DataSpace::SWITCH_COPY);
+        WVPASSEQ(*mem1, 2U);
+        WVPASSEQ(*mem2, 2U);
+    }
+
+    for(size_t size = SWITCH_MIN; size <= SWITCH_MAX; size *= 4) {
+        DataSpace ds1(size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+        DataSpace ds2(size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+        AvgProfiler remap(SWITCH_COUNT), copy(SWITCH_COUNT);
+        for(size_t i = 0; i < SWITCH_COUNT; ++i) {
+            // map everything first to include the costs of the revoke
+            touch(ds1, i);
+            touch(ds2, i);
+            remap.start();
+            ds1.switch_to(ds2);
+            remap.stop();
+
+            touch(ds1, i);
+            touch(ds2, i);
+            copy.start();
+            ds1.switch_to(ds2, DataSpace::SWITCH_COPY);
+            copy.stop();
+        }
+        WVPRINT("Switching " << fmt(size, 9) << " bytes: " << fmt(remap.avg(), 10)
+                             << " cycles, with copy: " << fmt(copy.avg(), 10) << " cycles");
+        if(size == SWITCH_MIN) {
+            WVPERF(remap.avg(), " cycles");
+            WVPERF(copy.avg(), " cycles");
+        }
+    }
+}
+
+static void test_pagepool() {
+    PagePool pool;
+    uintptr_t pages[PagePool::CHUNK_PAGES + 1];
+
+    // one chunk is requested at once and the pages are distinct and usable
+    pages[0] = pool.alloc();
+    WVPASSEQ(pool.total(), PagePool::CHUNK_PAGES);
+    for(size_t i = 1; i < PagePool::CHUNK_PAGES; ++i) {
+        pages[i] = pool.alloc();
+        WVPASS(pages[i] != pages[i - 1]);
+        WVPASSEQ(pages[i] & (ExecEnv::PAGE_SIZE - 1), static_cast<uintptr_t>(0));
+        memset(reinterpret_cast<void*>(pages[i]), i, ExecEnv::PAGE_SIZE);
+    }
+    WVPASSEQ(pool.total(), PagePool::CHUNK_PAGES);
+    pages[PagePool::CHUNK_PAGES] = pool.alloc();
+    WVPASSEQ(pool.total(), PagePool::CHUNK_PAGES * 2);
+    WVPASSEQ(pool.used(), PagePool::CHUNK_PAGES + 1);
+
+    // freed pages are reused
+    pool.free(pages[1]);
+    WVPASSEQ(pool.alloc(), pages[1]);
+
+    AvgProfiler prof(POOL_COUNT);
+    for(size_t i = 0; i < POOL_COUNT; ++i) {
+        prof.start();
+        uintptr_t page = pool.alloc();
+        pool.free(page);
+        prof.stop();
+    }
+    WVPRINT("Allocating and freeing a page:");
+    WVPERF(prof.avg(), " cycles");
+
+    for(size_t i = 0; i <= PagePool::CHUNK_PAGES; ++i)
+        pool.free(pages[i]);
+    WVPASSEQ(pool.used(), static_cast<size_t>(0));
+}
+
+static void test_dszero() {
+    static const size_t sizes[] = {
+        ExecEnv::PAGE_SIZE, 64 * 1024, 1024 * 1024, 8 * 1024 * 1024
+    };
+    for(size_t s = 0; s < ARRAY_SIZE(sizes); ++s) {
+        AvgProfiler prof(ZERO_COUNT);
+        size_t nonzero = 0, notflagged = 0;
+        for(size_t i = 0; i < ZERO_COUNT; ++i) {
+            prof.start();
+            DataSpace *ds = new DataSpace(sizes[s], DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+            prof.stop();
+
+            if(!(ds->flags() & DataSpaceDesc::ZEROED))
+                notflagged++;
+            word_t *words = reinterpret_cast<word_t*>(ds->virt());
+            for(size_t w = 0; w < ds->size() / sizeof(word_t); ++w) {
+                if(words[w] != 0)
+                    nonzero++;
+            }
+            // dirty it, so that we notice if the memory is handed out again without zeroing
+            memset(words, 0xFF, ds->size());
+
+            // a joiner gets no guarantee about the content
+            if(i == 0) {
+                DataSpace joined(ds->sel());
+                WVPASS(!(joined.flags() & DataSpaceDesc::ZEROED));
+            }
+            delete ds;
+        }
+        WVPASSEQ(notflagged, static_cast<size_t>(0));
+        WVPASSEQ(nonzero, static_cast<size_t>(0));
+        WVPRINT("Creating " << sizes[s] << " bytes: " << prof.avg() << " cycles");
+        WVPRINT("min: " << prof.min());
+        WVPRINT("max: " << prof.max());
+    }
+}
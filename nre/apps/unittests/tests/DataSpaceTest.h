@@ -19,3 +19,7 @@
 #include <Test.h>
 
 extern const nre::test::TestCase dstest;
+extern const nre::test::TestCase dspooltest;
+extern const nre::test::TestCase dsswitchtest;
+extern const nre::test::TestCase pagepooltest;
+extern const nre::test::TestCase dszerotest;
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <ipc/Service.h>
+#include <ipc/ClientSession.h>
+#include <subsystem/ChildManager.h>
+
+#include "ImageTest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+class CowService;
+static void test_cow();
+
+const TestCase imagecowtest = {
+    "Copy-on-write childs from an image", test_cow
+};
+
+static const int INITIAL = 0x1234;
+static const int CHANGED = 0x5678;
+
+// lives in the data segment, i.e. it is mapped copy-on-write into all childs of the image
+static int cow_value = INITIAL;
+static CowService *srv;
+
+class CowSession : public ServiceSession {
+public:
+    explicit CowSession(Service *s, size_t id, portal_func func)
+        : ServiceSession(s, id, func) {
+    }
+    virtual ~CowSession();
+};
+
+class CowService : public Service {
+public:
+    explicit CowService(portal_func func) : Service("cowtest", CPUSet(CPUSet::ALL), func) {
+    }
+
+private:
+    virtual ServiceSession *create_session(size_t id, const String&, portal_func func) {
+        return new CowSession(this, id, func);
+    }
+};
+
+CowSession::~CowSession() {
+    srv->stop();
+}
+
+PORTAL static void portal_empty(void*) {
+}
+
+static int cow_writer(int, char *[]) {
+    WVPASSEQ(cow_value, INITIAL);
+    cow_value = CHANGED;
+    WVPASSEQ(cow_value, CHANGED);
+
+    // stay alive with our private copy until the reader is done
+    srv = new CowService(portal_empty);
+    srv->start();
+    delete srv;
+
+    WVPASSEQ(cow_value, CHANGED);
+    return 0;
+}
+
+static int cow_reader(int, char *[]) {
+    // the writer has changed its copy of the page, but neither the template nor we see that
+    WVPASSEQ(cow_value, INITIAL);
+    ClientSession sess("cowtest");
+    return 0;
+}
+
+static int cow_reader_late(int, char *[]) {
+    WVPASSEQ(cow_value, INITIAL);
+    return 0;
+}
+
+static void test_cow() {
+    ChildManager *mng = new ChildManager();
+    Hip::mem_iterator self = Hip::get().mem_begin();
+    // map the memory of the module
+    DataSpace ds(self->size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::R, self->addr);
+    ChildManager::Image *img = mng->create_image(ds.virt(), self->size);
+    {
+        // this waits until the service is registered, i.e. until the writer has changed its copy
+        ChildConfig cfg(0, "cow-writer provides=cowtest");
+        cfg.entry(reinterpret_cast<uintptr_t>(cow_writer));
+        mng->load(*img, cfg);
+    }
+    {
+        ChildConfig cfg(0, "cow-reader");
+        cfg.entry(reinterpret_cast<uintptr_t>(cow_reader));
+        mng->load(*img, cfg);
+    }
+    while(mng->count() > 0)
+        mng->dead_sm().down();
+
+    // a child that is started afterwards gets the pristine template as well
+    {
+        ChildConfig cfg(0, "cow-check");
+        cfg.entry(reinterpret_cast<uintptr_t>(cow_reader_late));
+        mng->load(*img, cfg);
+    }
+    while(mng->count() > 0)
+        mng->dead_sm().down();
+    mng->destroy_image(img);
+    delete mng;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/LZ4.h>
+#include <cstring>
+
+#include "LZ4Test.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_decompress();
+static void test_stream();
+
+const TestCase lz4_decompress = {
+    "LZ4 decompress", test_decompress
+};
+const TestCase lz4_stream = {
+    "LZ4 streaming decompress", test_stream
+};
+
+// created by "lz4" with the default settings
+static const uint8_t frame[] = {
+    0x04, 0x22, 0x4d, 0x18, 0x64, 0x40, 0xa7, 0x31, 0x00, 0x00, 0x00, 0xff,
+    0x0e, 0x6c, 0x69, 0x6e, 0x65, 0x20, 0x31, 0x20, 0x73, 0x6f, 0x6d, 0x65,
+    0x20, 0x72, 0x65, 0x70, 0x65, 0x74, 0x69, 0x74, 0x69, 0x76, 0x65, 0x20,
+    0x74, 0x65, 0x78, 0x74, 0x20, 0x61, 0x01, 0x00, 0x00, 0x11, 0x0a, 0x31,
+    0x00, 0x1f, 0x32, 0x31, 0x00, 0x15, 0x50, 0x61, 0x61, 0x0a, 0x6c, 0x69,
+    0x00, 0x00, 0x00, 0x00, 0xd7, 0x16, 0x47, 0x0b,
+};
+static const char *content =
+    "line 1 some repetitive text aaaaaaaaaaaaaaaaaaaa\n"
+    "line 2 some repetitive text aaaaaaaaaaaaaaaaaaaa\n"
+    "li";
+
+/**
+ * Collects the data and checks that it repeats "ab", followed by a "c"
+ */
+class PatternSink : public LZ4::Sink {
+public:
+    explicit PatternSink() : _calls(), _count(), _errors() {
+    }
+
+    size_t calls() const {
+        return _calls;
+    }
+    size_t count() const {
+        return _count;
+    }
+    size_t errors() const {
+        return _errors;
+    }
+
+    virtual void write(const void *data, size_t len) {
+        const char *bytes = static_cast<const char*>(data);
+        for(size_t i = 0; i < len; ++i, ++_count) {
+            if(bytes[i] != ((_count % 2) ? 'b' : 'a') && bytes[i] != 'c')
+                _errors++;
+        }
+        _calls++;
+    }
+
+private:
+    size_t _calls;
+    size_t _count;
+    size_t _errors;
+};
+
+static void test_decompress() {
+    char buf[128];
+    size_t len = strlen(content);
+    WVPASS(LZ4::is_compressed(frame, sizeof(frame)));
+    WVPASS(!LZ4::is_compressed(content, len));
+    WVPASSEQ(LZ4::decompressed_size(frame, sizeof(frame)), static_cast<uint64_t>(len));
+    WVPASSEQ(LZ4::decompress(frame, sizeof(frame), buf, sizeof(buf)), len);
+    WVPASSEQ(memcmp(buf, content, len), 0);
+
+    // the buffer is too small
+    try {
+        LZ4::decompress(frame, sizeof(frame), buf, len - 1);
+        WVPASS(false);
+    }
+    catch(const LZ4Exception &e) {
+        WVPASSEQ(e.code(), E_CAPACITY);
+    }
+
+    // truncated data
+    try {
+        LZ4::decompress(frame, sizeof(frame) - 20, buf, sizeof(buf));
+        WVPASS(false);
+    }
+    catch(const LZ4Exception &e) {
+        WVPASSEQ(e.code(), E_ARGS_INVALID);
+    }
+}
+
+static void test_stream() {
+    // build a frame with a match that is much longer than the window, so that the decoder has
+    // to slide multiple times within one match
+    static const size_t MATCH_LEN = 200000;
+    static uint8_t data[1024];
+    uint8_t *p = data;
+    const uint8_t header[] = {0x04, 0x22, 0x4d, 0x18, 0x60, 0x40, 0x00};
+    memcpy(p, header, sizeof(header));
+    p += sizeof(header);
+    uint8_t *bsize = p;
+    p += 4;
+    uint8_t *block = p;
+    // 2 literals and an extended match length
+    *p++ = 0x2F;
+    *p++ = 'a';
+    *p++ = 'b';
+    *p++ = 0x02;
+    *p++ = 0x00;
+    size_t rem = MATCH_LEN - 4 - 15;
+    for(; rem >= 255; rem -= 255)
+        *p++ = 255;
+    *p++ = rem;
+    // last sequence: one literal
+    *p++ = 0x10;
+    *p++ = 'c';
+    size_t size = p - block;
+    bsize[0] = size;
+    bsize[1] = size >> 8;
+    bsize[2] = 0;
+    bsize[3] = 0;
+    // end mark
+    memset(p, 0, 4);
+    p += 4;
+
+    PatternSink sink;
+    uint64_t res = LZ4::decompress(data, p - data, sink);
+    WVPASSEQ(res, static_cast<uint64_t>(MATCH_LEN + 3));
+    WVPASSEQ(sink.count(), MATCH_LEN + 3);
+    WVPASSEQ(sink.errors(), static_cast<size_t>(0));
+    WVPASS(sink.calls() > 1);
+}
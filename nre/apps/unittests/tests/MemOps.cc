@@ -14,8 +14,12 @@
  * General Public License version 2 for more details.
  */
 
+#include <arch/ExecEnv.h>
+#include <mem/DataSpace.h>
+#include <util/MemOps.h>
 #include <util/Profiler.h>
-#include <cstdlib>
+#include <util/Math.h>
+#include <cstring>
 
 #include "MemOps.h"
 
@@ -26,6 +30,7 @@ typedef void (*memop_func)(void *a, void *b, size_t len);
 
 static void test_memcpy();
 static void test_memset();
+static void test_memcmp();
 static void do_test(const char *name, memop_func func);
 
 const TestCase memcpytest = {
@@ -34,9 +39,18 @@ const TestCase memcpytest = {
 const TestCase memsettest = {
     "Memory operations", test_memset
 };
+const TestCase memcmptest = {
+    "Memory operations", test_memcmp
+};
 
-static const size_t AREA_SIZE   = 4096;
-static const uint TEST_COUNT    = 1000;
+static const size_t MIN_SIZE    = 16;
+static const size_t MAX_SIZE    = 16 * 1024 * 1024;
+// the number of bytes to process per size; at least MIN_COUNT and at most MAX_COUNT runs
+static const size_t TOTAL_SIZE  = 64 * 1024 * 1024;
+static const uint MIN_COUNT     = 4;
+static const uint MAX_COUNT     = 1000;
+// the size of which the cycles are reported via WVPERF
+static const size_t PERF_SIZE   = 4096;
 
 static void memcpy_func(void *a, void *b, size_t len) {
     memcpy(a, const_cast<const void*>(b), len);
@@ -44,6 +58,11 @@ static void memcpy_func(void *a, void *b, size_t len) {
 static void memset_func(void *a, void *, size_t len) {
     memset(a, 0, len);
 }
+static void memcmp_func(void *a, void *b, size_t len) {
+    // the areas are equal, so that memcmp has to walk through all bytes
+    volatile int res = memcmp(a, b, len);
+    static_cast<void>(res);
+}
 
 static void test_memcpy() {
     do_test("memcpy", memcpy_func);
@@ -51,37 +70,100 @@ static void test_memcpy() {
 static void test_memset() {
     do_test("memset", memset_func);
 }
+static void test_memcmp() {
+    do_test("memcmp", memcmp_func);
+}
 
-static void do_test(const char *name, memop_func func) {
-    void *mem = malloc(AREA_SIZE);
-    void *buf = malloc(AREA_SIZE);
-
-    {
-        WVPRINT("Testing aligned " << name << " with " << AREA_SIZE << " bytes");
-        AvgProfiler prof(TEST_COUNT);
-        for(uint i = 0; i < TEST_COUNT; ++i) {
-            prof.start();
-            func(buf, mem, AREA_SIZE);
-            prof.stop();
-        }
-        WVPERF(prof.avg(), " cycles");
-        WVPRINT("min: " << prof.min());
-        WVPRINT("max: " << prof.max());
+static void check_variant(char *a, char *b) {
+    // a few sizes around the boundaries of the different paths, unaligned
+    static const size_t sizes[] = {
+        7, MemOps::SMALL_SIZE - 1, MemOps::SMALL_SIZE + 1, 1000, MemOps::NT_SIZE + 3
+    };
+    for(size_t i = 0; i < ARRAY_SIZE(sizes); ++i) {
+        for(size_t j = 0; j < sizes[i]; ++j)
+            a[j + 1] = j;
+        memset(b + 3, 0xFF, sizes[i]);
+        memcpy(b + 3, a + 1, sizes[i]);
+        WVPASSEQ(memcmp(b + 3, a + 1, sizes[i]), 0);
+        b[3 + sizes[i] - 1]++;
+        WVPASSEQ(memcmp(a + 1, b + 3, sizes[i]), -1);
+    }
+
+    // memset at the boundaries of the paths, unaligned, without touching the neighbours
+    static const size_t setsizes[] = {
+        MemOps::SMALL_SIZE - 1, MemOps::SMALL_SIZE, MemOps::SMALL_SIZE + 1,
+        MemOps::NT_SIZE - 1, MemOps::NT_SIZE, MemOps::NT_SIZE + 1
+    };
+    for(size_t i = 0; i < ARRAY_SIZE(setsizes); ++i) {
+        size_t len = setsizes[i];
+        memset(a, 0x11, len + 8);
+        memset(a + 3, 0xAB, len);
+        bool ok = a[2] == 0x11 && a[len + 3] == 0x11;
+        for(size_t j = 0; ok && j < len; ++j)
+            ok = static_cast<uchar>(a[j + 3]) == 0xAB;
+        WVPASS(ok);
     }
 
-    {
-        WVPRINT("Testing unaligned " << name << " with " << AREA_SIZE << " bytes");
-        AvgProfiler prof(TEST_COUNT);
-        for(uint i = 0; i < TEST_COUNT; ++i) {
-            prof.start();
-            func(reinterpret_cast<char*>(buf) + 1, reinterpret_cast<char*>(mem) + 1, AREA_SIZE - 2);
-            prof.stop();
+    // overlapping memmove in both directions with all distances up to two AVX2 moves
+    static const size_t MOVE_LEN = 200;
+    for(size_t dist = 1; dist <= 33; ++dist) {
+        for(int down = 0; down < 2; ++down) {
+            for(size_t j = 0; j < MOVE_LEN + dist + 8; ++j)
+                a[j] = j * 7 + dist;
+            size_t src = down ? 1 + dist : 1;
+            size_t dst = down ? 1 : 1 + dist;
+            memmove(a + dst, a + src, MOVE_LEN);
+            bool ok = true;
+            for(size_t j = 0; ok && j < MOVE_LEN + dist + 8; ++j) {
+                char exp = j >= dst && j < dst + MOVE_LEN ? (j - dst + src) * 7 + dist
+                                                          : j * 7 + dist;
+                ok = a[j] == exp;
+            }
+            WVPASS(ok);
         }
-        WVPERF(prof.avg(), " cycles");
-        WVPRINT("min: " << prof.min());
-        WVPRINT("max: " << prof.max());
     }
 
-    free(buf);
-    free(mem);
+    // the benchmark for memcmp expects equal areas
+    memset(a, 0, MemOps::NT_SIZE + 8);
+    memset(b, 0, MemOps::NT_SIZE + 8);
+}
+
+static void do_test(const char *name, memop_func func) {
+    DataSpace ds1(MAX_SIZE + ExecEnv::PAGE_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+    DataSpace ds2(MAX_SIZE + ExecEnv::PAGE_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+    char *mem = reinterpret_cast<char*>(ds1.virt());
+    char *buf = reinterpret_cast<char*>(ds2.virt());
+    memset(mem, 0, MAX_SIZE + ExecEnv::PAGE_SIZE);
+    memset(buf, 0, MAX_SIZE + ExecEnv::PAGE_SIZE);
+
+    MemOps::Variant best = MemOps::current();
+    for(int v = 0; v < MemOps::COUNT; ++v) {
+        MemOps::Variant var = static_cast<MemOps::Variant>(v);
+        if(!MemOps::select(var)) {
+            WVPRINT("Variant " << MemOps::name(var) << " is not supported");
+            continue;
+        }
+        check_variant(mem, buf);
+
+        for(int unaligned = 0; unaligned < 2; ++unaligned) {
+            WVPRINT("Testing " << (unaligned ? "unaligned " : "aligned ") << name
+                               << " (" << MemOps::name(var) << "):");
+            for(size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+                size_t len = unaligned ? size - 2 : size;
+                uint count = Math::max<uint>(MIN_COUNT, Math::min<size_t>(MAX_COUNT, TOTAL_SIZE / size));
+                AvgProfiler prof(count);
+                for(uint i = 0; i < count; ++i) {
+                    prof.start();
+                    func(buf + unaligned, mem + unaligned, len);
+                    prof.stop();
+                }
+                if(var == best && size == PERF_SIZE)
+                    WVPERF(prof.avg(), " cycles");
+                WVPRINT(fmt(len, 8) << " bytes: " << fmt(prof.avg(), 10) << " cycles (min "
+                                    << prof.min() << ", max " << prof.max() << "), "
+                                    << (static_cast<double>(len) / prof.avg()) << " bytes/cycle");
+            }
+        }
+    }
+    MemOps::select(best);
 }
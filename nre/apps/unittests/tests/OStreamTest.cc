@@ -15,6 +15,7 @@
  */
 
 #include <stream/OStringStream.h>
+#include <util/Profiler.h>
 #include <util/Float.h>
 
 #include "OStreamTest.h"
@@ -24,6 +25,7 @@ using namespace nre::test;
 
 static void test_writef();
 static void test_stream_ops();
+static void test_perf();
 
 const TestCase ostream_writef = {
     "OStream writef", test_writef
@@ -31,6 +33,11 @@ const TestCase ostream_writef = {
 const TestCase ostream_strops = {
     "OStream stream operators", test_stream_ops
 };
+const TestCase ostream_perf = {
+    "OStream formatting performance", test_perf
+};
+
+static const size_t PERF_COUNT  = 10000;
 
 #define STREAM_CHECK(expr, expstr) do {                                                     \
         OStringStream __os(str, sizeof(str));                                               \
@@ -167,3 +174,51 @@ static void test_stream_ops() {
     STREAM_CHECK(Float<double>::inf() << ", " << -Float<double>::inf(), "inf, -inf");
     STREAM_CHECK(Float<double>::nan() << ", " << -Float<double>::nan(), "nan, -nan");
 }
+
+static void test_perf() {
+    char str[256];
+    {
+        // a typical log line with strings, decimal, hexadecimal and padded numbers
+        AvgProfiler prof(PERF_COUNT);
+        for(size_t i = 0; i < PERF_COUNT; ++i) {
+            OStringStream os(str, sizeof(str));
+            prof.start();
+            os << "Child 'storage' requests " << fmt(i * 4096, "#0x", 8) << " on cpu " << i % 4
+               << " (" << static_cast<ullong>(i) * 123456789ULL << " bytes, "
+               << fmt(-static_cast<llong>(i), 12) << ")\n";
+            prof.stop();
+        }
+        WVPRINT("Mixed line:");
+        WVPERF(prof.avg(), "cycles");
+        WVPRINT("min: " << prof.min());
+        WVPRINT("max: " << prof.max());
+    }
+    {
+        AvgProfiler prof(PERF_COUNT);
+        for(size_t i = 0; i < PERF_COUNT; ++i) {
+            OStringStream os(str, sizeof(str));
+            prof.start();
+            for(ullong n = i; n < i + 16; ++n)
+                os << n * 1000003ULL << ' ';
+            prof.stop();
+        }
+        WVPRINT("16 decimal integers:");
+        WVPERF(prof.avg(), "cycles");
+        WVPRINT("min: " << prof.min());
+        WVPRINT("max: " << prof.max());
+    }
+    {
+        AvgProfiler prof(PERF_COUNT);
+        for(size_t i = 0; i < PERF_COUNT; ++i) {
+            OStringStream os(str, sizeof(str));
+            prof.start();
+            os.writef("%s: %08lx %lu %10s|%-6d|\n", "writef", static_cast<ulong>(i),
+                      static_cast<ulong>(i) * 7, "pad", static_cast<int>(i));
+            prof.stop();
+        }
+        WVPRINT("writef:");
+        WVPERF(prof.avg(), "cycles");
+        WVPRINT("min: " << prof.min());
+        WVPRINT("max: " << prof.max());
+    }
+}
@@ -20,3 +20,4 @@
 
 extern const nre::test::TestCase ostream_writef;
 extern const nre::test::TestCase ostream_strops;
+extern const nre::test::TestCase ostream_perf;
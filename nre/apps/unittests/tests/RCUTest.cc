@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <kobj/GlobalThread.h>
+#include <kobj/Sm.h>
+#include <util/Atomic.h>
+#include <util/ScopedLock.h>
+#include <RCU.h>
+#include <CPU.h>
+
+#include "RCUTest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_rcuperf();
+
+const TestCase rcuperf = {
+    "RCU reader scalability", test_rcuperf
+};
+
+static const size_t READS = 100000;
+static const uint MAGIC = 0x12345678;
+
+class RCUTestObj : public RCUObject {
+public:
+    explicit RCUTestObj() : RCUObject(), value(MAGIC) {
+    }
+    virtual ~RCUTestObj() {
+        value = 0;
+    }
+
+    uint value;
+};
+
+struct Reader {
+    uint64_t cycles;
+    size_t errors;
+};
+
+static RCUTestObj *shared;
+static Sm *done;
+static size_t finished;
+
+static void reader(void*) {
+    Reader *r = Thread::current()->get_tls<Reader*>(Thread::TLS_PARAM);
+    uint64_t begin = Util::tsc();
+    for(size_t i = 0; i < READS; ++i) {
+        ScopedLock<RCULock> guard(&RCU::lock());
+        RCUTestObj *o = rcu_dereference(shared);
+        if(o->value != MAGIC)
+            r->errors++;
+    }
+    r->cycles = Util::tsc() - begin;
+    Atomic::add(&finished, +1);
+    done->up();
+}
+
+static uint64_t run_readers(size_t n, bool write, size_t &errors) {
+    Reader *readers = new Reader[n]();
+    finished = 0;
+    for(size_t i = 0; i < n; ++i) {
+        Reference<GlobalThread> gt = GlobalThread::create(reader, i, "rcu-reader");
+        gt->set_tls<Reader*>(Thread::TLS_PARAM, readers + i);
+        gt->start();
+    }
+
+    // replace the object as fast as possible while the readers are running
+    size_t updates = 0;
+    while(write && ACCESS_ONCE(finished) < n) {
+        RCUTestObj *old = shared;
+        rcu_assign_pointer(shared, new RCUTestObj());
+        RCU::invalidate(old);
+        updates++;
+    }
+
+    uint64_t cycles = 0;
+    for(size_t i = 0; i < n; ++i) {
+        done->down();
+        cycles += readers[i].cycles;
+        errors += readers[i].errors;
+    }
+    if(write)
+        WVPRINT("Did " << updates << " updates");
+    delete[] readers;
+    return cycles / (n * READS);
+}
+
+static void test_rcuperf() {
+    done = new Sm(0);
+    shared = new RCUTestObj();
+
+    size_t errors = 0;
+    uint64_t per_section = 0;
+    for(size_t n = 1; n <= CPU::count(); ++n) {
+        per_section = run_readers(n, false, errors);
+        WVPRINT(n << " CPUs: " << per_section << " cycles per read section");
+    }
+    WVPERF(per_section, "cycles per read section on all CPUs");
+
+    per_section = run_readers(CPU::count(), true, errors);
+    WVPRINT(CPU::count() << " CPUs with writer: " << per_section << " cycles per read section");
+    WVPASSEQ(errors, static_cast<size_t>(0));
+
+    RCUTestObj *old = shared;
+    rcu_assign_pointer(shared, nullptr);
+    RCU::invalidate(old);
+    RCU::gc(true);
+    delete done;
+}
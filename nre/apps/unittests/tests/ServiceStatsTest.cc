@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <ipc/Service.h>
+#include <kobj/GlobalThread.h>
+#include <services/SysInfo.h>
+#include <CPU.h>
+#include <cstring>
+
+#include "ServiceStatsTest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_stats();
+
+const TestCase servicestats = {
+    "Join service statistics", test_stats
+};
+
+static const size_t MAX_TRIES   = 100000;
+static Service *srv;
+
+PORTAL static void portal_empty(void*) {
+}
+
+static void service_thread(void*) {
+    srv->start();
+}
+
+static void test_stats() {
+    srv = new Service("statstest", CPUSet(CPUSet::ALL), portal_empty);
+    srv->stats_ring("testring", 16);
+    Reference<GlobalThread> gt = GlobalThread::create(service_thread, CPU::current().log_id(),
+                                                      "statstest");
+    gt->start();
+
+    // the statistics are available as soon as the service is registered. the dataspace is
+    // joined at our parent, which has to know it although another child (we) created it.
+    SysInfoSession sysinfo("sysinfo");
+    DataSpace *ds = nullptr;
+    for(size_t i = 0; !ds && i < MAX_TRIES; ++i) {
+        try {
+            ds = sysinfo.get_service_stats("statstest");
+        }
+        catch(const Exception &e) {
+            WVPRINT("Joining the statistics failed: " << e.msg());
+            break;
+        }
+    }
+    WVPASS(ds != nullptr);
+    if(ds) {
+        const ServiceStats *stats = reinterpret_cast<const ServiceStats*>(ds->virt());
+        WVPASSEQ(strcmp(stats->name(), "statstest"), 0);
+        delete ds;
+    }
+
+    srv->stop();
+    gt->join();
+    delete srv;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <ipc/Service.h>
+#include <ipc/PtClientSession.h>
+#include <subsystem/ChildManager.h>
+#include <kobj/GlobalThread.h>
+#include <kobj/Pt.h>
+#include <stream/IStringStream.h>
+#include <stream/OStringStream.h>
+#include <utcb/UtcbFrame.h>
+#include <util/Profiler.h>
+#include <util/Atomic.h>
+#include <CPU.h>
+#include <cstring>
+
+#include "ServiceThreads.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_servicethreads();
+
+const TestCase servicethreads = {
+    "Service with multiple threads per CPU", test_servicethreads
+};
+
+// the number of clients that issue short requests concurrently to one long-running request
+static const size_t CLIENTS         = 3;
+static const uint TEST_COUNT        = 100;
+static const uint64_t SLOW_CYCLES   = 20000000;
+
+class WorkerService;
+static WorkerService *srv;
+static volatile bool fast_done;
+static size_t fast_finished;
+
+class WorkerSession : public ServiceSession {
+public:
+    explicit WorkerSession(Service *s, size_t id, portal_func func) : ServiceSession(s, id, func) {
+    }
+    virtual ~WorkerSession();
+};
+
+class WorkerService : public Service {
+public:
+    explicit WorkerService(size_t threads, portal_func func)
+        : Service("svcthreads", CPUSet(CPUSet::ALL), func, threads), closed() {
+    }
+
+    virtual ServiceSession *create_session(size_t id, const String &, portal_func func) {
+        return new WorkerSession(this, id, func);
+    }
+
+    size_t closed;
+};
+
+WorkerSession::~WorkerSession() {
+    if(Atomic::add(&srv->closed, +1) + 1 == CLIENTS + 1)
+        srv->stop();
+}
+
+PORTAL static void portal_work(void*) {
+    UtcbFrameRef uf;
+    uint64_t cycles;
+    uf >> cycles;
+    uf.clear();
+    // simulate a request that takes some time, e.g. a PIO transfer
+    uint64_t end = Util::tsc() + cycles;
+    while(Util::tsc() < end)
+        ;
+}
+
+static int svcthreads_server(int argc, char *argv[]) {
+    size_t threads = 1;
+    for(int i = 1; i < argc; ++i) {
+        if(strncmp(argv[i], "threads=", 8) == 0)
+            threads = IStringStream::read_from<size_t>(String(argv[i] + 8, strlen(argv[i] + 8)));
+    }
+    srv = new WorkerService(threads, portal_work);
+    srv->start();
+    delete srv;
+    return 0;
+}
+
+static void slow_client(void*) {
+    PtClientSession sess("svcthreads");
+    while(!fast_done) {
+        UtcbFrame uf;
+        uf << SLOW_CYCLES;
+        sess.pt(CPU::current().log_id()).call(uf);
+    }
+}
+
+static void fast_client(void*) {
+    PtClientSession sess("svcthreads");
+    AvgProfiler prof(TEST_COUNT);
+    for(uint i = 0; i < TEST_COUNT; ++i) {
+        UtcbFrame uf;
+        uf << static_cast<uint64_t>(0);
+        prof.start();
+        sess.pt(CPU::current().log_id()).call(uf);
+        prof.stop();
+    }
+    WVPERF(prof.avg(), " cycles");
+    WVPRINT("min: " << prof.min());
+    WVPRINT("max: " << prof.max());
+    if(Atomic::add(&fast_finished, +1) + 1 == CLIENTS)
+        fast_done = true;
+}
+
+static int svcthreads_client(int, char *[]) {
+    // all clients run on the same CPU, so that they compete for the service-threads on that CPU
+    cpu_t cpu = CPU::current().log_id();
+    Reference<GlobalThread> slow = GlobalThread::create(slow_client, cpu, "slow-client");
+    slow->start();
+    Reference<GlobalThread> *gts = new Reference<GlobalThread>[CLIENTS];
+    for(size_t i = 0; i < CLIENTS; ++i) {
+        gts[i] = GlobalThread::create(fast_client, cpu, "fast-client");
+        gts[i]->start();
+    }
+    for(size_t i = 0; i < CLIENTS; ++i)
+        gts[i]->join();
+    slow->join();
+    delete[] gts;
+    return 0;
+}
+
+static void run_bench(size_t threads) {
+    fast_done = false;
+    fast_finished = 0;
+    WVPRINT("Using " << threads << " thread(s) per CPU for " << CLIENTS
+                     << " clients next to one long-running request:");
+
+    ChildManager *mng = new ChildManager();
+    Hip::mem_iterator self = Hip::get().mem_begin();
+    // map the memory of the module
+    DataSpace ds(self->size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::R, self->addr);
+    {
+        OStringStream os;
+        os << "svcthreads-service provides=svcthreads threads=" << threads;
+        ChildConfig cfg(0, os.str());
+        cfg.entry(reinterpret_cast<uintptr_t>(svcthreads_server));
+        mng->load(ds.virt(), self->size, cfg);
+    }
+    {
+        ChildConfig cfg(0, "svcthreads-client");
+        cfg.entry(reinterpret_cast<uintptr_t>(svcthreads_client));
+        mng->load(ds.virt(), self->size, cfg);
+    }
+    while(mng->count() > 0)
+        mng->dead_sm().down();
+    delete mng;
+}
+
+static void test_servicethreads() {
+    run_bench(1);
+    run_bench(CLIENTS + 1);
+}
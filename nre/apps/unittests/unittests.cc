@@ -37,8 +37,13 @@
 #include "tests/OStreamTest.h"
 #include "tests/SListTreapTest.h"
 #include "tests/Sessions.h"
+#include "tests/ServiceThreads.h"
 #include "tests/ProducerConsumer.h"
 #include "tests/ThreadRefs.h"
+#include "tests/LZ4Test.h"
+#include "tests/RCUTest.h"
+#include "tests/ImageTest.h"
+#include "tests/ServiceStatsTest.h"
 
 using namespace nre;
 using namespace nre::test;
@@ -46,6 +51,7 @@ using namespace nre::test;
 const TestCase testcases[] = {
     memcpytest,
     memsettest,
+    memcmptest,
     threads,
     pingpong,
     pingpongxpd,
@@ -54,6 +60,11 @@ const TestCase testcases[] = {
     utcbnest,
     utcbperf,
     dstest,
+    dspooltest,
+    dsswitchtest,
+    pagepooltest,
+    imagecowtest,
+    dszerotest,
     slisttest,
     sortedslisttest,
     dlisttest,
@@ -73,9 +84,15 @@ const TestCase testcases[] = {
     slisttreaptest_perf,
     ostream_writef,
     ostream_strops,
+    ostream_perf,
     sessions,
+    servicethreads,
+    servicestats,
     prodcons,
     threadrefs,
+    lz4_decompress,
+    lz4_stream,
+    rcuperf,
 };
 
 int main() {
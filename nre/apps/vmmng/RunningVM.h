@@ -29,6 +29,9 @@ public:
         : nre::SListItem(), _cfg(cfg), _console(console), _id(id), _pd(pd), _prod() {
     }
 
+    VMConfig *cfg() {
+        return _cfg;
+    }
     const VMConfig *cfg() const {
         return _cfg;
     }
@@ -44,9 +44,13 @@ Child::id_type VMConfig::start(ChildManager &cm, size_t console, cpu_t cpu) {
     os << first->args() << " console:" << console << " constitle:" << _name;
 
     VMChildConfig cfg(_mods, args, cpu);
-    Hip::mem_iterator mod = get_module(first->name());
-    DataSpace ds(mod->size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::R, mod->addr);
-    return cm.load(ds.virt(), mod->size, cfg);
+    if(!_image) {
+        Hip::mem_iterator mod = get_module(first->name());
+        DataSpace ds(mod->size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::R, mod->addr);
+        _image = cm.create_image(ds.virt(), mod->size);
+        _cm = &cm;
+    }
+    return cm.load(*_image, cfg);
 }
 
 Hip::mem_iterator VMConfig::get_module(const String &name) {
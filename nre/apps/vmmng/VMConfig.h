@@ -71,10 +71,12 @@ class VMConfig : public nre::SListItem {
 public:
     explicit VMConfig(uintptr_t phys, size_t size, const char *name)
         : nre::SListItem(), _ds(size, nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::R, phys),
-          _name(name), _mods() {
+          _name(name), _mods(), _cm(), _image() {
         find_mods(size);
     }
     ~VMConfig() {
+        if(_image)
+            _cm->destroy_image(_image);
         for(auto it = _mods.begin(); it != _mods.end(); ) {
             auto old = it++;
             delete &*old;
@@ -88,6 +90,10 @@ public:
         auto first = _mods.cbegin();
         return first->args();
     }
+    /**
+     * Starts a new VM with this config. The first call prepares the image of the VMM, so that all
+     * further VMs share its read-only parts and get the writable parts copy-on-write.
+     */
     nre::Child::id_type start(nre::ChildManager &cm, size_t console, cpu_t cpu);
 
 private:
@@ -97,4 +103,6 @@ private:
     nre::DataSpace _ds;
     const char *_name;
     nre::SList<Module> _mods;
+    nre::ChildManager *_cm;
+    nre::ChildManager::Image *_image;
 };
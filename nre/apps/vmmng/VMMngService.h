@@ -69,12 +69,8 @@ class VMMngService : public nre::Service {
     explicit VMMngService(const char *name)
         : Service(name, nre::CPUSet(nre::CPUSet::ALL), reinterpret_cast<portal_func>(portal)) {
         // we want to accept one dataspaces and pd-translations
-        for(auto it = nre::CPU::begin(); it != nre::CPU::end(); ++it) {
-            nre::Reference<nre::LocalThread> ec = get_thread(it->log_id());
-            nre::UtcbFrameRef uf(ec->utcb());
-            uf.accept_translates();
-            uf.accept_delegates(1);
-        }
+        accept_translates();
+        accept_delegates(1);
     }
 
 public:
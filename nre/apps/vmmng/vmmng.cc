@@ -76,7 +76,7 @@ static void refresh_console() {
         if(vmidx == i)
             cs.color(oldcol);
     }
-    cs << "\nPress R to reset or K to kill the selected VM";
+    cs << "\nPress R to reset, K to kill or C to clone the selected VM";
 }
 
 static void input_thread(void*) {
@@ -110,6 +110,30 @@ static void input_thread(void*) {
             }
             break;
 
+            case Keyboard::VK_C: {
+                if(pk->flags & Keyboard::RELEASE) {
+                    VMConfig *cfg = nullptr;
+                    {
+                        ScopedLock<UserSm> guard(&sm);
+                        RunningVM *vm = vml.get(vmidx);
+                        if(vm)
+                            cfg = vm->cfg();
+                    }
+                    if(cfg) {
+                        try {
+                            timevalue_t start = Util::tsc();
+                            vml.add(cm, cfg, cpucyc.next()->log_id());
+                            Serial::get() << "Cloned '" << cfg->name() << "' in "
+                                          << (Util::tsc() - start) << " cycles\n";
+                        }
+                        catch(const Exception &e) {
+                            Serial::get() << "Clone of '" << cfg->name() << "' failed: " << e.msg() << "\n";
+                        }
+                    }
+                }
+            }
+            break;
+
             case Keyboard::VK_UP:
                 if((~pk->flags & Keyboard::RELEASE) && vmidx > 0) {
                     vmidx--;
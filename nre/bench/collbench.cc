@@ -0,0 +1,427 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+/*
+ * A host-native microbenchmark suite for the header-only collections, bitfields and the region
+ * manager. It runs on Linux, so that performance regressions in these data structures can be
+ * detected without booting NOVA.
+ *
+ * Usage: collbench [<maxexp> [<filter>]]
+ *   maxexp: the largest element count is 10^<maxexp> (2..6, default 6)
+ *   filter: only run benchmarks whose name contains <filter>
+ *
+ * Every result is printed as one line "<bench> <elements> <ops> <ns/op>". Lines starting with '#'
+ * are comments. Every benchmark is run several times with the same input and the best run is
+ * reported to reduce the noise.
+ */
+
+#include <collection/Treap.h>
+#include <collection/SListTreap.h>
+#include <collection/SortedSList.h>
+#include <collection/SList.h>
+#include <collection/DList.h>
+#include <collection/Cycler.h>
+#include <collection/QuickSort.h>
+#include <bits/BitField.h>
+#include <bits/MaskField.h>
+#include <region/RegionManager.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace nre;
+
+static const uint RUNS              = 3;
+// the sorted list has linear insertion costs; don't let it run forever
+static const size_t SORTED_MAX      = 10000;
+
+struct TNode : public TreapNode<uint> {
+    explicit TNode() : TreapNode<uint>(0) {
+    }
+};
+
+struct STNode : public SListTreapNode<uint> {
+    explicit STNode() : SListTreapNode<uint>(0) {
+    }
+};
+
+struct SNode : public SListItem {
+    uint val;
+};
+
+struct DNode : public DListItem {
+    uint val;
+};
+
+static const char *filter = nullptr;
+static uint *keys;
+static volatile size_t sink;
+
+/**
+ * A simple linear congruential generator to get reproducible inputs on all hosts.
+ */
+static uint next_rand(uint &state) {
+    state = state * 1103515245 + 12345;
+    return state >> 8;
+}
+
+/**
+ * Fills <keys> with a random permutation of 0..n-1
+ */
+static void permute(size_t n) {
+    uint state = 0x12345678;
+    for(size_t i = 0; i < n; ++i)
+        keys[i] = i;
+    for(size_t i = n - 1; i > 0; --i) {
+        size_t j = next_rand(state) % (i + 1);
+        Util::swap(keys[i], keys[j]);
+    }
+}
+
+static uint64_t now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool selected(const char *name) {
+    return filter == nullptr || strstr(name, filter) != nullptr;
+}
+
+static void report(const char *name, size_t n, size_t ops, uint64_t best) {
+    printf("%s %zu %zu %.2f\n", name, n, ops, static_cast<double>(best) / ops);
+    fflush(stdout);
+}
+
+/**
+ * Runs <B>::setup(), <B>::run() and <B>::teardown() RUNS times and reports the best time of
+ * run().
+ */
+template<class B>
+static void bench(const char *name, size_t n) {
+    if(!selected(name))
+        return;
+    uint64_t best = ~0ULL;
+    size_t ops = 0;
+    for(uint r = 0; r < RUNS; ++r) {
+        B b(n);
+        uint64_t start = now();
+        ops = b.run();
+        uint64_t time = now() - start;
+        if(time < best)
+            best = time;
+    }
+    report(name, n, ops, best);
+}
+
+template<class N, class C>
+struct TreeBase {
+    explicit TreeBase(size_t n) : n(n), nodes(new N[n]), tree() {
+        for(size_t i = 0; i < n; ++i)
+            nodes[i].key(keys[i]);
+    }
+    ~TreeBase() {
+        delete[] nodes;
+    }
+    void fill() {
+        for(size_t i = 0; i < n; ++i)
+            tree.insert(nodes + i);
+    }
+
+    size_t n;
+    N *nodes;
+    C tree;
+};
+
+template<class N, class C>
+struct TreeInsert : public TreeBase<N, C> {
+    explicit TreeInsert(size_t n) : TreeBase<N, C>(n) {
+    }
+    size_t run() {
+        this->fill();
+        return this->n;
+    }
+};
+
+template<class N, class C>
+struct TreeFind : public TreeBase<N, C> {
+    explicit TreeFind(size_t n) : TreeBase<N, C>(n) {
+        this->fill();
+    }
+    size_t run() {
+        size_t found = 0;
+        for(size_t i = 0; i < this->n; ++i)
+            found += this->tree.find(i) != nullptr;
+        sink = found;
+        return this->n;
+    }
+};
+
+template<class N, class C>
+struct TreeRemove : public TreeBase<N, C> {
+    explicit TreeRemove(size_t n) : TreeBase<N, C>(n) {
+        this->fill();
+    }
+    size_t run() {
+        // remove them in a different order than they have been inserted
+        for(size_t i = 0; i < this->n; ++i)
+            this->tree.remove(this->nodes + ((i * 7919) % this->n));
+        return this->n;
+    }
+};
+
+template<class N, class L>
+struct ListBase {
+    explicit ListBase(size_t n) : n(n), nodes(new N[n]), list() {
+        for(size_t i = 0; i < n; ++i)
+            nodes[i].val = keys[i];
+    }
+    ~ListBase() {
+        delete[] nodes;
+    }
+    void fill() {
+        for(size_t i = 0; i < n; ++i)
+            list.append(nodes + i);
+    }
+
+    size_t n;
+    N *nodes;
+    L list;
+};
+
+template<class N, class L>
+struct ListAppend : public ListBase<N, L> {
+    explicit ListAppend(size_t n) : ListBase<N, L>(n) {
+    }
+    size_t run() {
+        this->fill();
+        return this->n;
+    }
+};
+
+template<class N, class L>
+struct ListIterate : public ListBase<N, L> {
+    explicit ListIterate(size_t n) : ListBase<N, L>(n) {
+        this->fill();
+    }
+    size_t run() {
+        size_t sum = 0;
+        for(auto it = this->list.begin(); it != this->list.end(); ++it)
+            sum += it->val;
+        sink = sum;
+        return this->n;
+    }
+};
+
+struct SListRemove : public ListBase<SNode, SList<SNode> > {
+    explicit SListRemove(size_t n) : ListBase<SNode, SList<SNode> >(n) {
+        fill();
+    }
+    size_t run() {
+        // removing arbitrary elements is linear; the head is the common case (e.g., queues)
+        for(size_t i = 0; i < n; ++i)
+            list.remove(nodes + i);
+        return n;
+    }
+};
+
+struct DListRemove : public ListBase<DNode, DList<DNode> > {
+    explicit DListRemove(size_t n) : ListBase<DNode, DList<DNode> >(n) {
+        fill();
+    }
+    size_t run() {
+        for(size_t i = 0; i < n; ++i)
+            list.remove(nodes + keys[i]);
+        return n;
+    }
+};
+
+struct SortedInsert {
+    static bool isless(const SNode &a, const SNode &b) {
+        return a.val < b.val;
+    }
+
+    explicit SortedInsert(size_t n) : n(n), nodes(new SNode[n]), list(isless) {
+        for(size_t i = 0; i < n; ++i)
+            nodes[i].val = keys[i];
+    }
+    ~SortedInsert() {
+        delete[] nodes;
+    }
+    size_t run() {
+        for(size_t i = 0; i < n; ++i)
+            list.insert(nodes + i);
+        return n;
+    }
+
+    size_t n;
+    SNode *nodes;
+    SortedSList<SNode> list;
+};
+
+struct CyclerNext : public ListBase<DNode, DList<DNode> > {
+    explicit CyclerNext(size_t n) : ListBase<DNode, DList<DNode> >(n) {
+        fill();
+    }
+    size_t run() {
+        // walk around twice to include the wrap-around
+        Cycler<DList<DNode>::iterator> cyc(list.begin(), list.end());
+        size_t sum = 0;
+        for(size_t i = 0; i < n * 2; ++i)
+            sum += cyc.next()->val;
+        sink = sum;
+        return n * 2;
+    }
+};
+
+struct Sort {
+    static bool isless(const uint &a, const uint &b) {
+        return a < b;
+    }
+
+    explicit Sort(size_t n) : n(n), vals(new uint[n]) {
+        memcpy(vals, keys, n * sizeof(uint));
+    }
+    ~Sort() {
+        delete[] vals;
+    }
+    size_t run() {
+        Quicksort<uint>::sort(isless, vals, n);
+        return n;
+    }
+
+    size_t n;
+    uint *vals;
+};
+
+struct BitFieldOps {
+    static const uint BITS = 1 << 20;
+
+    explicit BitFieldOps(size_t n) : n(n), bf(new BitField<BITS>()) {
+    }
+    ~BitFieldOps() {
+        delete bf;
+    }
+    size_t run() {
+        size_t sum = 0;
+        for(size_t i = 0; i < n; ++i)
+            bf->set(keys[i] % BITS);
+        for(size_t i = 0; i < n; ++i)
+            sum += bf->is_set(i % BITS);
+        for(size_t i = 0; i < n; ++i)
+            bf->clear(keys[i] % BITS);
+        sink = sum;
+        return n * 3;
+    }
+
+    size_t n;
+    BitField<BITS> *bf;
+};
+
+struct MaskFieldOps {
+    explicit MaskFieldOps(size_t n) : n(n), mf(n * 4) {
+    }
+    size_t run() {
+        size_t sum = 0;
+        for(size_t i = 0; i < n; ++i)
+            mf.set(keys[i], keys[i] & 0xF);
+        for(size_t i = 0; i < n; ++i)
+            sum += mf.get(i);
+        sink = sum;
+        return n * 2;
+    }
+
+    size_t n;
+    MaskField<4> mf;
+};
+
+struct RegionMix {
+    static const size_t PAGE    = 0x1000;
+
+    explicit RegionMix(size_t n) : n(n), addrs(new uintptr_t[n]), sizes(new size_t[n]), rm() {
+        // enough space for all allocations, even with alignment
+        rm.free(0x100000, n * 16 * PAGE * 2);
+        uint state = 0xCAFEBABE;
+        for(size_t i = 0; i < n; ++i)
+            sizes[i] = ((next_rand(state) % 16) + 1) * PAGE;
+    }
+    ~RegionMix() {
+        delete[] addrs;
+        delete[] sizes;
+    }
+    size_t run() {
+        // allocate all, free every second one, allocate them again and free everything. this
+        // fragments the free list, which is the interesting case
+        for(size_t i = 0; i < n; ++i)
+            addrs[i] = rm.alloc(sizes[i], PAGE);
+        for(size_t i = 0; i < n; i += 2)
+            rm.free(addrs[i], sizes[i]);
+        for(size_t i = 0; i < n; i += 2)
+            addrs[i] = rm.alloc(sizes[i], PAGE);
+        for(size_t i = 0; i < n; ++i)
+            rm.free(addrs[keys[i]], sizes[keys[i]]);
+        return n * 2 + (n + 1) / 2 * 2;
+    }
+
+    size_t n;
+    uintptr_t *addrs;
+    size_t *sizes;
+    RegionManager<> rm;
+};
+
+int main(int argc, char **argv) {
+    uint maxexp = 6;
+    if(argc > 1)
+        maxexp = strtoul(argv[1], nullptr, 10);
+    if(argc > 2)
+        filter = argv[2];
+    if(maxexp < 2 || maxexp > 6) {
+        fprintf(stderr, "Usage: %s [<maxexp> [<filter>]]\n", argv[0]);
+        return 1;
+    }
+
+    size_t max = 1;
+    for(uint i = 0; i < maxexp; ++i)
+        max *= 10;
+    keys = new uint[max];
+
+    printf("# bench elements ops ns/op\n");
+    for(size_t n = 100; n <= max; n *= 10) {
+        permute(n);
+        bench<TreeInsert<TNode, Treap<TNode> > >("treap_insert", n);
+        bench<TreeFind<TNode, Treap<TNode> > >("treap_find", n);
+        bench<TreeRemove<TNode, Treap<TNode> > >("treap_remove", n);
+        bench<TreeInsert<STNode, SListTreap<STNode> > >("slisttreap_insert", n);
+        bench<TreeFind<STNode, SListTreap<STNode> > >("slisttreap_find", n);
+        bench<ListAppend<SNode, SList<SNode> > >("slist_append", n);
+        bench<ListIterate<SNode, SList<SNode> > >("slist_iterate", n);
+        bench<SListRemove>("slist_remove_head", n);
+        bench<ListAppend<DNode, DList<DNode> > >("dlist_append", n);
+        bench<ListIterate<DNode, DList<DNode> > >("dlist_iterate", n);
+        bench<DListRemove>("dlist_remove", n);
+        if(n <= SORTED_MAX)
+            bench<SortedInsert>("sortedslist_insert", n);
+        bench<CyclerNext>("cycler_next", n);
+        bench<Sort>("quicksort", n);
+        bench<BitFieldOps>("bitfield_ops", n);
+        bench<MaskFieldOps>("maskfield_ops", n);
+        if(n <= SORTED_MAX)
+            bench<RegionMix>("regionmng_mix", n);
+    }
+    delete[] keys;
+    return 0;
+}
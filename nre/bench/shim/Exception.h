@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+/*
+ * Host shim: a minimal exception class without backtraces.
+ */
+
+#include <arch/Types.h>
+#include <stream/OStringStream.h>
+#include <Errors.h>
+#include <String.h>
+
+#define VTHROW(cls, errorcode, expr) {                            \
+        nre::OStringStream __os;                                  \
+        __os << expr;                                             \
+        throw nre::cls(nre::errorcode, __os.str());               \
+    }
+
+namespace nre {
+
+class Exception {
+public:
+    explicit Exception(ErrorCode code = E_FAILURE, const String &msg = String()) throw()
+        : _code(code), _msg(msg) {
+    }
+    virtual ~Exception() throw() {
+    }
+
+    ErrorCode code() const throw() {
+        return _code;
+    }
+    const String &msg() const throw() {
+        return _msg;
+    }
+
+private:
+    ErrorCode _code;
+    String _msg;
+};
+
+}
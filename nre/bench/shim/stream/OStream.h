@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+/*
+ * Host shim: an output stream that discards everything. The benchmarks don't measure formatting,
+ * but the headers need the operators to compile.
+ */
+
+#include <arch/Types.h>
+
+namespace nre {
+
+class OStream {
+public:
+    explicit OStream() {
+    }
+    virtual ~OStream() {
+    }
+
+    template<typename T>
+    OStream &operator<<(const T&) {
+        return *this;
+    }
+};
+
+template<typename T>
+static inline const T &fmt(const T &value, const char * = "", uint = 0) {
+    return value;
+}
+
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+/*
+ * Host shim: a string stream that discards everything.
+ */
+
+#include <stream/OStream.h>
+
+namespace nre {
+
+class OStringStream : public OStream {
+public:
+    explicit OStringStream() : OStream() {
+    }
+
+    const char *str() const {
+        return "";
+    }
+};
+
+}
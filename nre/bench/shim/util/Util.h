@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+/*
+ * Host shim: the parts of Util that are used by the collections.
+ */
+
+#include <arch/Types.h>
+
+namespace nre {
+
+class Util {
+public:
+    template<typename T>
+    static void swap(T &t1, T &t2) {
+        T tmp = t1;
+        t1 = t2;
+        t2 = tmp;
+    }
+
+private:
+    Util();
+};
+
+}
@@ -38,6 +38,15 @@ class CPU : public SListItem {
 public:
     typedef SList<CPU>::iterator iterator;
 
+    /**
+     * Instruction set features, detected via CPUID at startup. They are the same for all CPUs.
+     */
+    enum Feature {
+        FEAT_SSE2   = 1 << 0,
+        FEAT_AVX2   = 1 << 1,   // AVX2 and the OS saves the ymm state
+        FEAT_ERMS   = 1 << 2,   // enhanced "rep movsb/stosb"
+    };
+
     /**
      * @return the current CPU, i.e. the CPU you're running on
      */
@@ -59,6 +68,13 @@ public:
     static size_t count() {
         return _online.length();
     }
+    /**
+     * @param feat the feature
+     * @return true if the CPUs support the given feature
+     */
+    static bool has(Feature feat) {
+        return _features & feat;
+    }
     /**
      * @return the next order of online CPUs, i.e. Math::next_pow2_shift(count())
      */
@@ -182,6 +198,7 @@ private:
     Pt *_srv_pt;
     Pt *_sc_pt;
     static uint _order;
+    static uint _features;
     static SList<CPU> _online;
     static CPU _cpus[Hip::MAX_CPUS];
     static cpu_t _logtophys[Hip::MAX_CPUS];
@@ -24,14 +24,14 @@
  * Executes the given expression (which should to the logging) if the log-level <lvl> is enabled.
  * A UserSm is used to make sure that different log-statements in one program don't get mixed.
  * The nice thing is that the compiler is able to completely eliminate this code, if the log-level
- * is disabled.
+ * is disabled. In particular, the arguments are not even formatted in this case.
  *
  * Usage example:
  *  LOG(TIMER, "My message " << 123 << "\n");
  */
 #define LOG(lvl, expr)                                                              \
     do {                                                                            \
-        if((nre::Logging::level & (nre::Logging::lvl)) == (nre::Logging::lvl)) {    \
+        if(nre::Logging::enabled(nre::Logging::lvl)) {                              \
             nre::ScopedLock<nre::UserSm> guard(&nre::Logging::sm);                  \
             nre::Serial::get() << expr;                                             \
         }                                                                           \
@@ -74,13 +74,25 @@ public:
         VESA_DETAIL     = 1 << 24,
         NET             = 1 << 25,
         NET_DETAIL      = 1 << 26,
+        BOOT            = 1 << 27,
     };
 
+    /**
+     * Checks whether the given log-level is enabled. Since <level> is a constant, this is
+     * evaluated at compile time. Use it to skip the preparation of expensive log-output.
+     *
+     * @param lvl the level(s)
+     * @return true if all of them are enabled
+     */
+    static bool enabled(int lvl) {
+        return (level & lvl) == lvl;
+    }
+
     static UserSm sm;
     static const int level = 0 |
 #ifndef NDEBUG
         CHILD_CREATE | MEM_MAP | CPUS | PLATFORM | CHILD_KILL | ACPI |
-        REBOOT | TIMER | KEYBOARD | STORAGE | VESA | NET
+        REBOOT | TIMER | KEYBOARD | STORAGE | VESA | NET | BOOT
 #else
         CHILD_KILL | MEM_MAP | PLATFORM | KEYBOARD | TIMER | STORAGE | VESA | NET
 #endif
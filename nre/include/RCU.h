@@ -18,6 +18,8 @@
 
 #include <kobj/Thread.h>
 #include <kobj/UserSm.h>
+#include <kobj/Sm.h>
+#include <arch/ExecEnv.h>
 #include <collection/SList.h>
 #include <util/ScopedLock.h>
 #include <util/Sync.h>
@@ -119,6 +121,10 @@ namespace nre {
  *   ScopedLock<RCULock> guard(&RCU::lock());
  *   // do stuff
  * }
+ *
+ * The read side uses neither atomic instructions nor memory fences. Instead, the writer makes
+ * sure that the counter updates have become visible before it takes a snapshot of them (see
+ * RCU::store_versions()).
  */
 class RCULock {
 public:
@@ -126,22 +132,24 @@ public:
     }
 
     void down() {
-        Reference<Thread> cur = Thread::current();
+        // don't use Thread::current() here, because the Reference would cause atomic operations
+        Thread *cur = ExecEnv::get_current_thread();
         uint32_t counter = cur->_rcu_counter;
         // update version-counter if we're entering a critical section
         if(!(counter & 0xFFFF))
             counter += 0x10000;
         // always update the nested-counter
         counter++;
-        // ensure that the counter-increase is written before anything else in the critical section
-        cur->_rcu_counter = counter;
+        // ensure that the compiler writes the counter before anything else in the critical section
+        ACCESS_ONCE(cur->_rcu_counter) = counter;
         Sync::memory_barrier();
     }
     void up() {
-        // ensure that everything in the critical section is written before the counter is increased
+        // the CPU does not reorder previous loads and stores with a later store. so, we only have
+        // to prevent the compiler from doing that
         Sync::memory_barrier();
-        Reference<Thread> cur = Thread::current();
-        cur->_rcu_counter--;
+        Thread *cur = ExecEnv::get_current_thread();
+        ACCESS_ONCE(cur->_rcu_counter) = cur->_rcu_counter - 1;
     }
 
 private:
@@ -290,6 +298,12 @@ private:
     }
 
     static void store_versions() {
+        // a reader might have loaded a pointer while its counter-update is still in the store
+        // buffer of its CPU. thus, drain the store buffers of all CPUs first.
+        fence_cpus();
+
+        // update the version-numbers for all Ecs
+        ScopedLock<UserSm> guard(&_ecsm);
         // new Ecs added?
         if(_versions_count != _ecs.length()) {
             delete[] _versions;
@@ -297,13 +311,18 @@ private:
             _versions = new uint32_t[_ecs.length()];
         }
 
-        // update the version-numbers for all Ecs
-        ScopedLock<UserSm> guard(&_ecsm);
         size_t i = 0;
         for(auto it = _ecs.begin(); it != _ecs.end(); ++it, ++i)
             _versions[i] = it->_rcu_counter;
     }
 
+    /**
+     * Executes a memory fence on all other CPUs. This is done by per-CPU threads that are created
+     * on first use.
+     */
+    static void fence_cpus();
+    static void fence_thread(void*);
+
     RCU();
     ~RCU();
     RCU(const RCU&);
@@ -318,6 +337,8 @@ private:
     // destroys a thread with the destructor of an RCUObject. so, when we used the same Sm,
     // it would cause a deadlock.
     static UserSm _ecsm;
+    static Sm **_fence_reqs;
+    static Sm *_fence_done;
     static RCULock _lock;
 };
 
@@ -245,6 +245,20 @@ public:
             *msi_value = out2;
     }
 
+    /**
+     * Assigns the PCI device, specified by <pci_cfg_mem>, to the given Pd. Afterwards, the device
+     * uses the DMA page table of that Pd, i.e. it can only access memory that has been delegated
+     * to the Pd with UtcbFrame::UPD_DPT, using the virtual addresses of the Pd.
+     *
+     * @param pd the protection domain
+     * @param pci_cfg_mem the memory-mapped PCI configuration space of the device
+     * @param rid the requester id of the device (only used as a hint by the kernel)
+     * @throws SyscallException if the system-call failed (result != E_SUCCESS)
+     */
+    static void assign_pci(capsel_t pd, void *pci_cfg_mem, word_t rid) {
+        SyscallABI::syscall(pd << 8 | ASSIGN_PCI, reinterpret_cast<word_t>(pci_cfg_mem), rid);
+    }
+
     /**
      * Revokes the capability range described by the given Crd.
      *
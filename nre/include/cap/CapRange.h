@@ -64,6 +64,16 @@ public:
      */
     void limit_to(size_t free_typed);
 
+    /**
+     * Counts the naturally aligned Crds, i.e. typed items, that are necessary to delegate the
+     * beginning of this range, but at most <max> of them.
+     *
+     * @param max the maximum number of Crds
+     * @param covered will be set to the number of capabilities these Crds cover
+     * @return the number of Crds
+     */
+    size_t crd_count(size_t max, size_t &covered) const;
+
     /**
      * The start of this range
      */
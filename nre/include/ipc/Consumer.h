@@ -18,6 +18,7 @@
 
 #include <kobj/Sm.h>
 #include <mem/DataSpace.h>
+#include <ipc/ServiceStats.h>
 #include <util/Sync.h>
 #include <util/Math.h>
 
@@ -60,7 +61,7 @@ public:
     explicit Consumer(DataSpace &ds, Sm &sm, bool init = false)
         : _ds(ds), _if(reinterpret_cast<Interface*>(ds.virt())),
           _max(Math::prev_pow2((ds.size() - sizeof(Interface)) / sizeof(T))),
-          _sm(sm), _stop(false) {
+          _sm(sm), _stop(false), _stats() {
         if(init) {
             _if->rpos = 0;
             _if->wpos = 0;
@@ -73,6 +74,22 @@ public:
     size_t rblength() const {
         return _max;
     }
+    /**
+     * @return the number of used slots
+     */
+    size_t level() const {
+        return (_if->wpos - _if->rpos) & (_max - 1);
+    }
+
+    /**
+     * Attaches the consumer to the given ring statistics. Afterwards, every consumed item is
+     * recorded there.
+     *
+     * @param stats the statistics (may be nullptr)
+     */
+    void stats(ServiceStats::Ring *stats) {
+        _stats = stats;
+    }
 
     /**
      * Stops waiting for the producer. This way, if get() is blocked on the semaphore, it will
@@ -126,6 +143,8 @@ public:
      */
     void next() {
         _if->rpos = (_if->rpos + 1) & (_max - 1);
+        if(_stats)
+            _stats->record(level());
     }
 
 protected:
@@ -134,6 +153,7 @@ protected:
     size_t _max;
     Sm &_sm;
     bool _stop;
+    ServiceStats::Ring *_stats;
 };
 
 }
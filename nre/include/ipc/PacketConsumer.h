@@ -51,6 +51,13 @@ public:
         _max = (ds.size() - sizeof(Interface)) / sizeof(size_t);
     }
 
+    /**
+     * @return the number of used words
+     */
+    size_t level() const {
+        return (_if->wpos + _max - _if->rpos) % _max;
+    }
+
     /**
      * Retrieves the item at current position. If there is no item anymore, it blocks until the
      * producer notifies it, that there is data available. You might interrupt that by using stop().
@@ -81,6 +88,8 @@ public:
     void next() {
         size_t len = (_if->buffer[_if->rpos] + 2 * sizeof(size_t) - 1) / sizeof(size_t);
         _if->rpos = (_if->rpos + len) % _max;
+        if(_stats)
+            _stats->record(level());
     }
 };
 
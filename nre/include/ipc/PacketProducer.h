@@ -43,6 +43,16 @@ public:
         _max = (ds.size() - sizeof(PacketConsumer::Interface)) / sizeof(size_t);
     }
 
+    using Producer<size_t>::rblength;
+    using Producer<size_t>::stats;
+
+    /**
+     * @return the number of used words
+     */
+    size_t level() const {
+        return (_if->wpos + _max - _if->rpos) % _max;
+    }
+
     /**
      * Puts <len> bytes at <buffer> as a packet into the ringbuffer.
      *
@@ -61,8 +71,11 @@ public:
             left = 0;
         }
         // take care that we leave at least 1 byte free.
-        if((needed >= right) && (needed >= left))
+        if((needed >= right) && (needed >= left)) {
+            if(_stats)
+                _stats->record_full();
             return false;
+        }
 
         // determine position
         size_t ofs = _if->wpos;
@@ -82,6 +95,8 @@ public:
             _if->wpos = 0;
         else
             _if->wpos = ofs + needed;
+        if(_stats)
+            _stats->record(level());
         Sync::memory_barrier();
         // notify consumer
         try {
@@ -18,6 +18,7 @@
 
 #include <mem/DataSpace.h>
 #include <ipc/Consumer.h>
+#include <ipc/ServiceStats.h>
 #include <util/Sync.h>
 #include <util/Math.h>
 
@@ -41,7 +42,7 @@ public:
     explicit Producer(DataSpace &ds, Sm &sm, bool init = true)
         : _ds(ds), _if(reinterpret_cast<typename Consumer<T>::Interface*>(ds.virt())),
           _max(Math::prev_pow2((ds.size() - sizeof(typename Consumer<T>::Interface)) / sizeof(T))),
-          _sm(sm) {
+          _sm(sm), _stats() {
         if(init) {
             _if->rpos = 0;
             _if->wpos = 0;
@@ -54,6 +55,22 @@ public:
     size_t rblength() const {
         return _max;
     }
+    /**
+     * @return the number of used slots
+     */
+    size_t level() const {
+        return (_if->wpos - _if->rpos) & (_max - 1);
+    }
+
+    /**
+     * Attaches the producer to the given ring statistics. Afterwards, every produced item and
+     * every time the ring is full is recorded there.
+     *
+     * @param stats the statistics (may be nullptr)
+     */
+    void stats(ServiceStats::Ring *stats) {
+        _stats = stats;
+    }
 
     /**
      * If the client is currently not able to accept it, the method will return nullptr.
@@ -62,18 +79,33 @@ public:
      */
     T *current() {
         // is it full?
-        if(EXPECT_FALSE(((_if->wpos + 1) & (_max - 1)) == _if->rpos))
+        if(EXPECT_FALSE(((_if->wpos + 1) & (_max - 1)) == _if->rpos)) {
+            if(_stats)
+                _stats->record_full();
             return nullptr;
+        }
         return _if->buffer + _if->wpos;
     }
 
     /**
      * Moves to the next slot. That is, the position is moved forward and the consumer is notified,
-     * that new data is available
+     * that new data is available. If you produce multiple items at once, you can pass false and
+     * call notify() once afterwards.
+     *
+     * @param notify whether to notify the consumer
      */
-    void next() {
+    void next(bool notify = true) {
         _if->wpos = (_if->wpos + 1) & (_max - 1);
+        if(_stats)
+            _stats->record(level());
         Sync::memory_barrier();
+        if(notify)
+            this->notify();
+    }
+    /**
+     * Notifies the consumer that new data is available
+     */
+    void notify() {
         try {
             _sm.up();
         }
@@ -103,6 +135,7 @@ protected:
     typename Consumer<T>::Interface * _if;
     size_t _max;
     Sm &_sm;
+    ServiceStats::Ring *_stats;
 };
 
 }
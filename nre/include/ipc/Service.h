@@ -22,12 +22,18 @@
 #include <kobj/UserSm.h>
 #include <ipc/ServiceCPUHandler.h>
 #include <ipc/ServiceSession.h>
+#include <ipc/ServiceSessionTable.h>
+#include <ipc/ServiceStats.h>
+#include <mem/DataSpace.h>
 #include <utcb/UtcbFrame.h>
 #include <util/ThreadedDeleter.h>
 #include <util/CPUSet.h>
 #include <bits/BitField.h>
+#include <util/Math.h>
 #include <Exception.h>
+#include <RCU.h>
 #include <CPU.h>
+#include <new>
 
 namespace nre {
 
@@ -53,6 +59,23 @@ class Service {
     friend class ServiceCPUHandler;
 
     class ServiceSessionDeleter : public ThreadedDeleter<ServiceSession> {
+        /**
+         * Drops the last reference of the service to a session as soon as all readers that
+         * might have found it in an old session table are done.
+         */
+        class RetiredSession : public RCUObject {
+        public:
+            explicit RetiredSession(ServiceSession *sess) : RCUObject(), _sess(sess) {
+            }
+            virtual ~RetiredSession() {
+                if(_sess->rem_ref())
+                    delete _sess;
+            }
+
+        private:
+            ServiceSession *_sess;
+        };
+
     public:
         explicit ServiceSessionDeleter(Service *s)
             : ThreadedDeleter<ServiceSession>("session"), _s(s) {
@@ -60,18 +83,22 @@ class Service {
 
     private:
         virtual void call() {
-            // call an empty portal with the session-Ec
-            UtcbFrame uf;
-            Pt(_s->get_thread(CPU::current().log_id()), cleanup_portal).call(uf);
+            // call an empty portal with every session-Ec on this CPU
+            cpu_t cpu = CPU::current().log_id();
+            for(size_t i = 0; i < _s->threads(); ++i) {
+                UtcbFrame uf;
+                Pt(_s->get_thread(cpu, i), cleanup_portal).call(uf);
+            }
         }
 
         virtual void invalidate(ServiceSession *obj) {
             obj->destroy();
         }
         virtual void destroy(ServiceSession *obj) {
-            ScopedLock<UserSm> guard(&_s->_sm);
-            if(obj->rem_ref())
-                delete obj;
+            // the session has already been removed from the session table, but there might still be
+            // readers that found it in the old one and are about to take a reference. so, let RCU
+            // drop ours when they are done instead of waiting for them here.
+            RCU::invalidate(new RetiredSession(obj));
         }
 
         PORTAL static void cleanup_portal(void*) {
@@ -82,7 +109,7 @@ class Service {
 
 public:
     typedef ServiceSession::portal_func portal_func;
-    typedef typename SListTreap<ServiceSession>::iterator iterator;
+    typedef ServiceSessionTable::iterator iterator;
 
     /**
      * The commands the parent provides for working with services
@@ -92,24 +119,32 @@ public:
         OPEN_SESSION,
         CLOSE_SESSION,
         UNREGISTER,
+        STATS,
     };
 
     /**
      * Constructor. Creates portals on the specified CPUs to accept client sessions and creates
      * Threads to handle <portal>. Note that you have to call reg() afterwards to finally register
      * the service.
+     * By default, there is one thread per CPU that handles all sessions. If you specify more
+     * threads, the sessions are distributed among them, so that a long-running request of one
+     * client doesn't block the clients of other sessions on the same CPU.
      *
      * @param name the name of the service
      * @param cpus the CPUs on which you want to provide the service
      * @param portal the portal-function to provide
+     * @param threads the number of threads per CPU to handle <portal> (default 1)
      */
-    explicit Service(const char *name, const CPUSet &cpus, portal_func portal)
+    explicit Service(const char *name, const CPUSet &cpus, portal_func portal, size_t threads = 1)
         : _next_id(0), _regcaps(CapSelSpace::get().allocate(1 << CPU::order(), 1 << CPU::order())),
           _sm(), _stop_sm(0), _stop(false), _name(name), _func(portal), _deleter(this),
-          _insts(new ServiceCPUHandler *[CPU::count()]), _reg_cpus(cpus.get()), _sessions() {
+          _insts(new ServiceCPUHandler *[CPU::count()]), _threads(Math::max<size_t>(threads, 1)),
+          _reg_cpus(cpus.get()), _sessions(new ServiceSessionTable()), _stats_sm(),
+          _stats_ds(ExecEnv::PAGE_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+          _stats(new (reinterpret_cast<void*>(_stats_ds.virt()))ServiceStats(name)) {
         for(size_t i = 0; i < CPU::count(); ++i) {
             if(_reg_cpus.is_set(i))
-                _insts[i] = new ServiceCPUHandler(this, _regcaps + i, i);
+                _insts[i] = new ServiceCPUHandler(this, _regcaps + i, i, _threads);
             else
                 _insts[i] = nullptr;
         }
@@ -127,10 +162,14 @@ public:
                 // wait until all sessions have been destroyed (we can't do that anymore if we've
                 // already destroyed the portals)
                 _deleter.wait();
+                // the sessions might still wait for their grace period; they should not survive
+                // the service
+                RCU::gc(true);
             }
             for(size_t i = 0; i < CPU::count(); ++i)
                 delete _insts[i];
             delete[] _insts;
+            delete _sessions;
             CapSelSpace::get().free(_regcaps, 1 << CPU::order());
         }
         catch(...) {
@@ -151,6 +190,7 @@ public:
             uf << _regcaps;
         CPU::current().srv_pt().call(uf);
         uf.check_reply();
+        reg_stats();
         _stop_sm.down();
     }
 
@@ -175,6 +215,25 @@ public:
     portal_func portal() const {
         return _func;
     }
+    /**
+     * @return the statistics of this service
+     */
+    ServiceStats &stats() {
+        return *_stats;
+    }
+    /**
+     * Determines the statistics for the rings with given name, so that you can attach a Producer or
+     * Consumer to it. All rings with the same name are aggregated.
+     *
+     * @param name the name of the ring (e.g. "rx")
+     * @param size the number of slots of the ring
+     * @return the ring statistics or nullptr if there are already too many different rings
+     */
+    ServiceStats::Ring *stats_ring(const char *name, size_t size) {
+        ScopedLock<UserSm> guard(&_stats_sm);
+        return _stats->ring(name, size);
+    }
+
     /**
      * @return the bitmask that specified on which CPUs it is available
      */
@@ -183,8 +242,8 @@ public:
     }
 
     /**
-     * The up-/down-implementation to allow ScopedLock<Service>. This is required if you want to
-     * iterate over all sessions to prevent that the list is manipulated during that time.
+     * The up-/down-implementation to allow ScopedLock<Service>. This serializes the creation and
+     * destruction of sessions. It is not required for looking up sessions or iterating over them.
      */
     void up() {
         _sm.up();
@@ -194,17 +253,15 @@ public:
     }
 
     /**
-     * @return the iterator-beginning to walk over all sessions (note that you need to use an
-     *  ScopedLock<Service> to prevent that sessions are destroyed while iterating over them)
-     */
-    iterator sessions_begin() {
-        return _sessions.begin();
-    }
-    /**
-     * @return the iterator-end
+     * Returns the current table of all sessions. You have to be in an RCU read section, i.e. use
+     * ScopedLock<RCULock> guard(&RCU::lock()), as long as you use the table and the sessions in it.
+     * The table won't change during that time, but sessions might be added or removed
+     * concurrently, so that the next call may return a different table.
+     *
+     * @return the session table
      */
-    iterator sessions_end() {
-        return _sessions.end();
+    const ServiceSessionTable *sessions() const {
+        return rcu_dereference(_sessions);
     }
 
     /**
@@ -217,19 +274,67 @@ public:
      */
     template<class T>
     Reference<T> get_session(size_t id) {
-        ScopedLock<UserSm> guard(&_sm);
-        T *sess = static_cast<T*>(_sessions.find(id));
+        ScopedLock<RCULock> guard(&RCU::lock());
+        T *sess = static_cast<T*>(sessions()->find(id));
         if(!sess)
             VTHROW(ServiceException, E_ARGS_INVALID, "Session " << id << " doesn't exist");
         return Reference<T>(sess);
     }
 
+    /**
+     * @return the number of threads per CPU that handle the provided portal
+     */
+    size_t threads() const {
+        return _threads;
+    }
     /**
      * @param cpu the cpu
+     * @param idx the index of the thread on that CPU (0 .. threads() - 1)
      * @return the local thread for the given CPU to handle the provided portal
      */
-    Reference<LocalThread> get_thread(cpu_t cpu) const {
-        return _insts[cpu] != nullptr ? _insts[cpu]->thread() : Reference<LocalThread>();
+    Reference<LocalThread> get_thread(cpu_t cpu, size_t idx = 0) const {
+        return _insts[cpu] != nullptr ? _insts[cpu]->thread(idx) : Reference<LocalThread>();
+    }
+
+    /**
+     * Prepares the UTCBs of all threads that handle the provided portal to accept 2^<order>
+     * capability delegations. Note that the portal has to call UtcbFrameRef::accept_delegates()
+     * again after it has received delegations.
+     *
+     * @param order the order of the receive window
+     */
+    void accept_delegates(uint order) {
+        for(size_t cpu = 0; cpu < CPU::count(); ++cpu) {
+            for(size_t i = 0; _insts[cpu] && i < _threads; ++i) {
+                UtcbFrameRef uf(_insts[cpu]->thread(i)->utcb());
+                uf.accept_delegates(order);
+            }
+        }
+    }
+    /**
+     * Prepares the UTCBs of all threads that handle the provided portal to accept capability
+     * translations.
+     */
+    void accept_translates() {
+        for(size_t cpu = 0; cpu < CPU::count(); ++cpu) {
+            for(size_t i = 0; _insts[cpu] && i < _threads; ++i) {
+                UtcbFrameRef uf(_insts[cpu]->thread(i)->utcb());
+                uf.accept_translates();
+            }
+        }
+    }
+    /**
+     * Sets the TLS slot <idx> of all threads that handle the provided portal to <val>.
+     *
+     * @param idx the TLS index
+     * @param val the value
+     */
+    template<typename T>
+    void set_thread_tls(size_t idx, T val) {
+        for(size_t cpu = 0; cpu < CPU::count(); ++cpu) {
+            for(size_t i = 0; _insts[cpu] && i < _threads; ++i)
+                _insts[cpu]->thread(i)->set_tls<T>(idx, val);
+        }
     }
 
 protected:
@@ -244,18 +349,18 @@ protected:
 
 private:
     Reference<ServiceSession> get_first() {
-        ScopedLock<UserSm> guard(&_sm);
-        if(_sessions.length() > 0)
-            return Reference<ServiceSession>(&*_sessions.begin());
+        ScopedLock<RCULock> guard(&RCU::lock());
+        const ServiceSessionTable *table = sessions();
+        if(table->count() > 0)
+            return Reference<ServiceSession>(&*table->begin());
         return Reference<ServiceSession>();
     }
     Reference<ServiceSession> get_session_by_ident(capsel_t ident) {
-        ScopedLock<UserSm> guard(&_sm);
-        for(auto it = _sessions.begin(); it != _sessions.end(); ++it) {
-            if(it->portal_caps() == ident)
-                return Reference<ServiceSession>(&*it);
-        }
-        VTHROW(ServiceException, E_ARGS_INVALID, "Session with ident " << ident << " doesn't exist");
+        ScopedLock<RCULock> guard(&RCU::lock());
+        ServiceSession *sess = sessions()->find_by_ident(ident);
+        if(!sess)
+            VTHROW(ServiceException, E_ARGS_INVALID, "Session with ident " << ident << " doesn't exist");
+        return Reference<ServiceSession>(sess);
     }
 
     /**
@@ -271,7 +376,20 @@ private:
     }
 
     void remove_session(ServiceSession *sess);
+    ServiceSessionTable *replace_sessions(ServiceSessionTable *table);
 
+    void reg_stats() {
+        UtcbFrame uf;
+        uf << STATS << String(_name);
+        // translate it, so that our parent gets its own selector for the dataspace. thus, the
+        // clients that receive it from the parent can join it there.
+        if(_startup_info.child)
+            uf.translate(_stats_ds.sel());
+        else
+            uf << _stats_ds.sel();
+        CPU::current().srv_pt().call(uf);
+        uf.check_reply();
+    }
     void unreg() {
         UtcbFrame uf;
         uf << UNREGISTER << String(_name);
@@ -291,8 +409,12 @@ private:
     portal_func _func;
     ServiceSessionDeleter _deleter;
     ServiceCPUHandler **_insts;
+    size_t _threads;
     BitField<Hip::MAX_CPUS> _reg_cpus;
-    SListTreap<ServiceSession> _sessions;
+    ServiceSessionTable *_sessions;
+    UserSm _stats_sm;
+    DataSpace _stats_ds;
+    ServiceStats *_stats;
 };
 
 }
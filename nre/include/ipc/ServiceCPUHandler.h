@@ -26,7 +26,7 @@ class Service;
 
 /**
  * Provides the portal to open/close sessions for a specific CPU. Additionally, it hosts the thread
- * to do so and the thread for the actual service-portal.
+ * to do so and the threads for the actual service-portal.
  */
 class ServiceCPUHandler {
 public:
@@ -36,20 +36,29 @@ public:
      * @param s the service
      * @param pt the portal-selector
      * @param cpu the CPU to run on
+     * @param threads the number of threads for the service-portal
      */
-    explicit ServiceCPUHandler(Service* s, capsel_t pt, cpu_t cpu);
+    explicit ServiceCPUHandler(Service* s, capsel_t pt, cpu_t cpu, size_t threads);
+    /**
+     * Destructor
+     */
+    ~ServiceCPUHandler() {
+        delete[] _session_ecs;
+    }
 
     /**
      * @return the CPU
      */
     cpu_t cpu() const {
-        return _session_ec->cpu();
+        return _service_ec->cpu();
     }
     /**
-     * @return the thread that is used for the service-portal
+     * @param idx the index of the thread
+     * @return the thread with given index that is used for the service-portal
      */
-    Reference<LocalThread> thread() {
-        return _session_ec;
+    Reference<LocalThread> thread(size_t idx) {
+        assert(idx < _count);
+        return _session_ecs[idx];
     }
 
 private:
@@ -59,7 +68,8 @@ private:
     PORTAL static void portal(void*);
 
     Service *_s;
-    Reference<LocalThread> _session_ec;
+    size_t _count;
+    Reference<LocalThread> *_session_ecs;
     Reference<LocalThread> _service_ec;
     Pt _pt;
     UserSm _sm;
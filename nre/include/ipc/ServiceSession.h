@@ -16,8 +16,8 @@
 
 #pragma once
 
+#include <collection/SList.h>
 #include <kobj/Pt.h>
-#include <collection/SListTreap.h>
 #include <util/Reference.h>
 #include <CPU.h>
 
@@ -29,7 +29,7 @@ class Service;
  * The server-part of a session. This way the service can manage per-session-data. That is,
  * it can distinguish between clients.
  */
-class ServiceSession : public SListTreapNode<size_t>, public RefCounted {
+class ServiceSession : public SListItem, public RefCounted {
     friend class Service;
     friend class ServiceCPUHandler;
 
@@ -65,6 +65,12 @@ public:
     capsel_t portal_caps() const {
         return _caps;
     }
+    /**
+     * @return the service this session belongs to
+     */
+    Service *service() const {
+        return _srv;
+    }
 
 protected:
     /**
@@ -75,12 +81,16 @@ protected:
     }
 
 private:
+    PORTAL static void portal(void *id);
+
     void destroy() {
         invalidate();
         for(uint i = 0; i < CPU::count(); ++i)
             delete _pts[i];
     }
 
+    Service *_srv;
+    portal_func _func;
     size_t _id;
     capsel_t _caps;
     Pt **_pts;
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <util/Math.h>
+#include <RCU.h>
+#include <CPU.h>
+
+namespace nre {
+
+class ServiceSession;
+
+/**
+ * An immutable snapshot of all sessions of a service, which is published via RCU. Readers look up
+ * sessions in O(1) by id or portal-ident and can iterate over all sessions without taking the
+ * service-lock. Writers create a modified copy and replace the current table with it (see
+ * Service::new_session and Service::remove_session).
+ */
+class ServiceSessionTable : public RCUObject {
+    static const size_t MIN_CAPACITY    = 16;
+
+public:
+    /**
+     * Iterator over all sessions of a table
+     */
+    class iterator {
+    public:
+        explicit iterator(ServiceSession *const *pos) : _pos(pos) {
+        }
+
+        ServiceSession &operator*() const {
+            return **_pos;
+        }
+        ServiceSession *operator->() const {
+            return *_pos;
+        }
+        iterator &operator++() {
+            ++_pos;
+            return *this;
+        }
+        bool operator==(const iterator &rhs) const {
+            return _pos == rhs._pos;
+        }
+        bool operator!=(const iterator &rhs) const {
+            return _pos != rhs._pos;
+        }
+
+    private:
+        ServiceSession *const *_pos;
+    };
+
+    /**
+     * Creates an empty table
+     */
+    explicit ServiceSessionTable()
+        : RCUObject(), _count(0), _mask(0), _shift(0), _list(), _ids(), _idents() {
+    }
+    /**
+     * Creates a copy of <old>, with <add> added and <rem> removed (both may be nullptr).
+     *
+     * @param old the table to copy
+     * @param add the session to add
+     * @param rem the session to remove
+     */
+    explicit ServiceSessionTable(const ServiceSessionTable &old, ServiceSession *add,
+                                 ServiceSession *rem);
+    /**
+     * Destructor. Note that the sessions are not destroyed.
+     */
+    virtual ~ServiceSessionTable() {
+        delete[] _list;
+        delete[] _ids;
+        delete[] _idents;
+    }
+
+    /**
+     * @return the number of sessions
+     */
+    size_t count() const {
+        return _count;
+    }
+    /**
+     * @return true if <sess> is in this table
+     */
+    bool contains(const ServiceSession *sess) const;
+
+    /**
+     * @return the beginning of the session list
+     */
+    iterator begin() const {
+        return iterator(_list);
+    }
+    /**
+     * @return the end of the session list
+     */
+    iterator end() const {
+        return iterator(_list + _count);
+    }
+
+    /**
+     * @param id the session-id
+     * @return the session with given id or nullptr
+     */
+    ServiceSession *find(size_t id) const;
+    /**
+     * @param ident the portal-ident (the selector of the first session-portal)
+     * @return the session with given ident or nullptr
+     */
+    ServiceSession *find_by_ident(capsel_t ident) const;
+
+private:
+    size_t hash(size_t key) const {
+        // fibonacci hashing: multiply by 2^bits / golden ratio and use the upper bits, which
+        // depend on all bits of the key
+        const size_t golden = sizeof(size_t) == 8 ? static_cast<size_t>(0x9e3779b97f4a7c15ULL)
+                                                  : static_cast<size_t>(0x9e3779b9UL);
+        return (key * golden) >> _shift;
+    }
+    static size_t ident_key(capsel_t ident) {
+        // the portal selectors are aligned to the number of CPUs
+        return ident >> CPU::order();
+    }
+
+    void insert(ServiceSession *sess);
+
+    ServiceSessionTable(const ServiceSessionTable&);
+    ServiceSessionTable& operator=(const ServiceSessionTable&);
+
+    size_t _count;
+    size_t _mask;
+    uint _shift;
+    ServiceSession **_list;
+    ServiceSession **_ids;
+    ServiceSession **_idents;
+};
+
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <arch/ExecEnv.h>
+#include <util/Atomic.h>
+#include <util/Math.h>
+#include <cstring>
+
+namespace nre {
+
+/**
+ * The statistics of a service. They live in a page that is shared with the parent, so that
+ * observers like the sysinfo app can watch them live. The ServiceSession portal dispatch records
+ * the number of requests and their latency per command, Producer and Consumer record the
+ * occupancy of the rings they are attached to.
+ * All members have a fixed size so that the layout doesn't depend on the architecture. The
+ * counters are updated without locking, so that readers might see slightly inconsistent values.
+ */
+class ServiceStats {
+public:
+    static const size_t MAX_NAME_LEN        = 32;
+    static const size_t MAX_RING_NAME_LEN   = 12;
+    /**
+     * The number of commands we distinguish. Bigger commands are counted in the last slot.
+     */
+    static const size_t MAX_CMDS            = 16;
+    static const size_t MAX_RINGS           = 8;
+    /**
+     * Bucket i of the latency histograms counts the requests that took less than
+     * 2^(i + MIN_SHIFT + 1) cycles. The last bucket counts all that took longer.
+     */
+    static const size_t BUCKETS             = 24;
+    static const uint MIN_SHIFT             = 6;
+
+    /**
+     * The statistics for one command
+     */
+    struct Command {
+        uint64_t cycles;
+        uint64_t max;
+        uint64_t hist[BUCKETS];
+
+        /**
+         * @return the number of handled requests
+         */
+        uint64_t count() const {
+            uint64_t total = 0;
+            for(size_t i = 0; i < BUCKETS; ++i)
+                total += hist[i];
+            return total;
+        }
+        /**
+         * @param percent the percentile (0..100)
+         * @return an upper bound for the latency (in cycles) of <percent> percent of the requests
+         */
+        uint64_t percentile(uint percent) const {
+            uint64_t total = count();
+            uint64_t limit = (total * percent + 99) / 100;
+            uint64_t sum = 0;
+            for(size_t i = 0; i < BUCKETS - 1; ++i) {
+                sum += hist[i];
+                if(sum >= limit)
+                    return Math::min<uint64_t>(max, static_cast<uint64_t>(1) << (i + MIN_SHIFT + 1));
+            }
+            return max;
+        }
+    };
+
+    /**
+     * The statistics for a kind of ring (all rings of the same name are aggregated)
+     */
+    struct Ring {
+        char name[MAX_RING_NAME_LEN];
+        uint32_t size;
+        uint32_t level;
+        uint32_t max_level;
+        uint64_t items;
+        uint64_t full;
+
+        /**
+         * Records that an item has been put into or taken out of the ring.
+         *
+         * @param lvl the number of used slots afterwards
+         */
+        void record(size_t lvl) {
+            level = lvl;
+            if(EXPECT_FALSE(lvl > max_level))
+                max_level = lvl;
+            Atomic::add(&items, 1);
+        }
+        /**
+         * Records that the ring was full
+         */
+        void record_full() {
+            level = size;
+            max_level = size;
+            Atomic::add(&full, 1);
+        }
+    };
+
+    /**
+     * Initializes the statistics for the service with given name
+     *
+     * @param name the service name
+     */
+    explicit ServiceStats(const char *name) : _cmds(), _rings() {
+        copy_name(_name, name, MAX_NAME_LEN);
+    }
+
+    /**
+     * @return the name of the service
+     */
+    const char *name() const {
+        return _name;
+    }
+
+    /**
+     * @param cmd the command
+     * @return the statistics of given command
+     */
+    const Command &command(size_t cmd) const {
+        return _cmds[Math::min(cmd, MAX_CMDS - 1)];
+    }
+
+    /**
+     * Records a request
+     *
+     * @param cmd the command (first untyped item of the request)
+     * @param cycles the number of cycles it took to handle it
+     */
+    void record(word_t cmd, uint64_t cycles) {
+        Command &c = _cmds[Math::min<word_t>(cmd, MAX_CMDS - 1)];
+        uint bucket = cycles ? 63 - __builtin_clzll(cycles) : 0;
+        bucket = bucket > MIN_SHIFT ? Math::min<uint>(bucket - MIN_SHIFT, BUCKETS - 1) : 0;
+        Atomic::add(c.hist + bucket, 1);
+        Atomic::add(&c.cycles, cycles);
+        if(EXPECT_FALSE(cycles > c.max))
+            c.max = cycles;
+    }
+
+    /**
+     * @param idx the index
+     * @return the ring with given index or nullptr if it is not in use
+     */
+    const Ring *ring(size_t idx) const {
+        return idx < MAX_RINGS && _rings[idx].size ? _rings + idx : nullptr;
+    }
+    /**
+     * Determines the ring with given name and allocates a new one if it does not exist yet. This
+     * is not thread-safe.
+     *
+     * @param name the name of the ring
+     * @param size the number of slots
+     * @return the ring or nullptr if all are in use
+     */
+    Ring *ring(const char *name, size_t size) {
+        for(size_t i = 0; i < MAX_RINGS; ++i) {
+            if(_rings[i].size == 0) {
+                copy_name(_rings[i].name, name, MAX_RING_NAME_LEN);
+                _rings[i].size = size;
+                return _rings + i;
+            }
+            if(strcmp(_rings[i].name, name) == 0)
+                return _rings + i;
+        }
+        return nullptr;
+    }
+
+private:
+    static void copy_name(char *dst, const char *src, size_t max) {
+        size_t i;
+        for(i = 0; i < max - 1 && src[i]; ++i)
+            dst[i] = src[i];
+        dst[i] = '\0';
+    }
+
+    char _name[MAX_NAME_LEN];
+    Command _cmds[MAX_CMDS];
+    Ring _rings[MAX_RINGS];
+};
+
+static_assert(sizeof(ServiceStats) <= ExecEnv::PAGE_SIZE, "ServiceStats has to fit into a page");
+
+}
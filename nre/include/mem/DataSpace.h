@@ -43,15 +43,29 @@ class OStream;
 class DataSpace {
     template<class DS>
     friend class DataSpaceManager;
+    friend class DataSpacePool;
 
 public:
     enum RequestType {
         CREATE,
         JOIN,
         SWITCH_TO,
-        DESTROY
+        DESTROY,
+        CREATE_BATCH,
+        DESTROY_BATCH,
+        MAP_DMA
     };
 
+    enum SwitchFlags {
+        // copy the content of the source into the destination before switching
+        SWITCH_COPY     = 1 << 0,
+    };
+
+    /**
+     * The maximum number of dataspaces that can be created or destroyed with one call
+     */
+    static const size_t MAX_BATCH   = 16;
+
     /**
      * Creates a new dataspace with given properties and assigns the received capability selectors
      * to <sel> and <unmapsel>, if not zero. This function is only intended for the malloc-backend,
@@ -60,6 +74,24 @@ public:
      * @throws DataSpaceException if the creation failed
      */
     static void create(DataSpaceDesc &desc, capsel_t *sel = nullptr, capsel_t *unmapsel = nullptr);
+    /**
+     * Creates <count> dataspaces with a single call to the parent. Either all of them are created
+     * or none. Virtual dataspaces are not supported.
+     *
+     * @param descs the descriptors of the dataspaces (will be updated)
+     * @param res will receive the created dataspaces, which have been allocated on the heap
+     * @param count the number of dataspaces (at most MAX_BATCH)
+     * @throws DataSpaceException if the creation failed
+     */
+    static void create(DataSpaceDesc *descs, DataSpace **res, size_t count);
+    /**
+     * Destroys the given <count> dataspaces with a single call to the parent and deletes the
+     * objects afterwards. They have to be created by this Pd, i.e. not joined.
+     *
+     * @param ds the dataspaces, allocated on the heap
+     * @param count the number of dataspaces (at most MAX_BATCH)
+     */
+    static void destroy(DataSpace **ds, size_t count);
 
     /**
      * Creates a new dataspace with given properties
@@ -166,13 +198,33 @@ public:
     }
 
     /**
-     * Copies the contents of this dataspace into <dest> and swaps this.desc().origin() with
-     * <dest>.desc().origin(). That means, afterwards this will access the memory of <dest> and
-     * the other way around.
+     * Swaps this.desc().origin() with <dest>.desc().origin(). That means, afterwards this will
+     * access the memory of <dest> and the other way around. By default, only the backing memory
+     * is exchanged and the new mappings are established lazily on the next access. Thus, the
+     * two dataspaces exchange their contents. With SWITCH_COPY, the content of this dataspace is
+     * copied into <dest> first, so that this dataspace keeps its content. Note that this costs a
+     * copy of the whole dataspace, during which all users of the two dataspaces are stalled.
+     *
+     * @param dest the dataspace to switch with (has to have the same size)
+     * @param flags the switch flags (see SwitchFlags)
      */
-    void switch_to(DataSpace &dest);
+    void switch_to(DataSpace &dest, uint flags = 0);
+
+    /**
+     * Asks the parent to map this dataspace completely into the DMA page table of our Pd. That
+     * is, afterwards, all devices that have been assigned to our Pd (see Syscalls::assign_pci)
+     * can access this dataspace at virt(). The mappings stay valid until the dataspace is
+     * destroyed.
+     */
+    void map_dma() const;
 
 private:
+    explicit DataSpace(const DataSpaceDesc &desc, capsel_t sel, capsel_t unmapsel)
+        : _desc(desc), _sel(sel), _unmapsel(unmapsel) {
+        if(_desc.type() == DataSpaceDesc::LOCKED)
+            touch();
+    }
+
     void create();
     void join();
     void destroy();
@@ -45,6 +45,9 @@ public:
         RX          = R | X,
         RWX         = R | W | X,
         BIGPAGES    = 1 << 3,   // use 4M pages; requires an align to 4M
+        // set by the creator of an anonymous dataspace, if the memory has been zeroed. this is
+        // only valid for the one that created the dataspace, not for joiners
+        ZEROED      = 1 << 6,
     };
 
     /**
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <arch/ExecEnv.h>
+#include <kobj/UserSm.h>
+#include <mem/DataSpace.h>
+
+namespace nre {
+
+/**
+ * Keeps already created and mapped anonymous dataspaces for reuse. This way, short-lived buffers
+ * do not cost a call to the parent (and possibly further ones up to root) each time. The
+ * dataspaces are kept in size classes of power-of-two pages. If a class is empty, it is refilled
+ * with a single batched call to the parent and if it is full, half of it is destroyed with one
+ * call as well.
+ * Note that the content of a dataspace is not cleared when it is handed out again. So, if
+ * dataspaces are passed to different clients, please clear them yourself if necessary.
+ */
+class DataSpacePool {
+public:
+    /**
+     * The number of size classes: from one page up to PAGE_SIZE << (CLASSES - 1)
+     */
+    static const size_t CLASSES     = 10;
+    /**
+     * The maximum number of cached dataspaces per class
+     */
+    static const size_t MAX_FREE    = DataSpace::MAX_BATCH;
+
+    /**
+     * Creates an empty pool
+     *
+     * @param flags the flags for the dataspaces (see DataSpaceDesc::Perm)
+     * @param refill the number of dataspaces to create at once if a class is empty
+     */
+    explicit DataSpacePool(uint flags = DataSpaceDesc::RW, size_t refill = 4);
+    /**
+     * Destroys all cached dataspaces. Dataspaces that have been handed out are not affected.
+     */
+    ~DataSpacePool();
+
+    /**
+     * Hands out a dataspace with at least <size> bytes. If <size> is larger than the largest
+     * class, a new dataspace is created.
+     *
+     * @param size the size in bytes
+     * @return the dataspace (allocated on the heap)
+     * @throws DataSpaceException if the creation failed
+     */
+    DataSpace *alloc(size_t size);
+    /**
+     * Puts the given dataspace, that has been handed out by alloc(), back to the pool. If it
+     * does not belong into a class, it is destroyed immediately.
+     *
+     * @param ds the dataspace
+     */
+    void free(DataSpace *ds);
+
+    /**
+     * Destroys all cached dataspaces
+     */
+    void flush();
+
+    /**
+     * @return the number of cached dataspaces
+     */
+    size_t cached() const;
+
+private:
+    static size_t class_size(size_t cls) {
+        return ExecEnv::PAGE_SIZE << cls;
+    }
+    static size_t class_of(size_t size);
+    void refill(size_t cls);
+    void trim(size_t cls, size_t keep);
+
+    DataSpacePool(const DataSpacePool&);
+    DataSpacePool& operator=(const DataSpacePool&);
+
+    uint _flags;
+    size_t _refill;
+    DataSpace *_free[CLASSES][MAX_FREE];
+    size_t _count[CLASSES];
+    mutable UserSm _sm;
+};
+
+}
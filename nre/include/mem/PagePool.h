@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+#pragma once
+
+#include <arch/Types.h>
+#include <arch/ExecEnv.h>
+#include <kobj/UserSm.h>
+#include <mem/DataSpace.h>
+#include <collection/SList.h>
+
+namespace nre {
+
+/**
+ * Hands out single pages that are carved out of larger anonymous dataspaces. This is intended for
+ * users that need memory page by page and in unpredictable amounts (e.g. the private copies of
+ * copy-on-write dataspaces), where one dataspace per page would be far too expensive. The chunks
+ * are never returned to the parent; freed pages are kept in a free list and reused instead.
+ */
+class PagePool {
+    class Chunk : public SListItem {
+    public:
+        explicit Chunk(size_t size)
+            : SListItem(), ds(size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW) {
+        }
+
+        DataSpace ds;
+    };
+
+public:
+    /**
+     * The number of pages to request from the parent at once
+     */
+    static const size_t CHUNK_PAGES     = 64;
+
+    /**
+     * Creates an empty pool
+     */
+    explicit PagePool() : _sm(), _chunks(), _free(), _total(), _used() {
+    }
+    /**
+     * Destroys all chunks. Note that all pages have to be freed before.
+     */
+    ~PagePool();
+
+    /**
+     * Allocates a page. The content is undefined.
+     *
+     * @return the address of the page
+     * @throws DataSpaceException if a new chunk could not be created
+     */
+    uintptr_t alloc();
+    /**
+     * Puts the given page back into the pool. All mappings of the page, that have been
+     * established by us, are revoked before, so that it can be handed out to somebody else.
+     *
+     * @param page the page address, as returned by alloc()
+     */
+    void free(uintptr_t page);
+
+    /**
+     * @return the total number of pages in the pool
+     */
+    size_t total() const {
+        return _total;
+    }
+    /**
+     * @return the number of pages that are in use
+     */
+    size_t used() const {
+        return _used;
+    }
+
+private:
+    PagePool(const PagePool&);
+    PagePool& operator=(const PagePool&);
+
+    UserSm _sm;
+    SList<Chunk> _chunks;
+    uintptr_t _free;
+    size_t _total;
+    size_t _used;
+};
+
+}
@@ -18,6 +18,8 @@
 
 #include <arch/Types.h>
 #include <ipc/PtClientSession.h>
+#include <mem/DataSpace.h>
+#include <util/ScopedCapSels.h>
 #include <utcb/UtcbFrame.h>
 #include <util/BDF.h>
 
@@ -30,6 +32,15 @@ class PCIConfig {
 public:
     typedef uint32_t value_type;
 
+    /**
+     * The size of the (legacy) PCI config space of a device in bytes
+     */
+    static const size_t SPACE_SIZE      = 0x100;
+    /**
+     * The size of the PCI express (extended) config space of a device in bytes
+     */
+    static const size_t EXT_SPACE_SIZE  = 0x1000;
+
     /**
      * The available commands
      */
@@ -39,7 +50,17 @@ public:
         ADDR,
         REBOOT,
         SEARCH_DEVICE,
-        SEARCH_BRIDGE
+        SEARCH_BRIDGE,
+        SEARCH_ID,
+        READ_ALL,
+        MAP_CONFIG,
+    };
+
+    /**
+     * The complete (legacy) config space of a device
+     */
+    struct Space {
+        value_type dwords[SPACE_SIZE / sizeof(value_type)];
     };
 
 private:
@@ -132,6 +153,59 @@ public:
         return bdf;
     }
 
+    /**
+     * Searches for the <inst>'th device that has the given vendor- and device-id.
+     *
+     * @param vendor the vendor-id
+     * @param device the device-id (~0U = ignore)
+     * @param inst the instance of the device (~0U = ignore)
+     * @return the bus-device-function triple if found
+     * @throws Exception if the device was not found
+     */
+    BDF search_id(value_type vendor, value_type device = ~0U, uint inst = ~0U) const {
+        UtcbFrame uf;
+        uf << PCIConfig::SEARCH_ID << vendor << device << inst;
+        pt().call(uf);
+        uf.check_reply();
+        BDF bdf;
+        uf >> bdf;
+        return bdf;
+    }
+
+    /**
+     * Reads the complete (legacy) config space of the given device with one call.
+     *
+     * @param bdf the bus-device-function triple
+     * @param space the space to read into
+     * @throws Exception if not found
+     */
+    void read_all(BDF bdf, PCIConfig::Space &space) const {
+        UtcbFrame uf;
+        uf << PCIConfig::READ_ALL << bdf;
+        pt().call(uf);
+        uf.check_reply();
+        uf >> space;
+    }
+
+    /**
+     * Maps the complete extended config space of the given device read-only into your address
+     * space. Afterwards, you can read the config space without any further calls.
+     * This requires MMCONFIG.
+     *
+     * @param bdf the bus-device-function triple
+     * @return the dataspace with a size of PCIConfig::EXT_SPACE_SIZE
+     * @throws Exception if not found or MMCONFIG is not available
+     */
+    DataSpace map_config(BDF bdf) const {
+        ScopedCapSels cap;
+        UtcbFrame uf;
+        uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
+        uf << PCIConfig::MAP_CONFIG << bdf;
+        pt().call(uf);
+        uf.check_reply();
+        return DataSpace(cap.release());
+    }
+
     /**
      * Searches for the bridge with given id
      *
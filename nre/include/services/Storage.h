@@ -37,6 +37,8 @@ public:
     static const size_t MAX_CONTROLLER      = 8;
     static const size_t MAX_DRIVES          = 32;   // per controller
     static const size_t MAX_DMA_DESCS       = 64;
+    // used as scratch drive to keep the overlay of a virtual drive in RAM
+    static const size_t OVERLAY_RAM         = static_cast<size_t>(-1);
 
     typedef DMADescList<MAX_DMA_DESCS> dma_type;
 
@@ -101,6 +103,23 @@ public:
           _cons(_ctrlds, _sm, true) {
         init(ds);
     }
+    /**
+     * Creates a new session at given service for a virtual drive that is layered over the given
+     * drive. The drive itself is never written. Instead, all writes go to an overlay that is
+     * private to this session and is kept in RAM or on the scratch drive <scratch>. This way,
+     * multiple clients can share one drive as a base image.
+     *
+     * @param service the service name
+     * @param ds the dataspace to use for data exchange
+     * @param drive the base drive
+     * @param scratch the drive to store the overlay on or Storage::OVERLAY_RAM
+     */
+    explicit StorageSession(const String &service, DataSpace &ds, size_t drive, size_t scratch)
+        : PtClientSession(service, build_args(drive, scratch)),
+          _ctrlds(ExecEnv::PAGE_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW), _sm(0),
+          _cons(_ctrlds, _sm, true) {
+        init(ds);
+    }
 
     /**
      * @return the consumer to get notified about finished commands
@@ -206,6 +225,15 @@ private:
         os << drive;
         return os.str();
     }
+    static String build_args(size_t drive, size_t scratch) {
+        OStringStream os;
+        os << drive << " overlay=";
+        if(scratch == Storage::OVERLAY_RAM)
+            os << "ram";
+        else
+            os << scratch;
+        return os.str();
+    }
 
     DataSpace _ctrlds;
     Sm _sm;
@@ -18,7 +18,14 @@
 
 #include <arch/Types.h>
 #include <ipc/PtClientSession.h>
+#include <mem/DataSpace.h>
+#include <util/ScopedCapSels.h>
+#include <util/Sync.h>
+#include <util/Util.h>
+#include <util/Math.h>
 #include <utcb/UtcbFrame.h>
+#include <Hip.h>
+#include <cstring>
 
 namespace nre {
 
@@ -107,6 +114,121 @@ public:
         size_t _threads;
     };
 
+    /**
+     * A snapshot of the whole system state, i.e. of all Scs, Pds and the memory usage. It lives in
+     * a dataspace that root shares read-only with all sysinfo clients and refreshes once per
+     * period. Thus, monitoring tools can read it without any IPC. Root updates it with a seqlock:
+     * <version> is odd while an update is in progress and incremented again afterwards. Use
+     * read() to get a consistent copy.
+     * All members have a fixed size so that the layout doesn't depend on the architecture.
+     */
+    class Snapshot {
+    public:
+        static const size_t MAX_NAME_LEN    = 32;
+        static const size_t MAX_CMDLINE_LEN = 64;
+        static const size_t MAX_SCS         = 256;
+        static const size_t MAX_PDS         = 64;
+        // the refresh period (in milliseconds)
+        static const uint64_t PERIOD_MS     = 1000;
+
+        /**
+         * The information about a global thread
+         */
+        struct Sc {
+            char name[MAX_NAME_LEN];
+            uint64_t cpu;
+            // the time run in the last period (in microseconds)
+            uint64_t time;
+            // the total time run so far (in microseconds)
+            uint64_t totaltime;
+        };
+
+        /**
+         * The information about a Pd. The first one is always root itself.
+         */
+        struct Pd {
+            char cmdline[MAX_CMDLINE_LEN];
+            uint64_t virt;
+            uint64_t phys;
+            uint64_t threads;
+        };
+
+        /**
+         * Copies this snapshot to <dst>. Since root might update it concurrently, it retries until
+         * the copy is consistent. Only the used Sc and Pd entries are copied.
+         *
+         * @param dst the destination
+         */
+        void read(Snapshot &dst) const {
+            while(true) {
+                uint32_t ver = version;
+                Sync::memory_barrier();
+                if(!(ver & 1)) {
+                    dst.timestamp = timestamp;
+                    dst.mem_total = mem_total;
+                    dst.mem_free = mem_free;
+                    memcpy(dst.cputime, cputime, sizeof(cputime));
+                    dst.sc_count = Math::min<size_t>(sc_count, MAX_SCS);
+                    dst.pd_count = Math::min<size_t>(pd_count, MAX_PDS);
+                    memcpy(dst.scs, scs, dst.sc_count * sizeof(Sc));
+                    memcpy(dst.pds, pds, dst.pd_count * sizeof(Pd));
+                    Sync::memory_barrier();
+                    if(version == ver) {
+                        dst.version = ver;
+                        return;
+                    }
+                }
+                Util::pause();
+            }
+        }
+
+        /**
+         * @param now the current TSC value
+         * @param periods the number of periods after which it is outdated
+         * @return true if the snapshot has never been refreshed or is older than <periods>
+         */
+        bool outdated(uint64_t now, uint periods = 1) const {
+            return version == 0 || now - timestamp >= periods * PERIOD_MS * Hip::get().freq_tsc;
+        }
+
+        /**
+         * Starts an update. Readers will retry until end_update() has been called.
+         */
+        void begin_update() {
+            version++;
+            Sync::memory_barrier();
+        }
+        /**
+         * Finishes an update
+         */
+        void end_update() {
+            Sync::memory_barrier();
+            version++;
+        }
+
+        /**
+         * Copies the string <src> with length <len> into <dst>, which has room for <max> chars.
+         */
+        static void copy_str(char *dst, const char *src, size_t len, size_t max) {
+            len = Math::min(len, max - 1);
+            memcpy(dst, src, len);
+            dst[len] = '\0';
+        }
+
+        uint32_t version;
+        uint32_t sc_count;
+        uint32_t pd_count;
+        uint32_t : 32;
+        // the TSC value of the last update
+        uint64_t timestamp;
+        uint64_t mem_total;
+        uint64_t mem_free;
+        // the total time that elapsed in the last period on each CPU (in microseconds)
+        uint64_t cputime[Hip::MAX_CPUS];
+        Sc scs[MAX_SCS];
+        Pd pds[MAX_PDS];
+    };
+
     /**
      * The available commands
      */
@@ -115,6 +237,9 @@ public:
         GET_TIMEUSER,
         GET_MEM,
         GET_CHILD,
+        GET_SERVICE,
+        GET_SERVICE_STATS,
+        GET_SNAPSHOT,
     };
 };
 
@@ -201,6 +326,65 @@ public:
         uf >> c._cmdline >> c._virt >> c._phys >> c._threads;
         return true;
     }
+
+    /**
+     * Gets the name of the service number <idx>.
+     *
+     * @param idx the index
+     * @param name will be set to the name
+     * @return true if <idx> exists
+     */
+    bool get_service(size_t idx, String &name) {
+        UtcbFrame uf;
+        uf << SysInfo::GET_SERVICE << idx;
+        pt().call(uf);
+        uf.check_reply();
+        bool found;
+        uf >> found;
+        if(!found)
+            return false;
+        uf >> name;
+        return true;
+    }
+
+    /**
+     * Gets the statistics of the service with given name. The dataspace contains a ServiceStats
+     * object, which is updated live by the service.
+     *
+     * @param name the service name
+     * @return the dataspace (you have to delete it) or nullptr if the service has no statistics
+     */
+    DataSpace *get_service_stats(const String &name) {
+        UtcbFrame uf;
+        ScopedCapSels cap;
+        uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
+        uf << SysInfo::GET_SERVICE_STATS << name;
+        pt().call(uf);
+        uf.check_reply();
+        bool found;
+        uf >> found;
+        if(!found)
+            return nullptr;
+        return new DataSpace(cap.release());
+    }
+
+    /**
+     * Gets the dataspace with the system snapshot. It contains a SysInfo::Snapshot object, which
+     * is refreshed by root periodically. Afterwards, no IPC is required to watch the system.
+     * If root has no timer, it refreshes the snapshot only here, if it is outdated. Thus, call it
+     * again in this case.
+     *
+     * @return the read-only dataspace (you have to delete it)
+     */
+    DataSpace *get_snapshot() {
+        UtcbFrame uf;
+        ScopedCapSels cap;
+        uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
+        uf << SysInfo::GET_SNAPSHOT;
+        pt().call(uf);
+        uf.check_reply();
+        return new DataSpace(cap.release());
+    }
 };
 
 }
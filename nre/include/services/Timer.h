@@ -18,7 +18,10 @@
 
 #include <arch/Types.h>
 #include <ipc/PtClientSession.h>
+#include <ipc/Consumer.h>
+#include <mem/DataSpace.h>
 #include <utcb/UtcbFrame.h>
+#include <Assert.h>
 #include <CPU.h>
 
 namespace nre {
@@ -29,6 +32,10 @@ namespace nre {
 class Timer {
 public:
     static const uint WALLCLOCK_FREQ    = 1000000;
+    /**
+     * The maximum number of timers per session and CPU
+     */
+    static const size_t MAX_TIMERS      = 65536;
 
     /**
      * The available commands
@@ -36,7 +43,25 @@ public:
     enum Command {
         GET_SMS,
         PROG_TIMER,
-        GET_TIME
+        GET_TIME,
+        INIT_TIMERS,
+        ARM_TIMER,
+        CANCEL_TIMER,
+    };
+
+    /**
+     * The notification about an expired timer, which is put into the expiry ring
+     */
+    struct Expiry {
+        // the timer id
+        uint32_t id;
+        // the CPU it has been armed on
+        uint32_t cpu;
+        // the number of expirations since the last notification. this is more than one if a
+        // periodic timer expired multiple times before the notification could be delivered.
+        uint32_t count;
+        // the deadline (TSC value) of the last expiration
+        timevalue_t deadline;
     };
 
 private:
@@ -53,13 +78,17 @@ public:
      *
      * @param service the service name
      */
-    explicit TimerSession(const String &service) : PtClientSession(service) {
+    explicit TimerSession(const String &service)
+        : PtClientSession(service), _tds(), _tsm(), _tcons() {
         get_sms();
     }
     /**
      * Destroys this session
      */
     virtual ~TimerSession() {
+        delete _tcons;
+        delete _tsm;
+        delete _tds;
         for(cpu_t cpu = 0; cpu < CPU::count(); ++cpu)
             delete _sms[cpu];
         delete[] _sms;
@@ -108,6 +137,65 @@ public:
         uf.check_reply();
     }
 
+    /**
+     * Enables the timer ids 0..<count>-1 on every CPU. In contrast to program(), you can have many
+     * of these timers armed at the same time, each of them either one-shot or periodic. The
+     * expirations of all timers are reported via the ring in expiries(), i.e. you can collect the
+     * expirations of many timers with one wakeup.
+     *
+     * @param count the number of timer ids per CPU (at most Timer::MAX_TIMERS)
+     * @param ringsize the size of the expiry ring in bytes
+     */
+    void init_timers(size_t count, size_t ringsize = ExecEnv::PAGE_SIZE) {
+        assert(_tds == nullptr);
+        _tds = new DataSpace(ringsize, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+        _tsm = new Sm(0);
+        _tcons = new Consumer<Timer::Expiry>(*_tds, *_tsm, true);
+        UtcbFrame uf;
+        uf.delegate(_tds->sel(), 0);
+        uf.delegate(_tsm->sel(), 1);
+        uf << Timer::INIT_TIMERS << count;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * @return the consumer for the expiry ring (requires init_timers())
+     */
+    Consumer<Timer::Expiry> &expiries() {
+        return *_tcons;
+    }
+
+    /**
+     * Arms the timer <id> on the current CPU for the TSC value <deadline>. If it is already
+     * armed, it is re-armed. If <period> is not zero, the timer fires every <period> cycles after
+     * <deadline> until it is canceled. The period is relative to the previous deadline, not to
+     * the time the expiration has been handled, so that the timer doesn't drift.
+     *
+     * @param id the timer id
+     * @param deadline the TSC value of the first expiration
+     * @param period the period in cycles (0 = one-shot)
+     */
+    void arm(uint id, timevalue_t deadline, timevalue_t period = 0) {
+        UtcbFrame uf;
+        uf << Timer::ARM_TIMER << id << deadline << period;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * Cancels the timer <id> on the current CPU. Note that there might still be an expiration
+     * of this timer in the ring.
+     *
+     * @param id the timer id
+     */
+    void cancel(uint id) {
+        UtcbFrame uf;
+        uf << Timer::CANCEL_TIMER << id;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
     /**
      * Determines the current time
      *
@@ -138,6 +226,9 @@ private:
 
     capsel_t _caps;
     Sm **_sms;
+    DataSpace *_tds;
+    Sm *_tsm;
+    Consumer<Timer::Expiry> *_tcons;
 };
 
 }
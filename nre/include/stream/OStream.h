@@ -25,7 +25,9 @@ namespace nre {
 /**
  * The output-stream is used to write formatted output to various destinations. Subclasses have
  * to implement the method to actually write a character. This class provides the higher-level
- * stuff around it.
+ * stuff around it. Strings, numbers and padding are passed to the subclass as a whole via
+ * write(const char*,size_t), which subclasses should override if they can do better than writing
+ * one character after another.
  *
  * It is encouraged to only use the shift operators for writing to the stream. Because writef()
  * is not type-safe, which means you can easily make mistakes and won't notice it. I know that
@@ -344,7 +346,20 @@ public:
     int vwritef(const char *fmt, va_list ap);
 
 private:
+    /**
+     * The maximum number of characters of an integer (base 2 and a sign)
+     */
+    static const size_t MAX_INT_LEN     = sizeof(ullong) * 8 + 1;
+
     virtual void write(char c) = 0;
+    /**
+     * Writes <len> characters of <str> into the stream. The default implementation uses
+     * write(char) for each character.
+     *
+     * @param str the characters
+     * @param len the number of characters
+     */
+    virtual void write(const char *str, size_t len);
 
     int printsignedprefix(llong n, uint flags);
     int putspad(const char *s, uint pad, uint prec, uint flags);
@@ -18,6 +18,7 @@
 
 #include <stream/OStream.h>
 #include <cstdlib>
+#include <cstring>
 
 namespace nre {
 
@@ -85,6 +86,27 @@ private:
         }
     }
 
+    virtual void write(const char *str, size_t len) {
+        // increase the buffer, if necessary
+        if(_pos + len >= _max && _dynamic) {
+            size_t nmax = _max ? _max : DEFAULT_SIZE;
+            while(_pos + len >= nmax)
+                nmax *= 2;
+            char *ndst = static_cast<char*>(realloc(_dst, nmax));
+            if(ndst) {
+                _max = nmax;
+                _dst = ndst;
+            }
+        }
+        // write as much as fits into the buffer
+        if(_pos + 1 < _max) {
+            size_t amount = len < _max - _pos - 1 ? len : _max - _pos - 1;
+            memcpy(_dst + _pos, str, amount);
+            _pos += amount;
+            _dst[_pos] = '\0';
+        }
+    }
+
     bool _dynamic;
     char *_dst;
     size_t _max;
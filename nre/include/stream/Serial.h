@@ -29,7 +29,8 @@ namespace nre {
 class LogSession;
 
 /**
- * Common base class for all serial-outstreams. Should not be used directly.
+ * Common base class for all serial-outstreams. Should not be used directly. It offers a line
+ * buffer for the subclasses that write their output line-wise.
  */
 class BaseSerial : public OStream {
     friend class ::Log;
@@ -37,10 +38,38 @@ class BaseSerial : public OStream {
 protected:
     static const size_t MAX_LINE_LEN    = 120;
 
-    explicit BaseSerial() : OStream() {
+    explicit BaseSerial() : OStream(), _bufpos(0), _buf() {
+    }
+
+    /**
+     * Appends <c> to the line buffer. If the line is complete or the buffer is full, the buffer
+     * is passed to flush().
+     *
+     * @param c the character
+     */
+    void buffer(char c);
+    /**
+     * Appends the <len> characters of <str> to the line buffer. This is the same as calling
+     * buffer(char) for each character, but copies all characters up to the next newline at once.
+     *
+     * @param str the characters
+     * @param len the number of characters
+     */
+    void buffer(const char *str, size_t len);
+    /**
+     * Writes out the line <line> with <len> characters (without newline). Is called by buffer().
+     *
+     * @param line the line
+     * @param len the length of the line
+     */
+    virtual void flush(const char *, size_t) {
     }
 
     static BaseSerial *_inst;
+
+private:
+    size_t _bufpos;
+    char _buf[MAX_LINE_LEN + 1];
 };
 
 /**
@@ -65,11 +94,15 @@ private:
     explicit Serial();
     virtual ~Serial();
 
-    virtual void write(char c);
+    virtual void write(char c) {
+        buffer(c);
+    }
+    virtual void write(const char *str, size_t len) {
+        buffer(str, len);
+    }
+    virtual void flush(const char *line, size_t len);
 
     LogSession *_sess;
-    size_t _bufpos;
-    char _buf[MAX_LINE_LEN + 1];
 };
 
 }
@@ -119,6 +119,18 @@ public:
     virtual void write(char c) {
         put((static_cast<ushort>(_color) << 8) | c, _pos);
     }
+    /**
+     * Writes the given characters to the console
+     *
+     * @param str the characters
+     * @param len the number of characters
+     */
+    virtual void write(const char *str, size_t len) {
+        uintptr_t addr = _sess.screen().virt() + TEXT_OFF + _page * PAGE_SIZE;
+        ushort *base = reinterpret_cast<ushort*>(addr);
+        for(size_t i = 0; i < len; ++i)
+            put((static_cast<ushort>(_color) << 8) | str[i], base, _pos);
+    }
 
     /**
      * Writes the given character+colorcode to the given position and updates <pos> accordingly.
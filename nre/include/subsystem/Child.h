@@ -129,6 +129,17 @@ class Child : public SListTreapNode<size_t>, public RefCounted {
 public:
     typedef size_t id_type;
 
+    /**
+     * The points in time (TSC) of the steps during the startup of a child. A value of 0 means
+     * that the step has not been reached yet.
+     */
+    struct Timeline {
+        timevalue_t load;       // the ChildManager started to load the ELF file
+        timevalue_t inflated;   // the compressed ELF file has been decompressed (0 if it wasn't)
+        timevalue_t start;      // the main thread executes its first instruction
+        timevalue_t ready;      // the child registered its most recent service
+    };
+
     /**
      * @return the id of this child
      */
@@ -154,6 +165,19 @@ public:
         return _cmdline;
     }
 
+    /**
+     * @return the startup timeline
+     */
+    const Timeline &timeline() const {
+        return _timeline;
+    }
+    /**
+     * @return the size of the (decompressed) ELF file it has been loaded from
+     */
+    size_t image_size() const {
+        return _imgsize;
+    }
+
     /**
      * @return the entry-point (0 = main)
      */
@@ -241,8 +265,9 @@ public:
 private:
     explicit Child(ChildManager *cm, id_type id, const String &cmdline)
         : SListTreapNode<size_t>(id), RefCounted(), _cm(cm), _id(id), _cmdline(cmdline), _started(),
+          _timeline(), _imgsize(),
           _pd(), _ec(), _pts(), _ptcount(), _regs(), _io(PortManager::USED), _scs(), _gsis(),
-          _sessions(), _joins(),  _gsi_caps(CapSelSpace::get().allocate(Hip::MAX_GSIS)),
+          _sessions(), _joins(), _gsi_caps(CapSelSpace::get().allocate(Hip::MAX_GSIS)),
           _gsi_next(), _entry(), _main(), _stack(), _utcb(), _hip(), _sm() {
     }
 public:
@@ -277,6 +302,8 @@ private:
     id_type _id;
     String _cmdline;
     bool _started;
+    Timeline _timeline;
+    size_t _imgsize;
     Pd *_pd;
     Reference<GlobalThread> _ec;
     Pt **_pts;
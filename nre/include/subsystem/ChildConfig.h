@@ -31,6 +31,7 @@ namespace nre {
 class ChildConfig {
 public:
     static const size_t MAX_WAITS       = 4;
+    static const size_t MAX_REQUIRES    = 8;
 
     enum ModuleAccess {
         OWN,                // access only to its own module
@@ -47,7 +48,7 @@ public:
      */
     explicit ChildConfig(size_t no, const String &cmdline, cpu_t cpu = CPU::current().log_id())
         : _no(no), _last(false), _modaccess(OWN), _cpu(cpu), _cpus(), _entry(0), _waitcount(),
-          _waits(), _cmdline() {
+          _waits(), _has_reqs(false), _reqcount(), _reqs(), _cmdline() {
         parse(cmdline);
     }
     virtual ~ChildConfig() {
@@ -80,6 +81,26 @@ public:
         return _waits[i];
     }
 
+    /**
+     * @return true if the dependencies have been specified explicitly via "requires=..."
+     */
+    bool has_requirements() const {
+        return _has_reqs;
+    }
+    /**
+     * @return the number of services this child requires
+     */
+    size_t requirements() const {
+        return _reqcount;
+    }
+    /**
+     * @param i the index
+     * @return the name of the service this child requires
+     */
+    const String &requirement(size_t i) const {
+        return _reqs[i];
+    }
+
     /**
      * @return the commandline
      */
@@ -149,6 +170,8 @@ private:
                     _last = true;
                 else if(strncmp(start, "provides=", 9) == 0 && _waitcount < MAX_WAITS)
                     _waits[_waitcount++] = String(start + 9, len - 9);
+                else if(strncmp(start, "requires=", 9) == 0)
+                    parse_requires(start + 9, len - 9);
                 else {
                     if(pos + len + 1 >= sizeof(buffer))
                         len = sizeof(buffer) - (pos + 2);
@@ -161,6 +184,18 @@ private:
         buffer[pos - 1] = '\0';
         _cmdline.reset(buffer, pos - 1);
     }
+    void parse_requires(const char *list, size_t len) {
+        // a comma-separated list of service names; may be empty to denote no dependencies at all
+        _has_reqs = true;
+        const char *start = list;
+        for(size_t i = 0; i <= len; ++i) {
+            if(i == len || list[i] == ',') {
+                if(list + i > start && _reqcount < MAX_REQUIRES)
+                    _reqs[_reqcount++] = String(start, list + i - start);
+                start = list + i + 1;
+            }
+        }
+    }
 
     size_t _no;
     bool _last;
@@ -170,6 +205,9 @@ private:
     uintptr_t _entry;
     size_t _waitcount;
     String _waits[MAX_WAITS];
+    bool _has_reqs;
+    size_t _reqcount;
+    String _reqs[MAX_REQUIRES];
     String _cmdline;
 };
 
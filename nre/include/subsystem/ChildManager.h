@@ -22,6 +22,9 @@
 #include <subsystem/Child.h>
 #include <subsystem/ChildConfig.h>
 #include <mem/DataSpaceManager.h>
+#include <mem/PagePool.h>
+#include <util/Atomic.h>
+#include <util/Util.h>
 #include <Exception.h>
 
 namespace nre {
@@ -136,6 +139,48 @@ class ChildManager {
 public:
     typedef typename SListTreap<Child>::const_iterator iterator;
 
+    /**
+     * A prepared ELF file. Its LOAD segments are kept in pristine dataspaces, so that any number of
+     * childs can be started from it without parsing and copying the ELF file again: read-only
+     * segments are shared by all childs and writable segments are mapped copy-on-write.
+     */
+    class Image {
+        friend class ChildManager;
+
+        struct Segment {
+            const DataSpace *ds;
+            uintptr_t virt;
+            uint perms;
+        };
+
+    public:
+        /**
+         * The maximum number of LOAD segments
+         */
+        static const size_t MAX_SEGMENTS    = 8;
+
+        /**
+         * @return the entry point
+         */
+        uintptr_t entry() const {
+            return _entry;
+        }
+        /**
+         * @return the number of segments
+         */
+        size_t segments() const {
+            return _count;
+        }
+
+    private:
+        explicit Image(uintptr_t entry) : _entry(entry), _count(), _segs() {
+        }
+
+        uintptr_t _entry;
+        size_t _count;
+        Segment _segs[MAX_SEGMENTS];
+    };
+
     /**
      * Some settings
      */
@@ -156,6 +201,8 @@ public:
      * Pd, adds the correspondings segments to that Pd, creates a main thread and finally starts
      * the main thread. Afterwards, if the command line contains "provides=..." it waits until
      * the service with given name is registered.
+     * The ELF file may be LZ4 compressed. In this case, the segments are decompressed directly
+     * into their dataspaces in one pass.
      *
      * @param addr the address of the ELF file
      * @param size the size of the ELF file
@@ -166,6 +213,59 @@ public:
      * @throws Exception if something else failed
      */
     Child::id_type load(uintptr_t addr, size_t size, const ChildConfig &config);
+    /**
+     * Like load(), but does not wait for the services the child provides. This method may be
+     * called by multiple threads in parallel.
+     *
+     * @param addr the address of the ELF file
+     * @param size the size of the ELF file
+     * @param config the config to use
+     * @return the id of the created child
+     * @throws ELFException if the ELF is invalid
+     * @throws Exception if something else failed
+     */
+    Child::id_type start(uintptr_t addr, size_t size, const ChildConfig &config);
+
+    /**
+     * Prepares the ELF file <addr>...<addr>+<size> for starting childs from it via
+     * load(const Image&,...). The ELF file is no longer needed afterwards. Like for load(), it
+     * may be LZ4 compressed.
+     *
+     * @param addr the address of the ELF file
+     * @param size the size of the ELF file
+     * @return the image (has to be destroyed via destroy_image())
+     * @throws ELFException if the ELF is invalid
+     * @throws Exception if something else failed
+     */
+    Image *create_image(uintptr_t addr, size_t size);
+    /**
+     * Destroys the given image. Childs that have been started from it are not affected.
+     *
+     * @param img the image
+     */
+    void destroy_image(Image *img);
+    /**
+     * Like load(uintptr_t,size_t,const ChildConfig&), but starts the child from the given image.
+     * That is, the read-only segments are shared with all other childs from this image and the
+     * writable segments are copied page by page on the first write. Thus, this is considerably
+     * faster and the child only consumes memory for the pages it changes.
+     *
+     * @param img the image
+     * @param config the config to use
+     * @return the id of the created child
+     * @throws Exception if something failed
+     */
+    Child::id_type load(const Image &img, const ChildConfig &config);
+    /**
+     * Like load(const Image&,const ChildConfig&), but does not wait for the services the child
+     * provides.
+     *
+     * @param img the image
+     * @param config the config to use
+     * @return the id of the created child
+     * @throws Exception if something failed
+     */
+    Child::id_type start(const Image &img, const ChildConfig &config);
 
     /**
      * @return the number of childs
@@ -179,6 +279,13 @@ public:
     Sm &dead_sm() {
         return _diesm;
     }
+    /**
+     * @return a semaphore that is up'ed as soon as a service has been registered. Note that load()
+     *  uses it as well, i.e. don't use it while another thread uses load().
+     */
+    Sm &reg_sm() {
+        return _regsm;
+    }
 
     /**
      * The up-/down-implementation to allow ScopedLock<ChildManager>. This is required if you want
@@ -245,6 +352,16 @@ public:
     capsel_t reg_service(capsel_t cap, const String& name, const BitField<Hip::MAX_CPUS> &available) {
         return reg_service(nullptr, cap, name, available);
     }
+    /**
+     * Sets the statistics dataspace of the given service, which has been registered by the task
+     * that hosts the childmanager.
+     *
+     * @param cap the dataspace capability
+     * @param name the service name
+     */
+    void reg_stats(capsel_t cap, const String& name) {
+        reg_stats(nullptr, cap, name);
+    }
     /**
      * Unregisters the service with given name
      *
@@ -255,6 +372,8 @@ public:
     }
 
 private:
+    class ElfStream;
+
     static size_t per_child_caps() {
         return Math::next_pow2(Hip::get().service_caps() * CPU::count());
     }
@@ -277,25 +396,42 @@ private:
                          const BitField<Hip::MAX_CPUS> &available) {
         ScopedLock<UserSm> guard(&_sm);
         const ServiceRegistry::Service *srv = _registry.reg(c, name, pts, 1 << CPU::order(), available);
+        if(c)
+            c->_timeline.ready = Util::tsc();
         _regsm.up();
         return srv->sm().sel();
     }
-    void unreg_service(Child *c, const String& name) {
-        ScopedLock<UserSm> guard(&_sm);
-        _registry.unreg(c, name);
-    }
+    void reg_stats(Child *c, capsel_t cap, const String& name);
+    void unreg_service(Child *c, const String& name);
+    void release_stats(const ServiceRegistry::Service &s);
 
     void exception_kill(Child *c, int vector);
     void term_child(Child *c, int vector, UtcbExcFrameRef &uf);
     void kill_child(Child *c, int vector, UtcbExcFrameRef &uf, ExitType type, int exitcode);
     void destroy_child(Child *c);
 
+    Child::id_type create(const ChildConfig &config, uintptr_t addr, size_t size, const Image *img);
+    const DataSpace &create_segment(uintptr_t src, size_t filesz, size_t memsz);
+    void wait_services(const ChildConfig &config);
+    static void cow_fault(UtcbExcFrameRef &uf, ChildMemory::DS *ds, uintptr_t pfpage, uint flags,
+                          uint perms, unsigned error);
+
     static void prepare_stack(Child *c, uintptr_t &sp, uintptr_t csp);
     void build_hip(Child *c, const ChildConfig &config);
 
     void map(UtcbFrameRef &uf, Child *c, DataSpace::RequestType type);
+    /**
+     * Creates the dataspace <desc> or joins the one given by <crd> and adds it to the regions of
+     * <c>. The capabilities for the child are delegated via <uf>; created dataspaces use the
+     * delegation slots idx * 2 and idx * 2 + 1. Afterwards, <desc> is the descriptor for the child.
+     */
+    const DataSpace &add_dataspace(UtcbFrameRef &uf, Child *c, DataSpace::RequestType type,
+                                   DataSpaceDesc &desc, Crd crd, size_t idx);
     void switch_to(UtcbFrameRef &uf, Child *c);
     void unmap(UtcbFrameRef &uf, Child *c);
+    void map_batch(UtcbFrameRef &uf, Child *c);
+    void unmap_batch(UtcbFrameRef &uf, Child *c);
+    void map_dma(UtcbFrameRef &uf, Child *c);
 
     ChildManager(const ChildManager&);
     ChildManager& operator=(const ChildManager&);
@@ -305,6 +441,7 @@ private:
     SListTreap<Child> _childs;
     ChildDeleter _deleter;
     DataSpaceManager<DataSpace> _dsm;
+    PagePool _pages;
     ServiceRegistry _registry;
     mutable UserSm _sm;
     UserSm _switchsm;
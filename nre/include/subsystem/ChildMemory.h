@@ -20,11 +20,13 @@
 #include <arch/ExecEnv.h>
 #include <kobj/ObjCap.h>
 #include <mem/DataSpaceDesc.h>
+#include <mem/PagePool.h>
 #include <collection/SortedSList.h>
 #include <stream/OStringStream.h>
 #include <bits/MaskField.h>
 #include <util/Math.h>
 #include <Exception.h>
+#include <cstring>
 
 namespace nre {
 
@@ -51,6 +53,8 @@ public:
         RWX = R | W | X,
         // indicates that the memory has been requested by us, i.e. we haven't just joined the DS
         OWN = 1 << 4,
+        // the pages are shared with the origin until the first write to them (copy-on-write)
+        COW = 1 << 5,
     };
 
     /**
@@ -59,11 +63,31 @@ public:
     class DS : public SListItem {
     public:
         /**
-         * Creates the dataspace with given descriptor and cap
+         * Creates the dataspace with given descriptor and cap. If <pool> is given, the dataspace
+         * is copy-on-write, i.e. desc.origin() is only the template and the private copies of the
+         * pages are allocated from <pool> on demand.
          */
-        explicit DS(const DataSpaceDesc &desc, capsel_t cap)
+        explicit DS(const DataSpaceDesc &desc, capsel_t cap, PagePool *pool = nullptr)
             : SListItem(), _desc(desc), _cap(cap),
-              _perms(Math::blockcount<size_t>(desc.size(), ExecEnv::PAGE_SIZE) * 4) {
+              _perms(Math::blockcount<size_t>(desc.size(), ExecEnv::PAGE_SIZE) * 4), _pool(pool),
+              _copies(), _copycount() {
+            if(_pool) {
+                size_t pages = Math::blockcount<size_t>(desc.size(), ExecEnv::PAGE_SIZE);
+                _copies = new uintptr_t[pages]();
+            }
+        }
+        /**
+         * Gives the private copies back to the pool
+         */
+        ~DS() {
+            if(_copies) {
+                size_t pages = Math::blockcount<size_t>(_desc.size(), ExecEnv::PAGE_SIZE);
+                for(size_t i = 0; i < pages; ++i) {
+                    if(_copies[i])
+                        _pool->free(_copies[i]);
+                }
+                delete[] _copies;
+            }
         }
 
         /**
@@ -95,8 +119,52 @@ public:
          * @return the origin for the given address
          */
         uintptr_t origin(uintptr_t addr) const {
+            if(_copies) {
+                uintptr_t copy = _copies[(addr - _desc.virt()) / ExecEnv::PAGE_SIZE];
+                if(copy)
+                    return copy + (addr & (ExecEnv::PAGE_SIZE - 1));
+            }
             return _desc.origin() + (addr - _desc.virt());
         }
+
+        /**
+         * @return true if this dataspace is copy-on-write
+         */
+        bool cow() const {
+            return _copies != nullptr;
+        }
+        /**
+         * @return the number of pages that have been copied so far
+         */
+        size_t copies() const {
+            return _copycount;
+        }
+        /**
+         * @param addr the virtual address (is expected to be in this dataspace)
+         * @return true if the page of <addr> has already been copied
+         */
+        bool copied(uintptr_t addr) const {
+            return _copies && _copies[(addr - _desc.virt()) / ExecEnv::PAGE_SIZE] != 0;
+        }
+        /**
+         * Creates the private copy of the page of <addr> from the template, if not already done.
+         * Afterwards, origin() refers to the copy.
+         *
+         * @param addr the virtual address (is expected to be in this dataspace)
+         * @return the address of the copy
+         */
+        uintptr_t copy(uintptr_t addr) {
+            size_t idx = (addr - _desc.virt()) / ExecEnv::PAGE_SIZE;
+            if(!_copies[idx]) {
+                uintptr_t page = _pool->alloc();
+                memcpy(reinterpret_cast<void*>(page),
+                       reinterpret_cast<void*>(_desc.origin() + idx * ExecEnv::PAGE_SIZE),
+                       ExecEnv::PAGE_SIZE);
+                _copies[idx] = page;
+                _copycount++;
+            }
+            return _copies[idx];
+        }
         /**
          * @param addr the virtual address (is expected to be in this dataspace)
          * @return the permissions of the given page
@@ -156,9 +224,15 @@ public:
         }
 
     private:
+        DS(const DS&);
+        DS& operator=(const DS&);
+
         DataSpaceDesc _desc;
         capsel_t _cap;
         MaskField<4> _perms;
+        PagePool *_pool;
+        uintptr_t *_copies;
+        size_t _copycount;
     };
 
     typedef SList<DS>::const_iterator iterator;
@@ -189,7 +263,10 @@ public:
         phys = 0;
         for(iterator it = begin(); it != end(); ++it) {
             virt += it->desc().size();
-            if(it->desc().type() != DataSpaceDesc::VIRTUAL && (it->desc().flags() & OWN))
+            // for copy-on-write dataspaces, only the copied pages belong to this child
+            if(it->cow())
+                phys += it->copies() * ExecEnv::PAGE_SIZE;
+            else if(it->desc().type() != DataSpaceDesc::VIRTUAL && (it->desc().flags() & OWN))
                 phys += it->desc().size();
         }
     }
@@ -261,10 +338,15 @@ public:
      * @param addr the virtual address where to map it to in the child
      * @param flags the flags to use (desc.flags() is ignored)
      * @param sel the selector for the dataspace
+     * @param pool if not nullptr, the dataspace is added copy-on-write, i.e. the given dataspace
+     *  is used as the template and is never written. The copies are allocated from <pool>.
      */
-    void add(const DataSpaceDesc& desc, uintptr_t addr, uint flags, capsel_t sel = ObjCap::INVALID) {
+    void add(const DataSpaceDesc& desc, uintptr_t addr, uint flags, capsel_t sel = ObjCap::INVALID,
+             PagePool *pool = nullptr) {
+        if(pool)
+            flags |= COW;
         DS *ds = new DS(DataSpaceDesc(desc.size(), desc.type(), flags, desc.phys(), addr,
-                                      desc.virt()), sel);
+                                      desc.virt()), sel, pool);
         _list.insert(ds);
     }
 
@@ -59,10 +59,11 @@ public:
         explicit Service(Child *child, const String &name, capsel_t pts, size_t count,
                          const BitField<Hip::MAX_CPUS> &available)
             : SListItem(), _child(child), _name(name), _pts(pts), _count(count), _sm(0),
-              _available(available) {
+              _available(available), _stats(ObjCap::INVALID), _stats_unmap(ObjCap::INVALID) {
         }
         /**
-         * The destructor revokes the caps and frees the selectors
+         * The destructor revokes the caps and frees the selectors. The statistics dataspace is
+         * not owned by the service; it is released by the one that set it.
          */
         ~Service() {
             CapRange(_pts, _count, Crd::OBJ_ALL).revoke(true);
@@ -94,6 +95,20 @@ public:
         capsel_t pts() const {
             return _pts;
         }
+        /**
+         * @return the dataspace capability of the statistics of the service (ObjCap::INVALID if it
+         *  has not been set yet)
+         */
+        capsel_t stats() const {
+            return _stats;
+        }
+        /**
+         * @return the unmap capability of the statistics dataspace (ObjCap::INVALID if it has not
+         *  been set or if the dataspace is not managed by the child manager)
+         */
+        capsel_t stats_unmap() const {
+            return _stats_unmap;
+        }
         /**
          * A semaphore that can be used to notify the service about potentially destroyed sessions
          */
@@ -111,6 +126,8 @@ public:
         size_t _count;
         Sm _sm;
         BitField<Hip::MAX_CPUS> _available;
+        capsel_t _stats;
+        capsel_t _stats_unmap;
     };
 
     typedef SList<Service>::iterator iterator;
@@ -163,6 +180,16 @@ public:
      */
     const Service* reg(Child *child, const String &name, capsel_t pts, size_t count,
                        const BitField<Hip::MAX_CPUS> &available);
+    /**
+     * Sets the statistics dataspace of the service with given name.
+     *
+     * @param child the child that created the service
+     * @param name the name of the service
+     * @param ds the dataspace capability
+     * @param unmap the unmap capability of the dataspace (may be ObjCap::INVALID)
+     * @throws ServiceRegistryException if the service doesn't exist or doesn't belong to <child>
+     */
+    void set_stats(Child *child, const String &name, capsel_t ds, capsel_t unmap);
     /**
      * Unregisters the service with given name from given child. Note that only the created can
      * unregister it.
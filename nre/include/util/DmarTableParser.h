@@ -32,6 +32,9 @@ public:
     };
 
     enum ScopeType {
+        PCI_ENDPOINT = 1,
+        PCI_SUBHIERARCHY = 2,
+        IOAPIC = 3,
         MSI_CAPABLE_HPET = 4,
     };
 
@@ -47,6 +50,15 @@ public:
         ScopeType type() const {
             return ScopeType(_elem->type);
         }
+        uint8_t start_bus() const {
+            return _elem->start_bus;
+        }
+        /**
+         * @return the number of (device,function) pairs in the path to the device
+         */
+        size_t path_length() const {
+            return (_elem->length - 6) / 2;
+        }
 
         uint16_t rid() {
             // We don't know what to do if this is not plain PCI.
@@ -83,6 +95,12 @@ public:
 
     class Dhrd {
     public:
+        enum Flags {
+            // the unit is responsible for all PCI devices of the segment that are not explicitly
+            // listed in the scope of another unit
+            INCLUDE_PCI_ALL = 1 << 0,
+        };
+
         explicit Dhrd(const char *base, size_t size_left) : _base(base), _size_left(size_left) {
         }
 
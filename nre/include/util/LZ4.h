@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <Exception.h>
+
+namespace nre {
+
+/**
+ * The exception used for malformed or unsupported compressed data
+ */
+class LZ4Exception : public Exception {
+public:
+    explicit LZ4Exception(ErrorCode code = E_FAILURE, const String &msg = String()) throw()
+        : Exception(code, msg) {
+    }
+};
+
+/**
+ * A decompressor for the LZ4 frame format. It supports linked and independent blocks of all sizes.
+ * Checksums are skipped instead of verified and dictionaries are not supported. Only the first
+ * frame is decompressed.
+ *
+ * The data can either be decompressed into a buffer that is large enough for everything or it can
+ * be streamed into a Sink. In the latter case, only the 64 KiB window that LZ4 needs for the back
+ * references is kept in memory.
+ */
+class LZ4 {
+    class Decoder;
+    class NullSink;
+
+    static const uint32_t MAGIC             = 0x184D2204;
+    static const size_t WINDOW_SIZE         = 64 * 1024;
+
+public:
+    /**
+     * The interface to receive the decompressed data in a streaming fashion
+     */
+    class Sink {
+    public:
+        virtual ~Sink() {
+        }
+
+        /**
+         * Is called for the next <len> bytes of the decompressed data
+         *
+         * @param data the data
+         * @param len the number of bytes
+         */
+        virtual void write(const void *data, size_t len) = 0;
+    };
+
+    /**
+     * @param data the data
+     * @param size the size of the data
+     * @return true if <data> starts with an LZ4 frame
+     */
+    static bool is_compressed(const void *data, size_t size) {
+        return size >= 4 && read32(static_cast<const uint8_t*>(data)) == MAGIC;
+    }
+
+    /**
+     * Determines the size of the decompressed data. If the frame header does not contain it, the
+     * data is decompressed once without storing it.
+     *
+     * @param data the compressed data
+     * @param size the size of the compressed data
+     * @return the decompressed size
+     * @throws LZ4Exception if the data is invalid
+     */
+    static uint64_t decompressed_size(const void *data, size_t size);
+
+    /**
+     * Decompresses <data> into <dst>.
+     *
+     * @param data the compressed data
+     * @param size the size of the compressed data
+     * @param dst the destination buffer
+     * @param dstsize the size of the destination buffer
+     * @return the decompressed size
+     * @throws LZ4Exception if the data is invalid or <dst> is too small
+     */
+    static size_t decompress(const void *data, size_t size, void *dst, size_t dstsize);
+
+    /**
+     * Decompresses <data> and passes the result piece by piece to <sink>.
+     *
+     * @param data the compressed data
+     * @param size the size of the compressed data
+     * @param sink the sink to write to
+     * @return the decompressed size
+     * @throws LZ4Exception if the data is invalid
+     */
+    static uint64_t decompress(const void *data, size_t size, Sink &sink);
+
+private:
+    static uint32_t read32(const uint8_t *p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+    static const uint8_t *read_header(const uint8_t *src, size_t size, uint8_t *flags,
+                                      uint64_t *content_size);
+    static uint64_t decode(const void *data, size_t size, Decoder &dec);
+    static void decode_block(Decoder &dec, const uint8_t *src, size_t size);
+
+    LZ4();
+};
+
+}
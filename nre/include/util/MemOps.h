@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+
+namespace nre {
+
+/**
+ * Selects the implementation behind memcpy, memset and memcmp. At startup, the best variant the
+ * CPU supports is chosen (see CPU::has()). All variants copy small areas with scalar moves and
+ * switch to non-temporal stores for areas of at least NT_SIZE bytes, so that large copies do not
+ * evict the whole cache. The variant can be changed at runtime to compare them (see the MemOps
+ * unittest).
+ */
+class MemOps {
+public:
+    enum Variant {
+        GENERIC,    // the portable word-wise C implementation
+        SSE2,       // 16-byte SSE2 loads and stores
+        AVX2,       // 32-byte AVX2 loads and stores
+        ERMS,       // "rep movsb/stosb" with enhanced fast strings; SSE2 for memcmp
+        COUNT
+    };
+
+    /**
+     * Below this size, the vector variants use overlapping scalar moves
+     */
+    static const size_t SMALL_SIZE  = 64;
+    /**
+     * From this size on, memcpy and memset use non-temporal stores
+     */
+    static const size_t NT_SIZE     = 1024 * 1024;
+
+    /**
+     * @param v the variant
+     * @return true if the CPU supports the given variant
+     */
+    static bool available(Variant v);
+    /**
+     * @return the variant that is currently used
+     */
+    static Variant current() {
+        return _current;
+    }
+    /**
+     * @param v the variant
+     * @return the name of the given variant
+     */
+    static const char *name(Variant v);
+
+    /**
+     * Uses the given variant from now on.
+     *
+     * @param v the variant
+     * @return true on success, false if the CPU does not support it
+     */
+    static bool select(Variant v);
+    /**
+     * Uses the best variant the CPU supports. This is done automatically at startup.
+     */
+    static void select_best();
+
+private:
+    MemOps();
+
+    static Variant _current;
+};
+
+}
@@ -75,9 +75,17 @@ public:
     }
 
     /**
-     * Program the nr-th MSI/MSI-X vector of the given device.
+     * @return the number of MSI-X vectors of the given device, 1 if it supports only MSI and 0 if
+     *  it supports neither of them
      */
-    Gsi *get_gsi_msi(BDF bdf, uint nr, void *msix_table = nullptr);
+    size_t msi_vectors(BDF bdf);
+
+    /**
+     * Program the nr-th MSI/MSI-X vector of the given device. The interrupt is delivered to the
+     * given CPU.
+     */
+    Gsi *get_gsi_msi(BDF bdf, uint nr, void *msix_table = nullptr,
+                     cpu_t cpu = CPU::current().log_id());
 
     /**
      * Returns the gsi and enables them.
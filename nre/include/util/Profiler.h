@@ -67,18 +67,54 @@ private:
 
 class AvgProfiler : public Profiler {
 public:
-    explicit AvgProfiler(size_t count) : _count(count), _pos(0), _results(new time_t[count]) {
+    explicit AvgProfiler(size_t count)
+        : _count(count), _pos(0), _sorted(false), _results(new time_t[count]) {
     }
     virtual ~AvgProfiler() {
         delete[] _results;
     }
 
+    /**
+     * @return the number of measurements so far
+     */
+    size_t count() const {
+        return _pos;
+    }
+    /**
+     * @param i the index (0 .. count() - 1)
+     * @return the <i>th measurement. Note that the order is undefined after percentile() has
+     *  been called
+     */
+    time_t result(size_t i) const {
+        return _results[i];
+    }
+
     time_t avg() const {
         time_t avg = 0;
         for(size_t i = 0; i < _count; i++)
             avg += _results[i];
         return avg / _count;
     }
+    time_t median() {
+        return percentile(500);
+    }
+    /**
+     * Determines the value that is not exceeded by <permille> 1/1000 of the measurements. The
+     * measurements are sorted for that on the first call.
+     *
+     * @param permille the percentile in 1/1000 (e.g. 990 for the 99th percentile)
+     * @return the value
+     */
+    time_t percentile(uint permille) {
+        if(_pos == 0)
+            return 0;
+        if(!_sorted) {
+            sort();
+            _sorted = true;
+        }
+        size_t idx = (_pos * Math::min<uint>(permille, 1000) + 999) / 1000;
+        return _results[idx > 0 ? idx - 1 : 0];
+    }
 
     virtual void start() {
         assert(_pos < _count);
@@ -87,12 +123,35 @@ public:
     virtual time_t stop() {
         time_t time = Profiler::stop();
         _results[_pos++] = time;
+        _sorted = false;
         return time;
     }
 
 private:
+    void sift_down(size_t root, size_t end) {
+        while(root * 2 + 1 < end) {
+            size_t child = root * 2 + 1;
+            if(child + 1 < end && _results[child] < _results[child + 1])
+                child++;
+            if(_results[root] >= _results[child])
+                break;
+            Util::swap(_results[root], _results[child]);
+            root = child;
+        }
+    }
+    void sort() {
+        // heapsort, because it's in place and doesn't need recursion
+        for(size_t i = _pos / 2; i > 0; --i)
+            sift_down(i - 1, _pos);
+        for(size_t end = _pos - 1; end > 0; --end) {
+            Util::swap(_results[0], _results[end]);
+            sift_down(0, end);
+        }
+    }
+
     size_t _count;
     size_t _pos;
+    bool _sorted;
     time_t *_results;
 };
 
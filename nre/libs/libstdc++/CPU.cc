@@ -17,6 +17,8 @@
 #include <arch/Startup.h>
 #include <kobj/Pt.h>
 #include <cap/CapSelSpace.h>
+#include <util/MemOps.h>
+#include <util/Util.h>
 #include <CPU.h>
 #include <Hip.h>
 
@@ -26,16 +28,47 @@ namespace nre {
 
 class CPUInit {
     CPUInit();
+    static void detect_features();
     static CPUInit init;
 };
 
 uint CPU::_order = 0;
+uint CPU::_features = 0;
 SList<CPU> CPU::_online INIT_PRIO_CPUS;
 CPU CPU::_cpus[Hip::MAX_CPUS] INIT_PRIO_CPUS;
 cpu_t CPU::_logtophys[Hip::MAX_CPUS];
 CPUInit CPUInit::init INIT_PRIO_CPUS;
 
+void CPUInit::detect_features() {
+    uint32_t ebx = 0, ecx = 0, edx = 0;
+    uint32_t max = Util::cpuid(0, ebx, ecx, edx);
+
+    ebx = ecx = edx = 0;
+    Util::cpuid(1, ebx, ecx, edx);
+    if(edx & (1 << 26))
+        CPU::_features |= CPU::FEAT_SSE2;
+    // AVX is only usable if the OS has enabled the xmm and ymm state (XCR0 bits 1 and 2)
+    bool avx = false;
+    if((ecx & (1 << 27)) && (ecx & (1 << 28))) {
+        uint32_t xcr0, xcr0h;
+        asm volatile ("xgetbv" : "=a" (xcr0), "=d" (xcr0h) : "c" (0));
+        avx = (xcr0 & 0x6) == 0x6;
+    }
+
+    if(max >= 7) {
+        ebx = ecx = edx = 0;
+        Util::cpuid(7, ebx, ecx, edx);
+        if(avx && (ebx & (1 << 5)))
+            CPU::_features |= CPU::FEAT_AVX2;
+        if(ebx & (1 << 9))
+            CPU::_features |= CPU::FEAT_ERMS;
+    }
+}
+
 CPUInit::CPUInit() {
+    detect_features();
+    MemOps::select_best();
+
     const Hip& hip = Hip::get();
     cpu_t i = 0, id = 0, offline = 0;
     for(auto it = hip.cpu_begin(); it != hip.cpu_end(); ++it, ++i) {
@@ -15,7 +15,9 @@
  */
 
 #include <arch/Startup.h>
+#include <kobj/GlobalThread.h>
 #include <RCU.h>
+#include <CPU.h>
 
 namespace nre {
 
@@ -26,6 +28,44 @@ class Init {
     static Init init;
 };
 
+void RCU::fence_thread(void*) {
+    Sm *req = Thread::current()->get_tls<Sm*>(Thread::TLS_PARAM);
+    while(1) {
+        req->down();
+        // drains the store buffer of this CPU, which contains the stores of all threads that ran
+        // on this CPU before
+        Sync::memory_fence();
+        _fence_done->up();
+    }
+}
+
+void RCU::fence_cpus() {
+    if(CPU::count() == 1)
+        return;
+
+    if(!_fence_reqs) {
+        _fence_done = new Sm(0);
+        Sm **reqs = new Sm*[CPU::count()];
+        for(CPU::iterator cpu = CPU::begin(); cpu != CPU::end(); ++cpu) {
+            reqs[cpu->log_id()] = new Sm(0);
+            Reference<GlobalThread> gt = GlobalThread::create(fence_thread, cpu->log_id(),
+                                                              "rcu-fence");
+            gt->set_tls<Sm*>(Thread::TLS_PARAM, reqs[cpu->log_id()]);
+            gt->start();
+        }
+        _fence_reqs = reqs;
+    }
+
+    // we don't need to fence our own CPU, because our loads see our own stores
+    cpu_t self = CPU::current().log_id();
+    for(size_t i = 0; i < CPU::count(); ++i) {
+        if(i != self)
+            _fence_reqs[i]->up();
+    }
+    for(size_t i = 0; i < CPU::count() - 1; ++i)
+        _fence_done->down();
+}
+
 uint32_t *RCU::_versions = nullptr;
 size_t RCU::_versions_count = 0;
 SList<Thread> RCU::_ecs;
@@ -33,6 +73,8 @@ RCUObject *RCU::_objs = nullptr;
 RCULock RCU::_lock;
 UserSm RCU::_sm INIT_PRIO_RCU;
 UserSm RCU::_ecsm INIT_PRIO_RCU;
+Sm **RCU::_fence_reqs = nullptr;
+Sm *RCU::_fence_done = nullptr;
 Init Init::init INIT_PRIO_RCU;
 
 }
@@ -34,17 +34,25 @@ void CapRange::revoke(bool self) {
 }
 
 void CapRange::limit_to(size_t free_typed) {
+    size_t covered;
+    crd_count(free_typed, covered);
+    _count = covered;
+}
+
+size_t CapRange::crd_count(size_t max, size_t &covered) const {
     uintptr_t hs = hotspot() != CapRange::NO_HOTSPOT ? hotspot() : start();
     size_t c = count();
     uintptr_t st = start();
-    while(free_typed > 0 && c > 0) {
+    size_t crds = 0;
+    while(crds < max && c > 0) {
         uint minshift = Math::minshift(st | hs, c);
         st += 1 << minshift;
         hs += 1 << minshift;
         c -= 1 << minshift;
-        free_typed--;
+        crds++;
     }
-    _count = count() - c;
+    covered = count() - c;
+    return crds;
 }
 
 OStream &operator<<(OStream &os, const CapRange &cr) {
@@ -19,21 +19,36 @@
 namespace nre {
 
 ServiceSession *Service::new_session(const String &args) {
-    ScopedLock<UserSm> guard(&_sm);
-    ServiceSession *sess = create_session(_next_id++, args, _func);
-    _sessions.insert(sess);
+    ServiceSession *sess;
+    ServiceSessionTable *old;
+    {
+        ScopedLock<UserSm> guard(&_sm);
+        sess = create_session(_next_id++, args, _func);
+        old = replace_sessions(new ServiceSessionTable(*_sessions, sess, nullptr));
+    }
+    // not with our lock held, because it might delete retired sessions
+    RCU::invalidate(old);
     return sess;
 }
 
 void Service::remove_session(ServiceSession *sess) {
     // take care that we don't delete a session twice.
-    bool del = false;
+    ServiceSessionTable *old = nullptr;
     {
         ScopedLock<UserSm> guard(&_sm);
-        del = _sessions.remove(sess);
+        if(_sessions->contains(sess))
+            old = replace_sessions(new ServiceSessionTable(*_sessions, nullptr, sess));
     }
-    if(del)
+    if(old) {
+        RCU::invalidate(old);
         _deleter.del(sess);
+    }
+}
+
+ServiceSessionTable *Service::replace_sessions(ServiceSessionTable *table) {
+    ServiceSessionTable *old = _sessions;
+    rcu_assign_pointer(_sessions, table);
+    return old;
 }
 
 }
@@ -21,9 +21,11 @@
 
 namespace nre {
 
-ServiceCPUHandler::ServiceCPUHandler(Service* s, capsel_t pt, cpu_t cpu)
-    : _s(s), _session_ec(LocalThread::create(cpu)), _service_ec(LocalThread::create(cpu)),
-      _pt(_service_ec, pt, portal), _sm() {
+ServiceCPUHandler::ServiceCPUHandler(Service* s, capsel_t pt, cpu_t cpu, size_t threads)
+    : _s(s), _count(threads), _session_ecs(new Reference<LocalThread>[threads]),
+      _service_ec(LocalThread::create(cpu)), _pt(_service_ec, pt, portal), _sm() {
+    for(size_t i = 0; i < _count; ++i)
+        _session_ecs[i] = LocalThread::create(cpu);
     _service_ec->set_tls<Service*>(Thread::TLS_PARAM, s);
     UtcbFrameRef ecuf(_service_ec->utcb());
     ecuf.accept_translates();
@@ -16,22 +16,92 @@
 
 #include <ipc/Service.h>
 #include <ipc/ServiceSession.h>
+#include <ipc/ServiceSessionTable.h>
 
 namespace nre {
 
 ServiceSession::ServiceSession(Service *s, size_t id, portal_func func)
-    : SListTreapNode<size_t>(id), RefCounted(), _id(id),
+    : SListItem(), RefCounted(), _srv(s), _func(func), _id(id),
       _caps(CapSelSpace::get().allocate(1 << CPU::order(), 1 << CPU::order())),
       _pts(new Pt *[CPU::count()]) {
     for(uint i = 0; i < CPU::count(); ++i) {
         _pts[i] = nullptr;
         if(s->available().is_set(i)) {
-            Reference<LocalThread> ec = s->get_thread(i);
+            // distribute the sessions among the threads of that CPU
+            Reference<LocalThread> ec = s->get_thread(i, id % s->threads());
             assert(ec.valid());
-            _pts[i] = new Pt(ec, _caps + i, func);
+            _pts[i] = new Pt(ec, _caps + i, portal);
             _pts[i]->set_id(reinterpret_cast<word_t>(this));
         }
     }
 }
 
+void ServiceSession::portal(void *id) {
+    ServiceSession *sess = reinterpret_cast<ServiceSession*>(id);
+    // all services send the command first. if there is none, it's counted as command 0
+    word_t cmd = 0;
+    {
+        UtcbFrameRef uf;
+        if(uf.has_more_untyped())
+            uf >> cmd;
+    }
+    uint64_t start = Util::tsc();
+    sess->_func(id);
+    sess->_srv->stats().record(cmd, Util::tsc() - start);
+}
+
+ServiceSessionTable::ServiceSessionTable(const ServiceSessionTable &old, ServiceSession *add,
+                                         ServiceSession *rem)
+    : RCUObject(), _count(0), _mask(), _shift(), _list(), _ids(), _idents() {
+    size_t count = old._count + (add ? 1 : 0);
+    // keep the load factor below 1/2 to keep the probe sequences short
+    size_t cap = Math::max<size_t>(MIN_CAPACITY, Math::next_pow2<size_t>(count * 2));
+    _mask = cap - 1;
+    _shift = sizeof(size_t) * 8 - Math::bit_scan_reverse(cap);
+    _list = new ServiceSession*[count];
+    _ids = new ServiceSession*[cap]();
+    _idents = new ServiceSession*[cap]();
+    for(size_t i = 0; i < old._count; ++i) {
+        if(old._list[i] != rem)
+            insert(old._list[i]);
+    }
+    if(add)
+        insert(add);
+}
+
+void ServiceSessionTable::insert(ServiceSession *sess) {
+    size_t i;
+    _list[_count++] = sess;
+    for(i = hash(sess->id()); _ids[i]; i = (i + 1) & _mask)
+        ;
+    _ids[i] = sess;
+    for(i = hash(ident_key(sess->portal_caps())); _idents[i]; i = (i + 1) & _mask)
+        ;
+    _idents[i] = sess;
+}
+
+bool ServiceSessionTable::contains(const ServiceSession *sess) const {
+    return find(sess->id()) == sess;
+}
+
+ServiceSession *ServiceSessionTable::find(size_t id) const {
+    if(_count == 0)
+        return nullptr;
+    for(size_t i = hash(id); _ids[i]; i = (i + 1) & _mask) {
+        if(_ids[i]->id() == id)
+            return _ids[i];
+    }
+    return nullptr;
+}
+
+ServiceSession *ServiceSessionTable::find_by_ident(capsel_t ident) const {
+    if(_count == 0)
+        return nullptr;
+    for(size_t i = hash(ident_key(ident)); _idents[i]; i = (i + 1) & _mask) {
+        if(_idents[i]->portal_caps() == ident)
+            return _idents[i];
+    }
+    return nullptr;
+}
+
 }
@@ -18,6 +18,7 @@
 #include <kobj/Pt.h>
 #include <utcb/UtcbFrame.h>
 #include <util/ScopedCapSels.h>
+#include <util/Math.h>
 #include <CPU.h>
 
 namespace nre {
@@ -39,6 +40,26 @@ void DataSpace::create(DataSpaceDesc &desc, capsel_t *sel, capsel_t *unmapsel) {
     caps.release();
 }
 
+void DataSpace::create(DataSpaceDesc *descs, DataSpace **res, size_t count) {
+    assert(count > 0 && count <= MAX_BATCH);
+    UtcbFrame uf;
+    // prepare for receiving the map and unmap-caps of all dataspaces
+    uint order = Math::next_pow2_shift(count * 2);
+    ScopedCapSels caps(1 << order, 1 << order);
+    uf.delegation_window(Crd(caps.get(), order, Crd::OBJ_ALL));
+    uf << CREATE_BATCH << count;
+    for(size_t i = 0; i < count; ++i)
+        uf << descs[i];
+    CPU::current().ds_pt().call(uf);
+
+    uf.check_reply();
+    for(size_t i = 0; i < count; ++i) {
+        uf >> descs[i];
+        res[i] = new DataSpace(descs[i], caps.get() + i * 2, caps.get() + i * 2 + 1);
+    }
+    caps.release();
+}
+
 void DataSpace::create() {
     assert(_sel == ObjCap::INVALID && _unmapsel == ObjCap::INVALID);
     create(_desc, &_sel, &_unmapsel);
@@ -47,11 +68,11 @@ void DataSpace::create() {
         touch();
 }
 
-void DataSpace::switch_to(DataSpace &dest) {
+void DataSpace::switch_to(DataSpace &dest, uint flags) {
     UtcbFrame uf;
     uf.translate(unmapsel());
     uf.translate(dest.unmapsel());
-    uf << SWITCH_TO;
+    uf << SWITCH_TO << flags;
     CPU::current().ds_pt().call(uf);
     uf.check_reply();
     uintptr_t tmp = _desc.origin();
@@ -59,6 +80,22 @@ void DataSpace::switch_to(DataSpace &dest) {
     dest._desc.origin(tmp);
 }
 
+void DataSpace::map_dma() const {
+    size_t off = 0;
+    while(off < _desc.size()) {
+        UtcbFrame uf;
+        // the parent delegates the pages to their virtual address in our address space
+        uf.delegation_window(Crd(0, 31, Crd::MEM_ALL));
+        uf << MAP_DMA << (_desc.virt() + off);
+        CPU::current().ds_pt().call(uf);
+
+        uf.check_reply();
+        size_t size;
+        uf >> size;
+        off += size;
+    }
+}
+
 void DataSpace::join() {
     assert(_sel != ObjCap::INVALID && _unmapsel == ObjCap::INVALID);
     UtcbFrame uf;
@@ -102,6 +139,31 @@ void DataSpace::destroy() {
     }
 }
 
+void DataSpace::destroy(DataSpace **ds, size_t count) {
+    assert(count <= MAX_BATCH);
+    UtcbFrame uf;
+    uf << DESTROY_BATCH << count;
+    for(size_t i = 0; i < count; ++i) {
+        assert(ds[i]->_unmapsel != ObjCap::INVALID);
+        // see destroy()
+        if(_startup_info.child) {
+            CapRange(ds[i]->_desc.virt() >> ExecEnv::PAGE_SHIFT,
+                     ds[i]->_desc.size() >> ExecEnv::PAGE_SHIFT, Crd::MEM_ALL).revoke(true);
+        }
+        uf.translate(ds[i]->_unmapsel);
+        uf << ds[i]->_desc;
+    }
+    CPU::current().ds_pt().call(uf);
+
+    for(size_t i = 0; i < count; ++i) {
+        CapSelSpace::get().free(ds[i]->_unmapsel);
+        CapSelSpace::get().free(ds[i]->_sel);
+        // it's already destroyed
+        ds[i]->_unmapsel = ObjCap::INVALID;
+        delete ds[i];
+    }
+}
+
 void DataSpace::touch() {
     uint *addr = reinterpret_cast<uint*>(_desc.virt());
     uint *end = reinterpret_cast<uint*>(_desc.virt() + _desc.size());
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <mem/DataSpacePool.h>
+#include <util/ScopedLock.h>
+#include <util/Math.h>
+#include <cstring>
+
+namespace nre {
+
+DataSpacePool::DataSpacePool(uint flags, size_t refill)
+    : _flags(flags), _refill(Math::max<size_t>(1, Math::min(refill, MAX_FREE))), _free(), _count(),
+      _sm() {
+}
+
+DataSpacePool::~DataSpacePool() {
+    flush();
+}
+
+size_t DataSpacePool::class_of(size_t size) {
+    size_t pages = Math::blockcount(size, ExecEnv::PAGE_SIZE);
+    return Math::next_pow2_shift(Math::max<size_t>(pages, 1));
+}
+
+DataSpace *DataSpacePool::alloc(size_t size) {
+    size_t cls = class_of(size);
+    if(cls >= CLASSES)
+        return new DataSpace(size, DataSpaceDesc::ANONYMOUS, _flags);
+
+    ScopedLock<UserSm> guard(&_sm);
+    if(_count[cls] == 0)
+        refill(cls);
+    return _free[cls][--_count[cls]];
+}
+
+void DataSpacePool::free(DataSpace *ds) {
+    size_t cls = class_of(ds->size());
+    uint flags = ds->flags() & ~DataSpaceDesc::ZEROED;
+    if(cls >= CLASSES || ds->size() != class_size(cls) || flags != _flags ||
+       ds->type() != DataSpaceDesc::ANONYMOUS) {
+        delete ds;
+        return;
+    }
+    // the next user will get the content of the previous one
+    ds->_desc.flags(flags);
+
+    ScopedLock<UserSm> guard(&_sm);
+    if(_count[cls] == MAX_FREE)
+        trim(cls, MAX_FREE / 2);
+    _free[cls][_count[cls]++] = ds;
+}
+
+void DataSpacePool::flush() {
+    ScopedLock<UserSm> guard(&_sm);
+    for(size_t cls = 0; cls < CLASSES; ++cls)
+        trim(cls, 0);
+}
+
+size_t DataSpacePool::cached() const {
+    ScopedLock<UserSm> guard(&_sm);
+    size_t total = 0;
+    for(size_t cls = 0; cls < CLASSES; ++cls)
+        total += _count[cls];
+    return total;
+}
+
+void DataSpacePool::refill(size_t cls) {
+    DataSpaceDesc descs[MAX_FREE];
+    for(size_t i = 0; i < _refill; ++i)
+        descs[i] = DataSpaceDesc(class_size(cls), DataSpaceDesc::ANONYMOUS, _flags);
+    DataSpace::create(descs, _free[cls], _refill);
+    _count[cls] = _refill;
+}
+
+void DataSpacePool::trim(size_t cls, size_t keep) {
+    if(_count[cls] > keep) {
+        // destroy the oldest ones; they have probably been evicted from the caches anyway
+        size_t n = _count[cls] - keep;
+        DataSpace::destroy(_free[cls], n);
+        memmove(_free[cls], _free[cls] + n, keep * sizeof(DataSpace*));
+        _count[cls] = keep;
+    }
+}
+
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+#include <mem/PagePool.h>
+#include <util/ScopedLock.h>
+#include <cap/CapRange.h>
+
+namespace nre {
+
+PagePool::~PagePool() {
+    for(auto it = _chunks.begin(); it != _chunks.end(); ) {
+        auto old = it++;
+        delete &*old;
+    }
+}
+
+uintptr_t PagePool::alloc() {
+    ScopedLock<UserSm> guard(&_sm);
+    if(!_free) {
+        Chunk *c = new Chunk(CHUNK_PAGES * ExecEnv::PAGE_SIZE);
+        _chunks.append(c);
+        // put all pages into the free list; the last one first to hand them out in ascending order
+        for(size_t i = CHUNK_PAGES; i-- > 0; ) {
+            uintptr_t page = c->ds.virt() + i * ExecEnv::PAGE_SIZE;
+            *reinterpret_cast<uintptr_t*>(page) = _free;
+            _free = page;
+        }
+        _total += CHUNK_PAGES;
+    }
+
+    uintptr_t page = _free;
+    _free = *reinterpret_cast<uintptr_t*>(page);
+    _used++;
+    return page;
+}
+
+void PagePool::free(uintptr_t page) {
+    CapRange(page >> ExecEnv::PAGE_SHIFT, 1, Crd::MEM_ALL).revoke(false);
+
+    ScopedLock<UserSm> guard(&_sm);
+    *reinterpret_cast<uintptr_t*>(page) = _free;
+    _free = page;
+    _used--;
+}
+
+}
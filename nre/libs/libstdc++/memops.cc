@@ -0,0 +1,432 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/MemOps.h>
+#include <util/Math.h>
+#include <CPU.h>
+#include <cstring>
+
+// the loops below must not be turned back into calls to memcpy/memset. clang doesn't know this
+// pragma; it gets -fno-builtin for this file instead (see SConscript)
+#if !defined(__clang__)
+#   pragma GCC optimize("no-tree-loop-distribute-patterns")
+#endif
+
+EXTERN_C void *memcpy_generic(void *dest, const void *src, size_t len);
+EXTERN_C void *memset_generic(void *addr, int value, size_t count);
+EXTERN_C int memcmp_generic(const void *str1, const void *str2, size_t count);
+
+namespace nre {
+
+typedef uint64_t __attribute__((may_alias, aligned(1))) ua64_t;
+typedef uint32_t __attribute__((may_alias, aligned(1))) ua32_t;
+
+typedef void (*copy_func)(uchar *d, const uchar *s, size_t len);
+typedef void (*set_func)(uchar *d, uchar value, size_t len);
+typedef int (*cmp_func)(const uchar *a, const uchar *b, size_t len);
+
+struct Ops {
+    copy_func copy;
+    set_func set;
+    cmp_func cmp;
+};
+
+/**
+ * Copies <len> < SMALL_SIZE bytes with overlapping 8 or 4 byte moves.
+ */
+static inline void copy_small(uchar *d, const uchar *s, size_t len) {
+    if(len >= 8) {
+        uint64_t last = *reinterpret_cast<const ua64_t*>(s + len - 8);
+        for(size_t i = 0; i + 8 < len; i += 8)
+            *reinterpret_cast<ua64_t*>(d + i) = *reinterpret_cast<const ua64_t*>(s + i);
+        *reinterpret_cast<ua64_t*>(d + len - 8) = last;
+    }
+    else if(len >= 4) {
+        uint32_t first = *reinterpret_cast<const ua32_t*>(s);
+        uint32_t last = *reinterpret_cast<const ua32_t*>(s + len - 4);
+        *reinterpret_cast<ua32_t*>(d) = first;
+        *reinterpret_cast<ua32_t*>(d + len - 4) = last;
+    }
+    else {
+        for(size_t i = 0; i < len; ++i)
+            d[i] = s[i];
+    }
+}
+
+static inline void set_small(uchar *d, uchar value, size_t len) {
+    if(len >= 8) {
+        uint64_t pat = 0x0101010101010101ULL * value;
+        for(size_t i = 0; i + 8 < len; i += 8)
+            *reinterpret_cast<ua64_t*>(d + i) = pat;
+        *reinterpret_cast<ua64_t*>(d + len - 8) = pat;
+    }
+    else {
+        for(size_t i = 0; i < len; ++i)
+            d[i] = value;
+    }
+}
+
+static inline int cmp_bytes(const uchar *a, const uchar *b, size_t len) {
+    for(size_t i = 0; i < len; ++i) {
+        if(a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static inline uchar *align_up(uchar *p, uintptr_t align) {
+    return reinterpret_cast<uchar*>(Math::round_up<uintptr_t>(reinterpret_cast<uintptr_t>(p), align));
+}
+
+static inline int cmp_mask(const uchar *a, const uchar *b, uint32_t neq) {
+    size_t i = __builtin_ctz(neq);
+    return a[i] < b[i] ? -1 : 1;
+}
+
+/* -------------------------------------------- generic -------------------------------------------- */
+
+static void copy_generic(uchar *d, const uchar *s, size_t len) {
+    memcpy_generic(d, s, len);
+}
+static void set_generic(uchar *d, uchar value, size_t len) {
+    memset_generic(d, value, len);
+}
+static int cmp_generic(const uchar *a, const uchar *b, size_t len) {
+    return memcmp_generic(a, b, len);
+}
+
+/* --------------------------------------------- SSE2 ---------------------------------------------- */
+
+static inline void move16(uchar *d, const uchar *s) {
+    asm volatile (
+        "movdqu (%1), %%xmm0\n\t"
+        "movdqu %%xmm0, (%0)"
+        : : "r" (d), "r" (s) : "xmm0", "memory"
+    );
+}
+
+// copies 64-byte blocks while at least 64 bytes are left; the destination is 16-byte aligned
+#define SSE2_COPY_LOOP(STORE)                           \
+    asm volatile (                                      \
+        "1:\n\t"                                        \
+        "movdqu   (%1), %%xmm0\n\t"                     \
+        "movdqu 16(%1), %%xmm1\n\t"                     \
+        "movdqu 32(%1), %%xmm2\n\t"                     \
+        "movdqu 48(%1), %%xmm3\n\t"                     \
+        STORE " %%xmm0,   (%0)\n\t"                     \
+        STORE " %%xmm1, 16(%0)\n\t"                     \
+        STORE " %%xmm2, 32(%0)\n\t"                     \
+        STORE " %%xmm3, 48(%0)\n\t"                     \
+        "add $64, %1\n\t"                               \
+        "add $64, %0\n\t"                               \
+        "sub $64, %2\n\t"                               \
+        "cmp $64, %2\n\t"                               \
+        "jae 1b"                                        \
+        : "+r" (d), "+r" (s), "+r" (len)                \
+        : : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc"  \
+    )
+
+// sets 64-byte blocks from <d> to <end>; the destination is 16-byte aligned
+#define SSE2_SET_LOOP(STORE)                            \
+    asm volatile (                                      \
+        "movq %2, %%xmm0\n\t"                           \
+        "punpcklqdq %%xmm0, %%xmm0\n\t"                 \
+        "1:\n\t"                                        \
+        STORE " %%xmm0,   (%0)\n\t"                     \
+        STORE " %%xmm0, 16(%0)\n\t"                     \
+        STORE " %%xmm0, 32(%0)\n\t"                     \
+        STORE " %%xmm0, 48(%0)\n\t"                     \
+        "add $64, %0\n\t"                               \
+        "cmp %1, %0\n\t"                                \
+        "jb 1b"                                         \
+        : "+r" (d)                                      \
+        : "r" (end), "m" (pat)                          \
+        : "xmm0", "memory", "cc"                        \
+    )
+
+static void copy_sse2(uchar *d, const uchar *s, size_t len) {
+    bool nt = len >= MemOps::NT_SIZE;
+    // copy the first 16 bytes unaligned and continue at the next 16-byte aligned destination
+    size_t head = -reinterpret_cast<uintptr_t>(d) & 15;
+    move16(d, s);
+    d += head;
+    s += head;
+    len -= head;
+    if(len >= 64) {
+        if(nt) {
+            SSE2_COPY_LOOP("movntdq");
+            asm volatile ("sfence" : : : "memory");
+        }
+        else
+            SSE2_COPY_LOOP("movdqa");
+    }
+    // the remaining bytes; the last move overlaps with the ones before
+    for(; len > 16; d += 16, s += 16, len -= 16)
+        move16(d, s);
+    if(len)
+        move16(d + len - 16, s + len - 16);
+}
+
+static void set_sse2(uchar *d, uchar value, size_t len) {
+    uint64_t pat = 0x0101010101010101ULL * value;
+    uchar *last = d + len;
+    // set the unaligned head and tail with 8-byte stores; they may overlap with the loop
+    uchar *start = align_up(d, 16);
+    for(uchar *p = d; p < start; p += 8)
+        *reinterpret_cast<ua64_t*>(p) = pat;
+    for(uchar *p = last - 16; p < last; p += 8)
+        *reinterpret_cast<ua64_t*>(p) = pat;
+    d = start;
+    if(last - d >= 64) {
+        uchar *end = d + Math::round_dn<size_t>(last - d, 64);
+        if(len >= MemOps::NT_SIZE) {
+            SSE2_SET_LOOP("movntdq");
+            asm volatile ("sfence" : : : "memory");
+        }
+        else
+            SSE2_SET_LOOP("movdqa");
+    }
+    for(; d + 8 <= last; d += 8)
+        *reinterpret_cast<ua64_t*>(d) = pat;
+}
+
+static int cmp_sse2(const uchar *a, const uchar *b, size_t len) {
+    for(; len >= 16; a += 16, b += 16, len -= 16) {
+        uint32_t eq;
+        asm volatile (
+            "movdqu (%1), %%xmm0\n\t"
+            "movdqu (%2), %%xmm1\n\t"
+            "pcmpeqb %%xmm1, %%xmm0\n\t"
+            "pmovmskb %%xmm0, %0"
+            : "=r" (eq) : "r" (a), "r" (b), "m" (*a), "m" (*b) : "xmm0", "xmm1", "memory"
+        );
+        if(eq != 0xFFFF)
+            return cmp_mask(a, b, ~eq);
+    }
+    return cmp_bytes(a, b, len);
+}
+
+/* --------------------------------------------- AVX2 ---------------------------------------------- */
+
+static inline void move32(uchar *d, const uchar *s) {
+    asm volatile (
+        "vmovdqu (%1), %%ymm0\n\t"
+        "vmovdqu %%ymm0, (%0)"
+        : : "r" (d), "r" (s) : "xmm0", "memory"
+    );
+}
+
+static inline void vzeroupper() {
+    asm volatile ("vzeroupper" : : : "xmm0", "xmm1", "xmm2", "xmm3");
+}
+
+// copies 128-byte blocks while at least 128 bytes are left; the destination is 32-byte aligned
+#define AVX2_COPY_LOOP(STORE)                           \
+    asm volatile (                                      \
+        "1:\n\t"                                        \
+        "vmovdqu   (%1), %%ymm0\n\t"                    \
+        "vmovdqu 32(%1), %%ymm1\n\t"                    \
+        "vmovdqu 64(%1), %%ymm2\n\t"                    \
+        "vmovdqu 96(%1), %%ymm3\n\t"                    \
+        STORE " %%ymm0,   (%0)\n\t"                     \
+        STORE " %%ymm1, 32(%0)\n\t"                     \
+        STORE " %%ymm2, 64(%0)\n\t"                     \
+        STORE " %%ymm3, 96(%0)\n\t"                     \
+        "add $128, %1\n\t"                              \
+        "add $128, %0\n\t"                              \
+        "sub $128, %2\n\t"                              \
+        "cmp $128, %2\n\t"                              \
+        "jae 1b"                                        \
+        : "+r" (d), "+r" (s), "+r" (len)                \
+        : : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc"  \
+    )
+
+// sets 128-byte blocks from <d> to <end>; the destination is 32-byte aligned
+#define AVX2_SET_LOOP(STORE)                            \
+    asm volatile (                                      \
+        "vpbroadcastb %2, %%ymm0\n\t"                   \
+        "1:\n\t"                                        \
+        STORE " %%ymm0,   (%0)\n\t"                     \
+        STORE " %%ymm0, 32(%0)\n\t"                     \
+        STORE " %%ymm0, 64(%0)\n\t"                     \
+        STORE " %%ymm0, 96(%0)\n\t"                     \
+        "add $128, %0\n\t"                              \
+        "cmp %1, %0\n\t"                                \
+        "jb 1b"                                         \
+        : "+r" (d)                                      \
+        : "r" (end), "m" (value)                        \
+        : "xmm0", "memory", "cc"                        \
+    )
+
+static void copy_avx2(uchar *d, const uchar *s, size_t len) {
+    bool nt = len >= MemOps::NT_SIZE;
+    size_t head = -reinterpret_cast<uintptr_t>(d) & 31;
+    move32(d, s);
+    d += head;
+    s += head;
+    len -= head;
+    if(len >= 128) {
+        if(nt) {
+            AVX2_COPY_LOOP("vmovntdq");
+            asm volatile ("sfence" : : : "memory");
+        }
+        else
+            AVX2_COPY_LOOP("vmovdqa");
+    }
+    for(; len > 32; d += 32, s += 32, len -= 32)
+        move32(d, s);
+    if(len)
+        move32(d + len - 32, s + len - 32);
+    vzeroupper();
+}
+
+static void set_avx2(uchar *d, uchar value, size_t len) {
+    uint64_t pat = 0x0101010101010101ULL * value;
+    uchar *last = d + len;
+    uchar *start = align_up(d, 32);
+    for(uchar *p = d; p < start; p += 8)
+        *reinterpret_cast<ua64_t*>(p) = pat;
+    for(uchar *p = last - 32; p < last; p += 8)
+        *reinterpret_cast<ua64_t*>(p) = pat;
+    d = start;
+    if(last - d >= 128) {
+        uchar *end = d + Math::round_dn<size_t>(last - d, 128);
+        if(len >= MemOps::NT_SIZE) {
+            AVX2_SET_LOOP("vmovntdq");
+            asm volatile ("sfence" : : : "memory");
+        }
+        else
+            AVX2_SET_LOOP("vmovdqa");
+        vzeroupper();
+    }
+    for(; d + 8 <= last; d += 8)
+        *reinterpret_cast<ua64_t*>(d) = pat;
+}
+
+static int cmp_avx2(const uchar *a, const uchar *b, size_t len) {
+    int res = 0;
+    for(; len >= 32; a += 32, b += 32, len -= 32) {
+        uint32_t eq;
+        asm volatile (
+            "vmovdqu (%1), %%ymm0\n\t"
+            "vpcmpeqb (%2), %%ymm0, %%ymm0\n\t"
+            "vpmovmskb %%ymm0, %0"
+            : "=r" (eq) : "r" (a), "r" (b), "m" (*a), "m" (*b) : "xmm0", "memory"
+        );
+        if(eq != 0xFFFFFFFF) {
+            res = cmp_mask(a, b, ~eq);
+            break;
+        }
+    }
+    vzeroupper();
+    return res ? res : cmp_bytes(a, b, len);
+}
+
+/* --------------------------------------------- ERMS ---------------------------------------------- */
+
+static void copy_erms(uchar *d, const uchar *s, size_t len) {
+    if(len >= MemOps::NT_SIZE)
+        copy_sse2(d, s, len);
+    else
+        asm volatile ("rep movsb" : "+D" (d), "+S" (s), "+c" (len) : : "memory");
+}
+
+static void set_erms(uchar *d, uchar value, size_t len) {
+    if(len >= MemOps::NT_SIZE)
+        set_sse2(d, value, len);
+    else
+        asm volatile ("rep stosb" : "+D" (d), "+c" (len) : "a" (value) : "memory");
+}
+
+static const Ops ops[] = {
+    /* GENERIC */ {copy_generic, set_generic, cmp_generic},
+    /* SSE2 */    {copy_sse2, set_sse2, cmp_sse2},
+    /* AVX2 */    {copy_avx2, set_avx2, cmp_avx2},
+    /* ERMS */    {copy_erms, set_erms, cmp_sse2},
+};
+
+static const char *names[] = {
+    "generic", "sse2", "avx2", "erms"
+};
+
+// start with the generic variant; memcpy & co. are already used before CPUInit runs
+static const Ops *cur_ops = ops + MemOps::GENERIC;
+static size_t small_size = 0;
+MemOps::Variant MemOps::_current = MemOps::GENERIC;
+
+bool MemOps::available(Variant v) {
+    switch(v) {
+        case GENERIC:
+            return true;
+        case SSE2:
+            return CPU::has(CPU::FEAT_SSE2);
+        case AVX2:
+            return CPU::has(CPU::FEAT_AVX2);
+        case ERMS:
+            return CPU::has(CPU::FEAT_ERMS) && CPU::has(CPU::FEAT_SSE2);
+        default:
+            return false;
+    }
+}
+
+const char *MemOps::name(Variant v) {
+    return v < COUNT ? names[v] : "??";
+}
+
+bool MemOps::select(Variant v) {
+    if(!available(v))
+        return false;
+    cur_ops = ops + v;
+    small_size = v == GENERIC ? 0 : SMALL_SIZE;
+    _current = v;
+    return true;
+}
+
+void MemOps::select_best() {
+    if(!select(AVX2) && !select(ERMS) && !select(SSE2))
+        select(GENERIC);
+}
+
+}
+
+using namespace nre;
+
+void *memcpy(void *dest, const void *src, size_t len) {
+    uchar *d = static_cast<uchar*>(dest);
+    const uchar *s = static_cast<const uchar*>(src);
+    if(len < small_size)
+        copy_small(d, s, len);
+    else
+        cur_ops->copy(d, s, len);
+    return dest;
+}
+
+void *memset(void *addr, int value, size_t count) {
+    uchar *d = static_cast<uchar*>(addr);
+    if(count < small_size)
+        set_small(d, value, count);
+    else
+        cur_ops->set(d, value, count);
+    return addr;
+}
+
+int memcmp(const void *str1, const void *str2, size_t count) {
+    const uchar *a = static_cast<const uchar*>(str1);
+    const uchar *b = static_cast<const uchar*>(str2);
+    if(count < small_size)
+        return cmp_bytes(a, b, count);
+    return cur_ops->cmp(a, b, count);
+}
@@ -25,6 +25,66 @@ namespace nre {
 char OStream::_hexchars_big[]     = "0123456789ABCDEF";
 char OStream::_hexchars_small[]   = "0123456789abcdef";
 
+// the decimal representations of 0..99 to convert two digits at once
+static const char dec_pairs[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+static const char pad_spaces[] = "                ";
+static const char pad_zeros[]  = "0000000000000000";
+
+/**
+ * Converts <n> to a string in base <base> that ends at <end>. The string is not null-terminated.
+ *
+ * @param end the end of the buffer
+ * @param n the number
+ * @param base the base
+ * @param chars the digits to use
+ * @return the beginning of the string
+ */
+static char *convert(char *end, ullong n, uint base, const char *chars) {
+    char *p = end;
+    if(base == 10) {
+        while(n >= 100) {
+            uint rem = n % 100;
+            n /= 100;
+            p -= 2;
+            p[0] = dec_pairs[rem * 2];
+            p[1] = dec_pairs[rem * 2 + 1];
+        }
+        if(n >= 10) {
+            p -= 2;
+            p[0] = dec_pairs[n * 2];
+            p[1] = dec_pairs[n * 2 + 1];
+        }
+        else
+            *--p = '0' + n;
+    }
+    // for powers of two, we can use shifts and masks instead of divisions
+    else if((base & (base - 1)) == 0) {
+        uint shift = __builtin_ctz(base);
+        do {
+            *--p = chars[n & (base - 1)];
+            n >>= shift;
+        }
+        while(n);
+    }
+    else {
+        do {
+            *--p = chars[n % base];
+            n /= base;
+        }
+        while(n);
+    }
+    return p;
+}
+
+void OStream::write(const char *str, size_t len) {
+    while(len-- > 0)
+        write(*str++);
+}
+
 OStream::FormatParams::FormatParams(const char *fmt, bool all, va_list *ap)
         : _base(10), _flags(0), _pad(0), _prec(-1), _end() {
     // read flags
@@ -140,13 +200,18 @@ int OStream::vwritef(const char *fmt, va_list ap0) {
     va_copy(ap, ap0);
     while(1) {
         char c;
-        // wait for a '%'
-        while((c = *fmt++) != '%') {
-            write(c);
-            // finished?
-            if(c == '\0')
-                return count;
-            count++;
+        // write everything up to the next '%' at once
+        const char *begin = fmt;
+        while(*fmt && *fmt != '%')
+            fmt++;
+        if(fmt > begin) {
+            write(begin, fmt - begin);
+            count += fmt - begin;
+        }
+        // finished?
+        if(*fmt++ == '\0') {
+            write('\0');
+            return count;
         }
 
         // read format parameter
@@ -360,9 +425,12 @@ int OStream::printpad(int count, uint flags) {
         return 0;
 
     int res = count;
-    char c = flags & FormatParams::PADZEROS ? '0' : ' ';
-    while(count-- > 0)
-        write(c);
+    const char *pad = flags & FormatParams::PADZEROS ? pad_zeros : pad_spaces;
+    while(count > 0) {
+        size_t amount = Math::min<size_t>(count, sizeof(pad_spaces) - 1);
+        write(pad, amount);
+        count -= amount;
+    }
     return res;
 }
 
@@ -370,28 +438,25 @@ int OStream::printu(ullong n, uint base, char *chars) {
     if(this == nullptr)
         return 0;
 
-    int res = 0;
-    if(n >= base)
-        res += printu(n / base, base, chars);
-    write(chars[(n % base)]);
-    return res + 1;
+    char buf[MAX_INT_LEN];
+    char *end = buf + sizeof(buf);
+    char *begin = convert(end, n, base, chars);
+    write(begin, end - begin);
+    return end - begin;
 }
 
 int OStream::printn(llong n) {
     if(this == nullptr)
         return 0;
 
-    int res = 0;
-    if(n < 0) {
-        write('-');
-        n = -n;
-        res++;
-    }
-
-    if(n >= 10)
-        res += printn(n / 10);
-    write('0' + n % 10);
-    return res + 1;
+    char buf[MAX_INT_LEN];
+    char *end = buf + sizeof(buf);
+    // negate it as unsigned to handle the smallest negative number as well
+    char *begin = convert(end, n < 0 ? -static_cast<ullong>(n) : n, 10, _hexchars_small);
+    if(n < 0)
+        *--begin = '-';
+    write(begin, end - begin);
+    return end - begin;
 }
 
 int OStream::printdbl(double d, uint precision) {
@@ -414,15 +479,23 @@ int OStream::printdbl(double d, uint precision) {
         d -= val;
         if(d < 0)
             d = -d;
-        write('.');
-        c++;
+        // collect the fractional digits in a buffer and write them in chunks
+        char buf[32];
+        size_t pos = 0;
+        buf[pos++] = '.';
         while(prec-- > 0) {
             d *= 10;
             val = static_cast<llong>(d);
-            write((val % 10) + '0');
+            buf[pos++] = (val % 10) + '0';
             d -= val;
-            c++;
+            if(pos == sizeof(buf)) {
+                write(buf, pos);
+                c += pos;
+                pos = 0;
+            }
         }
+        write(buf, pos);
+        c += pos;
     }
     return c;
 }
@@ -450,13 +523,11 @@ int OStream::puts(const char *str, ulong prec) {
     if(this == nullptr)
         return 0;
 
-    const char *begin = str;
-    char c;
-    while((prec == static_cast<ulong>(-1) || prec-- > 0) && (c = *str)) {
-        write(c);
-        str++;
-    }
-    return str - begin;
+    size_t len = 0;
+    while((prec == static_cast<ulong>(-1) || len < prec) && str[len])
+        len++;
+    write(str, len);
+    return len;
 }
 
 }
@@ -17,6 +17,8 @@
 #include <arch/Startup.h>
 #include <stream/Serial.h>
 #include <services/Log.h>
+#include <util/Math.h>
+#include <cstring>
 
 namespace nre {
 
@@ -30,24 +32,44 @@ Serial::Init::Init() {
         BaseSerial::_inst = new Serial();
 }
 
-Serial::Serial()
-    : BaseSerial(), _sess(new LogSession("log", _startup_info.progname)), _bufpos(0), _buf() {
-}
-
-Serial::~Serial() {
-    delete _sess;
-}
-
-void Serial::write(char c) {
+void BaseSerial::buffer(char c) {
     if(c == '\0')
         return;
 
     if(_bufpos == sizeof(_buf) || c == '\n') {
-        _sess->write(String(_buf, _bufpos));
+        flush(_buf, _bufpos);
         _bufpos = 0;
     }
     if(c != '\n')
         _buf[_bufpos++] = c;
 }
 
+void BaseSerial::buffer(const char *str, size_t len) {
+    const char *end = str + len;
+    while(str < end) {
+        // copy all characters up to the next special one or until the buffer is full at once
+        size_t max = Math::min<size_t>(end - str, sizeof(_buf) - _bufpos);
+        size_t n = 0;
+        while(n < max && str[n] != '\n' && str[n] != '\0')
+            n++;
+        memcpy(_buf + _bufpos, str, n);
+        _bufpos += n;
+        str += n;
+        // let buffer(char) handle newlines, null-chars and a full buffer
+        if(str < end)
+            buffer(*str++);
+    }
+}
+
+Serial::Serial() : BaseSerial(), _sess(new LogSession("log", _startup_info.progname)) {
+}
+
+Serial::~Serial() {
+    delete _sess;
+}
+
+void Serial::flush(const char *line, size_t len) {
+    _sess->write(String(line, len));
+}
+
 }
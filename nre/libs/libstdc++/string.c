@@ -17,7 +17,7 @@
 #include <arch/Defines.h>
 #include <cstring>
 
-void* memcpy(void *dest, const void *src, size_t len) {
+void *memcpy_generic(void *dest, const void *src, size_t len) {
     uchar *bdest = (uchar*)dest;
     uchar *bsrc = (uchar*)src;
     // copy bytes for alignment
@@ -78,14 +78,15 @@ void *memmove(void *dest, const void *src, size_t count) {
         while(count-- > 0)
             *d-- = *s--;
     }
-    // moving backwards
+    // moving backwards. don't use memcpy here, because the optimized variants may read source
+    // bytes that they have already overwritten. the generic one copies strictly forward.
     else
-        memcpy(dest, src, count);
+        memcpy_generic(dest, src, count);
 
     return dest;
 }
 
-void *memset(void *addr, int value, size_t count) {
+void *memset_generic(void *addr, int value, size_t count) {
     uchar *baddr = (uchar*)addr;
     // align it
     while(count > 0 && (uintptr_t)baddr % sizeof(word_t)) {
@@ -122,7 +123,7 @@ char *strcpy(char *dst, const char *src) {
     return res;
 }
 
-int memcmp(const void *str1, const void *str2, size_t count) {
+int memcmp_generic(const void *str1, const void *str2, size_t count) {
     const uchar *s1 = (const uchar*)str1;
     const uchar *s2 = (const uchar*)str2;
     while(count-- > 0) {
@@ -22,14 +22,15 @@
 #include <kobj/Ports.h>
 #include <arch/Elf.h>
 #include <util/Math.h>
+#include <util/LZ4.h>
 #include <Logging.h>
 #include <new>
 
 namespace nre {
 
 ChildManager::ChildManager()
-    : _next_id(0), _child_count(0), _childs(), _deleter(this), _dsm(), _registry(), _sm(),
-      _switchsm(), _slotsm(), _regsm(0), _diesm(0), _ecs(), _srvecs() {
+    : _next_id(0), _child_count(0), _childs(), _deleter(this), _dsm(), _pages(), _registry(),
+      _sm(), _switchsm(), _slotsm(), _regsm(0), _diesm(0), _ecs(), _srvecs() {
     _ecs = new Reference<LocalThread>[CPU::count()];
     _srvecs = new Reference<LocalThread>[CPU::count()];
     for(auto it = CPU::begin(); it != CPU::end(); ++it) {
@@ -169,16 +170,244 @@ void ChildManager::build_hip(Child *c, const ChildConfig &config) {
     c->reglist().add(ds.desc(), c->_hip, ChildMemory::R | ChildMemory::OWN, ds.unmapsel());
 }
 
-Child::id_type ChildManager::load(uintptr_t addr, size_t size, const ChildConfig &config) {
-    ElfEh *elf = reinterpret_cast<ElfEh*>(addr);
-
-    // check ELF
+static const ElfEh *check_elf(uintptr_t addr, size_t size) {
+    const ElfEh *elf = reinterpret_cast<const ElfEh*>(addr);
     if(size < sizeof(ElfEh) || sizeof(ElfPh) > elf->e_phentsize ||
        size < elf->e_phoff + elf->e_phentsize * elf->e_phnum)
         throw ElfException(E_ELF_INVALID, "Size of ELF file invalid");
     if(!(elf->e_ident[0] == 0x7f && elf->e_ident[1] == 'E' &&
          elf->e_ident[2] == 'L' && elf->e_ident[3] == 'F'))
         throw ElfException(E_ELF_SIG, "No ELF signature");
+    return elf;
+}
+
+static const ElfPh *load_segment(uintptr_t addr, size_t size, const ElfEh *elf, size_t i) {
+    const ElfPh *ph = reinterpret_cast<const ElfPh*>(addr + elf->e_phoff + i * elf->e_phentsize);
+    if(reinterpret_cast<uintptr_t>(ph) + sizeof(ElfPh) > addr + size)
+        throw ElfException(E_ELF_INVALID, "Program header outside binary");
+    if(ph->p_type != 1)
+        return nullptr;
+    if(size < ph->p_offset + ph->p_filesz)
+        throw ElfException(E_ELF_INVALID, "LOAD segment outside binary");
+    return ph;
+}
+
+static uint segment_perms(const ElfPh *ph) {
+    uint perms = 0;
+    if(ph->p_flags & PF_R)
+        perms |= ChildMemory::R;
+    if(ph->p_flags & PF_W)
+        perms |= ChildMemory::W;
+    if(ph->p_flags & PF_X)
+        perms |= ChildMemory::X;
+    return perms;
+}
+
+const DataSpace &ChildManager::create_segment(uintptr_t src, size_t filesz, size_t memsz) {
+    size_t dssize = Math::round_up<size_t>(memsz, ExecEnv::PAGE_SIZE);
+    const DataSpace &ds = _dsm.create(
+        DataSpaceDesc(dssize, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RWX));
+    // without source, the file content is written later
+    if(src)
+        memcpy(reinterpret_cast<void*>(ds.virt()), reinterpret_cast<void*>(src), filesz);
+    if(!(ds.flags() & DataSpaceDesc::ZEROED))
+        memset(reinterpret_cast<void*>(ds.virt() + filesz), 0, memsz - filesz);
+    return ds;
+}
+
+/**
+ * Receives a decompressed ELF file and builds an Image from it. The headers have to be in the
+ * first page, which is buffered. Afterwards, the LOAD segments are created and all data is copied
+ * directly into them, so that the decompressed file never exists as a whole.
+ */
+class ChildManager::ElfStream : public LZ4::Sink {
+    static const size_t HEADER_SIZE = ExecEnv::PAGE_SIZE;
+
+    struct Range {
+        uintptr_t offset;
+        size_t size;
+    };
+
+public:
+    explicit ElfStream(ChildManager *cm)
+        : _cm(cm), _img(), _pos(), _files(), _hdr(new uint8_t[HEADER_SIZE]) {
+    }
+    virtual ~ElfStream() {
+        if(_img)
+            _cm->destroy_image(_img);
+        delete[] _hdr;
+    }
+
+    virtual void write(const void *data, size_t len) {
+        const uint8_t *src = static_cast<const uint8_t*>(data);
+        if(!_img) {
+            size_t amount = Math::min(len, HEADER_SIZE - _pos);
+            memcpy(_hdr + _pos, src, amount);
+            _pos += amount;
+            if(_pos < HEADER_SIZE)
+                return;
+            parse();
+            src += amount;
+            len -= amount;
+        }
+        copy(src, len);
+    }
+
+    /**
+     * Checks whether the complete file has been received and hands the image over to the caller
+     */
+    Image *finish() {
+        if(!_img)
+            parse();
+        for(size_t i = 0; i < _img->_count; ++i) {
+            if(_pos < _files[i].offset + _files[i].size)
+                throw ElfException(E_ELF_INVALID, "LOAD segment outside binary");
+        }
+        Image *img = _img;
+        _img = nullptr;
+        return img;
+    }
+
+private:
+    void parse() {
+        uintptr_t hdr = reinterpret_cast<uintptr_t>(_hdr);
+        const ElfEh *elf = check_elf(hdr, _pos);
+        _img = new Image(elf->e_entry);
+        for(size_t i = 0; i < elf->e_phnum; i++) {
+            const ElfPh *ph = reinterpret_cast<const ElfPh*>(
+                hdr + elf->e_phoff + i * elf->e_phentsize);
+            if(ph->p_type != 1)
+                continue;
+            if(_img->_count == Image::MAX_SEGMENTS)
+                throw ElfException(E_CAPACITY, "Too many LOAD segments");
+
+            Image::Segment &seg = _img->_segs[_img->_count];
+            seg.ds = &_cm->create_segment(0, ph->p_filesz, ph->p_memsz);
+            seg.virt = ph->p_vaddr;
+            seg.perms = segment_perms(ph);
+            _files[_img->_count].offset = ph->p_offset;
+            _files[_img->_count].size = ph->p_filesz;
+            _img->_count++;
+        }
+
+        // the buffered header might belong to segments as well
+        size_t pos = _pos;
+        _pos = 0;
+        copy(_hdr, pos);
+    }
+
+    void copy(const uint8_t *src, size_t len) {
+        for(size_t i = 0; i < _img->_count; ++i) {
+            uintptr_t start = Math::max<uintptr_t>(_pos, _files[i].offset);
+            uintptr_t end = Math::min<uintptr_t>(_pos + len, _files[i].offset + _files[i].size);
+            if(start < end) {
+                uintptr_t dst = _img->_segs[i].ds->virt() + start - _files[i].offset;
+                memcpy(reinterpret_cast<void*>(dst), src + start - _pos, end - start);
+            }
+        }
+        _pos += len;
+    }
+
+    ChildManager *_cm;
+    Image *_img;
+    size_t _pos;
+    Range _files[Image::MAX_SEGMENTS];
+    // we are usually running on a small stack
+    uint8_t *_hdr;
+};
+
+ChildManager::Image *ChildManager::create_image(uintptr_t addr, size_t size) {
+    if(LZ4::is_compressed(reinterpret_cast<const void*>(addr), size)) {
+        ElfStream stream(this);
+        LZ4::decompress(reinterpret_cast<const void*>(addr), size, stream);
+        return stream.finish();
+    }
+
+    const ElfEh *elf = check_elf(addr, size);
+    Image *img = new Image(elf->e_entry);
+    try {
+        for(size_t i = 0; i < elf->e_phnum; i++) {
+            const ElfPh *ph = load_segment(addr, size, elf, i);
+            if(!ph)
+                continue;
+            if(img->_count == Image::MAX_SEGMENTS)
+                throw ElfException(E_CAPACITY, "Too many LOAD segments");
+
+            Image::Segment &seg = img->_segs[img->_count];
+            seg.ds = &create_segment(addr + ph->p_offset, ph->p_filesz, ph->p_memsz);
+            seg.virt = ph->p_vaddr;
+            seg.perms = segment_perms(ph);
+            img->_count++;
+        }
+    }
+    catch(...) {
+        destroy_image(img);
+        throw;
+    }
+    return img;
+}
+
+void ChildManager::destroy_image(Image *img) {
+    for(size_t i = 0; i < img->_count; ++i) {
+        // the segment might have been handed over to a child already
+        if(!img->_segs[i].ds)
+            continue;
+        DataSpaceDesc desc = img->_segs[i].ds->desc();
+        _dsm.release(desc, img->_segs[i].ds->unmapsel());
+    }
+    delete img;
+}
+
+void ChildManager::wait_services(const ChildConfig &config) {
+    // wait until all services are registered
+    if(config.waits() > 0) {
+        size_t services_present;
+        do {
+            _regsm.down();
+            services_present = 0;
+            for(size_t i = 0; i < config.waits(); ++i) {
+                if(_registry.find(config.wait(i)))
+                    services_present++;
+            }
+        }
+        while(services_present < config.waits());
+    }
+}
+
+Child::id_type ChildManager::load(uintptr_t addr, size_t size, const ChildConfig &config) {
+    Child::id_type id = start(addr, size, config);
+    wait_services(config);
+    return id;
+}
+
+Child::id_type ChildManager::load(const Image &img, const ChildConfig &config) {
+    Child::id_type id = start(img, config);
+    wait_services(config);
+    return id;
+}
+
+Child::id_type ChildManager::start(uintptr_t addr, size_t size, const ChildConfig &config) {
+    return create(config, addr, size, nullptr);
+}
+
+Child::id_type ChildManager::start(const Image &img, const ChildConfig &config) {
+    return create(config, 0, 0, &img);
+}
+
+Child::id_type ChildManager::create(const ChildConfig &config, uintptr_t addr, size_t size,
+                                    const Image *img) {
+    timevalue_t loadstart = Util::tsc();
+    timevalue_t inflated = 0;
+    // for compressed files, decompress the segments into an image that is owned by the child
+    Image *own = nullptr;
+    if(!img && LZ4::is_compressed(reinterpret_cast<const void*>(addr), size)) {
+        ElfStream stream(this);
+        size = LZ4::decompress(reinterpret_cast<const void*>(addr), size, stream);
+        img = own = stream.finish();
+        inflated = Util::tsc();
+    }
+    const ElfEh *elf = img ? nullptr : check_elf(addr, size);
+    uintptr_t entry = img ? img->entry() : elf->e_entry;
 
     static struct {
         int no;
@@ -205,7 +434,10 @@ Child::id_type ChildManager::load(uintptr_t addr, size_t size, const ChildConfig
 
     // create child
     capsel_t pts = CapSelSpace::get().allocate(per_child_caps(), per_child_caps());
-    Child *c = new Child(this, _next_id++, config.cmdline());
+    Child *c = new Child(this, Atomic::add(&_next_id, +1), config.cmdline());
+    c->_timeline.load = loadstart;
+    c->_timeline.inflated = inflated;
+    c->_imgsize = size;
     try {
         // we have to create the portals first to be able to delegate them to the new Pd
         c->_ptcount = CPU::count() * (ARRAY_SIZE(exc) + Portals::COUNT - 1);
@@ -248,36 +480,44 @@ Child::id_type ChildManager::load(uintptr_t addr, size_t size, const ChildConfig
         // now create Pd and pass portals
         c->_pd = new Pd(Crd(pts, Math::next_pow2_shift(per_child_caps()), Crd::OBJ_ALL));
         c->_pd->set_name(config.cmdline().str());
-        c->_entry = elf->e_entry;
+        c->_entry = entry;
         c->_main = config.entry();
 
-        // check load segments and add them to regions
-        for(size_t i = 0; i < elf->e_phnum; i++) {
-            ElfPh *ph = reinterpret_cast<ElfPh*>(addr + elf->e_phoff + i * elf->e_phentsize);
-            if(reinterpret_cast<uintptr_t>(ph) + sizeof(ElfPh) > addr + size)
-                throw ElfException(E_ELF_INVALID, "Program header outside binary");
-            if(ph->p_type != 1)
-                continue;
-            if(size < ph->p_offset + ph->p_filesz)
-                throw ElfException(E_ELF_INVALID, "LOAD segment outside binary");
+        if(own) {
+            // hand the segments over to the child
+            for(size_t i = 0; i < own->_count; ++i) {
+                Image::Segment &seg = own->_segs[i];
+                c->reglist().add(seg.ds->desc(), seg.virt, seg.perms | ChildMemory::OWN,
+                                 seg.ds->unmapsel());
+                seg.ds = nullptr;
+            }
+        }
+        else if(img) {
+            // share the segments of the image; the writable ones are copied on demand
+            for(size_t i = 0; i < img->_count; ++i) {
+                const Image::Segment &seg = img->_segs[i];
+                const DataSpace &ds = _dsm.join(seg.ds->sel());
+                if(seg.perms & ChildMemory::W) {
+                    c->reglist().add(ds.desc(), seg.virt, seg.perms | ChildMemory::OWN,
+                                     ds.unmapsel(), &_pages);
+                }
+                else
+                    c->reglist().add(ds.desc(), seg.virt, seg.perms, ds.unmapsel());
+            }
+        }
+        else {
+            // check load segments and add them to regions
+            for(size_t i = 0; i < elf->e_phnum; i++) {
+                const ElfPh *ph = load_segment(addr, size, elf, i);
+                if(!ph)
+                    continue;
 
-            uint perms = ChildMemory::OWN;
-            if(ph->p_flags & PF_R)
-                perms |= ChildMemory::R;
-            if(ph->p_flags & PF_W)
-                perms |= ChildMemory::W;
-            if(ph->p_flags & PF_X)
-                perms |= ChildMemory::X;
-
-            size_t dssize = Math::round_up<size_t>(ph->p_memsz, ExecEnv::PAGE_SIZE);
-            // TODO leak, if reglist().add throws
-            const DataSpace &ds = _dsm.create(
-                DataSpaceDesc(dssize, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RWX));
-            // TODO actually it would be better to do that later
-            memcpy(reinterpret_cast<void*>(ds.virt()),
-                   reinterpret_cast<void*>(addr + ph->p_offset), ph->p_filesz);
-            memset(reinterpret_cast<void*>(ds.virt() + ph->p_filesz), 0, ph->p_memsz - ph->p_filesz);
-            c->reglist().add(ds.desc(), ph->p_vaddr, perms, ds.unmapsel());
+                // TODO leak, if reglist().add throws
+                // TODO actually it would be better to copy the content later
+                const DataSpace &ds = create_segment(addr + ph->p_offset, ph->p_filesz, ph->p_memsz);
+                c->reglist().add(ds.desc(), ph->p_vaddr, segment_perms(ph) | ChildMemory::OWN,
+                                 ds.unmapsel());
+            }
         }
 
         // utcb
@@ -285,7 +525,7 @@ Child::id_type ChildManager::load(uintptr_t addr, size_t size, const ChildConfig
         // just reserve the virtual memory with no permissions; it will not be requested
         c->reglist().add(DataSpaceDesc(Utcb::SIZE, DataSpaceDesc::VIRTUAL, 0), c->_utcb, 0);
         c->_ec = GlobalThread::create_for(c->_pd,
-            reinterpret_cast<GlobalThread::startup_func>(elf->e_entry), config.cpu(),
+            reinterpret_cast<GlobalThread::startup_func>(entry), config.cpu(),
             c->cmdline(), c->_utcb);
 
         // he needs a stack
@@ -305,29 +545,18 @@ Child::id_type ChildManager::load(uintptr_t addr, size_t size, const ChildConfig
         c->_ec->start();
     }
     catch(...) {
+        if(own)
+            destroy_image(own);
         delete c;
         throw;
     }
+    delete own;
 
     {
         ScopedLock<UserSm> guard(&_sm);
         _childs.insert(c);
     }
     Atomic::add(&_child_count, +1);
-
-    // wait until all services are registered
-    if(config.waits() > 0) {
-        size_t services_present;
-        do {
-            _regsm.down();
-            services_present = 0;
-            for(size_t i = 0; i < config.waits(); ++i) {
-                if(_registry.find(config.wait(i)))
-                    services_present++;
-            }
-        }
-        while(services_present < config.waits());
-    }
     return c->id();
 }
 
@@ -359,6 +588,7 @@ void ChildManager::Portals::startup(Child *c) {
             uf->rcx = c->hip();
             uf->rdx = c->utcb();
             uf->mtd = Mtd::RIP_LEN | Mtd::RSP | Mtd::GPR_ACDB | Mtd::GPR_BSD;
+            c->_timeline.start = Util::tsc();
             c->_started = true;
         }
     }
@@ -411,6 +641,15 @@ void ChildManager::Portals::service(Child *c) {
             }
             break;
 
+            case Service::STATS: {
+                capsel_t cap = uf.get_translated(0).offset();
+                uf.finish_input();
+
+                cm->reg_stats(c, cap, name);
+                uf << E_SUCCESS;
+            }
+            break;
+
             case Service::UNREGISTER: {
                 uf.finish_input();
 
@@ -640,9 +879,8 @@ void ChildManager::map(UtcbFrameRef &uf, Child *c, DataSpace::RequestType type)
     uf.finish_input();
 
     ScopedLock<UserSm> guard(&c->_sm);
-    uintptr_t addr = 0;
     if(type != DataSpace::JOIN && desc.type() == DataSpaceDesc::VIRTUAL) {
-        addr = c->reglist().find_free(desc.size());
+        uintptr_t addr = c->reglist().find_free(desc.size());
         desc = DataSpaceDesc(desc.size(), desc.type(), desc.flags(), 0, 0, desc.align());
         c->reglist().add(desc, addr, desc.flags());
         desc.virt(addr);
@@ -650,57 +888,69 @@ void ChildManager::map(UtcbFrameRef &uf, Child *c, DataSpace::RequestType type)
         uf << E_SUCCESS << desc;
     }
     else {
-        // create it or attach to the existing dataspace
-        const DataSpace &ds = type == DataSpace::JOIN ? _dsm.join(crd.offset()) : _dsm.create(desc);
+        add_dataspace(uf, c, type, desc, crd, 0);
+        uf << E_SUCCESS << desc;
+    }
+}
 
-        // add it to the regions of the child
-        uint flags = ds.flags();
-        try {
-            // only create creations and non-device-memory
-            if(type != DataSpace::JOIN && desc.phys() == 0)
-                flags |= ChildMemory::OWN;
-            // restrict permissions based on semaphore permission bits
-            else if(type == DataSpace::JOIN) {
-                if(!(crd.attr() & Crd::SM_UP))
-                    flags &= ~ChildMemory::W;
-                if(!(crd.attr() & Crd::SM_DN))
-                    flags &= ~ChildMemory::X;
-            }
-            size_t align = 1 << (ds.desc().align() + ExecEnv::PAGE_SHIFT);
-            addr = c->reglist().find_free(ds.size(), align);
-            c->reglist().add(ds.desc(), addr, flags, ds.unmapsel());
-        }
-        catch(...) {
-            _dsm.release(desc, ds.unmapsel());
-            throw;
-        }
+const DataSpace &ChildManager::add_dataspace(UtcbFrameRef &uf, Child *c,
+                                             DataSpace::RequestType type, DataSpaceDesc &desc,
+                                             Crd crd, size_t idx) {
+    // create it or attach to the existing dataspace
+    const DataSpace &ds = type == DataSpace::JOIN ? _dsm.join(crd.offset()) : _dsm.create(desc);
 
-        // build answer
-        DataSpaceDesc childdesc(ds.size(), ds.type(), ds.flags() & flags, ds.phys(), addr,
-                                ds.virt(), ds.desc().align());
-        if(type == DataSpace::CREATE) {
-            LOG(DATASPACES, "Child '" << c->cmdline() << "' created:\n\t"
-                                      << "[sel=" << fmt(ds.sel(), "#x")
-                                      << ", umsel=" << fmt(ds.unmapsel(), "#x") << "] "
-                                      << childdesc << "\n");
-            uf.delegate(ds.sel(), 0);
-            uf.delegate(ds.unmapsel(), 1);
-        }
-        else {
-            LOG(DATASPACES, "Child '" << c->cmdline() << "' joined:\n\t"
-                    << "[sel=" << fmt(ds.sel(), "#x")
-                    << ", umsel=" << fmt(ds.unmapsel(), "#x") << "] "
-                    << childdesc << "\n");
-            uf.accept_delegates();
-            uf.delegate(ds.unmapsel());
+    // add it to the regions of the child
+    uint flags = ds.flags();
+    uintptr_t addr;
+    try {
+        // only create creations and non-device-memory
+        if(type != DataSpace::JOIN && desc.phys() == 0)
+            flags |= ChildMemory::OWN;
+        // restrict permissions based on semaphore permission bits
+        else if(type == DataSpace::JOIN) {
+            // only the creator may rely on the content being zeroed
+            flags &= ~DataSpaceDesc::ZEROED;
+            if(!(crd.attr() & Crd::SM_UP))
+                flags &= ~ChildMemory::W;
+            if(!(crd.attr() & Crd::SM_DN))
+                flags &= ~ChildMemory::X;
         }
-        uf << E_SUCCESS << childdesc;
+        size_t align = 1 << (ds.desc().align() + ExecEnv::PAGE_SHIFT);
+        addr = c->reglist().find_free(ds.size(), align);
+        c->reglist().add(ds.desc(), addr, flags, ds.unmapsel());
+    }
+    catch(...) {
+        _dsm.release(desc, ds.unmapsel());
+        throw;
+    }
+
+    // build answer
+    desc = DataSpaceDesc(ds.size(), ds.type(), ds.flags() & flags, ds.phys(), addr, ds.virt(),
+                         ds.desc().align());
+    if(type != DataSpace::JOIN) {
+        LOG(DATASPACES, "Child '" << c->cmdline() << "' created:\n\t"
+                                  << "[sel=" << fmt(ds.sel(), "#x")
+                                  << ", umsel=" << fmt(ds.unmapsel(), "#x") << "] "
+                                  << desc << "\n");
+        uf.delegate(ds.sel(), idx * 2);
+        uf.delegate(ds.unmapsel(), idx * 2 + 1);
     }
+    else {
+        LOG(DATASPACES, "Child '" << c->cmdline() << "' joined:\n\t"
+                << "[sel=" << fmt(ds.sel(), "#x")
+                << ", umsel=" << fmt(ds.unmapsel(), "#x") << "] "
+                << desc << "\n");
+        uf.accept_delegates();
+        uf.delegate(ds.unmapsel());
+    }
+    return ds;
 }
 
 void ChildManager::switch_to(UtcbFrameRef &uf, Child *c) {
+    uint flags;
     capsel_t srcsel = uf.get_translated(0).offset();
     capsel_t dstsel = uf.get_translated(0).offset();
+    uf >> flags;
     uf.finish_input();
 
     {
@@ -716,8 +966,6 @@ void ChildManager::switch_to(UtcbFrameRef &uf, Child *c) {
             ChildMemory::DS *src, *dst;
             src = c->reglist().find(srcsel);
             dst = c->reglist().find(dstsel);
-            LOG(DATASPACES, "Child '" << c->cmdline() << "' switches:\n\t" << src->desc()
-                                      << "\n\t" << dst->desc() << "\n");
             if(!src || !dst) {
                 VTHROW(Exception, E_ARGS_INVALID,
                        "Unable to switch. DS " << srcsel << " or " << dstsel << " not found");
@@ -727,16 +975,24 @@ void ChildManager::switch_to(UtcbFrameRef &uf, Child *c) {
                        "Unable to switch non-equal-sized dataspaces (" << src->desc().size() << ","
                                                                        << dst->desc().size() << ")");
             }
-
-            // first revoke the memory to prevent further accesses
+            if(src->cow() || dst->cow())
+                VTHROW(Exception, E_ARGS_INVALID, "Unable to switch copy-on-write dataspaces");
+            LOG(DATASPACES, "Child '" << c->cmdline() << "' switches"
+                                      << ((flags & DataSpace::SWITCH_COPY) ? " (copy)" : "")
+                                      << ":\n\t" << src->desc() << "\n\t" << dst->desc() << "\n");
+
+            // first revoke the memory to prevent further accesses. the pagefault handler will
+            // establish the mappings to the new backing memory on demand.
             CapRange(src->desc().origin() >> ExecEnv::PAGE_SHIFT,
                      src->desc().size() >> ExecEnv::PAGE_SHIFT, Crd::MEM_ALL).revoke(false);
             CapRange(dst->desc().origin() >> ExecEnv::PAGE_SHIFT,
                      dst->desc().size() >> ExecEnv::PAGE_SHIFT, Crd::MEM_ALL).revoke(false);
-            // now copy the content
-            memcpy(reinterpret_cast<char*>(dst->desc().origin()),
-                   reinterpret_cast<char*>(src->desc().origin()),
-                   src->desc().size());
+            // copy the content only if requested; otherwise, the dataspaces exchange their content
+            if(flags & DataSpace::SWITCH_COPY) {
+                memcpy(reinterpret_cast<char*>(dst->desc().origin()),
+                       reinterpret_cast<char*>(src->desc().origin()),
+                       src->desc().size());
+            }
             // now swap the two dataspaces
             srcorg = src->desc().origin();
             dstorg = dst->desc().origin();
@@ -796,6 +1052,111 @@ void ChildManager::unmap(UtcbFrameRef &uf, Child *c) {
     uf << E_SUCCESS;
 }
 
+void ChildManager::map_batch(UtcbFrameRef &uf, Child *c) {
+    size_t count;
+    DataSpaceDesc descs[DataSpace::MAX_BATCH];
+    uf >> count;
+    if(count == 0 || count > DataSpace::MAX_BATCH)
+        VTHROW(Exception, E_ARGS_INVALID, "Invalid number of dataspaces (" << count << ")");
+    for(size_t i = 0; i < count; ++i) {
+        uf >> descs[i];
+        if(descs[i].type() == DataSpaceDesc::VIRTUAL)
+            VTHROW(Exception, E_ARGS_INVALID, "Virtual dataspaces can't be created in a batch");
+    }
+    uf.finish_input();
+
+    ScopedLock<UserSm> guard(&c->_sm);
+    capsel_t umsels[DataSpace::MAX_BATCH];
+    size_t i = 0;
+    try {
+        for(; i < count; ++i)
+            umsels[i] = add_dataspace(uf, c, DataSpace::CREATE, descs[i], Crd(0), i).unmapsel();
+    }
+    catch(...) {
+        // all or nothing: undo the already created ones
+        while(i-- > 0) {
+            c->reglist().remove(umsels[i]);
+            _dsm.release(descs[i], umsels[i]);
+        }
+        throw;
+    }
+
+    uf << E_SUCCESS;
+    for(i = 0; i < count; ++i)
+        uf << descs[i];
+}
+
+void ChildManager::unmap_batch(UtcbFrameRef &uf, Child *c) {
+    size_t count;
+    DataSpaceDesc descs[DataSpace::MAX_BATCH];
+    capsel_t sels[DataSpace::MAX_BATCH];
+    uf >> count;
+    if(count > DataSpace::MAX_BATCH)
+        VTHROW(Exception, E_ARGS_INVALID, "Invalid number of dataspaces (" << count << ")");
+    for(size_t i = 0; i < count; ++i) {
+        uf >> descs[i];
+        sels[i] = uf.get_translated(0).offset();
+    }
+    uf.finish_input();
+
+    ScopedLock<UserSm> guard(&c->_sm);
+    for(size_t i = 0; i < count; ++i) {
+        LOG(DATASPACES, "Child '" << c->cmdline() << "' destroys "
+                                  << fmt(sels[i], "#x") << ": " << descs[i] << "\n");
+        _dsm.release(descs[i], sels[i]);
+        c->reglist().remove(sels[i]);
+    }
+    uf << E_SUCCESS;
+}
+
+void ChildManager::map_dma(UtcbFrameRef &uf, Child *c) {
+    uintptr_t addr;
+    uf >> addr;
+    uf.finish_input();
+
+    ScopedLock<UserSm> guard_switch(&_switchsm);
+    ScopedLock<UserSm> guard_regs(&c->_sm);
+    ChildMemory::DS *ds = c->reglist().find_by_addr(addr);
+    // copy-on-write dataspaces would change their backing memory behind the device's back
+    if(!ds || ds->desc().type() == DataSpaceDesc::VIRTUAL || ds->cow())
+        VTHROW(Exception, E_ARGS_INVALID, "Unable to map " << fmt(addr, "p") << " for DMA");
+
+    // delegate as much of the remaining dataspace as fits into the UTCB. in contrast to the
+    // pagefault handler, we delegate pages that are already mapped as well, because only the
+    // delegation with UPD_DPT puts them into the DMA page table
+    uintptr_t page = addr & ~(ExecEnv::PAGE_SIZE - 1);
+    uint perms = ds->desc().flags() & ChildMemory::RWX;
+    size_t pages = (ds->desc().virt() + ds->desc().size() - page) >> ExecEnv::PAGE_SHIFT;
+    CapRange cr(ds->origin(page) >> ExecEnv::PAGE_SHIFT, pages, Crd::MEM | (perms << 2),
+                page >> ExecEnv::PAGE_SHIFT);
+    cr.limit_to(uf.free_typed());
+
+    // if we're a subsystem, we might not have the memory ourself yet. thus, fault it in and stop
+    // at the first page that we still don't have, because we can't delegate what we don't own
+    size_t present = 0;
+    for(; present < cr.count(); ++present) {
+        uintptr_t src = ds->origin(page + present * ExecEnv::PAGE_SIZE);
+        Crd res = Syscalls::lookup(Crd(src >> ExecEnv::PAGE_SHIFT, 0, Crd::MEM));
+        if(res.is_null()) {
+            UNUSED volatile int x = *reinterpret_cast<int*>(src);
+            res = Syscalls::lookup(Crd(src >> ExecEnv::PAGE_SHIFT, 0, Crd::MEM));
+            if(res.is_null())
+                break;
+        }
+    }
+    if(present == 0)
+        VTHROW(Exception, E_NOT_FOUND, "Memory for " << fmt(page, "p") << " is not present");
+    cr.count(present);
+    cr.limit_to(uf.free_typed());
+    uf.delegate(cr, UtcbFrame::UPD_DPT);
+    for(size_t i = 0; i < cr.count(); ++i)
+        ds->page_perms(page + i * ExecEnv::PAGE_SIZE, 1, perms);
+
+    LOG(DATASPACES, "Child '" << c->cmdline() << "' mapped " << cr.count() << " pages @ "
+                              << fmt(page, "p") << " for DMA\n");
+    uf << E_SUCCESS << (cr.count() * ExecEnv::PAGE_SIZE);
+}
+
 void ChildManager::Portals::dataspace(Child *c) {
     ChildManager *cm = Thread::current()->get_tls<ChildManager*>(Thread::TLS_PARAM);
     UtcbFrameRef uf;
@@ -816,6 +1177,18 @@ void ChildManager::Portals::dataspace(Child *c) {
             case DataSpace::DESTROY:
                 cm->unmap(uf, c);
                 break;
+
+            case DataSpace::CREATE_BATCH:
+                cm->map_batch(uf, c);
+                break;
+
+            case DataSpace::DESTROY_BATCH:
+                cm->unmap_batch(uf, c);
+                break;
+
+            case DataSpace::MAP_DMA:
+                cm->map_dma(uf, c);
+                break;
         }
     }
     catch(const Exception& e) {
@@ -850,7 +1223,6 @@ void ChildManager::Portals::ex_pf(Child *c) {
                            << " @ " << fmt(eip, "p") << " on cpu " << pcpu << ", error="
                            << fmt(error, "#x") << "\n");
 
-        // TODO different handlers (cow, ...)
         uintptr_t pfpage = pfaddr & ~(ExecEnv::PAGE_SIZE - 1);
         bool remap = false;
         ChildMemory::DS *ds = c->reglist().find_by_addr(pfaddr);
@@ -869,8 +1241,13 @@ void ChildManager::Portals::ex_pf(Child *c) {
                 kill = true;
         }
 
+        // copy-on-write dataspaces need special treatment
+        bool cow = !kill && ds->cow();
+        if(cow)
+            cow_fault(uf, ds, pfpage, flags, perms, error);
+
         // is the page already mapped (may be ok if two cpus accessed the page at the same time)
-        if(!kill && flags) {
+        if(!kill && !cow && flags) {
             // first check if our parent has unmapped the memory
             Crd res = Syscalls::lookup(Crd(ds->origin(pfaddr) >> ExecEnv::PAGE_SHIFT, 0, Crd::MEM));
             // if so, remap it
@@ -888,7 +1265,7 @@ void ChildManager::Portals::ex_pf(Child *c) {
             }
         }
 
-        if(!kill && (remap || !flags)) {
+        if(!kill && !cow && (remap || !flags)) {
             // try to map the next few pages
             size_t pages = 32;
             if(ds->desc().flags() & DataSpaceDesc::BIGPAGES) {
@@ -937,6 +1314,27 @@ void ChildManager::Portals::ex_pf(Child *c) {
     }
 }
 
+void ChildManager::cow_fault(UtcbExcFrameRef &uf, ChildMemory::DS *ds, uintptr_t pfpage, uint flags,
+                             uint perms, unsigned error) {
+    // as long as the page has not been copied, the child gets the template page without write
+    // permission. on the first write, we copy it and exchange the mapping. note that we don't
+    // check whether the page is already mapped here, because revoking the template page affects
+    // all childs that share it; they simply fault again and get it remapped.
+    if(!ds->copied(pfpage)) {
+        if(error & 0x2) {
+            if(flags)
+                CapRange(ds->origin(pfpage) >> ExecEnv::PAGE_SHIFT, 1, Crd::MEM_ALL).revoke(false);
+            ds->copy(pfpage);
+        }
+        else
+            perms &= ~ChildMemory::W;
+    }
+
+    uf.delegate(CapRange(ds->origin(pfpage) >> ExecEnv::PAGE_SHIFT, 1, Crd::MEM | (perms << 2),
+                         pfpage >> ExecEnv::PAGE_SHIFT));
+    ds->page_perms(pfpage, 1, perms);
+}
+
 void ChildManager::exception_kill(Child *c, int vector) {
     ChildManager *cm = Thread::current()->get_tls<ChildManager*>(Thread::TLS_PARAM);
     UtcbExcFrameRef uf;
@@ -1087,6 +1485,46 @@ void ChildManager::kill_child(Child *c, int vector, UtcbExcFrameRef &uf, ExitTyp
         destroy_child(c);
 }
 
+void ChildManager::reg_stats(Child *c, capsel_t cap, const String& name) {
+    ScopedLock<UserSm> guard(&_sm);
+    // root registers its own dataspaces, which clients join at root directly
+    if(!c) {
+        _registry.set_stats(c, name, cap, ObjCap::INVALID);
+        return;
+    }
+
+    // <cap> has been translated to our selector of the dataspace. clients that get it via the
+    // registry translate to it again when joining, so that we find it in _dsm. keep a reference
+    // to it as long as the service is registered.
+    const DataSpace &ds = _dsm.join(cap);
+    try {
+        _registry.set_stats(c, name, ds.sel(), ds.unmapsel());
+    }
+    catch(...) {
+        DataSpaceDesc desc;
+        _dsm.release(desc, ds.unmapsel());
+        throw;
+    }
+}
+
+void ChildManager::unreg_service(Child *c, const String& name) {
+    ScopedLock<UserSm> guard(&_sm);
+    const ServiceRegistry::Service *s = _registry.find(name);
+    capsel_t unmap = s && s->child() == c ? s->stats_unmap() : ObjCap::INVALID;
+    _registry.unreg(c, name);
+    if(unmap != ObjCap::INVALID) {
+        DataSpaceDesc desc;
+        _dsm.release(desc, unmap);
+    }
+}
+
+void ChildManager::release_stats(const ServiceRegistry::Service &s) {
+    if(s.stats_unmap() != ObjCap::INVALID) {
+        DataSpaceDesc desc;
+        _dsm.release(desc, s.stats_unmap());
+    }
+}
+
 void ChildManager::destroy_child(Child *c) {
     // take care that we don't delete childs twice.
     bool del = false;
@@ -1094,6 +1532,10 @@ void ChildManager::destroy_child(Child *c) {
         ScopedLock<UserSm> guard(&_sm);
         if(_childs.remove(c)) {
             del = true;
+            for(auto it = _registry.cbegin(); it != _registry.cend(); ++it) {
+                if(it->child() == c)
+                    release_stats(*it);
+            }
             _registry.remove(c);
         }
     }
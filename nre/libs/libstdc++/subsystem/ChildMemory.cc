@@ -30,6 +30,7 @@ OStream &operator<<(OStream &os, const ChildMemory &cm) {
         os << fmt(it->desc().virt(), "p") << " .. " << fmt(it->desc().virt() + it->desc().size(), "p")
            << " (" << fmt(it->desc().size(), "#0x", sizeof(it->desc().size()) * 2) << " bytes) "
            << ((flags & ChildMemory::OWN) ? 'o' : '-')
+           << ((flags & ChildMemory::COW) ? 'c' : '-')
            << ((flags & ChildMemory::R) ? 'r' : '-')
            << ((flags & ChildMemory::W) ? 'w' : '-')
            << ((flags & ChildMemory::X) ? 'x' : '-')
@@ -29,6 +29,22 @@ const ServiceRegistry::Service* ServiceRegistry::reg(Child *child, const String
     return s;
 }
 
+void ServiceRegistry::set_stats(Child *child, const String &name, capsel_t ds, capsel_t unmap) {
+    Service *s = search(name);
+    if(!s)
+        VTHROW(ServiceRegistryException, E_NOT_FOUND, "Service '" << name << "' does not exist");
+    if(s->child() != child) {
+        VTHROW(ServiceRegistryException, E_NOT_FOUND,
+               "Child '" << child->cmdline() << "' does not own service '" << name << "'");
+    }
+    if(s->_stats != ObjCap::INVALID) {
+        VTHROW(ServiceRegistryException, E_EXISTS,
+               "Service '" << name << "' has statistics already");
+    }
+    s->_stats = ds;
+    s->_stats_unmap = unmap;
+}
+
 void ServiceRegistry::unreg(Child *child, const String &name) {
     Service *s = search(name);
     if(!s)
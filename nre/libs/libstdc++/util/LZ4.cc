@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/LZ4.h>
+#include <util/Math.h>
+#include <cstring>
+
+namespace nre {
+
+/**
+ * Produces the decompressed data. It either writes directly into the destination buffer or, if a
+ * sink is given, uses the buffer as a sliding window and passes everything that has been written
+ * to the sink before it slides.
+ */
+class LZ4::Decoder {
+public:
+    explicit Decoder(uint8_t *buf, size_t size, Sink *sink = nullptr)
+        : _buf(buf), _size(size), _pos(0), _flushed(0), _total(0), _sink(sink) {
+    }
+
+    uint64_t total() const {
+        return _total;
+    }
+
+    void literals(const uint8_t *src, size_t len) {
+        while(len > 0) {
+            size_t amount = room(len);
+            memcpy(_buf + _pos, src, amount);
+            _pos += amount;
+            _total += amount;
+            src += amount;
+            len -= amount;
+        }
+    }
+
+    void match(size_t offset, size_t len) {
+        if(offset == 0 || offset > _pos)
+            throw LZ4Exception(E_ARGS_INVALID, "Invalid match offset");
+        while(len > 0) {
+            size_t amount = room(len);
+            uint8_t *dst = _buf + _pos;
+            const uint8_t *src = dst - offset;
+            // the regions may overlap, which repeats the last <offset> bytes
+            if(offset >= amount)
+                memcpy(dst, src, amount);
+            else {
+                for(size_t i = 0; i < amount; ++i)
+                    dst[i] = src[i];
+            }
+            _pos += amount;
+            _total += amount;
+            len -= amount;
+        }
+    }
+
+    void flush() {
+        if(_sink && _pos > _flushed)
+            _sink->write(_buf + _flushed, _pos - _flushed);
+        _flushed = _pos;
+    }
+
+private:
+    size_t room(size_t len) {
+        if(_pos == _size) {
+            if(!_sink)
+                throw LZ4Exception(E_CAPACITY, "Destination buffer too small");
+            // keep the window for the back references and continue behind it
+            flush();
+            memmove(_buf, _buf + _size - WINDOW_SIZE, WINDOW_SIZE);
+            _pos = _flushed = WINDOW_SIZE;
+        }
+        return Math::min(len, _size - _pos);
+    }
+
+    uint8_t *_buf;
+    size_t _size;
+    size_t _pos;
+    size_t _flushed;
+    uint64_t _total;
+    Sink *_sink;
+};
+
+/**
+ * Counts the decompressed bytes without storing them
+ */
+class LZ4::NullSink : public LZ4::Sink {
+public:
+    virtual void write(const void *, size_t) {
+    }
+};
+
+enum {
+    FLG_VERSION_MASK        = 0xC0,
+    FLG_VERSION             = 0x40,
+    FLG_BLOCK_CHECKSUM      = 0x10,
+    FLG_CONTENT_SIZE        = 0x08,
+    FLG_CONTENT_CHECKSUM    = 0x04,
+    FLG_DICT_ID             = 0x01,
+    BLOCK_UNCOMPRESSED      = 0x80000000,
+};
+
+const uint8_t *LZ4::read_header(const uint8_t *src, size_t size, uint8_t *flags,
+                                uint64_t *content_size) {
+    // magic, FLG, BD and HC
+    if(size < 7 || read32(src) != MAGIC)
+        throw LZ4Exception(E_ARGS_INVALID, "No LZ4 frame");
+    *flags = src[4];
+    if((*flags & FLG_VERSION_MASK) != FLG_VERSION)
+        throw LZ4Exception(E_ARGS_INVALID, "Unsupported LZ4 version");
+    if(*flags & FLG_DICT_ID)
+        throw LZ4Exception(E_ARGS_INVALID, "LZ4 dictionaries are not supported");
+
+    src += 6;
+    *content_size = 0;
+    if(*flags & FLG_CONTENT_SIZE) {
+        if(size < 15)
+            throw LZ4Exception(E_ARGS_INVALID, "Truncated LZ4 frame header");
+        *content_size = read32(src) | (static_cast<uint64_t>(read32(src + 4)) << 32);
+        src += 8;
+    }
+    // skip header checksum
+    return src + 1;
+}
+
+void LZ4::decode_block(Decoder &dec, const uint8_t *src, size_t size) {
+    const uint8_t *end = src + size;
+    while(src < end) {
+        uint token = *src++;
+
+        size_t len = token >> 4;
+        if(len == 15) {
+            uint8_t b;
+            do {
+                if(src == end)
+                    throw LZ4Exception(E_ARGS_INVALID, "Truncated literal length");
+                b = *src++;
+                len += b;
+            }
+            while(b == 255);
+        }
+        if(len > static_cast<size_t>(end - src))
+            throw LZ4Exception(E_ARGS_INVALID, "Literals exceed block");
+        dec.literals(src, len);
+        src += len;
+
+        // the last sequence consists of literals only
+        if(src == end)
+            break;
+
+        if(end - src < 2)
+            throw LZ4Exception(E_ARGS_INVALID, "Truncated match offset");
+        size_t offset = src[0] | (src[1] << 8);
+        src += 2;
+        len = token & 0xF;
+        if(len == 15) {
+            uint8_t b;
+            do {
+                if(src == end)
+                    throw LZ4Exception(E_ARGS_INVALID, "Truncated match length");
+                b = *src++;
+                len += b;
+            }
+            while(b == 255);
+        }
+        dec.match(offset, len + 4);
+    }
+}
+
+uint64_t LZ4::decode(const void *data, size_t size, Decoder &dec) {
+    const uint8_t *start = static_cast<const uint8_t*>(data);
+    const uint8_t *end = start + size;
+    uint8_t flags;
+    uint64_t content_size;
+    const uint8_t *src = read_header(start, size, &flags, &content_size);
+
+    while(true) {
+        if(end - src < 4)
+            throw LZ4Exception(E_ARGS_INVALID, "Truncated LZ4 block");
+        uint32_t bsize = read32(src);
+        src += 4;
+        // end mark
+        if(bsize == 0)
+            break;
+
+        bool raw = bsize & BLOCK_UNCOMPRESSED;
+        bsize &= ~BLOCK_UNCOMPRESSED;
+        if(bsize > static_cast<size_t>(end - src))
+            throw LZ4Exception(E_ARGS_INVALID, "LZ4 block exceeds data");
+        if(raw)
+            dec.literals(src, bsize);
+        else
+            decode_block(dec, src, bsize);
+        src += bsize;
+        if(flags & FLG_BLOCK_CHECKSUM)
+            src += 4;
+    }
+    dec.flush();
+
+    if((flags & FLG_CONTENT_SIZE) && dec.total() != content_size)
+        throw LZ4Exception(E_ARGS_INVALID, "Decompressed size does not match frame header");
+    return dec.total();
+}
+
+uint64_t LZ4::decompressed_size(const void *data, size_t size) {
+    uint8_t flags;
+    uint64_t content_size;
+    read_header(static_cast<const uint8_t*>(data), size, &flags, &content_size);
+    if(flags & FLG_CONTENT_SIZE)
+        return content_size;
+
+    NullSink sink;
+    return decompress(data, size, sink);
+}
+
+size_t LZ4::decompress(const void *data, size_t size, void *dst, size_t dstsize) {
+    Decoder dec(static_cast<uint8_t*>(dst), dstsize);
+    return decode(data, size, dec);
+}
+
+uint64_t LZ4::decompress(const void *data, size_t size, Sink &sink) {
+    // the window plus the same amount to decompress into before we have to slide
+    uint8_t *buf = new uint8_t[WINDOW_SIZE * 2];
+    try {
+        Decoder dec(buf, WINDOW_SIZE * 2, &sink);
+        uint64_t res = decode(data, size, dec);
+        delete[] buf;
+        return res;
+    }
+    catch(...) {
+        delete[] buf;
+        throw;
+    }
+}
+
+}
@@ -19,7 +19,14 @@
 
 namespace nre {
 
-Gsi *PCI::get_gsi_msi(BDF bdf, uint nr, void *msix_table) {
+size_t PCI::msi_vectors(BDF bdf) {
+    size_t msix_offset = find_cap(bdf, CAP_MSIX);
+    if(msix_offset)
+        return ((conf_read(bdf, msix_offset) >> 16) & 0x7FF) + 1;
+    return find_cap(bdf, CAP_MSI) ? 1 : 0;
+}
+
+Gsi *PCI::get_gsi_msi(BDF bdf, uint nr, void *msix_table, cpu_t cpu) {
     size_t msix_offset = find_cap(bdf, CAP_MSIX);
     size_t msi_offset = find_cap(bdf, CAP_MSI);
     if(!(msix_offset || msi_offset))
@@ -33,7 +40,7 @@ Gsi *PCI::get_gsi_msi(BDF bdf, uint nr, void *msix_table) {
     DataSpace devds(ExecEnv::PAGE_SIZE, DataSpaceDesc::LOCKED, DataSpaceDesc::R, phys_addr);
 
     // create GSI
-    Gsi *gsi = new Gsi(reinterpret_cast<void*>(devds.virt()), CPU::current().log_id());
+    Gsi *gsi = new Gsi(reinterpret_cast<void*>(devds.virt()), cpu);
     if(!gsi->msi_addr())
         throw PCIException(E_FAILURE, "Attach to MSI failed - IRQs may be broken!");
 
@@ -97,12 +104,15 @@ Gsi *PCI::get_gsi(BDF bdf, uint nr, bool /*level*/, void *msix_table) {
 
 size_t PCI::find_cap(BDF bdf, cap_type id) {
     try {
+        // fetch the whole config space at once instead of walking the list dword by dword
+        PCIConfig::Space space;
+        _pcicfg.read_all(bdf, space);
         // capabilities supported?
-        if((conf_read(bdf, 1) >> 16) & 0x10) {
-            for(uint8_t offset = conf_read(bdf, 0xd);
+        if((space.dwords[1] >> 16) & 0x10) {
+            for(uint8_t offset = space.dwords[0xd];
                 (offset != 0) && !(offset & 0x3);
-                offset = conf_read(bdf, offset >> 2) >> 8) {
-                if((conf_read(bdf, offset >> 2) & 0xFF) == id)
+                offset = space.dwords[offset >> 2] >> 8) {
+                if((space.dwords[offset >> 2] & 0xFF) == id)
                     return offset >> 2;
             }
         }
@@ -28,11 +28,7 @@ ConsoleService::ConsoleService(const char *name, uint modifier)
       _vbe(), _reboot("reboot"), _console(), _mode(0), _cons(), _concyc(), _switcher(this),
       _modifier(modifier) {
     // we want to accept two dataspaces
-    for(auto it = CPU::begin(); it != CPU::end(); ++it) {
-        Reference<LocalThread> t = get_thread(it->log_id());
-        UtcbFrameRef uf(t->utcb());
-        uf.accept_delegates(2);
-    }
+    accept_delegates(2);
 
     // add dummy session for boot screen and HV screen
     create_dummy(0, "Bootloader");
@@ -26,8 +26,10 @@ void ConsoleSessionData::create(DataSpace *in_ds, DataSpace *out_ds, Sm *sm) {
     _in_ds = in_ds;
     _out_ds = out_ds;
     _in_sm = sm;
-    if(_in_ds)
+    if(_in_ds) {
         _prod = new Producer<Console::ReceivePacket>(*in_ds, *sm, false);
+        _prod->stats(service()->stats_ring("input", _prod->rblength()));
+    }
     _screen = _srv->create_screen(_mode, _out_ds->size());
     _srv->session_ready(this);
 }
@@ -118,7 +118,8 @@ public:
 
 private:
     void swap() {
-        _out_ds->switch_to(_screen->mem());
+        // the content has to move between the session buffer and the screen
+        _out_ds->switch_to(_screen->mem(), nre::DataSpace::SWITCH_COPY);
     }
 
     bool _has_screen;
@@ -33,6 +33,6 @@ void Logging::printf(const char *format, ...) {
 }
 
 void Logging::vprintf(const char *format, va_list &ap) {
-    if(nre::Logging::level & nre::Logging::VESA_DETAIL)
+    if(nre::Logging::enabled(nre::Logging::VESA_DETAIL))
         nre::Serial::get().vwritef(format, ap);
 }
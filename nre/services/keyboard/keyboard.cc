@@ -51,6 +51,7 @@ public:
         _ds = ds;
         _sm = sm;
         _prod = new Producer<T>(*ds, *sm, false);
+        _prod->stats(service()->stats_ring("events", _prod->rblength()));
     }
 
 private:
@@ -62,16 +63,10 @@ private:
 template<class T>
 class KeyboardService : public Service {
 public:
-    typedef typename SListTreap<KeyboardSessionData<T> >::iterator iterator;
-
     explicit KeyboardService(const char *name, portal_func func)
         : Service(name, CPUSet(CPUSet::ALL), func) {
         // we want to accept one dataspaces
-        for(auto it = CPU::begin(); it != CPU::end(); ++it) {
-            Reference<LocalThread> ec = get_thread(it->log_id());
-            UtcbFrameRef uf(ec->utcb());
-            uf.accept_delegates(1);
-        }
+        accept_delegates(1);
     }
 
 private:
@@ -88,8 +83,9 @@ static uint msgsi;
 
 template<class T>
 static void broadcast(KeyboardService<T> *srv, const T &data) {
-    ScopedLock<Service> guard(srv);
-    for(auto it = srv->sessions_begin(); it != srv->sessions_end(); ++it) {
+    ScopedLock<RCULock> guard(&RCU::lock());
+    const ServiceSessionTable *table = srv->sessions();
+    for(auto it = table->begin(); it != table->end(); ++it) {
         KeyboardSessionData<T> *sess = static_cast<KeyboardSessionData<T>*>(&*it);
         if(sess->prod())
             sess->prod()->produce(data);
@@ -21,7 +21,7 @@
 using namespace nre;
 
 static void print_packet(const char *prefix, size_t len, const void *packet) {
-    if(Logging::level & Logging::NET_DETAIL) {
+    if(Logging::enabled(Logging::NET_DETAIL)) {
         const char *type;
         const Network::EthernetHeader *header =
                 reinterpret_cast<const Network::EthernetHeader*>(packet);
@@ -55,6 +55,8 @@ void NetworkSessionData::init(DataSpace *inds, Sm *insm, DataSpace *outds, Sm *o
     _out.sm = outsm;
     _cons = new PacketConsumer(*_in.ds, *_in.sm, false);
     _prod = new PacketProducer(*_out.ds, *_out.sm, false);
+    _cons->stats(service()->stats_ring("tx", _cons->rblength()));
+    _prod->stats(service()->stats_ring("rx", _prod->rblength()));
     _gt = GlobalThread::create(consumer_thread, CPU::current().log_id(),
                                     "network-consumer");
     _gt->set_tls(Thread::TLS_PARAM, this);
@@ -70,29 +72,31 @@ void NetworkSessionData::consumer_thread(void*) {
             break;
 
         print_packet("Sending", len, packet);
-        sess->_driver->send(packet, len);
+        sess->_switch->forward(sess, packet, len);
         sess->_cons->next();
     }
 }
 
 NetworkService::NetworkService(NICList &nics, const char *name)
     : Service(name, CPUSet(CPUSet::ALL), reinterpret_cast<portal_func>(portal)),
-      _nics(nics) {
+      _nics(nics), _sm(), _switches() {
     // we want to accept two dataspaces and two sms
-    for(auto it = CPU::begin(); it != CPU::end(); ++it) {
-        Reference<LocalThread> ec = get_thread(it->log_id());
-        UtcbFrameRef uf(ec->utcb());
-        uf.accept_delegates(2);
-    }
+    accept_delegates(2);
+}
+
+VSwitch *NetworkService::vswitch(size_t nic) {
+    ScopedLock<UserSm> guard(&_sm);
+    if(!_switches[nic])
+        _switches[nic] = new VSwitch(*this, nic, _nics.get(nic));
+    return _switches[nic];
 }
 
-void NetworkService::broadcast(const void *packet, size_t len) {
-    ScopedLock<Service> guard(this);
+void NetworkService::receive(NICDriver *driver, const void *packet, size_t len) {
     print_packet("Received", len, packet);
-    for(auto sess = sessions_begin(); sess != sessions_end(); ++sess) {
-        if(!static_cast<NetworkSessionData*>(&*sess)->enqueue(packet, len))
-            LOG(NET, "Client " << sess->id() << " lost packet of length " << len << "\n");
-    }
+    size_t nic = 0;
+    for(auto it = _nics.begin(); it != _nics.end() && *it != driver; ++it)
+        nic++;
+    vswitch(nic)->forward(nullptr, packet, len);
 }
 
 ServiceSession *NetworkService::create_session(size_t id, const String &args, portal_func func) {
@@ -101,7 +105,7 @@ ServiceSession *NetworkService::create_session(size_t id, const String &args, po
     is >> nic;
     if(!_nics.exists(nic))
         VTHROW(Exception, E_ARGS_INVALID, "NIC (" << nic << ") does not exist");
-    return new NetworkSessionData(this, id, func, nic, _nics.get(nic));
+    return new NetworkSessionData(this, id, func, nic, _nics.get(nic), vswitch(nic));
 }
 
 void NetworkService::portal(NetworkSessionData *sess) {
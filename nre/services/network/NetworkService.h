@@ -23,8 +23,10 @@
 #include <ipc/PacketProducer.h>
 #include <ipc/PacketConsumer.h>
 #include <stream/IStringStream.h>
+#include <kobj/UserSm.h>
 
 #include "NICList.h"
+#include "VSwitch.h"
 
 class NetworkSessionData : public nre::ServiceSession {
     struct Channel {
@@ -40,9 +42,9 @@ class NetworkSessionData : public nre::ServiceSession {
 
 public:
     explicit NetworkSessionData(nre::Service *s, size_t id, portal_func func, size_t nic,
-                                NICDriver *driver)
-        : ServiceSession(s, id, func), _in(), _out(), _cons(), _prod(), _gt(),
-          _nic(nic), _driver(driver) {
+                                NICDriver *driver, VSwitch *vswitch)
+        : ServiceSession(s, id, func), _in(), _out(), _cons(), _prod(), _prodsm(), _gt(),
+          _nic(nic), _driver(driver), _switch(vswitch), _counters() {
     }
     virtual ~NetworkSessionData() {
         delete _prod;
@@ -52,6 +54,10 @@ public:
     virtual void invalidate() {
         if(_cons)
             _cons->stop();
+        _switch->detach(id());
+        LOG(NET, "Client " << id() << ": rx=" << _counters.rx_frames << " (" << _counters.rx_bytes
+            << "b), tx=" << _counters.tx_frames << " (" << _counters.tx_bytes << "b), flooded="
+            << _counters.flooded << ", dropped=" << _counters.dropped << "\n");
     }
 
     size_t nic() const {
@@ -60,8 +66,19 @@ public:
     NICDriver *driver() {
         return _driver;
     }
+    VSwitch::Counters &counters() {
+        return _counters;
+    }
+    /**
+     * Puts the given packet into the receive ring of this session. This can be called by
+     * multiple threads in parallel.
+     *
+     * @return true if successful
+     */
     bool enqueue(const void *packet, size_t len) {
-        return _prod->produce(packet, len);
+        nre::ScopedLock<nre::UserSm> guard(&_prodsm);
+        // the client might not have initialized the session yet
+        return _prod && _prod->produce(packet, len);
     }
 
     void init(nre::DataSpace *inds, nre::Sm *insm, nre::DataSpace *outds, nre::Sm *outsm);
@@ -73,22 +90,36 @@ private:
     Channel _out;
     nre::PacketConsumer *_cons;
     nre::PacketProducer *_prod;
+    nre::UserSm _prodsm;
     nre::Reference<nre::GlobalThread> _gt;
     size_t _nic;
     NICDriver *_driver;
+    VSwitch *_switch;
+    VSwitch::Counters _counters;
 };
 
 class NetworkService : public nre::Service {
 public:
     explicit NetworkService(NICList &nics, const char *name);
 
-    void broadcast(const void *packet, size_t len);
+    /**
+     * Passes the given packet, which has been received by <driver>, to the virtual switch of
+     * that NIC.
+     *
+     * @param driver the NIC driver
+     * @param packet the packet
+     * @param len the length of the packet
+     */
+    void receive(NICDriver *driver, const void *packet, size_t len);
 
 private:
+    VSwitch *vswitch(size_t nic);
     virtual nre::ServiceSession *create_session(size_t id, const nre::String &args, portal_func func);
 
     PORTAL static void portal(NetworkSessionData *sess);
 
 private:
     NICList &_nics;
+    nre::UserSm _sm;
+    VSwitch *_switches[nre::Network::MAX_NICS];
 };
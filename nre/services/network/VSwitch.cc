@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/ScopedLock.h>
+#include <Logging.h>
+
+#include "VSwitch.h"
+#include "NetworkService.h"
+
+using namespace nre;
+
+size_t VSwitch::lookup(uint64_t mac) const {
+    for(size_t i = hash(mac), n = 0; n < MAX_MACS; i = (i + 1) & (MAX_MACS - 1), ++n) {
+        if(_macs[i].mac == mac)
+            return _macs[i].port;
+        if(_macs[i].mac == 0)
+            break;
+    }
+    return UNKNOWN;
+}
+
+void VSwitch::learn(uint64_t mac, size_t port) {
+    size_t i = hash(mac);
+    for(size_t n = 0; n < MAX_MACS; i = (i + 1) & (MAX_MACS - 1), ++n) {
+        if(_macs[i].mac == mac) {
+            // the station might have moved to a different port
+            _macs[i].port = port;
+            return;
+        }
+        if(_macs[i].mac == 0)
+            break;
+    }
+    // keep some free slots to keep the probe sequences short. if the table is full, the frames
+    // for the unknown MACs are simply flooded
+    if(_learned < MAX_MACS * 3 / 4) {
+        _macs[i].mac = mac;
+        _macs[i].port = port;
+        _learned++;
+    }
+}
+
+void VSwitch::remove(size_t i) {
+    // we use linear probing. thus, move the following entries of the cluster into the gap, if
+    // they would be found there as well (i.e. if their home slot is not in (i, j])
+    size_t j = i;
+    while(true) {
+        _macs[i].mac = 0;
+        while(true) {
+            j = (j + 1) & (MAX_MACS - 1);
+            if(_macs[j].mac == 0)
+                return;
+            size_t k = hash(_macs[j].mac);
+            if(i <= j ? (k <= i || k > j) : (k <= i && k > j))
+                break;
+        }
+        _macs[i] = _macs[j];
+        i = j;
+    }
+}
+
+void VSwitch::detach(size_t port) {
+    ScopedLock<UserSm> guard(&_sm);
+    for(size_t i = 0; i < MAX_MACS; ) {
+        if(_macs[i].mac != 0 && _macs[i].port == port) {
+            // another entry might have been moved to slot i
+            remove(i);
+            _learned--;
+        }
+        else
+            i++;
+    }
+}
+
+void VSwitch::forward(NetworkSessionData *src, const void *packet, size_t len) {
+    size_t srcport = src ? src->id() : UPLINK;
+    Counters &cnt = src ? src->counters() : _uplink;
+    cnt.received(len);
+    if(len < sizeof(Network::EthernetHeader)) {
+        Atomic::add(&cnt.dropped, 1);
+        return;
+    }
+
+    const Network::EthernetHeader *hdr = reinterpret_cast<const Network::EthernetHeader*>(packet);
+    size_t dst = UNKNOWN;
+    {
+        ScopedLock<UserSm> guard(&_sm);
+        // multicast addresses are not valid as source
+        if(!(hdr->mac_src[0] & 1))
+            learn(mac_of(hdr->mac_src), srcport);
+        if(!(hdr->mac_dst[0] & 1))
+            dst = lookup(mac_of(hdr->mac_dst));
+    }
+
+    // the destination is behind the port the frame came from; nothing to do
+    if(dst == srcport)
+        return;
+    if(dst == UPLINK) {
+        send(packet, len);
+        return;
+    }
+    if(dst != UNKNOWN) {
+        ScopedLock<RCULock> guard(&RCU::lock());
+        NetworkSessionData *sess = static_cast<NetworkSessionData*>(_srv.sessions()->find(dst));
+        if(sess && sess->nic() == _nic) {
+            deliver(sess, packet, len);
+            return;
+        }
+        // the session is gone, so that we don't know where it is anymore
+    }
+    Atomic::add(&cnt.flooded, 1);
+    flood(srcport, packet, len);
+}
+
+void VSwitch::deliver(NetworkSessionData *sess, const void *packet, size_t len) {
+    if(sess->enqueue(packet, len))
+        sess->counters().sent(len);
+    else {
+        Atomic::add(&sess->counters().dropped, 1);
+        LOG(NET, "Client " << sess->id() << " lost packet of length " << len << "\n");
+    }
+}
+
+void VSwitch::send(const void *packet, size_t len) {
+    if(_driver->send(packet, len))
+        _uplink.sent(len);
+    else
+        Atomic::add(&_uplink.dropped, 1);
+}
+
+void VSwitch::flood(size_t src, const void *packet, size_t len) {
+    {
+        ScopedLock<RCULock> guard(&RCU::lock());
+        const ServiceSessionTable *table = _srv.sessions();
+        for(auto it = table->begin(); it != table->end(); ++it) {
+            NetworkSessionData *sess = static_cast<NetworkSessionData*>(&*it);
+            if(sess->id() != src && sess->nic() == _nic)
+                deliver(sess, packet, len);
+        }
+    }
+    if(src != UPLINK)
+        send(packet, len);
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <kobj/UserSm.h>
+#include <util/Atomic.h>
+
+class NICDriver;
+class NetworkService;
+class NetworkSessionData;
+
+/**
+ * A learning layer-2 switch that connects all sessions of one NIC with each other and with the NIC
+ * itself. Every session is a port and the NIC is the uplink port. The switch learns the source
+ * MAC address of every frame and forwards unicast frames to a known destination only to that
+ * port. Thus, frames between local sessions (e.g. VMs) never touch the NIC. Broadcast, multicast
+ * and unknown destinations are flooded to all other ports.
+ */
+class VSwitch {
+    struct Entry {
+        uint64_t mac;
+        size_t port;
+    };
+
+    // the result of lookup() for unknown MAC addresses
+    static const size_t UNKNOWN     = static_cast<size_t>(-2);
+
+public:
+    /**
+     * The port id of the NIC. All other ports are identified by the session id.
+     */
+    static const size_t UPLINK      = static_cast<size_t>(-1);
+    /**
+     * The number of MAC addresses we can learn (has to be a power of 2)
+     */
+    static const size_t MAX_MACS    = 256;
+
+    /**
+     * The counters of a port. rx refers to the frames the port sent into the switch and tx to
+     * the frames the switch delivered to the port.
+     */
+    struct Counters {
+        explicit Counters() : rx_frames(), rx_bytes(), tx_frames(), tx_bytes(), flooded(),
+                              dropped() {
+        }
+
+        void received(size_t len) {
+            nre::Atomic::add(&rx_frames, 1);
+            nre::Atomic::add(&rx_bytes, len);
+        }
+        void sent(size_t len) {
+            nre::Atomic::add(&tx_frames, 1);
+            nre::Atomic::add(&tx_bytes, len);
+        }
+
+        uint64_t rx_frames;
+        uint64_t rx_bytes;
+        uint64_t tx_frames;
+        uint64_t tx_bytes;
+        // the number of received frames that had to be flooded
+        uint64_t flooded;
+        // the number of frames that could not be delivered to this port
+        uint64_t dropped;
+    };
+
+    /**
+     * Creates a switch for the NIC with given id
+     *
+     * @param srv the network service
+     * @param nic the NIC id
+     * @param driver the NIC driver
+     */
+    explicit VSwitch(NetworkService &srv, size_t nic, NICDriver *driver)
+        : _srv(srv), _nic(nic), _driver(driver), _sm(), _macs(), _learned(), _uplink() {
+    }
+
+    /**
+     * @return the counters of the uplink port
+     */
+    const Counters &uplink() const {
+        return _uplink;
+    }
+
+    /**
+     * Forwards the given frame that has been received from session <src> or the NIC.
+     *
+     * @param src the session or nullptr for the NIC
+     * @param packet the frame
+     * @param len the length of the frame
+     */
+    void forward(NetworkSessionData *src, const void *packet, size_t len);
+
+    /**
+     * Forgets all MAC addresses that have been learned on given port. Should be called when the
+     * session is destroyed.
+     *
+     * @param port the port
+     */
+    void detach(size_t port);
+
+private:
+    static uint64_t mac_of(const uint8_t *bytes) {
+        uint64_t mac = 0;
+        for(size_t i = 0; i < 6; ++i)
+            mac |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+        return mac;
+    }
+    static size_t hash(uint64_t mac) {
+        return ((mac * 0x9E3779B97F4A7C15ULL) >> 32) & (MAX_MACS - 1);
+    }
+
+    size_t lookup(uint64_t mac) const;
+    void learn(uint64_t mac, size_t port);
+    void remove(size_t i);
+    void deliver(NetworkSessionData *sess, const void *packet, size_t len);
+    void send(const void *packet, size_t len);
+    void flood(size_t src, const void *packet, size_t len);
+
+    NetworkService &_srv;
+    size_t _nic;
+    NICDriver *_driver;
+    nre::UserSm _sm;
+    Entry _macs[MAX_MACS];
+    size_t _learned;
+    Counters _uplink;
+};
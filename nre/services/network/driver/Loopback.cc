@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <Logging.h>
+#include <cstring>
+
+#include "Loopback.h"
+
+using namespace nre;
+
+void Loopback::create(NetworkService &srv, NICList &list, Mode mode) {
+    Loopback *nic = new Loopback(srv, mode);
+    size_t id = list.reg(nic);
+    // use a locally administered address
+    nic->_mac = Network::EthernetAddr(0x02, 0x00, 0x00, 0x00, 0x00, id + 1);
+    LOG(NET, "Created " << nic->name() << " NIC with id=" << id << ", MAC=" << nic->_mac << "\n");
+}
+
+bool Loopback::send(const void *packet, size_t size) {
+    if(_mode == DISCARD)
+        return true;
+    if(size < sizeof(Network::EthernetHeader) || size > MAX_FRAME_SIZE)
+        return false;
+
+    // send it back to where it came from
+    uint8_t frame[MAX_FRAME_SIZE];
+    memcpy(frame, packet, size);
+    Network::EthernetHeader *hdr = reinterpret_cast<Network::EthernetHeader*>(frame);
+    uint8_t tmp[sizeof(hdr->mac_dst)];
+    memcpy(tmp, hdr->mac_dst, sizeof(tmp));
+    memcpy(hdr->mac_dst, hdr->mac_src, sizeof(tmp));
+    memcpy(hdr->mac_src, tmp, sizeof(tmp));
+    _srv.receive(this, frame, size);
+    return true;
+}
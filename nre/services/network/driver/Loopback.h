@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <services/Network.h>
+
+#include "../NICDriver.h"
+#include "../NetworkService.h"
+
+/**
+ * A software NIC without hardware behind it, intended to measure the overhead of the network
+ * service itself. In REFLECT mode, it sends every frame back with swapped source and destination
+ * MAC, so that it arrives at the session that sent it. In DISCARD mode, it drops all frames.
+ */
+class Loopback : public NICDriver {
+public:
+    enum Mode {
+        REFLECT,
+        DISCARD,
+    };
+
+    static const size_t MAX_FRAME_SIZE  = 1518;
+
+    /**
+     * Creates a new software NIC and registers it at <list>
+     *
+     * @param srv the network service
+     * @param list the NIC list
+     * @param mode the mode
+     */
+    static void create(NetworkService &srv, NICList &list, Mode mode);
+
+    explicit Loopback(NetworkService &srv, Mode mode)
+        : NICDriver(), _srv(srv), _mode(mode), _mac() {
+    }
+
+    virtual const char *name() const {
+        return _mode == REFLECT ? "loopback" : "null";
+    }
+    virtual nre::Network::EthernetAddr get_mac() {
+        return _mac;
+    }
+    virtual bool send(const void *packet, size_t size);
+
+private:
+    NetworkService &_srv;
+    Mode _mode;
+    nre::Network::EthernetAddr _mac;
+};
@@ -165,7 +165,7 @@ void NE2K::handle_irq() {
                 packet_len = _receive_buffer[offset + 2] + (_receive_buffer[offset + 3] << 8);
                 assert(packet_len + offset < BUFFER_SIZE);
 
-                _srv.broadcast(_receive_buffer + offset + 4, packet_len - 4);
+                _srv.receive(this, _receive_buffer + offset + 4, packet_len - 4);
             }
         }
     }
@@ -14,16 +14,32 @@
  * General Public License version 2 for more details.
  */
 
+#include <cstring>
+
 #include "driver/NE2K.h"
+#include "driver/Loopback.h"
 #include "NetworkService.h"
 #include "NICList.h"
 
 using namespace nre;
 
-int main() {
+int main(int argc, char *argv[]) {
     NICList nics;
     NetworkService srv(nics, "network");
-    NE2K::detect(srv, nics);
+    // a software NIC replaces the real ones to measure the overhead of the network service
+    bool soft = false;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "loopback") == 0) {
+            Loopback::create(srv, nics, Loopback::REFLECT);
+            soft = true;
+        }
+        else if(strcmp(argv[i], "nullnic") == 0) {
+            Loopback::create(srv, nics, Loopback::DISCARD);
+            soft = true;
+        }
+    }
+    if(!soft)
+        NE2K::detect(srv, nics);
     srv.start();
     return 0;
 }
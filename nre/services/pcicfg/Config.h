@@ -33,4 +33,13 @@ public:
     virtual uintptr_t addr(nre::BDF bdf, size_t offset) = 0;
     virtual value_type read(nre::BDF bdf, size_t offset) = 0;
     virtual void write(nre::BDF bdf, size_t offset, value_type value) = 0;
+
+    /**
+     * Reads <count> dwords, beginning at offset 0, from the config space of <bdf> into <values>.
+     * Subclasses may override it to do that more efficiently than dword by dword.
+     */
+    virtual void read_all(nre::BDF bdf, value_type *values, size_t count) {
+        for(size_t i = 0; i < count; ++i)
+            values[i] = read(bdf, i * sizeof(value_type));
+    }
 };
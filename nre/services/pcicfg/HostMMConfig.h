@@ -68,6 +68,11 @@ class HostMMConfig : public Config {
         void write(nre::BDF bdf, size_t offset, value_type value) {
             _mmconfig[field(bdf, offset)] = value;
         }
+        void read_all(nre::BDF bdf, value_type *values, size_t count) const {
+            const volatile value_type *src = _mmconfig + field(bdf, 0);
+            for(size_t i = 0; i < count; ++i)
+                values[i] = src[i];
+        }
 
     private:
         size_t field(nre::BDF bdf, size_t offset) const {
@@ -106,6 +111,10 @@ public:
         MMConfigRange *range = find(bdf, offset);
         range->write(bdf, offset, value);
     }
+    virtual void read_all(nre::BDF bdf, value_type *values, size_t count) {
+        MMConfigRange *range = find(bdf, (count - 1) * sizeof(value_type));
+        range->read_all(bdf, values, count);
+    }
 
 private:
     MMConfigRange *find(nre::BDF bdf, size_t offset) {
@@ -50,15 +50,20 @@ public:
         select(bdf, offset);
         _data.out<uint32_t>(value);
     }
+    virtual void read_all(nre::BDF bdf, value_type *values, size_t count) {
+        // acquire the lock only once for all dwords
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        for(size_t i = 0; i < count; ++i) {
+            select(bdf, i * sizeof(value_type));
+            values[i] = _data.in<uint32_t>();
+        }
+    }
     void reset() {
         _addr.out<uint8_t>((_addr.in<uint8_t>(1) & ~4) | 0x02, 1);
         _addr.out<uint8_t>(0x06, 1);
         _addr.out<uint8_t>(0x01, 1);
     }
 
-    nre::BDF search_device(value_type theclass = ~0U, value_type subclass = ~0U, uint inst = ~0U);
-    nre::BDF search_bridge(value_type dst);
-
 private:
     void select(nre::BDF bdf, size_t offset) {
         uint32_t addr = 0x80000000 | (bdf.value() << 8) | (offset & 0xFC);
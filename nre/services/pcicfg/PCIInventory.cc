@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Copyright (C) 2009, Bernhard Kauer <bk@vmmon.org>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/ScopedLock.h>
+#include <Logging.h>
+
+#include "PCIInventory.h"
+
+using namespace nre;
+
+PCIInventory::PCIInventory(Config *cfg)
+    : _devs(), _classes(), _vendors(), _bridges(), _sm() {
+    // the last element of every chain, so that the chains are in the order of enumeration
+    Device *class_tails[ARRAY_SIZE(_classes)] = {nullptr};
+    Device *vendor_tails[VENDOR_BUCKETS] = {nullptr};
+    Device *bridge_tail = nullptr;
+
+    for(BDF::bdf_type bus = 0; bus < 256; bus++) {
+        for(BDF::bdf_type dev = 0; dev < 32; dev++) {
+            BDF::bdf_type maxfunc = 1;
+            for(BDF::bdf_type func = 0; func < maxfunc; func++) {
+                BDF bdf(bus, dev, func);
+                value_type id = cfg->read(bdf, 0 * 4);
+                if(id == ~0U)
+                    continue;
+                value_type header = cfg->read(bdf, 3 * 4) >> 16;
+                if(maxfunc == 1 && (header & 0x80))
+                    maxfunc = 8;
+
+                Device *d = new Device(bdf, id, cfg->read(bdf, 2 * 4), header);
+                if(d->is_bridge())
+                    d->_buses = cfg->read(bdf, 6 * 4);
+                _devs.insert(d);
+
+                Device **tail = class_tails + d->theclass();
+                if(*tail)
+                    (*tail)->_next_class = d;
+                else
+                    _classes[d->theclass()] = d;
+                *tail = d;
+
+                tail = vendor_tails + vendor_bucket(d->vendor());
+                if(*tail)
+                    (*tail)->_next_vendor = d;
+                else
+                    _vendors[vendor_bucket(d->vendor())] = d;
+                *tail = d;
+
+                if(d->is_bridge()) {
+                    if(bridge_tail)
+                        bridge_tail->_next_bridge = d;
+                    else
+                        _bridges = d;
+                    bridge_tail = d;
+                }
+
+                LOG(PCICFG, "Found " << bdf << " " << fmt(d->vendor(), "#0x", 4)
+                                     << ":" << fmt(d->device(), "#0x", 4)
+                                     << " class " << fmt(d->theclass(), "#0x", 2)
+                                     << ":" << fmt(d->subclass(), "#0x", 2) << "\n");
+            }
+        }
+    }
+}
+
+BDF PCIInventory::search_device(value_type theclass, value_type subclass, uint inst) const {
+    uint orginst = inst;
+    if(theclass == ~0U) {
+        for(auto it = _devs.cbegin(); it != _devs.cend(); ++it) {
+            if((subclass == ~0U || it->subclass() == subclass) && (inst == ~0U || !inst--))
+                return it->bdf();
+        }
+    }
+    else if(theclass < ARRAY_SIZE(_classes)) {
+        for(Device *d = _classes[theclass]; d != nullptr; d = d->_next_class) {
+            if((subclass == ~0U || d->subclass() == subclass) && (inst == ~0U || !inst--))
+                return d->bdf();
+        }
+    }
+    VTHROW(Exception, E_NOT_FOUND,
+           "Unable to find class " << fmt(theclass, "#x") << " subclass "
+                                   << fmt(subclass, "#x") << " inst "
+                                   << fmt(orginst, "#x"));
+}
+
+BDF PCIInventory::search_id(value_type vendor, value_type device, uint inst) const {
+    uint orginst = inst;
+    for(Device *d = _vendors[vendor_bucket(vendor)]; d != nullptr; d = d->_next_vendor) {
+        if(d->vendor() == vendor && (device == ~0U || d->device() == device)
+           && (inst == ~0U || !inst--))
+            return d->bdf();
+    }
+    VTHROW(Exception, E_NOT_FOUND,
+           "Unable to find device " << fmt(vendor, "#0x", 4) << ":" << fmt(device, "#x")
+                                    << " inst " << fmt(orginst, "#x"));
+}
+
+BDF PCIInventory::search_bridge(value_type dst) const {
+    value_type dstbus = dst >> 8;
+    for(Device *d = _bridges; d != nullptr; d = d->_next_bridge) {
+        if(d->bdf().bus() == 0 && d->bridges(dstbus))
+            return d->bdf();
+    }
+    VTHROW(Exception, E_NOT_FOUND, "Unable to find bridge " << fmt(dst, "#x"));
+}
+
+const DataSpace &PCIInventory::config_ds(BDF bdf, uintptr_t phys) {
+    ScopedLock<UserSm> guard(&_sm);
+    Device *d = find(bdf);
+    if(!d)
+        VTHROW(Exception, E_NOT_FOUND, "Device " << bdf << " does not exist");
+    if(!d->_ds)
+        d->_ds = new DataSpace(ExecEnv::PAGE_SIZE, DataSpaceDesc::LOCKED, DataSpaceDesc::R, phys);
+    return *d->_ds;
+}
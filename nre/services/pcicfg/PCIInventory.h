@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <collection/SListTreap.h>
+#include <mem/DataSpace.h>
+#include <kobj/UserSm.h>
+#include <util/BDF.h>
+
+#include "Config.h"
+
+/**
+ * The inventory of all PCI devices. The PCI hierarchy is enumerated once at startup and all
+ * searches are answered from the inventory afterwards. Thus, we don't need to walk through all
+ * buses, devices and functions via port I/O for every request.
+ */
+class PCIInventory {
+    static const size_t VENDOR_BUCKETS  = 64;
+
+public:
+    typedef nre::PCIConfig::value_type value_type;
+
+    /**
+     * A PCI device (or function, to be precise)
+     */
+    class Device : public nre::SListTreapNode<nre::BDF::bdf_type> {
+        friend class PCIInventory;
+
+    public:
+        explicit Device(nre::BDF bdf, value_type id, value_type classrev, value_type header)
+            : nre::SListTreapNode<nre::BDF::bdf_type>(bdf.value()), _id(id), _classrev(classrev),
+              _header(header), _buses(), _next_class(), _next_vendor(), _next_bridge(), _ds() {
+        }
+        ~Device() {
+            delete _ds;
+        }
+
+        nre::BDF bdf() const {
+            return nre::BDF(key());
+        }
+        value_type vendor() const {
+            return _id & 0xFFFF;
+        }
+        value_type device() const {
+            return _id >> 16;
+        }
+        value_type theclass() const {
+            return (_classrev >> 24) & 0xFF;
+        }
+        value_type subclass() const {
+            return (_classrev >> 16) & 0xFF;
+        }
+        bool is_bridge() const {
+            return (_header & 0x7F) == 1;
+        }
+        /**
+         * @param bus the bus number
+         * @return true if this is a bridge and <bus> is behind it
+         */
+        bool bridges(value_type bus) const {
+            return is_bridge() && ((_buses >> 8) & 0xFF) <= bus && ((_buses >> 16) & 0xFF) >= bus;
+        }
+
+    private:
+        value_type _id;
+        value_type _classrev;
+        value_type _header;
+        value_type _buses;
+        Device *_next_class;
+        Device *_next_vendor;
+        Device *_next_bridge;
+        nre::DataSpace *_ds;
+    };
+
+    /**
+     * Enumerates the PCI hierarchy via <cfg>.
+     *
+     * @param cfg the config space to use for the enumeration
+     */
+    explicit PCIInventory(Config *cfg);
+
+    /**
+     * @return the number of devices
+     */
+    size_t count() const {
+        return _devs.length();
+    }
+    /**
+     * @param bdf the bus-device-function triple
+     * @return the device with given BDF or nullptr if it doesn't exist
+     */
+    Device *find(nre::BDF bdf) const {
+        return _devs.find(bdf.value());
+    }
+
+    /**
+     * Searches for the <inst>'th device that has the given class and/or subclass.
+     *
+     * @param theclass the class of the device (~0U = ignore)
+     * @param subclass the subclass of the device (~0U = ignore)
+     * @param inst the instance of the device (~0U = ignore)
+     * @return the bus-device-function triple
+     * @throws Exception if not found
+     */
+    nre::BDF search_device(value_type theclass, value_type subclass, uint inst) const;
+    /**
+     * Searches for the <inst>'th device that has the given vendor- and device-id.
+     *
+     * @param vendor the vendor-id
+     * @param device the device-id (~0U = ignore)
+     * @param inst the instance of the device (~0U = ignore)
+     * @return the bus-device-function triple
+     * @throws Exception if not found
+     */
+    nre::BDF search_id(value_type vendor, value_type device, uint inst) const;
+    /**
+     * Searches for the bridge on bus 0 that is responsible for the bus of <dst>.
+     *
+     * @param dst the bus-device-function triple
+     * @return the bus-device-function triple of the bridge
+     * @throws Exception if not found
+     */
+    nre::BDF search_bridge(value_type dst) const;
+
+    /**
+     * Determines the dataspace that contains the MMCONFIG page of the given device. It is created
+     * on the first request and kept afterwards.
+     *
+     * @param bdf the bus-device-function triple
+     * @param phys the physical address of the MMCONFIG page
+     * @return the dataspace (read-only)
+     * @throws Exception if the device doesn't exist
+     */
+    const nre::DataSpace &config_ds(nre::BDF bdf, uintptr_t phys);
+
+private:
+    static size_t vendor_bucket(value_type vendor) {
+        return vendor % VENDOR_BUCKETS;
+    }
+
+    PCIInventory(const PCIInventory&);
+    PCIInventory& operator=(const PCIInventory&);
+
+    nre::SListTreap<Device> _devs;
+    Device *_classes[256];
+    Device *_vendors[VENDOR_BUCKETS];
+    Device *_bridges;
+    nre::UserSm _sm;
+};
@@ -20,11 +20,13 @@
 
 #include "HostPCIConfig.h"
 #include "HostMMConfig.h"
+#include "PCIInventory.h"
 
 using namespace nre;
 
 static HostPCIConfig *pcicfg;
 static HostMMConfig *mmcfg;
+static PCIInventory *inventory;
 
 static Config *find(BDF bdf, size_t offset) {
     if(pcicfg->contains(bdf, offset))
@@ -82,7 +84,7 @@ PORTAL static void portal_pcicfg(void*) {
                 PCIConfig::value_type theclass, subclass, inst;
                 uf >> theclass >> subclass >> inst;
                 uf.finish_input();
-                BDF bdf = pcicfg->search_device(theclass, subclass, inst);
+                BDF bdf = inventory->search_device(theclass, subclass, inst);
                 LOG(PCICFG, "PCIConfig::SEARCH_DEVICE" << " class=" << fmt(theclass, "#x")
                                                        << " subclass=" << fmt(subclass, "#x")
                                                        << " inst=" << fmt(inst, "#x")
@@ -95,13 +97,51 @@ PORTAL static void portal_pcicfg(void*) {
                 PCIConfig::value_type bridge;
                 uf >> bridge;
                 uf.finish_input();
-                BDF bdf = pcicfg->search_bridge(bridge);
+                BDF bdf = inventory->search_bridge(bridge);
                 LOG(PCICFG, "PCIConfig::SEARCH_BRIDGE bridge=" << fmt(bridge, "#x")
                                                                << " => " << bdf << "\n");
                 uf << E_SUCCESS << bdf;
             }
             break;
 
+            case PCIConfig::SEARCH_ID: {
+                PCIConfig::value_type vendor, device, inst;
+                uf >> vendor >> device >> inst;
+                uf.finish_input();
+                BDF bdf = inventory->search_id(vendor, device, inst);
+                LOG(PCICFG, "PCIConfig::SEARCH_ID" << " vendor=" << fmt(vendor, "#x")
+                                                   << " device=" << fmt(device, "#x")
+                                                   << " inst=" << fmt(inst, "#x")
+                                                   << " => " << bdf << "\n");
+                uf << E_SUCCESS << bdf;
+            }
+            break;
+
+            case PCIConfig::READ_ALL: {
+                uf >> bdf;
+                uf.finish_input();
+                if(!inventory->find(bdf))
+                    VTHROW(Exception, E_NOT_FOUND, "Device " << bdf << " does not exist");
+                PCIConfig::Space space;
+                cfg = find(bdf, 0);
+                cfg->read_all(bdf, space.dwords, ARRAY_SIZE(space.dwords));
+                LOG(PCICFG, cfg->name() << "::READ_ALL " << bdf << "\n");
+                uf << E_SUCCESS << space;
+            }
+            break;
+
+            case PCIConfig::MAP_CONFIG: {
+                uf >> bdf;
+                uf.finish_input();
+                if(!mmcfg || !mmcfg->contains(bdf, PCIConfig::EXT_SPACE_SIZE - 1))
+                    VTHROW(Exception, E_NOT_FOUND, "No MMConfig for " << bdf);
+                const DataSpace &ds = inventory->config_ds(bdf, mmcfg->addr(bdf, 0));
+                LOG(PCICFG, "MMConfig::MAP_CONFIG " << bdf << ": " << ds << "\n");
+                uf.delegate(ds.sel());
+                uf << E_SUCCESS;
+            }
+            break;
+
             case PCIConfig::REBOOT: {
                 uf.finish_input();
                 pcicfg->reset();
@@ -124,6 +164,7 @@ int main() {
     catch(const Exception &e) {
         Serial::get() << e.name() << ": " << e.msg() << "\n";
     }
+    inventory = new PCIInventory(pcicfg);
 
     Service *srv = new Service("pcicfg", CPUSet(CPUSet::ALL), portal_pcicfg);
     srv->start();
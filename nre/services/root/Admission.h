@@ -17,6 +17,7 @@
 #pragma once
 
 #include <kobj/UserSm.h>
+#include <services/SysInfo.h>
 #include <cap/CapRange.h>
 #include <collection/SList.h>
 #include <util/ScopedLock.h>
@@ -124,6 +125,31 @@ public:
         return false;
     }
 
+    /**
+     * Starts a new period for all SchedEntities and stores their properties in <snap>. That is,
+     * in contrast to total_time() and get_sched_entity(), it walks the list only once.
+     *
+     * @param snap the snapshot to fill (scs, sc_count and cputime)
+     */
+    static void snapshot(nre::SysInfo::Snapshot &snap) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        size_t i = 0;
+        memset(snap.cputime, 0, sizeof(snap.cputime));
+        for(auto s = _list.begin(); s != _list.end(); ++s) {
+            timevalue_t time = s->ms_last_sec(true);
+            snap.cputime[s->cpu()] += time;
+            if(i < nre::SysInfo::Snapshot::MAX_SCS) {
+                nre::SysInfo::Snapshot::Sc &sc = snap.scs[i++];
+                nre::SysInfo::Snapshot::copy_str(sc.name, s->name().str(), s->name().length(),
+                                                 sizeof(sc.name));
+                sc.cpu = s->cpu();
+                sc.time = time;
+                sc.totaltime = s->totaltime();
+            }
+        }
+        snap.sc_count = i;
+    }
+
     /**
      * End-of-recursion service portal
      */
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <kobj/GlobalThread.h>
+#include <collection/Cycler.h>
+#include <stream/Serial.h>
+#include <util/Bytes.h>
+#include <util/Sync.h>
+#include <util/Util.h>
+#include <Logging.h>
+#include <CPU.h>
+
+#include "Boot.h"
+#include "Hypervisor.h"
+#include "Modules.h"
+#include "VirtualMemory.h"
+
+using namespace nre;
+
+ChildManager *Boot::_mng;
+Boot::Module *Boot::_mods;
+size_t Boot::_count;
+timevalue_t Boot::_begin;
+timevalue_t Boot::_end;
+volatile bool Boot::_booting;
+Sm *Boot::_loaded;
+
+void Boot::start(ChildManager *mng) {
+    _mng = mng;
+    _begin = Util::tsc();
+    _loaded = new Sm(0);
+    collect();
+    build_deps();
+
+    // notice childs that die before they have registered their services
+    _booting = true;
+    Reference<GlobalThread> watch = GlobalThread::create(
+        death_thread, CPU::current().log_id(), "root-bootwatch");
+    watch->start();
+
+    size_t started = 0;
+    while(true) {
+        bool startable = false;
+        for(size_t i = 0; i < _count; ++i) {
+            Module &m = _mods[i];
+            if(m.state == WAITING && deps_present(m)) {
+                m.state = LOADING;
+                m.ready = Util::tsc();
+                Reference<GlobalThread> gt = GlobalThread::create(
+                    load_thread, m.cfg->cpu(), "root-boot");
+                gt->set_tls<Module*>(Thread::TLS_PARAM, &m);
+                gt->start();
+                started++;
+                startable = true;
+            }
+        }
+
+        fail_dead();
+        fail_dependents();
+
+        bool loading = false, waiting = false;
+        for(size_t i = 0; i < _count; ++i) {
+            loading |= _mods[i].state == LOADING;
+            waiting |= _mods[i].state == WAITING;
+        }
+        if(!startable && !loading && provides_present()) {
+            // if nothing is loading and all services are there, nothing else will be registered.
+            // thus, the modules that are still waiting can't be started anymore.
+            if(waiting)
+                fail_waiting();
+            break;
+        }
+        // wait until the next service has been registered or a module failed to load or died
+        if(!startable)
+            _mng->reg_sm().down();
+    }
+    _booting = false;
+    _mng->dead_sm().up();
+    watch->join();
+
+    for(size_t i = 0; i < started; ++i)
+        _loaded->down();
+    _end = Util::tsc();
+    dump();
+}
+
+void Boot::collect() {
+    const Hip &hip = Hip::get();
+    size_t max = 0;
+    for(auto it = hip.mem_begin(); it != hip.mem_end(); ++it) {
+        if(it->type == HipMem::MB_MODULE)
+            max++;
+    }
+    _mods = new Module[max]();
+
+    size_t mod = 0, i = 0;
+    ForwardCycler<CPU::iterator> cpus(CPU::begin(), CPU::end());
+    for(auto it = hip.mem_begin(); it != hip.mem_end(); ++it, ++mod) {
+        // we are the first one :)
+        if(it->type == HipMem::MB_MODULE && i++ >= 1) {
+            Module &m = _mods[_count++];
+            m.mem = &*it;
+            m.cfg = new ChildConfig(mod, it->cmdline(), cpus.next()->log_id());
+            m.state = WAITING;
+            if(m.cfg->last())
+                break;
+        }
+    }
+
+    // the remaining modules are used by our childs, which might need them decompressed
+    i = 0;
+    for(auto it = hip.mem_begin(); it != hip.mem_end(); ++it) {
+        if(it->type != HipMem::MB_MODULE || i++ == 0)
+            continue;
+        bool booted = false;
+        for(size_t j = 0; !booted && j < _count; ++j)
+            booted = _mods[j].mem == &*it;
+        if(!booted)
+            Modules::add(const_cast<HipMem*>(&*it));
+    }
+}
+
+void Boot::build_deps() {
+    for(size_t i = 0; i < _count; ++i) {
+        Module &m = _mods[i];
+        const ChildConfig &cfg = *m.cfg;
+        if(cfg.has_requirements()) {
+            m.depcount = cfg.requirements();
+            m.deps = new const String*[m.depcount];
+            for(size_t j = 0; j < m.depcount; ++j)
+                m.deps[j] = &cfg.requirement(j);
+        }
+        else {
+            // depend on everything that is provided by the modules before us
+            for(size_t j = 0; j < i; ++j)
+                m.depcount += _mods[j].cfg->waits();
+            m.deps = new const String*[m.depcount];
+            for(size_t j = 0, d = 0; j < i; ++j) {
+                for(size_t k = 0; k < _mods[j].cfg->waits(); ++k)
+                    m.deps[d++] = &_mods[j].cfg->wait(k);
+            }
+        }
+    }
+}
+
+bool Boot::deps_present(const Module &m) {
+    for(size_t i = 0; i < m.depcount; ++i) {
+        if(!_mng->registry().find(*m.deps[i]))
+            return false;
+    }
+    return true;
+}
+
+bool Boot::provides_present(const Module &m) {
+    for(size_t i = 0; i < m.cfg->waits(); ++i) {
+        if(!_mng->registry().find(m.cfg->wait(i)))
+            return false;
+    }
+    return true;
+}
+
+bool Boot::provides_present() {
+    for(size_t i = 0; i < _count; ++i) {
+        const Module &m = _mods[i];
+        if(m.state != FAILED && !provides_present(m))
+            return false;
+    }
+    return true;
+}
+
+bool Boot::is_lost(const String &service) {
+    if(_mng->registry().find(service))
+        return false;
+    // it is lost if it is provided by modules, but all of them failed
+    bool provided = false;
+    for(size_t i = 0; i < _count; ++i) {
+        const Module &m = _mods[i];
+        for(size_t j = 0; j < m.cfg->waits(); ++j) {
+            if(m.cfg->wait(j) == service) {
+                if(m.state != FAILED)
+                    return false;
+                provided = true;
+            }
+        }
+    }
+    return provided;
+}
+
+void Boot::fail_dead() {
+    for(size_t i = 0; i < _count; ++i) {
+        Module &m = _mods[i];
+        if(m.state == RUNNING && !_mng->get(m.id).valid() && !provides_present(m)) {
+            Serial::get() << "Module '" << m.cfg->cmdline()
+                          << "' died without registering its services\n";
+            m.state = FAILED;
+        }
+    }
+}
+
+void Boot::fail_dependents() {
+    // repeat until nothing changes to fail the dependents of the dependents as well
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t i = 0; i < _count; ++i) {
+            Module &m = _mods[i];
+            for(size_t j = 0; m.state == WAITING && j < m.depcount; ++j) {
+                if(is_lost(*m.deps[j])) {
+                    Serial::get() << "Not starting '" << m.cfg->cmdline() << "': service '"
+                                  << *m.deps[j] << "' will not be provided\n";
+                    m.state = FAILED;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+void Boot::fail_waiting() {
+    for(size_t i = 0; i < _count; ++i) {
+        Module &m = _mods[i];
+        if(m.state != WAITING)
+            continue;
+        Serial::get() << "Not starting '" << m.cfg->cmdline() << "': missing services";
+        for(size_t j = 0; j < m.depcount; ++j) {
+            if(!_mng->registry().find(*m.deps[j]))
+                Serial::get() << " '" << *m.deps[j] << "'";
+        }
+        Serial::get() << "\n";
+        m.state = FAILED;
+    }
+}
+
+void Boot::load_thread(void*) {
+    Module *m = Thread::current()->get_tls<Module*>(Thread::TLS_PARAM);
+    try {
+        // map the memory of the module
+        uintptr_t virt = VirtualMemory::alloc(m->mem->size,
+                                              Hypervisor::map_align(m->mem->addr, m->mem->size));
+        Hypervisor::map_mem(m->mem->addr, virt, m->mem->size);
+
+        m->id = _mng->start(virt, m->mem->size, *m->cfg);
+        // make sure that the id is written before the state
+        Sync::memory_barrier();
+        m->state = RUNNING;
+    }
+    catch(const Exception &e) {
+        Serial::get() << "Unable to start '" << m->cfg->cmdline() << "': " << e << "\n";
+        m->state = FAILED;
+    }
+    m->loaded = Util::tsc();
+    _loaded->up();
+    // let Boot::start() reconsider the modules. this is necessary in both cases, because a module
+    // that provides no service will not wake it up by registering one
+    _mng->reg_sm().up();
+}
+
+void Boot::death_thread(void*) {
+    while(_booting) {
+        _mng->dead_sm().down();
+        // let Boot::start() check whether a module died before registering its services
+        _mng->reg_sm().up();
+    }
+}
+
+static timevalue_t to_us(timevalue_t begin, timevalue_t tsc) {
+    if(tsc < begin)
+        return 0;
+    return (tsc - begin) * 1000 / Hip::get().freq_tsc;
+}
+
+void Boot::dump() {
+    LOG(BOOT, "Boot timeline (in us since " << fmt(_begin, "#x") << ", total "
+                                            << to_us(_begin, _end) << " us):\n");
+    LOG(BOOT, "\t" << fmt("Module", 24) << fmt("CPU", 4) << fmt("Ready", 10) << fmt("Load", 10)
+                   << fmt("Loaded", 10) << fmt("Start", 10) << fmt("Service", 10) << "\n");
+    for(size_t i = 0; i < _count; ++i) {
+        const Module &m = _mods[i];
+        Child::Timeline tl = Child::Timeline();
+        size_t size = 0;
+        if(m.state == RUNNING) {
+            Reference<const Child> c = _mng->get(m.id);
+            if(c.valid()) {
+                tl = c->timeline();
+                size = c->image_size();
+            }
+        }
+        LOG(BOOT, "\t" << fmt(m.cfg->cmdline().str(), 24, 23) << fmt(m.cfg->cpu(), 4)
+                       << fmt(to_us(_begin, m.ready), 10) << fmt(to_us(_begin, tl.load), 10)
+                       << fmt(to_us(_begin, m.loaded), 10) << fmt(to_us(_begin, tl.start), 10)
+                       << fmt(to_us(_begin, tl.ready), 10)
+                       << (m.state == FAILED ? " (failed)" : ""));
+        // for compressed modules, show how much less had to be loaded and what it cost
+        if(tl.inflated) {
+            LOG(BOOT, " (" << Bytes(m.mem->size) << " instead of " << Bytes(size) << ", saved "
+                           << Bytes(size > m.mem->size ? size - m.mem->size : 0) << ", inflated in "
+                           << to_us(tl.load, tl.inflated) << " us)");
+        }
+        LOG(BOOT, "\n");
+    }
+    const Hypervisor::MapStats &stats = Hypervisor::map_stats();
+    LOG(BOOT, "Mappings: " << stats.calls << " calls, " << stats.crds << " Crds, " << stats.pages
+                           << " pages in " << to_us(0, stats.time) << " us\n");
+}
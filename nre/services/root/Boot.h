@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <kobj/Sm.h>
+#include <subsystem/ChildManager.h>
+#include <subsystem/ChildConfig.h>
+#include <Hip.h>
+
+/**
+ * Starts the boot modules. Instead of loading one module after another, it builds a dependency
+ * graph from the module cmdlines and starts all modules whose dependencies are satisfied in
+ * parallel, each on its own CPU. The dependencies of a module are the services listed in
+ * "requires=a,b,...". Without "requires=", a module depends on all services that are provided
+ * by the modules before it, i.e. it is started as it would be by a sequential boot.
+ * Additionally, it records a timeline of the boot process, which is printed with the BOOT
+ * log level.
+ */
+class Boot {
+    enum State {
+        WAITING,
+        LOADING,
+        RUNNING,
+        FAILED,
+    };
+
+    struct Module {
+        const nre::HipMem *mem;
+        nre::ChildConfig *cfg;
+        // written by the load threads and polled by Boot::start()
+        volatile State state;
+        nre::Child::id_type id;
+        const nre::String **deps;
+        size_t depcount;
+        // the TSC when the dependencies have been satisfied and when the load finished
+        timevalue_t ready;
+        timevalue_t loaded;
+    };
+
+public:
+    /**
+     * Starts all boot modules (except the first one, which is root itself) and returns as soon
+     * as all of them are running and have registered the services they provide. Modules that
+     * require a service that will not be provided anymore, because its module failed to load or
+     * died, are not started.
+     *
+     * @param mng the child manager
+     */
+    static void start(nre::ChildManager *mng);
+
+    /**
+     * Prints the boot timeline with the BOOT log level. For each module, it contains the time
+     * when its dependencies were satisfied, when root started and finished to load it, when it
+     * executed its first instruction and when it registered its last service. 0 means that the
+     * step has not been reached. For compressed modules, it shows the size difference and the
+     * time it took to decompress them.
+     */
+    static void dump();
+
+private:
+    Boot();
+
+    static void collect();
+    static void build_deps();
+    static bool deps_present(const Module &m);
+    static bool provides_present(const Module &m);
+    static bool provides_present();
+    static bool is_lost(const nre::String &service);
+    static void fail_dead();
+    static void fail_dependents();
+    static void fail_waiting();
+    static void load_thread(void*);
+    static void death_thread(void*);
+
+    static nre::ChildManager *_mng;
+    static Module *_mods;
+    static size_t _count;
+    static timevalue_t _begin;
+    static timevalue_t _end;
+    static volatile bool _booting;
+    static nre::Sm *_loaded;
+};
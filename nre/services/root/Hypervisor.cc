@@ -18,6 +18,8 @@
 #include <kobj/Gsi.h>
 #include <kobj/Ports.h>
 #include <utcb/UtcbFrame.h>
+#include <util/Atomic.h>
+#include <util/Util.h>
 #include <Logging.h>
 
 #include "Hypervisor.h"
@@ -27,6 +29,7 @@ using namespace nre;
 
 uchar Hypervisor::_stack[ExecEnv::STACK_SIZE] ALIGNED(ARCH_STACK_SIZE);
 Pt *Hypervisor::_map_pts[Hip::MAX_CPUS];
+Hypervisor::MapStats Hypervisor::_map_stats;
 PortManager Hypervisor::_io INIT_PRIO_HV (PortManager::FREE);
 BitField<Hip::MAX_GSIS> Hypervisor::_gsis INIT_PRIO_HV;
 UserSm Hypervisor::_io_sm INIT_PRIO_HV;
@@ -54,43 +57,63 @@ void Hypervisor::init() {
     }
 }
 
-void Hypervisor::map_mem(uintptr_t phys, uintptr_t virt, size_t size) {
+void Hypervisor::map_mem(const MemRange *ranges, size_t count) {
+    // the number of typed items a CapRange occupies in the UTCB
+    const size_t CR_ITEMS = Math::blockcount(sizeof(CapRange), sizeof(word_t) * 2);
+
+    timevalue_t start = Util::tsc();
+    size_t calls = 0, crds = 0, pages = 0;
     UtcbFrame uf;
     uf.delegation_window(Crd(0, 31, Crd::MEM_ALL));
-    size_t pages = Math::blockcount<size_t>(size, ExecEnv::PAGE_SIZE);
-    CapRange cr(phys >> ExecEnv::PAGE_SHIFT, pages, Crd::MEM_ALL, virt >> ExecEnv::PAGE_SHIFT);
-    size_t count = pages;
-    while(count > 0) {
+
+    size_t next = 0;
+    CapRange cur;
+    while(1) {
+        CapRange batch[MAX_MAP_RANGES];
+        size_t n = 0;
+        // the request contains the number of ranges and the ranges; the reply the Crds. since both
+        // share the UTCB, we account for both
         uf.clear();
-        if(cr.hotspot() != CapRange::NO_HOTSPOT) {
-            // if start and hotspot are different, we have to check whether it fits in the utcb
-            uintptr_t diff = cr.hotspot() ^ cr.start();
-            if(diff) {
-                // the lowest bit that's different defines how many we can map with one Crd.
-                // with bit 0, its 2^0 = 1 at once, with bit 1, 2^1 = 2 and so on.
-                unsigned at_once = Math::bit_scan_forward(diff);
-                if((1UL << at_once) < count) {
-                    // be carefull that we might have to align it to 1 << at_once first. this takes
-                    // at most at_once typed items.
-                    size_t free = uf.free_typed();
-                    // we still have to put in the caprange
-                    free -= Math::blockcount(sizeof(CapRange), sizeof(word_t) * 2);
-                    size_t min = Math::min<uintptr_t>(free - at_once, count >> at_once);
-                    cr.count(min << at_once);
-                }
+        size_t items = uf.free_typed() - 1;
+        while(n < MAX_MAP_RANGES && items > CR_ITEMS) {
+            // go to the next range, if the current one is finished
+            while(cur.count() == 0 && next < count) {
+                cur = CapRange(ranges[next].phys >> ExecEnv::PAGE_SHIFT,
+                               Math::blockcount<size_t>(ranges[next].size, ExecEnv::PAGE_SIZE),
+                               Crd::MEM_ALL, ranges[next].virt >> ExecEnv::PAGE_SHIFT);
+                next++;
             }
+            if(cur.count() == 0)
+                break;
+
+            // put as many naturally aligned blocks into the UTCB as possible
+            CapRange cr = cur;
+            size_t covered;
+            size_t crs = cr.crd_count(items - CR_ITEMS, covered);
+            cr.count(covered);
+            batch[n++] = cr;
+            items -= CR_ITEMS + crs;
+            crds += crs;
+            pages += cr.count();
+
+            cur.start(cur.start() + cr.count());
+            cur.hotspot(cur.hotspot() + cr.count());
+            cur.count(cur.count() - cr.count());
         }
+        if(n == 0)
+            break;
 
-        uf << cr;
+        uf << n;
+        for(size_t j = 0; j < n; ++j)
+            uf << batch[j];
         _map_pts[CPU::current().log_id()]->call(uf);
-
-        // adjust start and hotspot for the next round
-        cr.start(cr.start() + cr.count());
-        if(cr.hotspot() != CapRange::NO_HOTSPOT)
-            cr.hotspot(cr.hotspot() + cr.count());
-        count -= cr.count();
-        cr.count(count);
+        calls++;
     }
+
+    Atomic::add(&_map_stats.calls, calls);
+    Atomic::add(&_map_stats.crds, crds);
+    Atomic::add(&_map_stats.pages, pages);
+    Atomic::add(&_map_stats.time, Util::tsc() - start);
 }
 
 void Hypervisor::unmap_mem(uintptr_t virt, size_t size) {
@@ -135,10 +158,15 @@ void Hypervisor::unmap_string(const char *str) {
 
 void Hypervisor::portal_map(void*) {
     UtcbFrameRef uf;
-    CapRange range;
-    uf >> range;
+    CapRange ranges[MAX_MAP_RANGES];
+    size_t count;
+    uf >> count;
+    assert(count <= MAX_MAP_RANGES);
+    for(size_t i = 0; i < count; ++i)
+        uf >> ranges[i];
     uf.clear();
-    uf.delegate(range, UtcbFrame::FROM_HV);
+    for(size_t i = 0; i < count; ++i)
+        uf.delegate(ranges[i], UtcbFrame::FROM_HV);
 }
 
 void Hypervisor::portal_gsi(void*) {
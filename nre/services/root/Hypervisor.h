@@ -36,11 +36,72 @@ public:
      */
     static void init();
 
+    /**
+     * A physical memory range that should be mapped to <virt>
+     */
+    struct MemRange {
+        uintptr_t phys;
+        uintptr_t virt;
+        size_t size;
+    };
+
+    /**
+     * Statistics about the mappings that have been requested from the hypervisor
+     */
+    struct MapStats {
+        // the number of portal calls
+        size_t calls;
+        // the number of Crds, i.e. naturally aligned memory blocks
+        size_t crds;
+        // the number of pages
+        size_t pages;
+        // the time spent in map_mem() in cycles
+        timevalue_t time;
+    };
+
+    /**
+     * The maximum number of ranges that are passed to the hypervisor in one call
+     */
+    static const size_t MAX_MAP_RANGES  = 16;
+
     /**
      * Maps <size> bytes at <phys> to <virt>. It assumes that both the virtual and the physical
      * pages are available.
      */
-    static void map_mem(uintptr_t phys, uintptr_t virt, size_t size);
+    static void map_mem(uintptr_t phys, uintptr_t virt, size_t size) {
+        MemRange range = {phys, virt, size};
+        map_mem(&range, 1);
+    }
+    /**
+     * Maps all given ranges. The ranges are split into the largest naturally aligned blocks and
+     * as many of them as fit into the UTCB are requested with one call.
+     *
+     * @param ranges the ranges
+     * @param count the number of ranges
+     */
+    static void map_mem(const MemRange *ranges, size_t count);
+    /**
+     * Determines the alignment for a virtual address to map <size> bytes at <phys> to, so that the
+     * mapping can use as large blocks as possible.
+     *
+     * @param phys the physical address
+     * @param size the number of bytes
+     * @return the alignment
+     */
+    static size_t map_align(uintptr_t phys, size_t size) {
+        size_t align = nre::ExecEnv::BIG_PAGE_SIZE;
+        if(phys)
+            align = nre::Math::min<size_t>(align, phys & -phys);
+        if(size)
+            align = nre::Math::min<size_t>(align, nre::Math::prev_pow2<size_t>(size));
+        return nre::Math::max<size_t>(align, nre::ExecEnv::PAGE_SIZE);
+    }
+    /**
+     * @return the statistics about all mappings so far
+     */
+    static const MapStats &map_stats() {
+        return _map_stats;
+    }
     /**
      * Undos the operation of map_mem(). That is, unmaps <size> bytes at <virt>.
      */
@@ -113,7 +174,7 @@ public:
     static capsel_t request_idle_sc(cpu_t cpu) {
         nre::UtcbFrame uf;
         uf.accept_delegates(0, nre::Crd::OBJ_ALL);
-        uf << nre::CapRange(cpu, 1, nre::Crd::OBJ_ALL);
+        uf << static_cast<size_t>(1) << nre::CapRange(cpu, 1, nre::Crd::OBJ_ALL);
         _map_pts[nre::CPU::current().log_id()]->call(uf);
         return uf.get_delegated(0).offset();
     }
@@ -131,6 +192,7 @@ private:
 
     static uchar _stack[];
     static nre::Pt *_map_pts[];
+    static MapStats _map_stats;
     static nre::PortManager _io;
     static nre::BitField<nre::Hip::MAX_GSIS> _gsis;
     static nre::UserSm _io_sm;
@@ -31,7 +31,7 @@ const char *Log::_colors[] = {
     "31", "32", "33", "34", "35", "36"
 };
 
-BufferedLog::BufferedLog() : BaseSerial(), _bufpos(0), _buf() {
+BufferedLog::BufferedLog() : BaseSerial() {
     BaseSerial::_inst = this;
 }
 
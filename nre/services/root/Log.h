@@ -139,20 +139,16 @@ class BufferedLog : public nre::BaseSerial {
     explicit BufferedLog();
 
     virtual void write(char c) {
-        if(c == '\0')
-            return;
-
-        if(_bufpos == sizeof(_buf) || c == '\n') {
-            // take care that the log is already initialized
-            if(Log::get()._ready)
-                Log::get().write("root", Log::ROOT_SESS, _buf, _bufpos);
-            _bufpos = 0;
-        }
-        if(c != '\n')
-            _buf[_bufpos++] = c;
+        buffer(c);
+    }
+    virtual void write(const char *str, size_t len) {
+        buffer(str, len);
+    }
+    virtual void flush(const char *line, size_t len) {
+        // take care that the log is already initialized
+        if(Log::get()._ready)
+            Log::get().write("root", Log::ROOT_SESS, line, len);
     }
 
-    size_t _bufpos;
-    char _buf[MAX_LINE_LEN + 1];
     static BufferedLog _inst;
 };
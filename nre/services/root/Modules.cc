@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/LZ4.h>
+#include <util/ScopedLock.h>
+#include <util/Bytes.h>
+#include <util/Math.h>
+#include <util/Util.h>
+#include <Logging.h>
+
+#include "Modules.h"
+#include "PhysicalMemory.h"
+#include "VirtualMemory.h"
+#include "Hypervisor.h"
+
+using namespace nre;
+
+Modules::Module Modules::_mods[MAX_MODULES];
+size_t Modules::_count;
+UserSm *Modules::_sm;
+
+void Modules::add(HipMem *mem) {
+    if(_count == MAX_MODULES)
+        return;
+
+    // map the module to see whether it is compressed
+    uintptr_t virt = VirtualMemory::alloc(mem->size, Hypervisor::map_align(mem->addr, mem->size));
+    Hypervisor::map_mem(mem->addr, virt, mem->size);
+    if(!LZ4::is_compressed(reinterpret_cast<const void*>(virt), mem->size)) {
+        Hypervisor::unmap_mem(virt, mem->size);
+        VirtualMemory::free(virt, mem->size);
+        return;
+    }
+
+    if(!_sm)
+        _sm = new UserSm();
+
+    // reserve the memory for the decompressed content and let the Hip refer to it. the source stays
+    // mapped for the decompression
+    size_t size = LZ4::decompressed_size(reinterpret_cast<const void*>(virt), mem->size);
+    uintptr_t phys = PhysicalMemory::alloc(Math::round_up<size_t>(size, ExecEnv::PAGE_SIZE),
+                                           ExecEnv::PAGE_SIZE);
+    Module &m = _mods[_count];
+    m.mem = mem;
+    m.src = virt;
+    m.srcsize = mem->size;
+    m.inflated = false;
+    LOG(BOOT, "Module '" << mem->cmdline() << "' is compressed: " << Bytes(mem->size) << " -> "
+                         << Bytes(size) << " @ " << fmt(phys, "p") << "\n");
+    mem->addr = phys;
+    mem->size = size;
+    _count++;
+}
+
+bool Modules::prepare(uintptr_t phys, size_t size) {
+    for(size_t i = 0; i < _count; ++i) {
+        Module &m = _mods[i];
+        uintptr_t end = m.mem->addr + Math::round_up<size_t>(m.mem->size, ExecEnv::PAGE_SIZE);
+        if(phys < m.mem->addr || phys + size > end)
+            continue;
+
+        ScopedLock<UserSm> guard(_sm);
+        if(!m.inflated) {
+            timevalue_t start = Util::tsc();
+            LZ4::decompress(reinterpret_cast<const void*>(m.src), m.srcsize,
+                            reinterpret_cast<void*>(VirtualMemory::phys_to_virt(m.mem->addr)),
+                            m.mem->size);
+            m.inflated = true;
+            timevalue_t duration = Util::tsc() - start;
+            LOG(BOOT, "Inflated module '" << m.mem->cmdline() << "' from " << Bytes(m.srcsize)
+                                          << " to " << Bytes(m.mem->size) << " in "
+                                          << (duration * 1000 / Hip::get().freq_tsc) << " us\n");
+        }
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <kobj/UserSm.h>
+#include <Hip.h>
+
+/**
+ * Manages the LZ4 compressed boot modules that are not started by root, but used by other
+ * childs (e.g. guest kernels or images that are loaded by vmmng). For each of them, physical memory
+ * for the decompressed content is reserved at startup and the module entry in the Hip is changed
+ * to refer to it. Thus, childs see the decompressed module. The decompression happens when a
+ * dataspace for the module is requested for the first time, so that modules that are never used
+ * don't cost any time.
+ */
+class Modules {
+    static const size_t MAX_MODULES     = 32;
+
+    struct Module {
+        nre::HipMem *mem;
+        uintptr_t src;
+        size_t srcsize;
+        bool inflated;
+    };
+
+public:
+    /**
+     * Adds the given module, if it is compressed. This has to be done at startup, before any child
+     * has been created that has access to it.
+     *
+     * @param mem the module in the Hip, which is changed accordingly
+     */
+    static void add(nre::HipMem *mem);
+
+    /**
+     * Decompresses the module that contains <phys>..<phys>+<size>, if not already done.
+     *
+     * @param phys the physical address
+     * @param size the size
+     * @return true if the memory belongs to a compressed module
+     * @throws LZ4Exception if the decompression failed
+     */
+    static bool prepare(uintptr_t phys, size_t size);
+
+private:
+    Modules();
+
+    static Module _mods[MAX_MODULES];
+    static size_t _count;
+    static nre::UserSm *_sm;
+};
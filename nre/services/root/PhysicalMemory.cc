@@ -14,11 +14,16 @@
  * General Public License version 2 for more details.
  */
 
+#include <kobj/GlobalThread.h>
+#include <util/Sync.h>
 #include <Logging.h>
+#include <CPU.h>
+#include <cstring>
 
 #include "PhysicalMemory.h"
 #include "VirtualMemory.h"
 #include "Hypervisor.h"
+#include "Modules.h"
 
 using namespace nre;
 
@@ -27,7 +32,11 @@ PhysicalMemory::RootDataSpace *PhysicalMemory::RootDataSpace::_free = nullptr;
 size_t PhysicalMemory::_totalsize = 0;
 PhysicalMemory::MemRegion PhysicalMemory::MemRegManager::_initial_regs[64];
 bool PhysicalMemory::MemRegManager::_initial_added = false;
+UserSm PhysicalMemory::_sm INIT_PRIO_PMEM;
 PhysicalMemory::MemRegManager PhysicalMemory::_mem INIT_PRIO_PMEM;
+PhysicalMemory::MemRegManager PhysicalMemory::_zeroed INIT_PRIO_PMEM;
+size_t PhysicalMemory::_zeroed_max = 0;
+Sm *PhysicalMemory::_zero_sm = nullptr;
 DataSpaceManager<PhysicalMemory::RootDataSpace> PhysicalMemory::_dsmng INIT_PRIO_PMEM;
 
 void *PhysicalMemory::MemRegion::operator new(size_t) throw() {
@@ -78,7 +87,9 @@ PhysicalMemory::RootDataSpace::RootDataSpace(const DataSpaceDesc &desc)
                                                     << fmt(_desc.phys() + _desc.size(), "p"));
         }
 
-        _desc.virt(VirtualMemory::alloc(_desc.size()));
+        // align the virtual memory like the physical memory to map it with large blocks
+        size_t align = Hypervisor::map_align(_desc.phys(), _desc.size());
+        _desc.virt(VirtualMemory::alloc(_desc.size(), align));
         _desc.origin(_desc.phys());
         Hypervisor::map_mem(_desc.phys(), _desc.virt(), _desc.size());
     }
@@ -87,9 +98,10 @@ PhysicalMemory::RootDataSpace::RootDataSpace(const DataSpaceDesc &desc)
         if(align < ExecEnv::BIG_PAGE_SIZE || _desc.size() < ExecEnv::BIG_PAGE_SIZE)
             flags &= ~DataSpaceDesc::BIGPAGES;
 
-        _desc.phys(alloc(_desc.size(), align));
+        _desc.phys(alloc_zeroed(_desc.size(), align));
         _desc.origin(_desc.phys());
         _desc.virt(VirtualMemory::phys_to_virt(_desc.phys()));
+        flags |= DataSpaceDesc::ZEROED;
     }
     _desc.flags(flags);
 }
@@ -144,6 +156,102 @@ void PhysicalMemory::RootDataSpace::revoke_mem(uintptr_t addr, size_t size, bool
     CapRange(start, count, Crd::MEM_ALL).revoke(self);
 }
 
+/**
+ * Zeroes the given memory with non-temporal stores, so that we don't pollute the cache with
+ * memory that nobody is going to use soon.
+ */
+static void zero_nt(uintptr_t virt, size_t size) {
+    word_t *p = reinterpret_cast<word_t*>(virt);
+    word_t *end = reinterpret_cast<word_t*>(virt + size);
+    for(; p < end; p += 4) {
+        asm volatile ("movnti %1, %0" : "=m" (p[0]) : "r" (0UL));
+        asm volatile ("movnti %1, %0" : "=m" (p[1]) : "r" (0UL));
+        asm volatile ("movnti %1, %0" : "=m" (p[2]) : "r" (0UL));
+        asm volatile ("movnti %1, %0" : "=m" (p[3]) : "r" (0UL));
+    }
+    // non-temporal stores are weakly ordered
+    Sync::store_fence();
+}
+
+uintptr_t PhysicalMemory::alloc_zeroed(size_t size, size_t align) {
+    uintptr_t phys;
+    {
+        ScopedLock<UserSm> guard(&_sm);
+        try {
+            phys = _zeroed.alloc(size, align);
+            size = 0;
+        }
+        catch(const RegionManagerException&) {
+            try {
+                phys = _mem.alloc(size, align);
+            }
+            catch(const RegionManagerException&) {
+                drain_pool();
+                phys = _mem.alloc(size, align);
+            }
+        }
+        if(_zero_sm && _zeroed.total_count() < _zeroed_max / 2)
+            _zero_sm->up();
+    }
+
+    // we didn't get it from the pool, so zero it now. use normal stores here, because the caller
+    // is likely to access the memory soon
+    if(size)
+        memset(reinterpret_cast<void*>(VirtualMemory::phys_to_virt(phys)), 0, size);
+    return phys;
+}
+
+void PhysicalMemory::drain_pool() {
+    while(_zeroed.begin() != _zeroed.end()) {
+        uintptr_t addr = _zeroed.begin()->addr;
+        size_t size = _zeroed.begin()->size;
+        if(_zeroed.alloc_at(addr, size) == 0)
+            break;
+        _mem.free(addr, size);
+    }
+}
+
+bool PhysicalMemory::refill_pool() {
+    uintptr_t phys;
+    {
+        ScopedLock<UserSm> guard(&_sm);
+        if(_zeroed.total_count() >= _zeroed_max)
+            return false;
+        // keep the pool from taking the last free memory
+        if(_mem.total_count() < ZERO_CHUNK * 2)
+            return false;
+        try {
+            phys = _mem.alloc(ZERO_CHUNK, ExecEnv::PAGE_SIZE);
+        }
+        catch(const RegionManagerException&) {
+            return false;
+        }
+    }
+
+    // nobody else knows about the chunk at this point, so we can zero it without holding the lock
+    zero_nt(VirtualMemory::phys_to_virt(phys), ZERO_CHUNK);
+
+    ScopedLock<UserSm> guard(&_sm);
+    _zeroed.free(phys, ZERO_CHUNK);
+    return true;
+}
+
+void PhysicalMemory::zero_thread(void*) {
+    while(1) {
+        while(refill_pool())
+            ;
+        _zero_sm->down();
+    }
+}
+
+void PhysicalMemory::start_zeroing() {
+    _zero_sm = new Sm(0);
+    // use the last CPU to stay out of the way of the boot process on the first one. the thread
+    // has the lowest priority that is available and a short quantum
+    cpu_t cpu = CPU::count() - 1;
+    GlobalThread::create(zero_thread, cpu, "root-zero")->start(Qpd(1, ZERO_QUANTUM));
+}
+
 void PhysicalMemory::add(uintptr_t addr, size_t size) {
     if(VirtualMemory::alloc_ram(addr, size))
         free(addr, size);
@@ -154,11 +262,23 @@ void PhysicalMemory::remove(uintptr_t addr, size_t size) {
 }
 
 void PhysicalMemory::map_all() {
+    Hypervisor::MemRange ranges[Hypervisor::MAX_MAP_RANGES];
+    size_t count = 0;
     for(auto it = _mem.begin(); it != _mem.end(); ++it) {
-        if(it->size)
-            Hypervisor::map_mem(it->addr, VirtualMemory::phys_to_virt(it->addr), it->size);
+        if(it->size) {
+            ranges[count].phys = it->addr;
+            ranges[count].virt = VirtualMemory::phys_to_virt(it->addr);
+            ranges[count].size = it->size;
+            if(++count == Hypervisor::MAX_MAP_RANGES) {
+                Hypervisor::map_mem(ranges, count);
+                count = 0;
+            }
+        }
     }
+    if(count > 0)
+        Hypervisor::map_mem(ranges, count);
     _totalsize = _mem.total_count();
+    _zeroed_max = Math::min(ZERO_POOL_MAX, _totalsize / ZERO_POOL_SHARE);
 }
 
 bool PhysicalMemory::can_map(uintptr_t phys, size_t size, uint &flags) {
@@ -167,6 +287,12 @@ bool PhysicalMemory::can_map(uintptr_t phys, size_t size, uint &flags) {
     if(phys + size < phys)
         return false;
 
+    // compressed modules are decompressed on the first request
+    if(Modules::prepare(phys, size)) {
+        flags = DataSpaceDesc::R;
+        return true;
+    }
+
     // check if its a module
     for(auto it = hip.mem_begin(); it != hip.mem_end(); ++it) {
         if(it->type == HipMem::MB_MODULE) {
@@ -188,6 +314,64 @@ bool PhysicalMemory::can_map(uintptr_t phys, size_t size, uint &flags) {
     return true;
 }
 
+void PhysicalMemory::create_batch(UtcbFrameRef &uf) {
+    size_t count;
+    DataSpaceDesc descs[DataSpace::MAX_BATCH];
+    uf >> count;
+    if(count == 0 || count > DataSpace::MAX_BATCH)
+        VTHROW(Exception, E_ARGS_INVALID, "Invalid number of dataspaces (" << count << ")");
+    for(size_t i = 0; i < count; ++i) {
+        uf >> descs[i];
+        if(descs[i].type() == DataSpaceDesc::VIRTUAL)
+            VTHROW(Exception, E_ARGS_INVALID, "Virtual dataspaces can't be created in a batch");
+    }
+    uf.finish_input();
+
+    const RootDataSpace *ds[DataSpace::MAX_BATCH];
+    size_t i = 0;
+    try {
+        for(; i < count; ++i) {
+            ds[i] = &_dsmng.create(descs[i]);
+            LOG(DATASPACES, "Root: Created " << *ds[i] << "\n");
+        }
+    }
+    catch(...) {
+        while(i-- > 0) {
+            DataSpaceDesc desc = ds[i]->desc();
+            _dsmng.release(desc, ds[i]->unmapsel());
+        }
+        throw;
+    }
+
+    for(i = 0; i < count; ++i) {
+        uf.delegate(ds[i]->sel(), i * 2);
+        uf.delegate(ds[i]->unmapsel(), i * 2 + 1);
+    }
+    uf << E_SUCCESS;
+    for(i = 0; i < count; ++i)
+        uf << ds[i]->desc();
+}
+
+void PhysicalMemory::destroy_batch(UtcbFrameRef &uf) {
+    size_t count;
+    DataSpaceDesc descs[DataSpace::MAX_BATCH];
+    capsel_t sels[DataSpace::MAX_BATCH];
+    uf >> count;
+    if(count > DataSpace::MAX_BATCH)
+        VTHROW(Exception, E_ARGS_INVALID, "Invalid number of dataspaces (" << count << ")");
+    for(size_t i = 0; i < count; ++i) {
+        uf >> descs[i];
+        sels[i] = uf.get_translated(0).offset();
+    }
+    uf.finish_input();
+
+    for(size_t i = 0; i < count; ++i) {
+        LOG(DATASPACES, "Root: Destroyed ds " << sels[i] << ": " << descs[i] << "\n");
+        _dsmng.release(descs[i], sels[i]);
+    }
+    uf << E_SUCCESS;
+}
+
 void PhysicalMemory::portal_dataspace(void*) {
     UtcbFrameRef uf;
     try {
@@ -195,6 +379,17 @@ void PhysicalMemory::portal_dataspace(void*) {
         DataSpaceDesc desc;
         DataSpace::RequestType type;
         uf >> type;
+        if(type == DataSpace::CREATE_BATCH) {
+            create_batch(uf);
+            return;
+        }
+        if(type == DataSpace::DESTROY_BATCH) {
+            destroy_batch(uf);
+            return;
+        }
+        // we have no DMA page table to fill; the root-task does not drive devices itself
+        if(type == DataSpace::MAP_DMA)
+            throw Exception(E_NOT_FOUND, "DMA mappings are not supported by root");
         if(type == DataSpace::JOIN || type == DataSpace::DESTROY)
             sel = uf.get_translated(0).offset();
         if(type != DataSpace::JOIN)
@@ -224,8 +419,12 @@ void PhysicalMemory::portal_dataspace(void*) {
                         LOG(DATASPACES, "Root: Joined " << ds << "\n");
                         uf.delegate(ds.unmapsel());
                     }
-                    // pass back attributes so that the caller has the correct ones
-                    uf << E_SUCCESS << ds.desc();
+                    // pass back attributes so that the caller has the correct ones. the content
+                    // of a joined dataspace is not zeroed anymore
+                    DataSpaceDesc res = ds.desc();
+                    if(type == DataSpace::JOIN)
+                        res.flags(res.flags() & ~DataSpaceDesc::ZEROED);
+                    uf << E_SUCCESS << res;
                 }
                 break;
 
@@ -242,6 +441,9 @@ void PhysicalMemory::portal_dataspace(void*) {
                 break;
 
             case DataSpace::SWITCH_TO:
+            case DataSpace::CREATE_BATCH:
+            case DataSpace::DESTROY_BATCH:
+            case DataSpace::MAP_DMA:
                 assert(false);
                 break;
         }
@@ -17,16 +17,20 @@
 #pragma once
 
 #include <kobj/Pt.h>
+#include <kobj/Sm.h>
 #include <kobj/UserSm.h>
 #include <mem/DataSpaceManager.h>
 #include <region/RegionManager.h>
 #include <util/Bytes.h>
+#include <util/ScopedLock.h>
 
 /**
  * Manages all physical memory. At the beginning, it is told what memory is available according
  * to the memory map in the Hip. Afterwards, you can allocate something from that and also free
  * it again. Note that all physical memory is directly mapped to VirtualMemory::RAM_BEGIN. Thus,
  * you can get the virtual address for a physical one by using VirtualMemory::phys_to_virt().
+ * Additionally, it keeps a pool of pre-zeroed memory, which is refilled by a background thread, so
+ * that anonymous dataspaces can be handed out zeroed without zeroing them on the allocation path.
  */
 class PhysicalMemory {
     class RootDataSpace;
@@ -124,6 +128,14 @@ class PhysicalMemory {
         static RootDataSpace *_free;
     };
 
+    // the granularity in which the zeroing thread takes memory for the pool
+    static const size_t ZERO_CHUNK      = 64 * 1024;
+    // the pool holds at most this much memory and at most 1/ZERO_POOL_SHARE of the total memory
+    static const size_t ZERO_POOL_MAX   = 32 * 1024 * 1024;
+    static const size_t ZERO_POOL_SHARE = 8;
+    // the quantum of the zeroing thread in microseconds
+    static const uint ZERO_QUANTUM      = 1000;
+
 public:
     /**
      * Allocates <size> bytes from the physical memory.
@@ -132,8 +144,24 @@ public:
      * @param align the alignment (in bytes; has to be a power of 2)
      */
     static uintptr_t alloc(size_t size, size_t align = 1) {
-        return _mem.alloc(size, align);
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        try {
+            return _mem.alloc(size, align);
+        }
+        catch(const nre::RegionManagerException&) {
+            // give the pool back and try again
+            drain_pool();
+            return _mem.alloc(size, align);
+        }
     }
+    /**
+     * Allocates <size> bytes of zeroed memory. If possible, it is taken from the pool of
+     * pre-zeroed memory. Otherwise, it is zeroed synchronously.
+     *
+     * @param size the number of bytes to allocate (a multiple of the page size)
+     * @param align the alignment (in bytes; has to be a power of 2)
+     */
+    static uintptr_t alloc_zeroed(size_t size, size_t align = 1);
     /**
      * Free's the given physical memory
      *
@@ -141,9 +169,15 @@ public:
      * @param size the number of bytes
      */
     static void free(uintptr_t phys, size_t size) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
         _mem.free(phys, size);
     }
 
+    /**
+     * Starts the thread that keeps the pool of pre-zeroed memory filled
+     */
+    static void start_zeroing();
+
     /**
      * Only for the startup: Add the given memory to the available list
      */
@@ -168,7 +202,15 @@ public:
      * @return the amount of still free physical memory
      */
     static size_t free_size() {
-        return _mem.total_count();
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        return _mem.total_count() + _zeroed.total_count();
+    }
+    /**
+     * @return the amount of free physical memory that is already zeroed
+     */
+    static size_t zeroed_size() {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        return _zeroed.total_count();
     }
 
     /**
@@ -185,10 +227,19 @@ public:
 
 private:
     static bool can_map(uintptr_t phys, size_t size, uint &flags);
+    static void create_batch(nre::UtcbFrameRef &uf);
+    static void destroy_batch(nre::UtcbFrameRef &uf);
+    static void drain_pool();
+    static bool refill_pool();
+    static void zero_thread(void*);
 
     PhysicalMemory();
 
     static size_t _totalsize;
+    static nre::UserSm _sm;
     static MemRegManager _mem;
+    static MemRegManager _zeroed;
+    static size_t _zeroed_max;
+    static nre::Sm *_zero_sm;
     static nre::DataSpaceManager<RootDataSpace> _dsmng;
 };
@@ -30,7 +30,19 @@ extern void *TEXT_END;
 extern void *DATA_BEGIN;
 extern void *DATA_END;
 
-const char *SysInfoService::get_root_info(size_t &virt, size_t &phys, size_t &threads) {
+size_t SysInfoService::get_child_phys() {
+    ScopedLock<ChildManager> guard(_cm);
+    size_t phys = 0;
+    for(auto it = _cm->begin(); it != _cm->end(); ++it) {
+        size_t cvirt, cphys;
+        it->reglist().memusage(cvirt, cphys);
+        phys += cphys;
+    }
+    return phys;
+}
+
+const char *SysInfoService::get_root_info(size_t &virt, size_t &phys, size_t &threads,
+                                          size_t childphys) {
     // find our own module; we're always the first one
     const char *cmdline = "";
     for(auto mem = Hip::get().mem_begin(); mem != Hip::get().mem_end(); ++mem) {
@@ -41,15 +53,7 @@ const char *SysInfoService::get_root_info(size_t &virt, size_t &phys, size_t &th
     }
     // determine physical memory by taking the total amount of used mem and substracting the amount
     // we've passed to children
-    phys = PhysicalMemory::total_size() - PhysicalMemory::free_size();
-    {
-        ScopedLock<ChildManager> guard(_cm);
-        for(auto it = _cm->begin(); it != _cm->end(); ++it) {
-            size_t cvirt, cphys;
-            it->reglist().memusage(cvirt, cphys);
-            phys -= cphys;
-        }
-    }
+    phys = PhysicalMemory::total_size() - PhysicalMemory::free_size() - childphys;
     // determine virtual memory by calculating the mem for our text and data area and the one we
     // assign dynamically.
     size_t textsize = reinterpret_cast<uintptr_t>(&TEXT_END)
@@ -62,6 +66,47 @@ const char *SysInfoService::get_root_info(size_t &virt, size_t &phys, size_t &th
     return cmdline;
 }
 
+void SysInfoService::refresh_snapshot() {
+    ScopedLock<UserSm> guard(&_snapsm);
+    SysInfo::Snapshot *snap = snapshot();
+    snap->begin_update();
+    snap->timestamp = Util::tsc();
+    snap->mem_total = PhysicalMemory::total_size();
+    snap->mem_free = PhysicalMemory::free_size();
+    Admission::snapshot(*snap);
+
+    // the children start at index 1; root is put in front afterwards, because we need the memory
+    // of all children for it
+    size_t idx = 1, childphys = 0;
+    {
+        ScopedLock<ChildManager> cmguard(_cm);
+        for(auto it = _cm->begin(); it != _cm->end(); ++it) {
+            size_t virt, phys;
+            it->reglist().memusage(virt, phys);
+            childphys += phys;
+            if(idx < SysInfo::Snapshot::MAX_PDS) {
+                SysInfo::Snapshot::Pd &pd = snap->pds[idx++];
+                SysInfo::Snapshot::copy_str(pd.cmdline, it->cmdline().str(),
+                                            it->cmdline().length(), sizeof(pd.cmdline));
+                pd.virt = virt;
+                pd.phys = phys;
+                // the main thread is not included in the sc-list
+                pd.threads = it->scs().length() + 1;
+            }
+        }
+    }
+
+    size_t virt, phys, threads;
+    const char *cmdline = get_root_info(virt, phys, threads, childphys);
+    SysInfo::Snapshot::copy_str(snap->pds[0].cmdline, cmdline, strlen(cmdline),
+                                sizeof(snap->pds[0].cmdline));
+    snap->pds[0].virt = virt;
+    snap->pds[0].phys = phys;
+    snap->pds[0].threads = threads;
+    snap->pd_count = idx;
+    snap->end_update();
+}
+
 Reference<const Child> SysInfoService::get_child_at(size_t idx) {
     ScopedLock<ChildManager> guard(_cm);
     auto it = _cm->begin();
@@ -72,6 +117,23 @@ Reference<const Child> SysInfoService::get_child_at(size_t idx) {
     return Reference<const Child>(&*it);
 }
 
+bool SysInfoService::get_service_at(size_t idx, String &name) {
+    ScopedLock<ChildManager> guard(_cm);
+    auto it = _cm->registry().cbegin();
+    for(; idx-- > 0 && it != _cm->registry().cend(); ++it)
+        ;
+    if(it == _cm->registry().cend())
+        return false;
+    name = it->name();
+    return true;
+}
+
+capsel_t SysInfoService::get_service_stats(const String &name) {
+    ScopedLock<ChildManager> guard(_cm);
+    const ServiceRegistry::Service *s = _cm->registry().find(name);
+    return s ? s->stats() : ObjCap::INVALID;
+}
+
 void SysInfoService::portal(ServiceSession*) {
     UtcbFrameRef uf;
     try {
@@ -135,11 +197,55 @@ void SysInfoService::portal(ServiceSession*) {
                 }
                 // idx 0 is root
                 else {
-                    const char *cmdline = srv->get_root_info(virt, phys, threads);
+                    const char *cmdline = srv->get_root_info(virt, phys, threads,
+                                                             srv->get_child_phys());
                     uf << E_SUCCESS << true << String(cmdline) << virt << phys << threads;
                 }
             }
             break;
+
+            case SysInfo::GET_SERVICE: {
+                SysInfoService *srv = Thread::current()->get_tls<SysInfoService*>(Thread::TLS_PARAM);
+                size_t idx;
+                uf >> idx;
+                uf.finish_input();
+
+                String name;
+                if(srv->get_service_at(idx, name))
+                    uf << E_SUCCESS << true << name;
+                else
+                    uf << E_SUCCESS << false;
+            }
+            break;
+
+            case SysInfo::GET_SERVICE_STATS: {
+                SysInfoService *srv = Thread::current()->get_tls<SysInfoService*>(Thread::TLS_PARAM);
+                String name;
+                uf >> name;
+                uf.finish_input();
+
+                capsel_t ds = srv->get_service_stats(name);
+                if(ds != ObjCap::INVALID) {
+                    uf.delegate(ds);
+                    uf << E_SUCCESS << true;
+                }
+                else
+                    uf << E_SUCCESS << false;
+            }
+            break;
+
+            case SysInfo::GET_SNAPSHOT: {
+                SysInfoService *srv = Thread::current()->get_tls<SysInfoService*>(Thread::TLS_PARAM);
+                uf.finish_input();
+
+                // without timer, there is no periodic refresh. so, refresh it on demand and also
+                // don't hand out an empty snapshot if the first periodic refresh didn't happen yet
+                if(srv->snapshot()->outdated(Util::tsc()))
+                    srv->refresh_snapshot();
+                uf.delegate(srv->_snapds.sel());
+                uf << E_SUCCESS;
+            }
+            break;
         }
     }
     catch(const Exception& e) {
@@ -15,28 +15,48 @@
  */
 
 #include <ipc/Service.h>
+#include <services/SysInfo.h>
 #include <subsystem/ChildManager.h>
+#include <mem/DataSpace.h>
+#include <kobj/UserSm.h>
 
 /**
  * The sysinfo-service is intended to allow applications to display information about the running
  * system to the user. At the moment, you can get information about the existing Scs, and the
- * child tasks of root with the memory usage and some other things.
+ * child tasks of root with the memory usage and some other things. Besides the per-index
+ * requests, it offers a snapshot of all that in a shared dataspace, which is refreshed via
+ * refresh_snapshot().
  */
 class SysInfoService : public nre::Service {
 public:
     SysInfoService(nre::ChildManager *cm)
         : nre::Service("sysinfo", nre::CPUSet(nre::CPUSet::ALL), reinterpret_cast<portal_func>(portal)),
-          _cm(cm) {
-        for(auto it = nre::CPU::begin(); it != nre::CPU::end(); ++it) {
-            nre::Reference<nre::LocalThread> ec = get_thread(it->log_id());
-            ec->set_tls<SysInfoService*>(nre::Thread::TLS_PARAM, this);
-        }
+          _cm(cm), _snapds(nre::Math::round_up(sizeof(nre::SysInfo::Snapshot),
+                                               nre::ExecEnv::PAGE_SIZE),
+                           nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::R),
+          _snapsm() {
+        set_thread_tls<SysInfoService*>(nre::Thread::TLS_PARAM, this);
+        memset(snapshot(), 0, sizeof(nre::SysInfo::Snapshot));
     }
 
+    /**
+     * Updates the snapshot, i.e. collects the current state of all Scs and Pds and starts a new
+     * period for the Sc times.
+     */
+    void refresh_snapshot();
+
 private:
-    const char *get_root_info(size_t &virt, size_t &phys, size_t &threads);
+    nre::SysInfo::Snapshot *snapshot() {
+        return reinterpret_cast<nre::SysInfo::Snapshot*>(_snapds.virt());
+    }
+    size_t get_child_phys();
+    const char *get_root_info(size_t &virt, size_t &phys, size_t &threads, size_t childphys);
     nre::Reference<const nre::Child> get_child_at(size_t idx);
+    bool get_service_at(size_t idx, nre::String &name);
+    capsel_t get_service_stats(const nre::String &name);
     PORTAL static void portal(nre::ServiceSession*);
 
     nre::ChildManager *_cm;
+    nre::DataSpace _snapds;
+    nre::UserSm _snapsm;
 };
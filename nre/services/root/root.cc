@@ -16,13 +16,17 @@
 
 #include <kobj/LocalThread.h>
 #include <kobj/Pt.h>
+#include <kobj/UserSm.h>
 #include <utcb/UtcbFrame.h>
 #include <subsystem/ChildManager.h>
 #include <subsystem/ChildHip.h>
 #include <ipc/Service.h>
-#include <collection/Cycler.h>
+#include <ipc/ClientSession.h>
+#include <services/Timer.h>
+#include <util/Clock.h>
 #include <util/Math.h>
 #include <util/Bytes.h>
+#include <util/ScopedLock.h>
 #include <String.h>
 #include <Hip.h>
 #include <CPU.h>
@@ -37,6 +41,7 @@
 #include "Admission.h"
 #include "SysInfoService.h"
 #include "Log.h"
+#include "Boot.h"
 
 using namespace nre;
 
@@ -50,10 +55,10 @@ class CPU0Init {
 EXTERN_C void dlmalloc_init();
 static void log_thread(void*);
 static void sysinfo_thread(void*);
+static void snapshot_thread(void*);
 PORTAL static void portal_service(void*);
 PORTAL static void portal_pagefault(void*);
 PORTAL static void portal_startup(void*);
-static void start_childs();
 
 CPU0Init CPU0Init::init INIT_PRIO_CPU0;
 
@@ -65,6 +70,10 @@ static uchar ptstack[ExecEnv::STACK_SIZE] ALIGNED(ARCH_STACK_SIZE);
 static uchar regptstack[ExecEnv::STACK_SIZE] ALIGNED(ARCH_STACK_SIZE);
 static uchar nhip[ExecEnv::PAGE_SIZE] ALIGNED(ARCH_PAGE_SIZE);
 static ChildManager *mng;
+static SysInfoService *sysinfo;
+// the sessions root has opened at services of its children
+static UserSm sessions_sm;
+static SList<ClientSession> sessions;
 
 CPU0Init::CPU0Init() {
     // just init the current CPU to prevent that the startup-heap-size depends on the number of CPUs
@@ -168,6 +177,11 @@ int main() {
 
     // now allocate the available memory from the hypervisor
     PhysicalMemory::map_all();
+    {
+        const Hypervisor::MapStats &stats = Hypervisor::map_stats();
+        LOG(BOOT, "Mapped " << Bytes(stats.pages * ExecEnv::PAGE_SIZE) << " with " << stats.crds
+                            << " Crds in " << stats.calls << " calls (" << stats.time << " cycles)\n");
+    }
 
     LOG(MEM_MAP, "Virtual memory for mappings:\n");
     const RegionManager<> &vmregs = VirtualMemory::regions();
@@ -254,12 +268,18 @@ int main() {
     mng = new ChildManager();
     GlobalThread::create(log_thread, CPU::current().log_id(), "root-log")->start();
     GlobalThread::create(sysinfo_thread, CPU::current().log_id(), "root-sysinfo")->start();
+    PhysicalMemory::start_zeroing();
 
     // wait until log and sysinfo are registered
     while(mng->registry().find("log") == nullptr || mng->registry().find("sysinfo") == nullptr)
         Util::pause();
 
-    start_childs();
+    Boot::start(mng);
+
+    // refresh the sysinfo snapshot periodically, if we have a timer. otherwise it is refreshed
+    // on demand by SysInfo::GET_SNAPSHOT, if it is outdated
+    if(mng->registry().find("timer"))
+        GlobalThread::create(snapshot_thread, CPU::current().log_id(), "root-snapshot")->start();
 
     Sm sm(0);
     sm.down();
@@ -271,26 +291,19 @@ static void log_thread(void*) {
 }
 
 static void sysinfo_thread(void*) {
-    SysInfoService *sysinfo = new SysInfoService(mng);
+    sysinfo = new SysInfoService(mng);
     sysinfo->start();
 }
 
-static void start_childs() {
-    size_t mod = 0, i = 0;
-    ForwardCycler<CPU::iterator> cpus(CPU::begin(), CPU::end());
-    const Hip &hip = Hip::get();
-    for(auto it = hip.mem_begin(); it != hip.mem_end(); ++it, ++mod) {
-        // we are the first one :)
-        if(it->type == HipMem::MB_MODULE && i++ >= 1) {
-            // map the memory of the module
-            uintptr_t virt = VirtualMemory::alloc(it->size);
-            Hypervisor::map_mem(it->addr, virt, it->size);
-
-            ChildConfig cfg(mod, it->cmdline(), cpus.next()->log_id());
-            mng->load(virt, it->size, cfg);
-            if(cfg.last())
-                break;
-        }
+static void snapshot_thread(void*) {
+    TimerSession timer("timer");
+    Clock clock(1000);
+    // refresh every period, like the sysinfo app did before it used the snapshot
+    timer.init_timers(1);
+    timer.arm(0, clock.source_time(), clock.source_freq() * SysInfo::Snapshot::PERIOD_MS / 1000);
+    while(timer.expiries().get() != nullptr) {
+        timer.expiries().next();
+        sysinfo->refresh_snapshot();
     }
 }
 
@@ -313,16 +326,60 @@ static void portal_service(void*) {
             }
             break;
 
+            case Service::STATS: {
+                String name;
+                capsel_t cap;
+                uf >> name >> cap;
+                uf.finish_input();
+
+                mng->reg_stats(cap, name);
+                uf << E_SUCCESS;
+            }
+            break;
+
             case Service::OPEN_SESSION: {
                 String name, args;
                 uf >> name >> args;
                 uf.finish_input();
-                VTHROW(Exception, E_NOT_FOUND,
-                       "Unable to find service '" << name << "' (args=" << args << ")");
+
+                // root can use the services of its children as well
+                const ServiceRegistry::Service *s = mng->registry().find(name);
+                if(!s) {
+                    VTHROW(Exception, E_NOT_FOUND,
+                           "Unable to find service '" << name << "' (args=" << args << ")");
+                }
+                ClientSession *sess = new ClientSession(name, args, s->pts());
+                {
+                    ScopedLock<UserSm> guard(&sessions_sm);
+                    sessions.append(sess);
+                }
+                uf.delegate(CapRange(sess->caps(), 1 << CPU::order(), Crd::OBJ_ALL));
+                uf << E_SUCCESS << sess->available();
+            }
+            break;
+
+            case Service::CLOSE_SESSION: {
+                capsel_t ident = uf.get_translated(0).offset();
+                uf.finish_input();
+
+                ClientSession *sess = nullptr;
+                {
+                    ScopedLock<UserSm> guard(&sessions_sm);
+                    for(auto it = sessions.begin(); it != sessions.end(); ++it) {
+                        if(it->caps() + CPU::current().log_id() == ident) {
+                            sess = &*it;
+                            sessions.remove(sess);
+                            break;
+                        }
+                    }
+                }
+                if(!sess)
+                    VTHROW(Exception, E_NOT_FOUND, "Session with handle " << ident << " not found");
+                delete sess;
+                uf << E_SUCCESS;
             }
             break;
 
-            case Service::CLOSE_SESSION:
             case Service::UNREGISTER:
                 uf.clear();
                 uf << E_NOT_FOUND;
@@ -19,6 +19,7 @@
 #include "ControllerMng.h"
 #include "HostAHCICtrl.h"
 #include "HostIDECtrl.h"
+#include "HostNVMeCtrl.h"
 
 using namespace nre;
 
@@ -35,16 +36,14 @@ void ControllerMng::find_ahci_controller() {
             break;
         }
 
-        //MessageHostOp msg1(MessageHostOp::OP_ASSIGN_PCI,bdf);
-        // TODO bool dmar = mb.bus_hostop.send(msg1);
-        bool dmar = false;
+        DmaDomain *dom = _dom.assign(bdf) ? &_dom : nullptr;
         Gsi *gsi = _pci.get_gsi(bdf, 0);
 
         LOG(STORAGE, "Disk controller " << fmt(_count, "#x") << " AHCI " << bdf
                                         << " id " << fmt(_pci.conf_read(bdf, 0), "#x")
                                         << " mmio " << fmt(_pci.conf_read(bdf, 9), "#x") << "\n");
 
-        HostAHCICtrl * ctrl = new HostAHCICtrl(_count, _pci, bdf, gsi, dmar);
+        HostAHCICtrl * ctrl = new HostAHCICtrl(_count, _pci, bdf, gsi, dom);
         _ctrls[_count++] = ctrl;
         inst++;
     }
@@ -111,3 +110,36 @@ void ControllerMng::find_ide_controller() {
         inst++;
     }
 }
+
+void ControllerMng::find_nvme_controller() {
+    uint inst = 0;
+    BDF bdf;
+    while(_count < Storage::MAX_CONTROLLER) {
+        try {
+            bdf = _pcicfg.search_device(CLASS_STORAGE_CTRL, SUBCLASS_NVM, inst);
+        }
+        catch(const Exception &e) {
+            LOG(STORAGE_DETAIL,
+                "Stopping search for NVMe controllers: " << e.code() << ": " << e.msg() << "\n");
+            break;
+        }
+        inst++;
+
+        // the subclass includes NVMHCI as well
+        if(((_pci.conf_read(bdf, 0x2) >> 8) & 0xFF) != PROGIF_NVME)
+            continue;
+
+        LOG(STORAGE, "Disk controller " << fmt(_count, "#x") << " NVMe " << bdf
+                                        << " id " << fmt(_pci.conf_read(bdf, 0), "#x")
+                                        << " mmio " << fmt(_pci.conf_read(bdf, 4), "#x") << "\n");
+
+        try {
+            DmaDomain *dom = _dom.assign(bdf) ? &_dom : nullptr;
+            Controller *ctrl = new HostNVMeCtrl(_count, _pci, bdf, dom);
+            _ctrls[_count++] = ctrl;
+        }
+        catch(const Exception &e) {
+            LOG(STORAGE, e.msg() << "\n");
+        }
+    }
+}
@@ -22,19 +22,24 @@
 #include <util/PCI.h>
 
 #include "Controller.h"
+#include "DmaDomain.h"
 
 class ControllerMng {
     enum {
         CLASS_STORAGE_CTRL      = 0x1,
         SUBCLASS_IDE            = 0x1,
         SUBCLASS_SATA           = 0x6,
+        SUBCLASS_NVM            = 0x8,
+        PROGIF_NVME             = 0x2,
     };
 
 public:
     explicit ControllerMng(bool idedma)
-        : _idedma(idedma), _pcicfg("pcicfg"), _acpi("acpi"), _pci(_pcicfg, &_acpi), _count(0), _ctrls() {
+        : _idedma(idedma), _pcicfg("pcicfg"), _acpi("acpi"), _pci(_pcicfg, &_acpi),
+          _dom(_pcicfg, _acpi), _count(0), _ctrls() {
         find_ahci_controller();
         find_ide_controller();
+        find_nvme_controller();
     }
 
     bool exists(size_t ctrl) const {
@@ -43,15 +48,20 @@ public:
     Controller *get(size_t ctrl) const {
         return _ctrls[ctrl];
     }
+    DmaDomain &dma_domain() {
+        return _dom;
+    }
 
 private:
     void find_ahci_controller();
     void find_ide_controller();
+    void find_nvme_controller();
 
     bool _idedma;
     nre::PCIConfigSession _pcicfg;
     nre::ACPISession _acpi;
     nre::PCI _pci;
+    DmaDomain _dom;
     size_t _count;
     Controller *_ctrls[nre::Storage::MAX_CONTROLLER];
 };
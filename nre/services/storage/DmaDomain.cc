@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/DmarTableParser.h>
+#include <kobj/Pd.h>
+#include <Syscalls.h>
+#include <Logging.h>
+
+#include "DmaDomain.h"
+
+using namespace nre;
+
+bool DmaDomain::covers(BDF bdf) {
+    try {
+        DataSpace table = _acpi.find_table("DMAR");
+        DmarTableParser p(reinterpret_cast<char*>(table.virt()));
+        DmarTableParser::Element e = p.get_element();
+        do {
+            if(e.type() != DmarTableParser::DHRD)
+                continue;
+
+            DmarTableParser::Dhrd dhrd = e.get_dhrd();
+            if(dhrd.segment() != 0)
+                continue;
+            if(dhrd.flags() & DmarTableParser::Dhrd::INCLUDE_PCI_ALL)
+                return true;
+            if(!dhrd.has_scopes())
+                continue;
+
+            DmarTableParser::DeviceScope s = dhrd.get_scope();
+            do {
+                // devices behind bridges are not supported yet
+                if(s.type() != DmarTableParser::PCI_ENDPOINT || s.path_length() != 1)
+                    continue;
+                if(s.rid() == bdf.value())
+                    return true;
+            }
+            while(s.has_next() and ((s = s.next()), true));
+        }
+        while(e.has_next() and ((e = e.next()), true));
+    }
+    catch(const Exception &e) {
+        LOG(STORAGE_DETAIL, "No DMAR table: " << e.code() << ": " << e.msg() << "\n");
+    }
+    return false;
+}
+
+bool DmaDomain::assign(BDF bdf) {
+    if(_devcount == MAX_DEVICES || !covers(bdf))
+        return false;
+
+    try {
+        DataSpace *cfg = new DataSpace(_pcicfg.map_config(bdf));
+        try {
+            Syscalls::assign_pci(Pd::current()->sel(), reinterpret_cast<void*>(cfg->virt()),
+                                 bdf.value());
+        }
+        catch(...) {
+            delete cfg;
+            throw;
+        }
+        _devs[_devcount++] = cfg;
+    }
+    catch(const Exception &e) {
+        LOG(STORAGE, "Unable to assign " << bdf << ": " << e.code() << ": " << e.msg() << "\n");
+        return false;
+    }
+    LOG(STORAGE, "Assigned " << bdf << " to our DMA domain\n");
+    return true;
+}
+
+void DmaDomain::add(const DataSpace &ds) {
+    ds.map_dma();
+    // if we're out of slots, we simply forget the oldest mapping. it stays in the page table,
+    // so that the worst case is that we map it again
+    _maps[_next].sel = ds.unmapsel();
+    _maps[_next].virt = ds.virt();
+    _maps[_next].size = ds.size();
+    _last = _next;
+    _next = (_next + 1) % MAX_MAPPINGS;
+    LOG(STORAGE_DETAIL, "Mapped " << ds << " for DMA\n");
+}
+
+void DmaDomain::unmap(const DataSpace &ds) {
+    ScopedLock<UserSm> guard(&_sm);
+    for(size_t i = 0; i < MAX_MAPPINGS; ++i) {
+        if(matches(i, ds))
+            _maps[i] = Mapping();
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <services/PCIConfig.h>
+#include <services/ACPI.h>
+#include <mem/DataSpace.h>
+#include <kobj/UserSm.h>
+#include <util/ScopedLock.h>
+#include <util/BDF.h>
+
+/**
+ * The DMA address space (IOMMU domain) of the storage service. NOVA has one DMA page table per
+ * Pd, which mirrors the virtual address space of the Pd for all memory that has been delegated
+ * with UtcbFrame::UPD_DPT. Thus, the I/O virtual address of a buffer is simply its virtual address,
+ * but each dataspace has to be mapped into the DMA page table before a device can access it.
+ * To keep that out of the I/O path, we remember which dataspaces have been mapped already, so that
+ * only the first access to a dataspace pays for the mapping.
+ */
+class DmaDomain {
+    struct Mapping {
+        capsel_t sel;
+        uintptr_t virt;
+        size_t size;
+    };
+
+    static const size_t MAX_DEVICES     = 8;
+    static const size_t MAX_MAPPINGS    = 64;
+
+public:
+    explicit DmaDomain(const nre::PCIConfigSession &pcicfg, const nre::ACPISession &acpi)
+        : _sm(), _pcicfg(pcicfg), _acpi(acpi), _devcount(0), _devs(), _last(0), _next(0),
+          _maps() {
+    }
+    ~DmaDomain() {
+        for(size_t i = 0; i < _devcount; ++i)
+            delete _devs[i];
+    }
+
+    /**
+     * @return true if at least one device has been assigned to this domain
+     */
+    bool active() const {
+        return _devcount > 0;
+    }
+
+    /**
+     * Assigns the given device to our Pd, if it is behind an IOMMU according to the DMAR table.
+     *
+     * @param bdf the device
+     * @return true if the device has been assigned, i.e. it has to use I/O virtual addresses
+     */
+    bool assign(nre::BDF bdf);
+
+    /**
+     * Determines the I/O virtual address for <addr>, which has to be within <ds>. Maps <ds> into
+     * the DMA page table, if that has not been done yet.
+     *
+     * @param ds the dataspace
+     * @param addr the virtual address
+     * @return the address to give to the device
+     */
+    uint64_t iova(const nre::DataSpace &ds, uintptr_t addr) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        if(!is_mapped(ds))
+            add(ds);
+        return addr;
+    }
+
+    /**
+     * Maps <ds> into the DMA page table, if that has not been done yet.
+     *
+     * @param ds the dataspace
+     */
+    void map(const nre::DataSpace &ds) {
+        iova(ds, ds.virt());
+    }
+
+    /**
+     * Forgets the mapping of <ds>. This has to be done before the dataspace is destroyed, because
+     * its selector and address might be reused for a different dataspace afterwards. The DMA
+     * mappings themself are revoked together with the memory.
+     *
+     * @param ds the dataspace
+     */
+    void unmap(const nre::DataSpace &ds);
+
+private:
+    bool matches(size_t i, const nre::DataSpace &ds) const {
+        return _maps[i].sel == ds.unmapsel() && _maps[i].virt == ds.virt() &&
+               _maps[i].size == ds.size();
+    }
+    bool is_mapped(const nre::DataSpace &ds) {
+        // in the common case, all requests of a client use the same dataspace
+        if(matches(_last, ds))
+            return true;
+        for(size_t i = 0; i < MAX_MAPPINGS; ++i) {
+            if(matches(i, ds)) {
+                _last = i;
+                return true;
+            }
+        }
+        return false;
+    }
+    void add(const nre::DataSpace &ds);
+    bool covers(nre::BDF bdf);
+
+    nre::UserSm _sm;
+    const nre::PCIConfigSession &_pcicfg;
+    const nre::ACPISession &_acpi;
+    size_t _devcount;
+    nre::DataSpace *_devs[MAX_DEVICES];
+    size_t _last;
+    size_t _next;
+    Mapping _maps[MAX_MAPPINGS];
+};
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/ExecEnv.h>
+#include <mem/DataSpace.h>
+#include <services/Storage.h>
+#include <util/Math.h>
+
+#include "DmaDomain.h"
+
+/**
+ * Splits the memory that is described by a DMA descriptor list into runs that a controller can
+ * transfer with one scatter-gather entry. The dataspace is looked up page by page, so that a run
+ * ends as soon as the next page is not backed by the following frame. Additionally, runs are
+ * limited to a maximum length and do not cross a given boundary.
+ */
+class DmaRuns {
+    typedef nre::DMADescList<nre::Storage::MAX_DMA_DESCS> dma_type;
+
+public:
+    /**
+     * Creates a walker over <dma> in <ds>. The descriptors have to be within <ds>.
+     *
+     * @param ds the dataspace
+     * @param dma the DMA descriptors
+     * @param dom the DMA domain, if the device is behind an IOMMU (nullptr otherwise)
+     * @param max the maximum number of bytes per run
+     * @param boundary if not zero, runs do not cross an address that is a multiple of this
+     *  (has to be a power of 2)
+     */
+    explicit DmaRuns(const nre::DataSpace &ds, const dma_type &dma, DmaDomain *dom, size_t max,
+                     size_t boundary = 0)
+        : _base(dom ? dom->iova(ds, ds.virt()) : ds.phys()), _max(max),
+          _boundary(boundary), _it(dma.begin()), _end(dma.end()), _off(0) {
+    }
+
+    /**
+     * Determines the next run.
+     *
+     * @param addr will be set to the address of the run, as seen by the device
+     * @param bytes will be set to the length of the run
+     * @return false if there are no runs left
+     */
+    bool next(uint64_t &addr, size_t &bytes) {
+        while(_it != _end && _off == _it->count) {
+            ++_it;
+            _off = 0;
+        }
+        if(_it == _end)
+            return false;
+
+        size_t pos = _it->offset + _off;
+        size_t left = _it->count - _off;
+        addr = frame(pos);
+        size_t limit = _max;
+        if(_boundary)
+            limit = nre::Math::min<size_t>(limit, _boundary - (addr & (_boundary - 1)));
+        limit = nre::Math::min(limit, left);
+
+        // add pages as long as they are physically contiguous
+        bytes = nre::ExecEnv::PAGE_SIZE - (pos & (nre::ExecEnv::PAGE_SIZE - 1));
+        while(bytes < limit && frame(pos + bytes) == addr + bytes)
+            bytes += nre::ExecEnv::PAGE_SIZE;
+        bytes = nre::Math::min(bytes, limit);
+        _off += bytes;
+        return true;
+    }
+
+private:
+    /**
+     * The page-to-frame lookup. Dataspaces are backed by contiguous memory at the moment, so that
+     * this is simple. With an IOMMU, the device uses our virtual addresses anyway.
+     *
+     * @param pos the offset in the dataspace
+     * @return the address of that byte, as seen by the device
+     */
+    uint64_t frame(size_t pos) const {
+        return _base + pos;
+    }
+
+    uint64_t _base;
+    size_t _max;
+    size_t _boundary;
+    dma_type::iterator _it;
+    dma_type::iterator _end;
+    size_t _off;
+};
@@ -21,7 +21,7 @@
 
 using namespace nre;
 
-HostAHCICtrl::HostAHCICtrl(uint id, PCI &pci, BDF bdf, Gsi *gsi, bool dmar)
+HostAHCICtrl::HostAHCICtrl(uint id, PCI &pci, BDF bdf, Gsi *gsi, DmaDomain *dom)
     : Controller(id), _gsi(gsi), _bdf(bdf), _regs_ds(), _regs_high_ds(), _regs(),
       _regs_high(0), _portcount(0), _ports() {
     assert(!(~pci.conf_read(_bdf, 1) & 6) && "we need mem-decode and busmaster dma");
@@ -49,9 +49,9 @@ HostAHCICtrl::HostAHCICtrl(uint id, PCI &pci, BDF bdf, Gsi *gsi, bool dmar)
     // create ports
     memset(_ports, 0, sizeof(_ports));
     for(uint i = 0; i < 30; i++)
-        create_ahci_port(i, _regs->ports + i, dmar);
+        create_ahci_port(i, _regs->ports + i, dom);
     for(uint i = 30; _regs_high && i < 32; i++)
-        create_ahci_port(i, _regs_high + (i - 30), dmar);
+        create_ahci_port(i, _regs_high + (i - 30), dom);
 
     // clear pending irqs
     _regs->is = _regs->pi;
@@ -67,7 +67,7 @@ HostAHCICtrl::HostAHCICtrl(uint id, PCI &pci, BDF bdf, Gsi *gsi, bool dmar)
     gt->start();
 }
 
-void HostAHCICtrl::create_ahci_port(uint nr, HostAHCIDevice::Register *portreg, bool dmar) {
+void HostAHCICtrl::create_ahci_port(uint nr, HostAHCIDevice::Register *portreg, DmaDomain *dom) {
     // port not implemented
     if(!(_regs->pi & (1 << nr)))
         return;
@@ -77,7 +77,7 @@ void HostAHCICtrl::create_ahci_port(uint nr, HostAHCIDevice::Register *portreg,
     if(sig != HostAHCIDevice::SATA_SIG_NONE) {
         try {
             _ports[nr] = new HostAHCIDevice(portreg, _id * Storage::MAX_DRIVES + _portcount,
-                                            ((_regs->cap >> 8) & 0x1f) + 1, dmar);
+                                            ((_regs->cap >> 8) & 0x1f) + 1, dom);
             _ports[nr]->determine_capacity();
             LOG(STORAGE, *_ports[nr] << "\n");
             _portcount++;
@@ -59,7 +59,7 @@ class HostAHCICtrl : public Controller {
     };
 
 public:
-    explicit HostAHCICtrl(uint id, nre::PCI &pci, nre::BDF bdf, nre::Gsi *gsi, bool dmar);
+    explicit HostAHCICtrl(uint id, nre::PCI &pci, nre::BDF bdf, nre::Gsi *gsi, DmaDomain *dom);
     virtual ~HostAHCICtrl() {
         delete _gsi;
         delete _regs_ds;
@@ -96,7 +96,7 @@ private:
     static size_t idx(size_t drive) {
         return drive % nre::Storage::MAX_DRIVES;
     }
-    void create_ahci_port(uint nr, HostAHCIDevice::Register *portreg, bool dmar);
+    void create_ahci_port(uint nr, HostAHCIDevice::Register *portreg, DmaDomain *dom);
     static void gsi_thread(void*);
 
     nre::Gsi *_gsi;
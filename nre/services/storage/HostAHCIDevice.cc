@@ -84,8 +84,8 @@ void HostAHCIDevice::readwrite(Producer<Storage::Packet> *prod, Storage::tag_typ
                                bool write) {
     ScopedLock<UserSm> guard(&_sm);
     size_t length = dma.bytecount();
-    // exceeds max. length?
-    if(length >> 22) {
+    // exceeds max. length? (a sector count of 0 means 256 or 65536, respectively)
+    if((length >> 9) > (has_lba48() ? 0x10000U : 0x100U)) {
         VTHROW(Exception, E_ARGS_INVALID,
                "Device " << _id << ": Max. sector count exceeded (" << (length >> 9) << ")");
     }
@@ -101,8 +101,8 @@ void HostAHCIDevice::readwrite(Producer<Storage::Packet> *prod, Storage::tag_typ
                    "Device " << _id << ": Invalid offset(" << it->offset <<")/"
                                                << "count(" << it->count << ")");
         }
-        add_dma(ds, it->offset, it->count);
     }
+    add_dma(ds, dma);
     start_command(prod, tag);
 }
 
@@ -144,25 +144,31 @@ void HostAHCIDevice::set_command(uint8_t command, uint64_t sector, bool read, ui
     memcpy(_ct + _tag * (128 + MAX_PRD_COUNT * 16) / 4, cfis, sizeof(cfis));
 }
 
-void HostAHCIDevice::add_dma(const nre::DataSpace &ds, size_t offset, uint bytes) {
-    uint32_t prd = _cl[_tag * CL_DWORDS] >> 16;
-    if(prd >= MAX_PRD_COUNT)
-        VTHROW(Exception, E_ARGS_INVALID, "Device " << _id << ": No free PRD slot");
-    _cl[_tag * CL_DWORDS] += 1 << 16;
-    uint32_t *p = _ct + ((_tag * (128 + MAX_PRD_COUNT * 16) + 0x80 + prd * 16) >> 2);
-    addr2phys(ds, reinterpret_cast<void*>(ds.virt() + offset), p);
-    p[3] = bytes - 1;
+void HostAHCIDevice::add_dma(const nre::DataSpace &ds, const dma_type &dma) {
+    // one PRD per physically contiguous run, so that the buffer does not need to be contiguous
+    DmaRuns runs(ds, dma, _dom, MAX_PRD_BYTES);
+    uint64_t addr;
+    size_t bytes;
+    while(runs.next(addr, bytes)) {
+        if((addr | bytes) & 1) {
+            VTHROW(Exception, E_ARGS_INVALID,
+                   "Device " << _id << ": DMA run " << fmt(addr, "#x") << " with " << bytes
+                             << " bytes is not word aligned");
+        }
+        add_prd(addr, bytes);
+    }
 }
 
-void HostAHCIDevice::add_prd(const nre::DataSpace &ds, uint bytes) {
+void HostAHCIDevice::add_prd(uint64_t addr, size_t bytes) {
     uint32_t prd = _cl[_tag * CL_DWORDS] >> 16;
     assert(~bytes & 1);
-    assert(!(bytes >> 22));
+    assert(bytes > 0 && bytes <= MAX_PRD_BYTES);
     if(prd >= MAX_PRD_COUNT)
         VTHROW(Exception, E_ARGS_INVALID, "Device " << _id << ": No free PRD slot");
     _cl[_tag * CL_DWORDS] += 1 << 16;
     uint32_t *p = _ct + ((_tag * (128 + MAX_PRD_COUNT * 16) + 0x80 + prd * 16) >> 2);
-    addr2phys(ds, reinterpret_cast<void*>(ds.virt()), p);
+    p[0] = addr;
+    p[1] = addr >> 32;
     p[3] = bytes - 1;
 }
 
@@ -183,7 +189,7 @@ void HostAHCIDevice::identify_drive(nre::DataSpace &buffer) {
     uint16_t *buf = reinterpret_cast<uint16_t*>(buffer.virt());
     memset(reinterpret_cast<void*>(buffer.virt()), 0, 512);
     set_command(0xec, 0, true);
-    add_prd(buffer, 512);
+    add_prd(translate(buffer, buffer.virt()), 512);
     size_t tag = start_command(nullptr, 0);
 
     // there is no IRQ on identify, as this is PIO data-in command
@@ -23,6 +23,7 @@
 #include <Assert.h>
 
 #include "Device.h"
+#include "DmaRuns.h"
 
 #define check3(X) { unsigned __res = X; if(__res) return __res; }
 
@@ -35,7 +36,8 @@
  */
 class HostAHCIDevice : public Device {
     static const size_t CL_DWORDS     = 8;
-    static const size_t MAX_PRD_COUNT = 64;
+    static const size_t MAX_PRD_COUNT = 256;
+    static const size_t MAX_PRD_BYTES = 1 << 22;
     // timeout in milliseconds
     static const uint FREQ            = 1000;
     static const uint TIMEOUT         = 200;
@@ -102,8 +104,8 @@ public:
         return port->sig;
     }
 
-    explicit HostAHCIDevice(Register *regs, uint disknr, size_t max_slots, bool dmar)
-        : Device(disknr), _sm(), _regs(regs), _clock(FREQ), _max_slots(max_slots), _dmar(dmar),
+    explicit HostAHCIDevice(Register *regs, uint disknr, size_t max_slots, DmaDomain *dom)
+        : Device(disknr), _sm(), _regs(regs), _clock(FREQ), _max_slots(max_slots), _dom(dom),
           _bufferds(512, nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::RW),
           _clds(max_slots * CL_DWORDS * 4, nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::RW),
           _ctds(max_slots * (32 + MAX_PRD_COUNT * 4) * 4,
@@ -149,21 +151,25 @@ private:
     }
 
     /**
-     * Translate a virtual to a physical address.
+     * Translate a virtual to a physical address (or to an I/O virtual address, if we're behind
+     * an IOMMU).
      */
+    uint64_t translate(const nre::DataSpace &ds, uintptr_t addr) {
+        if(!_dom)
+            return ds.phys() + (addr - ds.virt());
+        return _dom->iova(ds, addr);
+    }
     void addr2phys(const nre::DataSpace &ds, void *ptr, volatile uint32_t *dst) {
-        uintptr_t value = reinterpret_cast<uintptr_t>(ptr);
-        if(!_dmar)
-            value = ds.phys() + (value - ds.virt());
+        uint64_t value = translate(ds, reinterpret_cast<uintptr_t>(ptr));
         dst[0] = value;
-        dst[1] = 0; // support 64bit mode
+        dst[1] = value >> 32;
     }
 
     void init();
     void set_command(uint8_t command, uint64_t sector, bool read, uint count = 0, bool atapi = false,
                      uint pmp = 0, uint features = 0);
-    void add_dma(const nre::DataSpace &ds, size_t offset, uint count);
-    void add_prd(const nre::DataSpace &ds, uint count);
+    void add_dma(const nre::DataSpace &ds, const dma_type &dma);
+    void add_prd(uint64_t addr, size_t bytes);
     size_t start_command(nre::Producer<nre::Storage::Packet> *prod, ulong usertag);
     void identify_drive(nre::DataSpace &buffer);
     uint set_features(uint features, uint count = 0);
@@ -172,7 +178,7 @@ private:
     Register volatile *_regs;
     nre::Clock _clock;
     size_t _max_slots;
-    bool _dmar;
+    DmaDomain *_dom;
     nre::DataSpace _bufferds;
     nre::DataSpace _clds;
     nre::DataSpace _ctds;
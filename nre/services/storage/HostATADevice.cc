@@ -15,6 +15,7 @@
  */
 
 #include "HostATADevice.h"
+#include "DmaRuns.h"
 
 using namespace nre;
 
@@ -117,23 +118,36 @@ void HostATADevice::transferDMA(Operation op, const DataSpace &ds, const dma_typ
     // setup PRDTs
     ATA_LOGDETAIL("Setting PRDs");
     HostIDECtrl::PRD *prd = _ctrl.prdt();
-    for(auto it = dma.begin(); it != dma.end(); ) {
-        if(((static_cast<uint64_t>(ds.phys()) + it->offset + it->count) >= 0x100000000)) {
-            VTHROW(Exception, E_ARGS_INVALID,
-                   "Physical address " << fmt(ds.phys(), "p") << " is too large for DMA");
-        }
-
+    for(auto it = dma.begin(); it != dma.end(); ++it) {
         if(it->offset > ds.size() || it->offset + it->count > ds.size()) {
             VTHROW(Exception, E_ARGS_INVALID,
                    "Device " << _id << ": Invalid offset(" << it->offset <<")/"
                                                << "count(" << it->count << ")");
         }
-        prd->buffer = static_cast<uint32_t>(ds.phys() + it->offset);
-        prd->byteCount = it->count;
-        prd->last = ++it == dma.end();
-        prd++;
     }
 
+    // one PRD per physically contiguous run within the limits of the busmaster
+    DmaRuns runs(ds, dma, nullptr, HostIDECtrl::MAX_PRD_BYTES, HostIDECtrl::MAX_PRD_BYTES);
+    uint64_t addr;
+    size_t bytes;
+    size_t count = 0;
+    while(runs.next(addr, bytes)) {
+        if(addr + bytes > 0x100000000ULL) {
+            VTHROW(Exception, E_ARGS_INVALID,
+                   "Physical address " << fmt(addr, "p") << " is too large for DMA");
+        }
+        if(count == HostIDECtrl::MAX_PRDS)
+            VTHROW(Exception, E_ARGS_INVALID, "Device " << _id << ": Too many PRDs");
+
+        prd[count].buffer = static_cast<uint32_t>(addr);
+        // 0 means 64K
+        prd[count].byteCount = static_cast<uint16_t>(bytes);
+        prd[count].last = 0;
+        count++;
+    }
+    if(count > 0)
+        prd[count - 1].last = 1;
+
     // stop running transfers
     //ATA_LOGDETAIL("Stopping running transfers");
     //_ctrl.outbmrb(BMR_REG_COMMAND,0);
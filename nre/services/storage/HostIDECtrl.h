@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <arch/ExecEnv.h>
 #include <kobj/Ports.h>
 #include <kobj/Gsi.h>
 #include <kobj/GlobalThread.h>
@@ -44,6 +45,11 @@ public:
         uint16_t last : 1;
     } PACKED;
 
+    // the PRDT occupies one page, which ensures that it does not cross a 64K boundary
+    static const size_t MAX_PRDS        = nre::ExecEnv::PAGE_SIZE / sizeof(PRD);
+    // a PRD covers at most 64K and must not cross a 64K boundary
+    static const size_t MAX_PRD_BYTES   = 0x10000;
+
     explicit HostIDECtrl(uint id, uint irq, nre::Ports::port_t portbase, nre::Ports::port_t bmportbase,
                          uint bmportcount, bool dma = true);
     virtual ~HostIDECtrl() {
@@ -0,0 +1,432 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <stream/OStringStream.h>
+#include <util/Math.h>
+#include <Logging.h>
+#include <cstring>
+
+#include "HostNVMeCtrl.h"
+
+using namespace nre;
+
+HostNVMeCtrl::Queue::Queue(uint16_t id, size_t size, volatile uint32_t *sqdb,
+                           volatile uint32_t *cqdb)
+    : _sm(), _id(id), _size(size), _sqdb(sqdb), _cqdb(cqdb),
+      _sqds(size * sizeof(Command), DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+      _cqds(size * sizeof(Completion), DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+      _prpds(size * PAGE_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+      _sq(reinterpret_cast<Command*>(_sqds.virt())),
+      _cq(reinterpret_cast<volatile Completion*>(_cqds.virt())),
+      _sqtail(0), _cqhead(0), _phase(1), _gsi(), _freecount(0), _free(), _tags() {
+    assert(size <= IO_QUEUE_SIZE);
+    memset(_sq, 0, _sqds.size());
+    memset(const_cast<Completion*>(_cq), 0, _cqds.size());
+    // one entry has to stay free to distinguish a full from an empty queue
+    for(size_t i = size - 1; i > 0; --i)
+        _free[_freecount++] = i - 1;
+}
+
+HostNVMeCtrl::Command *HostNVMeCtrl::Queue::prepare(producer_type *prod, tag_type tag,
+                                                    uint16_t *cid) {
+    if(_freecount == 0)
+        VTHROW(Exception, E_CAPACITY, "NVMe queue " << _id << " is full");
+    *cid = _free[--_freecount];
+    _tags[*cid].prod = prod;
+    _tags[*cid].tag = tag;
+
+    Command *cmd = _sq + _sqtail;
+    memset(cmd, 0, sizeof(*cmd));
+    cmd->cdw0 = *cid << 16;
+    return cmd;
+}
+
+bool HostNVMeCtrl::Queue::fetch(Completion *res) {
+    volatile Completion *c = _cq + _cqhead;
+    uint16_t status = c->status;
+    if((status & 1) != _phase)
+        return false;
+
+    res->result = c->result;
+    res->sqhead = c->sqhead;
+    res->sqid = c->sqid;
+    res->cid = c->cid;
+    res->status = status;
+    if(++_cqhead == _size) {
+        _cqhead = 0;
+        _phase ^= 1;
+    }
+    return true;
+}
+
+void HostNVMeCtrl::Queue::irq() {
+    ScopedLock<UserSm> guard(&_sm);
+    Completion c;
+    bool found = false;
+    while(fetch(&c)) {
+        UserTag &ut = _tags[c.cid];
+        LOG(STORAGE_DETAIL, "Operation for user " << fmt(ut.tag, "x") << " is finished (queue "
+                                                  << _id << ", status " << fmt(c.status >> 1, "#x")
+                                                  << ")\n");
+        if(ut.prod)
+            ut.prod->produce(Storage::Packet(ut.tag, c.status >> 1));
+        release(c.cid);
+        found = true;
+    }
+    if(found)
+        consumed();
+}
+
+HostNVMeCtrl::HostNVMeCtrl(uint id, PCI &pci, BDF bdf, DmaDomain *dom)
+    : Controller(id), _bdf(bdf), _dom(dom), _clock(FREQ), _regs_ds(), _dbs_ds(), _regs(),
+      _dbstride(), _timeout(), _max_transfer(), _bufferds(PAGE_SIZE, DataSpaceDesc::ANONYMOUS,
+                                                          DataSpaceDesc::RW),
+      _gsi(), _admin(), _queuecount(0), _queues(), _cpuqueue(), _model(), _nscount(0), _ns() {
+    assert(!(~pci.conf_read(_bdf, 1) & 6) && "we need mem-decode and busmaster dma");
+    PCI::value_type bar = pci.conf_read(_bdf, PCI::BAR0);
+    assert(!(bar & PCI::BAR_IO) && "we need a memory bar");
+    uint64_t base = bar & PCI::BAR_MEM_MASK;
+    if((bar & PCI::BAR_TYPE_MASK) == PCI::BAR_TYPE_64B)
+        base |= static_cast<uint64_t>(pci.conf_read(_bdf, PCI::BAR0 + 1)) << 32;
+
+    _regs_ds = new DataSpace(PAGE_SIZE, DataSpaceDesc::LOCKED, DataSpaceDesc::RW, base);
+    _regs = reinterpret_cast<Register*>(_regs_ds->virt());
+
+    // the doorbells start at 0x1000 and are separated by the stride the controller tells us
+    _dbstride = 4 << (_regs->cap[1] & 0xF);
+    size_t dbsize = Math::round_up<size_t>((MAX_QUEUES + 1) * 2 * _dbstride, PAGE_SIZE);
+    _dbs_ds = new DataSpace(dbsize, DataSpaceDesc::LOCKED, DataSpaceDesc::RW, base + 0x1000);
+    // the timeout is specified in 500ms units
+    _timeout = Math::max<uint>(((_regs->cap[0] >> 24) & 0xFF) * 500, TIMEOUT);
+
+    LOG(STORAGE, "NVMe:" << " cap " << fmt(_regs->cap[1], "#x") << ":" << fmt(_regs->cap[0], "#x")
+                         << " version " << fmt(_regs->vs, "#x")
+                         << " dbstride " << _dbstride << "\n");
+
+    reset();
+    identify();
+    create_queues(pci);
+}
+
+HostNVMeCtrl::~HostNVMeCtrl() {
+    for(size_t i = 0; i < _queuecount; ++i)
+        delete _queues[i];
+    delete _admin;
+    delete _gsi;
+    delete _dbs_ds;
+    delete _regs_ds;
+}
+
+uint32_t HostNVMeCtrl::wait_timeout(volatile uint32_t *reg, uint32_t mask, uint32_t value) {
+    timevalue_t timeout = _clock.source_time(_timeout);
+    while(((*reg & mask) != value) && _clock.source_time() < timeout)
+        Util::pause();
+    return (*reg & mask) != value;
+}
+
+void HostNVMeCtrl::reset() {
+    // disable the controller and wait until it's idle
+    _regs->cc &= ~CC_EN;
+    if(wait_timeout(&_regs->csts, CSTS_RDY, 0))
+        VTHROW(Exception, E_TIMEOUT, "NVMe controller " << _bdf << " did not stop");
+
+    // setup the admin queue; it is polled, so that we don't need an interrupt for it
+    size_t mqes = (_regs->cap[0] & 0xFFFF) + 1;
+    size_t size = Math::min(ADMIN_QUEUE_SIZE, mqes);
+    _admin = new Queue(0, size, doorbell(0, false), doorbell(0, true));
+    uint64_t asq = addr2phys(_admin->sq(), _admin->sq().virt());
+    uint64_t acq = addr2phys(_admin->cq(), _admin->cq().virt());
+    _regs->aqa = (size - 1) | ((size - 1) << 16);
+    _regs->asq[0] = asq;
+    _regs->asq[1] = asq >> 32;
+    _regs->acq[0] = acq;
+    _regs->acq[1] = acq >> 32;
+
+    // we use 4K pages, the NVM command set and round-robin arbitration
+    _regs->cc = CC_IOSQES | CC_IOCQES | CC_EN;
+    if(wait_timeout(&_regs->csts, CSTS_RDY | CSTS_CFS, CSTS_RDY))
+        VTHROW(Exception, E_TIMEOUT, "NVMe controller " << _bdf << " did not become ready");
+}
+
+uint32_t HostNVMeCtrl::admin(Command &cmd, const DataSpace *buffer) {
+    ScopedLock<UserSm> guard(&_admin->sm());
+    uint16_t cid;
+    Command *c = _admin->prepare(nullptr, 0, &cid);
+    cmd.cdw0 |= cid << 16;
+    if(buffer)
+        cmd.prp1 = addr2phys(*buffer, buffer->virt());
+    memcpy(c, &cmd, sizeof(cmd));
+    _admin->submit();
+
+    Completion res;
+    timevalue_t timeout = _clock.source_time(_timeout);
+    while(!_admin->fetch(&res)) {
+        if(_clock.source_time() >= timeout) {
+            VTHROW(Exception, E_TIMEOUT,
+                   "NVMe admin command " << fmt(cmd.cdw0 & 0xFF, "#x") << " timed out");
+        }
+        Util::pause();
+    }
+    _admin->consumed();
+    _admin->release(res.cid);
+
+    if(res.status >> 1) {
+        VTHROW(Exception, E_FAILURE, "NVMe admin command " << fmt(cmd.cdw0 & 0xFF, "#x")
+                                     << " failed with " << fmt(res.status >> 1, "#x"));
+    }
+    return res.result;
+}
+
+void HostNVMeCtrl::identify() {
+    Command cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.cdw0 = ADMIN_IDENTIFY;
+    cmd.cdw10 = IDENTIFY_CONTROLLER;
+    admin(cmd, &_bufferds);
+
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(_bufferds.virt());
+    memcpy(_model, data + 24, sizeof(_model) - 1);
+    for(ssize_t i = sizeof(_model) - 2; i >= 0 && _model[i] == ' '; --i)
+        _model[i] = '\0';
+
+    // the max. data transfer size is given as a power of two in units of the min. page size
+    uint mps = PAGE_SIZE << ((_regs->cap[1] >> 16) & 0xF);
+    _max_transfer = PRPS_PER_CMD * PAGE_SIZE;
+    if(data[77])
+        _max_transfer = Math::min<size_t>(_max_transfer, mps << data[77]);
+
+    uint32_t nn = *reinterpret_cast<const uint32_t*>(data + 516);
+    LOG(STORAGE, "NVMe: model '" << _model << "' namespaces " << nn << " max. transfer "
+                                 << _max_transfer << "\n");
+
+    for(uint32_t nsid = 1; nsid <= Math::min<uint32_t>(nn, Storage::MAX_DRIVES); ++nsid) {
+        try {
+            identify_namespace(nsid);
+        }
+        catch(const Exception &e) {
+            LOG(STORAGE, "Unable to identify NVMe namespace " << nsid << ": " << e.msg() << "\n");
+        }
+    }
+}
+
+void HostNVMeCtrl::identify_namespace(uint32_t nsid) {
+    Command cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.cdw0 = ADMIN_IDENTIFY;
+    cmd.nsid = nsid;
+    cmd.cdw10 = IDENTIFY_NAMESPACE;
+    admin(cmd, &_bufferds);
+
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(_bufferds.virt());
+    uint64_t size = *reinterpret_cast<const uint64_t*>(data);
+    // inactive namespace
+    if(size == 0)
+        return;
+
+    uint flbas = data[26] & 0xF;
+    const uint32_t *lbaf = reinterpret_cast<const uint32_t*>(data + 128);
+    Namespace &ns = _ns[nsid - 1];
+    ns.sectors = size;
+    ns.sector_size = 1 << ((lbaf[flbas] >> 16) & 0xFF);
+    OStringStream os(ns.name, sizeof(ns.name));
+    os << _model << " n" << nsid;
+    _nscount++;
+
+    LOG(STORAGE, "NVMe namespace " << nsid << ": " << ns.name << " sectors " << ns.sectors
+                                   << " sector size " << ns.sector_size << "\n");
+}
+
+void HostNVMeCtrl::create_queues(PCI &pci) {
+    // we want one queue per CPU and need a separate MSI-X vector for each of them, because
+    // vector 0 belongs to the admin queue
+    size_t vectors = pci.msi_vectors(_bdf);
+    size_t count = Math::min(CPU::count(), MAX_QUEUES);
+    bool shared = vectors < 2;
+    if(!shared)
+        count = Math::min(count, vectors - 1);
+
+    // ask the controller how many queues it gives us
+    Command cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.cdw0 = ADMIN_SET_FEATURES;
+    cmd.cdw10 = FEATURE_QUEUE_COUNT;
+    cmd.cdw11 = (count - 1) | ((count - 1) << 16);
+    uint32_t res = admin(cmd);
+    count = Math::min<size_t>(count, (res & 0xFFFF) + 1);
+    count = Math::min<size_t>(count, (res >> 16) + 1);
+
+    size_t size = Math::min<size_t>(IO_QUEUE_SIZE, (_regs->cap[0] & 0xFFFF) + 1);
+    if(shared)
+        _gsi = pci.get_gsi(_bdf, 0);
+
+    auto cpu = CPU::begin();
+    for(uint16_t i = 0; i < count; ++i, ++cpu) {
+        uint16_t qid = i + 1;
+        Queue *q = new Queue(qid, size, doorbell(qid, false), doorbell(qid, true));
+        uint16_t vector = shared ? 0 : qid;
+
+        memset(&cmd, 0, sizeof(cmd));
+        cmd.cdw0 = ADMIN_CREATE_CQ;
+        cmd.prp1 = addr2phys(q->cq(), q->cq().virt());
+        cmd.cdw10 = qid | ((size - 1) << 16);
+        // physically contiguous, interrupts enabled
+        cmd.cdw11 = 0x3 | (vector << 16);
+        admin(cmd);
+
+        memset(&cmd, 0, sizeof(cmd));
+        cmd.cdw0 = ADMIN_CREATE_SQ;
+        cmd.prp1 = addr2phys(q->sq(), q->sq().virt());
+        cmd.cdw10 = qid | ((size - 1) << 16);
+        cmd.cdw11 = 0x1 | (qid << 16);
+        admin(cmd);
+
+        // deliver the interrupt of this queue to the CPU it belongs to
+        if(!shared) {
+            q->gsi(pci.get_gsi_msi(_bdf, vector, nullptr, cpu->log_id()));
+            start_thread(q->gsi(), cpu->log_id(), q, queue_thread);
+        }
+        _queues[_queuecount++] = q;
+    }
+    if(shared)
+        start_thread(_gsi, CPU::current().log_id(), this, gsi_thread);
+
+    // distribute the CPUs round-robin among the queues
+    size_t i = 0;
+    for(auto it = CPU::begin(); it != CPU::end(); ++it, ++i)
+        _cpuqueue[it->log_id()] = _queues[i % _queuecount];
+
+    LOG(STORAGE, "NVMe: created " << _queuecount << " I/O queues with " << size << " entries ("
+                                  << (shared ? "shared" : "per-queue") << " interrupts)\n");
+}
+
+void HostNVMeCtrl::start_thread(Gsi *gsi, cpu_t cpu, void *param, GlobalThread::startup_func func) {
+    char name[32];
+    OStringStream os(name, sizeof(name));
+    os << "nvme-gsi-" << gsi->gsi();
+    Reference<GlobalThread> gt = GlobalThread::create(func, cpu, name);
+    gt->set_tls<void*>(Thread::TLS_PARAM, param);
+    gt->start();
+}
+
+void HostNVMeCtrl::get_params(size_t drive, Storage::Parameter *params) const {
+    const Namespace &ns = _ns[idx(drive)];
+    assert(ns.sectors != 0);
+    params->flags = Storage::Parameter::FLAG_HARDDISK;
+    params->max_requests = _queues[0]->size() - 1;
+    memcpy(params->name, ns.name, sizeof(params->name));
+    params->sector_size = ns.sector_size;
+    params->sectors = ns.sectors;
+}
+
+void HostNVMeCtrl::flush(size_t drive, producer_type *prod, tag_type tag) {
+    Queue *q = queue();
+    ScopedLock<UserSm> guard(&q->sm());
+    uint16_t cid;
+    Command *cmd = q->prepare(prod, tag, &cid);
+    cmd->cdw0 |= IO_FLUSH;
+    cmd->nsid = idx(drive) + 1;
+    q->submit();
+}
+
+void HostNVMeCtrl::readwrite(size_t drive, producer_type *prod, tag_type tag, const DataSpace &ds,
+                             sector_type sector, const dma_type &dma, bool write) {
+    const Namespace &ns = _ns[idx(drive)];
+    size_t length = dma.bytecount();
+    if(length == 0 || (length % ns.sector_size) != 0 || length > _max_transfer ||
+       length / ns.sector_size > 0x10000) {
+        VTHROW(Exception, E_ARGS_INVALID,
+               "Drive " << drive << ": Invalid transfer size (" << length << ")");
+    }
+
+    Queue *q = queue();
+    ScopedLock<UserSm> guard(&q->sm());
+    uint16_t cid;
+    Command *cmd = q->prepare(prod, tag, &cid);
+    try {
+        add_prps(q, cid, cmd, ds, dma);
+    }
+    catch(...) {
+        q->release(cid);
+        throw;
+    }
+    cmd->cdw0 |= write ? IO_WRITE : IO_READ;
+    cmd->nsid = idx(drive) + 1;
+    cmd->cdw10 = sector;
+    cmd->cdw11 = static_cast<uint64_t>(sector) >> 32;
+    cmd->cdw12 = length / ns.sector_size - 1;
+    q->submit();
+}
+
+void HostNVMeCtrl::add_prps(Queue *q, uint16_t cid, Command *cmd, const DataSpace &ds,
+                            const dma_type &dma) {
+    // the first entry may start anywhere, but all others have to start at a page boundary and
+    // all but the last one have to end at a page boundary
+    uint64_t *list = q->prp_list(cid);
+    for(auto it = dma.begin(); it != dma.end(); ++it) {
+        if(it->offset > ds.size() || it->offset + it->count > ds.size()) {
+            VTHROW(Exception, E_ARGS_INVALID,
+                   "Controller " << _id << ": Invalid offset(" << it->offset << ")/"
+                                 << "count(" << it->count << ")");
+        }
+    }
+
+    // every page is looked up on its own, so that the buffer does not need to be contiguous
+    DmaRuns runs(ds, dma, _dom, PAGE_SIZE, PAGE_SIZE);
+    uint64_t addr;
+    size_t bytes;
+    size_t pages = 0;
+    bool aligned_end = true;
+    while(runs.next(addr, bytes)) {
+        if(pages > 0 && ((addr & (PAGE_SIZE - 1)) || !aligned_end)) {
+            VTHROW(Exception, E_ARGS_INVALID,
+                   "Controller " << _id << ": DMA run " << fmt(addr, "#x")
+                                 << " not page aligned");
+        }
+
+        if(pages == 0)
+            cmd->prp1 = addr;
+        else {
+            if(pages > PRPS_PER_CMD)
+                VTHROW(Exception, E_ARGS_INVALID, "Controller " << _id << ": Too many PRPs");
+            list[pages - 1] = addr;
+        }
+        aligned_end = ((addr + bytes) & (PAGE_SIZE - 1)) == 0;
+        pages++;
+    }
+
+    // two pages are described directly, more via the list
+    if(pages == 2)
+        cmd->prp2 = list[0];
+    else if(pages > 2)
+        cmd->prp2 = addr2phys(q->prps(), reinterpret_cast<uintptr_t>(list));
+}
+
+void HostNVMeCtrl::gsi_thread(void*) {
+    HostNVMeCtrl *nc = Thread::current()->get_tls<HostNVMeCtrl*>(Thread::TLS_PARAM);
+    while(1) {
+        nc->_gsi->down();
+        for(size_t i = 0; i < nc->_queuecount; ++i)
+            nc->_queues[i]->irq();
+    }
+}
+
+void HostNVMeCtrl::queue_thread(void*) {
+    Queue *q = Thread::current()->get_tls<Queue*>(Thread::TLS_PARAM);
+    while(1) {
+        q->gsi()->down();
+        q->irq();
+    }
+}
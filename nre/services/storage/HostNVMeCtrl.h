@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/ExecEnv.h>
+#include <kobj/Gsi.h>
+#include <kobj/GlobalThread.h>
+#include <kobj/UserSm.h>
+#include <mem/DataSpace.h>
+#include <util/PCI.h>
+#include <util/Clock.h>
+#include <util/ScopedLock.h>
+#include <Assert.h>
+#include <Compiler.h>
+#include <CPU.h>
+
+#include "Controller.h"
+#include "DmaRuns.h"
+
+/**
+ * A driver for NVMe controllers. Besides the admin queue, it creates one I/O submission/completion
+ * queue pair per CPU, each with its own MSI-X vector that is delivered to that CPU. Requests are
+ * always submitted to the queue of the CPU they are issued on, so that neither the submission nor
+ * the completion has to cross cores. If the controller supports less queues or vectors than we
+ * have CPUs, the queues are shared round-robin.
+ *
+ * State: testing
+ * Features: Namespaces, PRP lists, per-CPU queues
+ */
+class HostNVMeCtrl : public Controller {
+    static const size_t ADMIN_QUEUE_SIZE    = 16;
+    static const size_t IO_QUEUE_SIZE       = 64;
+    static const size_t MAX_QUEUES          = 16;
+    static const size_t PAGE_SIZE           = nre::ExecEnv::PAGE_SIZE;
+    static const size_t PRPS_PER_CMD        = PAGE_SIZE / sizeof(uint64_t);
+    // timeout for admin commands in milliseconds
+    static const uint FREQ                  = 1000;
+    static const uint TIMEOUT               = 1000;
+
+    enum {
+        CC_EN                               = 1 << 0,
+        CC_IOSQES                           = 6 << 16,  // 64 byte submission entries
+        CC_IOCQES                           = 4 << 20,  // 16 byte completion entries
+        CSTS_RDY                            = 1 << 0,
+        CSTS_CFS                            = 1 << 1,
+    };
+
+    enum AdminCommand {
+        ADMIN_CREATE_SQ                     = 0x01,
+        ADMIN_CREATE_CQ                     = 0x05,
+        ADMIN_IDENTIFY                      = 0x06,
+        ADMIN_SET_FEATURES                  = 0x09,
+    };
+
+    enum IOCommand {
+        IO_FLUSH                            = 0x00,
+        IO_WRITE                            = 0x01,
+        IO_READ                             = 0x02,
+    };
+
+    enum {
+        IDENTIFY_NAMESPACE                  = 0x0,
+        IDENTIFY_CONTROLLER                 = 0x1,
+        FEATURE_QUEUE_COUNT                 = 0x7,
+    };
+
+    /**
+     * The register set of an NVMe controller. The 64-bit registers are split into two dwords to
+     * access them with 32-bit accesses only.
+     */
+    struct Register {
+        volatile uint32_t cap[2];   // controller capabilities
+        volatile uint32_t vs;       // version
+        volatile uint32_t intms;    // interrupt mask set
+        volatile uint32_t intmc;    // interrupt mask clear
+        volatile uint32_t cc;       // controller configuration
+        volatile uint32_t : 32;     // reserved
+        volatile uint32_t csts;     // controller status
+        volatile uint32_t nssr;     // NVM subsystem reset
+        volatile uint32_t aqa;      // admin queue attributes
+        volatile uint32_t asq[2];   // admin submission queue base address
+        volatile uint32_t acq[2];   // admin completion queue base address
+    };
+
+    /**
+     * A submission queue entry
+     */
+    struct Command {
+        uint32_t cdw0;              // opcode and command id
+        uint32_t nsid;
+        uint32_t cdw2;
+        uint32_t cdw3;
+        uint64_t mptr;
+        uint64_t prp1;
+        uint64_t prp2;
+        uint32_t cdw10;
+        uint32_t cdw11;
+        uint32_t cdw12;
+        uint32_t cdw13;
+        uint32_t cdw14;
+        uint32_t cdw15;
+    } PACKED;
+
+    /**
+     * A completion queue entry
+     */
+    struct Completion {
+        uint32_t result;
+        uint32_t : 32;
+        uint16_t sqhead;
+        uint16_t sqid;
+        uint16_t cid;
+        uint16_t status;            // bit 0 is the phase tag
+    } PACKED;
+
+    struct UserTag {
+        producer_type *prod;
+        tag_type tag;
+    };
+
+    /**
+     * A submission/completion queue pair. All operations have to be done with sm() held.
+     */
+    class Queue {
+    public:
+        explicit Queue(uint16_t id, size_t size, volatile uint32_t *sqdb, volatile uint32_t *cqdb);
+        ~Queue() {
+            delete _gsi;
+        }
+
+        uint16_t id() const {
+            return _id;
+        }
+        size_t size() const {
+            return _size;
+        }
+        nre::UserSm &sm() {
+            return _sm;
+        }
+        nre::Gsi *gsi() const {
+            return _gsi;
+        }
+        void gsi(nre::Gsi *gsi) {
+            _gsi = gsi;
+        }
+        const nre::DataSpace &sq() const {
+            return _sqds;
+        }
+        const nre::DataSpace &cq() const {
+            return _cqds;
+        }
+        const nre::DataSpace &prps() const {
+            return _prpds;
+        }
+
+        /**
+         * @param cid the command id
+         * @return the page that holds the PRP list for the given command
+         */
+        uint64_t *prp_list(uint16_t cid) {
+            return reinterpret_cast<uint64_t*>(_prpds.virt() + cid * PAGE_SIZE);
+        }
+
+        /**
+         * Allocates a command id and returns the zeroed submission entry for it. The command is
+         * not visible to the controller until submit() is called.
+         *
+         * @param prod the producer to notify when the command is finished (may be null)
+         * @param tag the tag to use for the notify
+         * @param cid will be set to the allocated command id
+         * @return the submission entry
+         * @throws Exception if the queue is full
+         */
+        Command *prepare(producer_type *prod, tag_type tag, uint16_t *cid);
+        /**
+         * Releases the given command id again, without submitting it
+         */
+        void release(uint16_t cid) {
+            _tags[cid].prod = nullptr;
+            _free[_freecount++] = cid;
+        }
+        /**
+         * Hands the prepared command over to the controller
+         */
+        void submit() {
+            _sqtail = (_sqtail + 1) % _size;
+            *_sqdb = _sqtail;
+        }
+
+        /**
+         * Fetches the next completion, if there is any.
+         *
+         * @param res where to store it
+         * @return true if there was a completion
+         */
+        bool fetch(Completion *res);
+        /**
+         * Tells the controller that all fetched completions have been consumed
+         */
+        void consumed() {
+            *_cqdb = _cqhead;
+        }
+
+        /**
+         * Handles all completions and notifies the producers of the finished commands
+         */
+        void irq();
+
+    private:
+        nre::UserSm _sm;
+        uint16_t _id;
+        size_t _size;
+        volatile uint32_t *_sqdb;
+        volatile uint32_t *_cqdb;
+        nre::DataSpace _sqds;
+        nre::DataSpace _cqds;
+        nre::DataSpace _prpds;
+        Command *_sq;
+        volatile Completion *_cq;
+        size_t _sqtail;
+        size_t _cqhead;
+        uint16_t _phase;
+        nre::Gsi *_gsi;
+        size_t _freecount;
+        uint16_t _free[IO_QUEUE_SIZE];
+        UserTag _tags[IO_QUEUE_SIZE];
+    };
+
+    struct Namespace {
+        sector_type sectors;
+        size_t sector_size;
+        char name[64];
+    };
+
+public:
+    explicit HostNVMeCtrl(uint id, nre::PCI &pci, nre::BDF bdf, DmaDomain *dom);
+    virtual ~HostNVMeCtrl();
+
+    virtual bool exists(size_t drive) const {
+        return _ns[idx(drive)].sectors != 0;
+    }
+    virtual size_t drive_count() const {
+        return _nscount;
+    }
+    virtual void get_params(size_t drive, nre::Storage::Parameter *params) const;
+
+    virtual void flush(size_t drive, producer_type *prod, tag_type tag);
+    virtual void read(size_t drive, producer_type *prod, tag_type tag, const nre::DataSpace &ds,
+                      sector_type sector, const dma_type &dma) {
+        readwrite(drive, prod, tag, ds, sector, dma, false);
+    }
+    virtual void write(size_t drive, producer_type *prod, tag_type tag, const nre::DataSpace &ds,
+                       sector_type sector, const dma_type &dma) {
+        readwrite(drive, prod, tag, ds, sector, dma, true);
+    }
+
+private:
+    static size_t idx(size_t drive) {
+        return drive % nre::Storage::MAX_DRIVES;
+    }
+    Queue *queue() const {
+        return _cpuqueue[nre::CPU::current().log_id()];
+    }
+    volatile uint32_t *doorbell(uint16_t qid, bool cq) const {
+        return reinterpret_cast<volatile uint32_t*>(
+            _dbs_ds->virt() + (2 * qid + (cq ? 1 : 0)) * _dbstride);
+    }
+
+    /**
+     * Translate a virtual to a physical address (or to an I/O virtual address, if we're behind
+     * an IOMMU).
+     */
+    uint64_t addr2phys(const nre::DataSpace &ds, uintptr_t addr) const {
+        if(!_dom)
+            return ds.phys() + (addr - ds.virt());
+        return _dom->iova(ds, addr);
+    }
+
+    void reset();
+    void identify();
+    void create_queues(nre::PCI &pci);
+    void identify_namespace(uint32_t nsid);
+    uint32_t admin(Command &cmd, const nre::DataSpace *buffer = nullptr);
+    void readwrite(size_t drive, producer_type *prod, tag_type tag, const nre::DataSpace &ds,
+                   sector_type sector, const dma_type &dma, bool write);
+    void add_prps(Queue *q, uint16_t cid, Command *cmd, const nre::DataSpace &ds,
+                  const dma_type &dma);
+    uint32_t wait_timeout(volatile uint32_t *reg, uint32_t mask, uint32_t value);
+    void start_thread(nre::Gsi *gsi, cpu_t cpu, void *param, nre::GlobalThread::startup_func func);
+    static void gsi_thread(void*);
+    static void queue_thread(void*);
+
+    nre::BDF _bdf;
+    DmaDomain *_dom;
+    nre::Clock _clock;
+    nre::DataSpace *_regs_ds;
+    nre::DataSpace *_dbs_ds;
+    Register *_regs;
+    size_t _dbstride;
+    uint _timeout;
+    size_t _max_transfer;
+    nre::DataSpace _bufferds;
+    nre::Gsi *_gsi;
+    Queue *_admin;
+    size_t _queuecount;
+    Queue *_queues[MAX_QUEUES];
+    Queue *_cpuqueue[nre::Hip::MAX_CPUS];
+    char _model[41];
+    size_t _nscount;
+    Namespace _ns[nre::Storage::MAX_DRIVES];
+};
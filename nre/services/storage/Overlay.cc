@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+#include <kobj/GlobalThread.h>
+#include <ipc/Consumer.h>
+#include <mem/PagePool.h>
+#include <util/ScopedLock.h>
+
+#include "Overlay.h"
+
+using namespace nre;
+
+/**
+ * Hands out the extents of a scratch drive to the overlays
+ */
+class ScratchSpace {
+public:
+    explicit ScratchSpace(size_t drive, Storage::sector_type sectors, size_t blksecs)
+        : _drive(drive), _sectors(sectors), _extsize(Overlay::EXTENT_BLOCKS * blksecs), _next(),
+          _free(), _sm() {
+    }
+
+    size_t drive() const {
+        return _drive;
+    }
+
+    Overlay::Extent *alloc() {
+        ScopedLock<UserSm> guard(&_sm);
+        if(_free.length() > 0) {
+            Overlay::Extent *e = &*_free.begin();
+            _free.remove(e);
+            return e;
+        }
+        if(_next + _extsize > _sectors)
+            VTHROW(Exception, E_CAPACITY, "Scratch drive " << _drive << " is full");
+        Overlay::Extent *e = new Overlay::Extent(_next);
+        _next += _extsize;
+        return e;
+    }
+    void free(Overlay::Extent *e) {
+        ScopedLock<UserSm> guard(&_sm);
+        _free.append(e);
+    }
+
+private:
+    size_t _drive;
+    Storage::sector_type _sectors;
+    Storage::sector_type _extsize;
+    Storage::sector_type _next;
+    SList<Overlay::Extent> _free;
+    UserSm _sm;
+};
+
+/**
+ * Since a command of a client may be split into multiple commands for the base and the scratch
+ * drive, we let the controllers report the completions to us and notify the client as soon as
+ * all parts are finished. There is one ring per drive, because the completions of a drive are
+ * produced by one thread only.
+ */
+class Completions {
+    struct Pending {
+        Overlay *overlay;
+        Producer<Storage::Packet> *prod;
+        Storage::tag_type tag;
+        uint status;
+        size_t refs;
+        // the sectors that become valid in the overlay if the command succeeds
+        Storage::sector_type sector;
+        size_t count;
+    };
+
+    class Ring {
+    public:
+        explicit Ring(Sm &sm)
+            : ds(ExecEnv::PAGE_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW), prod(ds, sm, true),
+              cons(ds, sm, false) {
+        }
+
+        DataSpace ds;
+        Producer<Storage::Packet> prod;
+        Consumer<Storage::Packet> cons;
+    };
+
+    static const size_t MAX_RINGS   = Storage::MAX_CONTROLLER * Storage::MAX_DRIVES;
+
+public:
+    static const size_t MAX_PENDING = 128;
+
+    explicit Completions() : _sm(), _ringsm(0), _rings(), _pending(), _free(), _freecount() {
+        for(size_t i = 0; i < MAX_PENDING; ++i)
+            _free[_freecount++] = i;
+    }
+
+    Producer<Storage::Packet> *producer(size_t drive) {
+        ScopedLock<UserSm> guard(&_sm);
+        if(!_rings[drive])
+            _rings[drive] = new Ring(_ringsm);
+        return &_rings[drive]->prod;
+    }
+
+    /**
+     * Starts a new client command. The returned tag holds one reference, which has to be dropped
+     * via done() or cancel() as soon as all parts have been issued. If <count> is not zero, the
+     * sectors <sector>..<sector>+<count>-1 are marked valid in the overlay as soon as all parts
+     * have been finished successfully.
+     */
+    Storage::tag_type begin(Overlay *ov, Producer<Storage::Packet> *prod, Storage::tag_type tag,
+                            Storage::sector_type sector = 0, size_t count = 0) {
+        ScopedLock<UserSm> guard(&_sm);
+        if(_freecount == 0)
+            throw Exception(E_CAPACITY, "Too many overlay commands in flight");
+        Storage::tag_type itag = _free[--_freecount];
+        Pending &p = _pending[itag];
+        p.overlay = ov;
+        p.prod = prod;
+        p.tag = tag;
+        p.status = 0;
+        p.refs = 1;
+        p.sector = sector;
+        p.count = count;
+        return itag;
+    }
+    void add(Storage::tag_type itag) {
+        ScopedLock<UserSm> guard(&_sm);
+        _pending[itag].refs++;
+    }
+    void cancel(Storage::tag_type itag) {
+        {
+            ScopedLock<UserSm> guard(&_sm);
+            _pending[itag].prod = nullptr;
+        }
+        done(itag, 0);
+    }
+    void done(Storage::tag_type itag, uint status) {
+        Pending p;
+        {
+            ScopedLock<UserSm> guard(&_sm);
+            Pending &cur = _pending[itag];
+            if(status && !cur.status)
+                cur.status = status;
+            if(--cur.refs > 0)
+                return;
+            p = cur;
+            _free[_freecount++] = itag;
+        }
+        if(p.prod) {
+            if(!p.status && p.count)
+                p.overlay->validate(p.sector, p.count);
+            p.overlay->complete(p.prod, p.tag, p.status);
+        }
+    }
+
+    void run() {
+        while(1) {
+            _ringsm.zero();
+            for(size_t i = 0; i < MAX_RINGS; ++i) {
+                Ring *r = _rings[i];
+                while(r && r->cons.has_data()) {
+                    Storage::Packet *pk = r->cons.get();
+                    Storage::tag_type itag = pk->tag;
+                    uint status = pk->status;
+                    r->cons.next();
+                    done(itag, status);
+                }
+            }
+        }
+    }
+
+private:
+    UserSm _sm;
+    Sm _ringsm;
+    Ring *volatile _rings[MAX_RINGS];
+    Pending _pending[MAX_PENDING];
+    Storage::tag_type _free[MAX_PENDING];
+    size_t _freecount;
+};
+
+static Completions *comps;
+static PagePool *pages;
+static ScratchSpace *scratches[Storage::MAX_CONTROLLER * Storage::MAX_DRIVES];
+static UserSm scratchsm;
+
+static void completion_thread(void*) {
+    comps->run();
+}
+
+void Overlay::init() {
+    comps = new Completions();
+    pages = new PagePool();
+    GlobalThread::create(completion_thread, CPU::current().log_id(), "storage-overlay")->start();
+}
+
+Overlay::Overlay(ControllerMng &mng, size_t base, size_t scratch)
+    : _mng(mng), _base(base), _scratch(), _params(), _blksecs(), _blocks(), _extents(), _next(),
+      _end(), _sm(), _prodsm() {
+    mng.get(base / Storage::MAX_DRIVES)->get_params(base, &_params);
+    size_t secsize = _params.sector_size;
+    if(secsize == 0 || secsize > ExecEnv::PAGE_SIZE || (ExecEnv::PAGE_SIZE % secsize) ||
+       ExecEnv::PAGE_SIZE / secsize > sizeof(uint32_t) * 8)
+        VTHROW(Exception, E_ARGS_INVALID, "Sector size " << secsize << " is not supported");
+    _blksecs = ExecEnv::PAGE_SIZE / secsize;
+
+    if(scratch != RAM) {
+        size_t ctrl = scratch / Storage::MAX_DRIVES;
+        if(scratch == base || !mng.exists(ctrl) || !mng.get(ctrl)->exists(scratch))
+            VTHROW(Exception, E_NOT_FOUND, "Scratch drive " << scratch << " is not usable");
+        Storage::Parameter sparams;
+        mng.get(ctrl)->get_params(scratch, &sparams);
+        if(sparams.sector_size != secsize) {
+            VTHROW(Exception, E_ARGS_INVALID,
+                   "Sector sizes of base and scratch drive differ (" << secsize << " vs. "
+                                                                     << sparams.sector_size << ")");
+        }
+
+        ScopedLock<UserSm> guard(&scratchsm);
+        if(!scratches[scratch])
+            scratches[scratch] = new ScratchSpace(scratch, sparams.sectors, _blksecs);
+        _scratch = scratches[scratch];
+    }
+}
+
+Overlay::~Overlay() {
+    for(auto it = _blocks.begin(); it != _blocks.end(); ) {
+        Block *b = &*it++;
+        if(!_scratch)
+            pages->free(b->slot);
+        delete b;
+    }
+    for(auto it = _extents.begin(); it != _extents.end(); ) {
+        Extent *e = &*it++;
+        _scratch->free(e);
+    }
+}
+
+void Overlay::flush(producer_type *prod, tag_type tag) {
+    tag_type itag = comps->begin(this, prod, tag);
+    try {
+        // the RAM is always up to date
+        if(_scratch) {
+            size_t drive = _scratch->drive();
+            comps->add(itag);
+            try {
+                _mng.get(drive / nre::Storage::MAX_DRIVES)->flush(drive, comps->producer(drive), itag);
+            }
+            catch(...) {
+                comps->done(itag, 0);
+                throw;
+            }
+        }
+    }
+    catch(...) {
+        comps->cancel(itag);
+        throw;
+    }
+    comps->done(itag, 0);
+}
+
+void Overlay::check_range(sector_type sector, size_t count) const {
+    if(sector + count < sector || sector + count > _params.sectors) {
+        VTHROW(Exception, E_ARGS_INVALID,
+               "Sectors " << sector << ".." << (sector + count) << " are out of bounds");
+    }
+}
+
+void Overlay::read(producer_type *prod, tag_type tag, const DataSpace &ds, sector_type sector,
+                   const dma_type &dma) {
+    size_t count = dma.bytecount() / _params.sector_size;
+    check_range(sector, count);
+    tag_type itag = comps->begin(this, prod, tag);
+    try {
+        ScopedLock<UserSm> guard(&_sm);
+        size_t secsize = _params.sector_size;
+        Run run = Run();
+        for(size_t i = 0; i < count; ++i) {
+            sector_type s = sector + i;
+            size_t idx = s % _blksecs;
+            Block *b = _blocks.find(s / _blksecs);
+            size_t drive = _base;
+            sector_type dsec = s;
+            if(b && (b->valid & (1U << idx))) {
+                // sectors in RAM can be copied directly
+                if(!_scratch) {
+                    dma.out(reinterpret_cast<void*>(static_cast<uintptr_t>(b->slot) + idx * secsize), secsize, i * secsize, ds);
+                    continue;
+                }
+                drive = _scratch->drive();
+                dsec = b->slot + idx;
+            }
+
+            size_t off = i * secsize;
+            if(run.count && (run.drive != drive || run.sector + run.count != dsec ||
+                             run.offset + run.count * secsize != off))
+                submit(run, false, itag, ds, dma);
+            if(!run.count) {
+                run.drive = drive;
+                run.sector = dsec;
+                run.offset = off;
+            }
+            run.count++;
+        }
+        submit(run, false, itag, ds, dma);
+    }
+    catch(...) {
+        comps->cancel(itag);
+        throw;
+    }
+    comps->done(itag, 0);
+}
+
+void Overlay::write(producer_type *prod, tag_type tag, const DataSpace &ds, sector_type sector,
+                    const dma_type &dma) {
+    size_t count = dma.bytecount() / _params.sector_size;
+    check_range(sector, count);
+    // on the scratch drive, the sectors become valid when the write has succeeded. before that,
+    // reads still go to the base drive
+    tag_type itag = comps->begin(this, prod, tag, sector, _scratch ? count : 0);
+    try {
+        ScopedLock<UserSm> guard(&_sm);
+        size_t secsize = _params.sector_size;
+        Run run = Run();
+        for(size_t i = 0; i < count; ++i) {
+            sector_type s = sector + i;
+            size_t idx = s % _blksecs;
+            Block *b = get_block(s / _blksecs);
+            if(!_scratch) {
+                b->valid |= 1U << idx;
+                dma.in(reinterpret_cast<void*>(static_cast<uintptr_t>(b->slot) + idx * secsize), secsize, i * secsize, ds);
+                continue;
+            }
+
+            sector_type dsec = b->slot + idx;
+            size_t off = i * secsize;
+            if(run.count && (run.sector + run.count != dsec || run.offset + run.count * secsize != off))
+                submit(run, true, itag, ds, dma);
+            if(!run.count) {
+                run.drive = _scratch->drive();
+                run.sector = dsec;
+                run.offset = off;
+            }
+            run.count++;
+        }
+        submit(run, true, itag, ds, dma);
+    }
+    catch(...) {
+        comps->cancel(itag);
+        throw;
+    }
+    comps->done(itag, 0);
+}
+
+void Overlay::validate(sector_type sector, size_t count) {
+    ScopedLock<UserSm> guard(&_sm);
+    for(size_t i = 0; i < count; ++i) {
+        sector_type s = sector + i;
+        Block *b = _blocks.find(s / _blksecs);
+        b->valid |= 1U << (s % _blksecs);
+    }
+}
+
+void Overlay::complete(producer_type *prod, tag_type tag, uint status) {
+    // the completions are produced by the portal threads and the completion thread
+    ScopedLock<UserSm> guard(&_prodsm);
+    prod->produce(Storage::Packet(tag, status));
+}
+
+Overlay::Block *Overlay::get_block(sector_type no) {
+    Block *b = _blocks.find(no);
+    if(!b) {
+        b = new Block(no, alloc_slot());
+        _blocks.insert(b);
+    }
+    return b;
+}
+
+Overlay::sector_type Overlay::alloc_slot() {
+    if(!_scratch)
+        return pages->alloc();
+
+    if(_next == _end) {
+        Extent *e = _scratch->alloc();
+        _extents.append(e);
+        _next = e->start;
+        _end = _next + EXTENT_BLOCKS * _blksecs;
+    }
+    sector_type slot = _next;
+    _next += _blksecs;
+    return slot;
+}
+
+void Overlay::submit(Run &run, bool write, tag_type itag, const DataSpace &ds, const dma_type &dma) {
+    if(run.count == 0)
+        return;
+
+    dma_type sub;
+    slice(dma, run.offset, run.count * _params.sector_size, sub);
+    Controller *ctrl = _mng.get(run.drive / nre::Storage::MAX_DRIVES);
+    comps->add(itag);
+    try {
+        if(write)
+            ctrl->write(run.drive, comps->producer(run.drive), itag, ds, run.sector, sub);
+        else
+            ctrl->read(run.drive, comps->producer(run.drive), itag, ds, run.sector, sub);
+    }
+    catch(...) {
+        comps->done(itag, 0);
+        throw;
+    }
+    run.count = 0;
+}
+
+void Overlay::slice(const dma_type &dma, size_t offset, size_t len, dma_type &sub) {
+    for(auto it = dma.begin(); it != dma.end() && len > 0; ++it) {
+        if(offset >= it->count) {
+            offset -= it->count;
+            continue;
+        }
+        size_t amount = Math::min(it->count - offset, len);
+        sub.push(DMADesc(it->offset + offset, amount));
+        len -= amount;
+        offset = 0;
+    }
+}
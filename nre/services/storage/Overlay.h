@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+#pragma once
+
+#include <kobj/UserSm.h>
+#include <collection/SListTreap.h>
+#include <services/Storage.h>
+
+#include "ControllerMng.h"
+
+class ScratchSpace;
+
+/**
+ * A virtual drive that is layered over a read-only base drive. The base drive is never written.
+ * Instead, all writes are redirected into an overlay that is private to this virtual drive and
+ * reads are served from the overlay for all sectors that have been written and from the base
+ * drive for all others. Thus, many clients can share one base image, while each of them sees its
+ * own modifications only.
+ * The overlay manages the sectors in blocks of one page and stores these blocks either in RAM or
+ * on a scratch drive.
+ */
+class Overlay {
+    friend class ScratchSpace;
+
+    typedef nre::Storage::sector_type sector_type;
+    typedef nre::Storage::tag_type tag_type;
+    typedef nre::Producer<nre::Storage::Packet> producer_type;
+    typedef nre::DMADescList<nre::Storage::MAX_DMA_DESCS> dma_type;
+
+    /**
+     * A block in the overlay with a mask of the sectors that have been written
+     */
+    class Block : public nre::SListTreapNode<sector_type> {
+    public:
+        explicit Block(sector_type no, sector_type slot)
+            : nre::SListTreapNode<sector_type>(no), slot(slot), valid() {
+        }
+
+        // the page in RAM or the first sector on the scratch drive
+        sector_type slot;
+        uint32_t valid;
+    };
+
+    /**
+     * A contiguous range of sectors on the drive, that is transferred with one command
+     */
+    struct Run {
+        size_t drive;
+        sector_type sector;
+        size_t offset;
+        size_t count;
+    };
+
+    /**
+     * A range of EXTENT_BLOCKS blocks on the scratch drive
+     */
+    class Extent : public nre::SListItem {
+    public:
+        explicit Extent(sector_type start) : nre::SListItem(), start(start) {
+        }
+
+        sector_type start;
+    };
+
+public:
+    /**
+     * Indicates that the overlay should be kept in RAM
+     */
+    static const size_t RAM             = nre::Storage::OVERLAY_RAM;
+    /**
+     * The number of blocks that are reserved on the scratch drive at once
+     */
+    static const size_t EXTENT_BLOCKS   = 256;
+
+    /**
+     * Starts the thread that collects the completions of the commands that are issued on behalf of
+     * the overlays. Has to be called once at startup.
+     */
+    static void init();
+
+    /**
+     * Creates an empty overlay for the base drive <base>
+     *
+     * @param mng the controller manager
+     * @param base the base drive
+     * @param scratch the drive to store the overlay on or RAM
+     * @throws Exception if the scratch drive does not exist or is not suitable
+     */
+    explicit Overlay(ControllerMng &mng, size_t base, size_t scratch);
+    /**
+     * Releases all blocks of the overlay
+     */
+    ~Overlay();
+
+    /**
+     * @return the parameters of the virtual drive
+     */
+    const nre::Storage::Parameter &params() const {
+        return _params;
+    }
+    /**
+     * @return the number of blocks in the overlay
+     */
+    size_t blocks() const {
+        return _blocks.length();
+    }
+
+    /**
+     * Flushes the overlay, if it is stored on a scratch drive
+     *
+     * @param prod the producer to notify when the command is finished
+     * @param tag the tag to use for the notify
+     */
+    void flush(producer_type *prod, tag_type tag);
+    /**
+     * Reads the sectors starting at <sector> into <ds>. See Controller::read().
+     */
+    void read(producer_type *prod, tag_type tag, const nre::DataSpace &ds, sector_type sector,
+              const dma_type &dma);
+    /**
+     * Writes the sectors starting at <sector> from <ds> into the overlay. See Controller::write().
+     */
+    void write(producer_type *prod, tag_type tag, const nre::DataSpace &ds, sector_type sector,
+               const dma_type &dma);
+
+    /**
+     * Marks the sectors <sector>..<sector>+<count>-1 as valid, i.e. reads are served from the
+     * overlay afterwards. This is done as soon as they have been written to the scratch drive.
+     */
+    void validate(sector_type sector, size_t count);
+    /**
+     * Notifies the client about the completion of the command with tag <tag>
+     */
+    void complete(producer_type *prod, tag_type tag, uint status);
+
+private:
+    void check_range(sector_type sector, size_t count) const;
+    Block *get_block(sector_type no);
+    sector_type alloc_slot();
+    void submit(Run &run, bool write, tag_type itag, const nre::DataSpace &ds, const dma_type &dma);
+    static void slice(const dma_type &dma, size_t offset, size_t len, dma_type &sub);
+
+    Overlay(const Overlay&);
+    Overlay& operator=(const Overlay&);
+
+    ControllerMng &_mng;
+    size_t _base;
+    ScratchSpace *_scratch;
+    nre::Storage::Parameter _params;
+    size_t _blksecs;
+    nre::SListTreap<Block> _blocks;
+    nre::SList<Extent> _extents;
+    sector_type _next;
+    sector_type _end;
+    nre::UserSm _sm;
+    nre::UserSm _prodsm;
+};
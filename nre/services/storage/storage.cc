@@ -24,6 +24,7 @@
 #include <cstring>
 
 #include "ControllerMng.h"
+#include "Overlay.h"
 
 using namespace nre;
 
@@ -36,13 +37,22 @@ static StorageService *srv;
 
 class StorageServiceSession : public ServiceSession {
 public:
-    explicit StorageServiceSession(Service *s, size_t id, portal_func func, size_t drive)
-        : ServiceSession(s, id, func), _ctrlds(), _sm(), _prod(), _datads(), _drive(drive) {
+    explicit StorageServiceSession(Service *s, size_t id, portal_func func, size_t drive,
+                                   Overlay *overlay)
+        : ServiceSession(s, id, func), _ctrlds(), _sm(), _prod(), _datads(), _drive(drive),
+          _overlay(overlay) {
     }
     virtual ~StorageServiceSession() {
+        if(_overlay) {
+            LOG(STORAGE, "Destroying overlay of drive " << _drive << " with "
+                                                        << _overlay->blocks() << " blocks\n");
+            delete _overlay;
+        }
         delete _ctrlds;
         delete _sm;
         delete _prod;
+        if(_datads && mng->dma_domain().active())
+            mng->dma_domain().unmap(*_datads);
         delete _datads;
     }
 
@@ -55,6 +65,9 @@ public:
     size_t ctrl() const {
         return _drive / Storage::MAX_DRIVES;
     }
+    Overlay *overlay() {
+        return _overlay;
+    }
     const DataSpace &data() const {
         return *_datads;
     }
@@ -71,8 +84,15 @@ public:
         _ctrlds = ctrlds;
         _sm = sm;
         _prod = new Producer<Storage::Packet>(*_ctrlds, *_sm, false);
+        _prod->stats(service()->stats_ring("completions", _prod->rblength()));
         _datads = data;
-        mng->get(_drive / Storage::MAX_DRIVES)->get_params(_drive, &_params);
+        // map it for DMA now, so that the I/O path does not have to
+        if(mng->dma_domain().active())
+            mng->dma_domain().map(*_datads);
+        if(_overlay)
+            _params = _overlay->params();
+        else
+            mng->get(_drive / Storage::MAX_DRIVES)->get_params(_drive, &_params);
     }
 
 private:
@@ -81,19 +101,16 @@ private:
     Producer<Storage::Packet> *_prod;
     DataSpace *_datads;
     size_t _drive;
+    Overlay *_overlay;
     Storage::Parameter _params;
 };
 
 class StorageService : public Service {
 public:
-    explicit StorageService(const char *name)
-        : Service(name, CPUSet(CPUSet::ALL), reinterpret_cast<portal_func>(portal)) {
+    explicit StorageService(const char *name, size_t threads)
+        : Service(name, CPUSet(CPUSet::ALL), reinterpret_cast<portal_func>(portal), threads) {
         // we want to accept two dataspaces
-        for(auto it = CPU::begin(); it != CPU::end(); ++it) {
-            Reference<LocalThread> ec = get_thread(it->log_id());
-            UtcbFrameRef uf(ec->utcb());
-            uf.accept_delegates(2);
-        }
+        accept_delegates(2);
     }
 
 private:
@@ -106,7 +123,17 @@ private:
             VTHROW(Exception, E_NOT_FOUND,
                    "Controller/drive (" << ctrl << "," << drive << ") does not exist");
         }
-        return new StorageServiceSession(this, id, func, drive);
+        // a virtual drive over <drive> with an overlay in RAM or on a scratch drive?
+        Overlay *overlay = nullptr;
+        const char *opt = strstr(args.str(), "overlay=");
+        if(opt) {
+            opt += 8;
+            size_t scratch = Overlay::RAM;
+            if(strcmp(opt, "ram") != 0)
+                scratch = IStringStream::read_from<size_t>(String(opt, strlen(opt)));
+            overlay = new Overlay(*mng, drive, scratch);
+        }
+        return new StorageServiceSession(this, id, func, drive, overlay);
     }
 
     PORTAL static void portal(StorageServiceSession *sess);
@@ -134,7 +161,10 @@ void StorageService::portal(StorageServiceSession *sess) {
                 uf >> tag;
                 uf.finish_input();
                 LOG(STORAGE_DETAIL, "[" << sess->id() << "," << fmt(tag, "#x") << "] FLUSH\n");
-                mng->get(sess->ctrl())->flush(sess->drive(), sess->prod(), tag);
+                if(sess->overlay())
+                    sess->overlay()->flush(sess->prod(), tag);
+                else
+                    mng->get(sess->ctrl())->flush(sess->drive(), sess->prod(), tag);
                 uf << E_SUCCESS;
             }
             break;
@@ -173,14 +203,22 @@ void StorageService::portal(StorageServiceSession *sess) {
                 if(cmd == Storage::READ) {
                     if(!(sess->data().flags() & DataSpaceDesc::R))
                         throw Exception(E_ARGS_INVALID, "Need to read, but no read permission");
-                    mng->get(sess->ctrl())->read(sess->drive(), sess->prod(), tag,
-                                                 sess->data(), sector, dma);
+                    if(sess->overlay())
+                        sess->overlay()->read(sess->prod(), tag, sess->data(), sector, dma);
+                    else {
+                        mng->get(sess->ctrl())->read(sess->drive(), sess->prod(), tag,
+                                                     sess->data(), sector, dma);
+                    }
                 }
                 else {
                     if(!(sess->data().flags() & DataSpaceDesc::W))
                         throw Exception(E_ARGS_INVALID, "Need to write, but no write permission");
-                    mng->get(sess->ctrl())->write(sess->drive(), sess->prod(), tag, sess->data(), sector,
-                                                  dma);
+                    if(sess->overlay())
+                        sess->overlay()->write(sess->prod(), tag, sess->data(), sector, dma);
+                    else {
+                        mng->get(sess->ctrl())->write(sess->drive(), sess->prod(), tag, sess->data(),
+                                                      sector, dma);
+                    }
                 }
                 uf << E_SUCCESS;
             }
@@ -196,15 +234,20 @@ void StorageService::portal(StorageServiceSession *sess) {
 
 int main(int argc, char *argv[]) {
     bool idedma = true;
+    size_t threads = 1;
     for(int i = 1; i < argc; ++i) {
         if(strcmp(argv[i], "noidedma") == 0) {
             LOG(STORAGE, "Disabling DMA for IDE devices\n");
             idedma = false;
         }
+        // use multiple threads per CPU so that one slow request doesn't block the other clients
+        if(strncmp(argv[i], "threads=", 8) == 0)
+            threads = IStringStream::read_from<size_t>(String(argv[i] + 8, strlen(argv[i] + 8)));
     }
 
     mng = new ControllerMng(idedma);
-    srv = new StorageService("storage");
+    Overlay::init();
+    srv = new StorageService("storage", threads);
     srv->start();
     return 0;
 }
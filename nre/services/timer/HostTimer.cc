@@ -27,9 +27,10 @@
 
 using namespace nre;
 
-HostTimer::ClientData::ClientData(size_t sid, cpu_t cpu, HostTimer::PerCpu *per_cpu, nre::Sm *sm)
+HostTimer::ClientData::ClientData(size_t sid, cpu_t cpu, HostTimer::PerCpu *per_cpu, nre::Sm *sm,
+                                  TimerSet *set)
     : abstimeout(0), count(0), nr(per_cpu->abstimeouts.alloc(this)), cpu(cpu),
-      sm(sm), sid(sid), per_cpu(per_cpu) {
+      sm(sm), sid(sid), per_cpu(per_cpu), set(set) {
     assert(CPU::current().log_id() == cpu);
     // ensure that there is no pending timeout. this can happen if this slot was allocated by a
     // different client previously.
@@ -39,6 +40,7 @@ HostTimer::ClientData::ClientData(size_t sid, cpu_t cpu, HostTimer::PerCpu *per_
 HostTimer::ClientData::~ClientData() {
     // we can't cancel the maybe pending timeout here because we might be called from a different CPU.
     per_cpu->abstimeouts.dealloc(nr);
+    delete set;
 }
 
 HostTimer::HostTimer(bool force_pit, bool force_hpet_legacy, bool slow_rtc)
@@ -193,6 +195,28 @@ bool HostTimer::per_cpu_client_request(PerCpu *per_cpu, ClientData *data) {
     return (t < per_cpu->last_to);
 }
 
+bool HostTimer::per_cpu_set_request(PerCpu *per_cpu, const WorkerMessage &m) {
+    if(m.type == WorkerMessage::TIMER_ARM)
+        m.data->set->arm(m.id, m.deadline, m.period);
+    else
+        m.data->set->cancel(m.id);
+    return rearm_set(per_cpu, m.data);
+}
+
+bool HostTimer::rearm_set(PerCpu *per_cpu, ClientData *data) {
+    per_cpu->abstimeouts.cancel(data->nr);
+    while(!data->set->empty()) {
+        timevalue_t t = absolute_tsc_to_timer(data->set->next());
+        if(t != 0) {
+            per_cpu->abstimeouts.request(data->nr, t);
+            return t < per_cpu->last_to;
+        }
+        // the earliest timer is already due
+        data->set->expire(Util::tsc());
+    }
+    return false;
+}
+
 // Returns the next timeout.
 timevalue_t HostTimer::handle_expired_timers(PerCpu *per_cpu, timevalue_t now) {
     ClientData *data;
@@ -201,8 +225,14 @@ timevalue_t HostTimer::handle_expired_timers(PerCpu *per_cpu, timevalue_t now) {
         per_cpu->abstimeouts.cancel(nr);
         // can happen if the client is already gone
         if(data) {
-            Atomic::add(&data->count, 1U);
-            data->sm->up();
+            if(data->set) {
+                data->set->expire(Util::tsc());
+                rearm_set(per_cpu, data);
+            }
+            else {
+                Atomic::add(&data->count, 1U);
+                data->sm->up();
+            }
         }
     }
     return per_cpu->abstimeouts.timeout();
@@ -228,6 +258,10 @@ again:
         case WorkerMessage::CLIENT_REQUEST:
             reprogram = ht->per_cpu_client_request(per_cpu, m.data);
             break;
+        case WorkerMessage::TIMER_ARM:
+        case WorkerMessage::TIMER_CANCEL:
+            reprogram = ht->per_cpu_set_request(per_cpu, m);
+            break;
         case WorkerMessage::TIMER_IRQ: {
             timevalue_t now = ht->_timer->update_ticks(false);
             ht->handle_expired_timers(per_cpu, now);
@@ -26,6 +26,7 @@
 
 #include "HostTimerDevice.h"
 #include "HostRTC.h"
+#include "TimerSet.h"
 
 class HostTimer {
     struct PerCpu;
@@ -50,10 +51,13 @@ public:
         nre::Sm *sm;
         size_t sid;
         HostTimer::PerCpu *per_cpu;
+        // if not null, the slot is used for the timers in this set instead of a single timeout
+        TimerSet *set;
 
-        explicit ClientData() : abstimeout(), count(), nr(), cpu(), sm(), sid(), per_cpu() {
+        explicit ClientData() : abstimeout(), count(), nr(), cpu(), sm(), sid(), per_cpu(), set() {
         }
-        explicit ClientData(size_t sid, cpu_t cpu, HostTimer::PerCpu *per_cpu, nre::Sm *sm);
+        explicit ClientData(size_t sid, cpu_t cpu, HostTimer::PerCpu *per_cpu, nre::Sm *sm,
+                            TimerSet *set = nullptr);
         ~ClientData();
     };
 
@@ -63,8 +67,14 @@ private:
             XCPU_REQUEST = 1,
             CLIENT_REQUEST,
             TIMER_IRQ,
+            TIMER_ARM,
+            TIMER_CANCEL,
         } type;
         ClientData *data;
+        // for TIMER_ARM and TIMER_CANCEL
+        uint id;
+        timevalue_t deadline;
+        timevalue_t period;
     };
 
     struct RemoteSlot {
@@ -114,6 +124,13 @@ public:
         _per_cpu[data->cpu]->worker_pt.call(uf);
     }
 
+    void arm_timer(ClientData *data, uint id, timevalue_t deadline, timevalue_t period) {
+        set_request(data, WorkerMessage::TIMER_ARM, id, deadline, period);
+    }
+    void cancel_timer(ClientData *data, uint id) {
+        set_request(data, WorkerMessage::TIMER_CANCEL, id, 0, 0);
+    }
+
     void get_time(timevalue_t &uptime, timevalue_t &unixts) {
         timevalue_t ticks = _timer->current_ticks();
         uptime = _clock.dest_time();
@@ -133,8 +150,23 @@ private:
         return diff + _timer->current_ticks();
     }
 
+    void set_request(ClientData *data, WorkerMessage::WMType type, uint id,
+                     timevalue_t deadline, timevalue_t period) {
+        nre::UtcbFrame uf;
+        WorkerMessage m;
+        m.type = type;
+        m.data = data;
+        m.id = id;
+        m.deadline = deadline;
+        m.period = period;
+        uf << m;
+        _per_cpu[data->cpu]->worker_pt.call(uf);
+    }
+
     bool per_cpu_handle_xcpu(PerCpu *per_cpu);
     bool per_cpu_client_request(PerCpu *per_cpu, ClientData *data);
+    bool per_cpu_set_request(PerCpu *per_cpu, const WorkerMessage &m);
+    bool rearm_set(PerCpu *per_cpu, ClientData *data);
     timevalue_t handle_expired_timers(PerCpu *per_cpu, timevalue_t now);
 
     PORTAL static void portal_per_cpu(void*);
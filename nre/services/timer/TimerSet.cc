@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <Hip.h>
+
+#include "TimerSet.h"
+
+using namespace nre;
+
+TimerSet::TimerSet(TimerRing *ring, cpu_t cpu, size_t count)
+    : _ring(ring), _cpu(cpu), _count(count), _size(0), _timers(new Entry[count]),
+      _heap(new uint32_t[count]),
+      // if the ring is full, retry one-shot timers after 1ms (freq_tsc is in kHz)
+      _retry(Hip::get().freq_tsc) {
+    for(size_t i = 0; i < count; ++i) {
+        _timers[i].deadline = 0;
+        _timers[i].period = 0;
+        _timers[i].count = 0;
+        _timers[i].pos = NONE;
+    }
+}
+
+size_t TimerSet::expire(timevalue_t now) {
+    size_t delivered = 0;
+    while(_size > 0 && next() <= now) {
+        uint32_t id = _heap[0];
+        Entry &t = _timers[id];
+        timevalue_t deadline = t.deadline;
+        if(t.period) {
+            // move forward by whole periods, so that we keep the phase. if we've missed some
+            // periods, they are reported via the count.
+            timevalue_t missed = (now - t.deadline) / t.period;
+            deadline += missed * t.period;
+            t.deadline = deadline + t.period;
+            t.count += missed + 1;
+            sift_down(0);
+        }
+        else {
+            t.count++;
+            remove(0);
+        }
+
+        Timer::Expiry exp;
+        exp.id = id;
+        exp.cpu = _cpu;
+        exp.count = t.count;
+        exp.deadline = deadline;
+        if(_ring->put(exp)) {
+            t.count = 0;
+            delivered++;
+        }
+        // the ring is full. periodic timers will report it with the next expiration, but one-shot
+        // timers have to try again later.
+        else if(!t.period) {
+            t.deadline = now + _retry;
+            insert(id);
+        }
+    }
+    if(delivered)
+        _ring->notify();
+    return delivered;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <ipc/Producer.h>
+#include <kobj/UserSm.h>
+#include <services/Timer.h>
+#include <util/ScopedLock.h>
+
+/**
+ * The ring of a session that receives the expirations of all its timers. It is shared by the
+ * timer workers of all CPUs.
+ */
+class TimerRing {
+public:
+    explicit TimerRing(nre::DataSpace *ds, nre::Sm *sm)
+        : _ds(ds), _sm(sm), _prod(*ds, *sm, false), _lock() {
+    }
+    ~TimerRing() {
+        delete _sm;
+        delete _ds;
+    }
+
+    nre::Producer<nre::Timer::Expiry> &prod() {
+        return _prod;
+    }
+
+    /**
+     * Puts <exp> into the ring without notifying the client
+     *
+     * @return false if the ring is full
+     */
+    bool put(const nre::Timer::Expiry &exp) {
+        nre::ScopedLock<nre::UserSm> guard(&_lock);
+        nre::Timer::Expiry *slot = _prod.current();
+        if(!slot)
+            return false;
+        *slot = exp;
+        _prod.next(false);
+        return true;
+    }
+    /**
+     * Notifies the client about new expirations
+     */
+    void notify() {
+        _prod.notify();
+    }
+
+private:
+    TimerRing(const TimerRing&);
+    TimerRing& operator=(const TimerRing&);
+
+    nre::DataSpace *_ds;
+    nre::Sm *_sm;
+    nre::Producer<nre::Timer::Expiry> _prod;
+    nre::UserSm _lock;
+};
+
+/**
+ * The timers of a session on one CPU. They are kept in a binary min-heap ordered by deadline, so
+ * that the whole set needs only one slot in the TimeoutList of the CPU, which is programmed with
+ * the earliest deadline. It is only accessed by the timer worker of that CPU.
+ */
+class TimerSet {
+    static const size_t NONE    = static_cast<size_t>(-1);
+
+    struct Entry {
+        timevalue_t deadline;
+        timevalue_t period;
+        uint32_t count;
+        size_t pos;
+    };
+
+public:
+    explicit TimerSet(TimerRing *ring, cpu_t cpu, size_t count);
+    ~TimerSet() {
+        delete[] _heap;
+        delete[] _timers;
+    }
+
+    /**
+     * @return the number of timer ids
+     */
+    size_t count() const {
+        return _count;
+    }
+    /**
+     * @return true if no timer is armed
+     */
+    bool empty() const {
+        return _size == 0;
+    }
+    /**
+     * @return the earliest deadline (requires !empty())
+     */
+    timevalue_t next() const {
+        return _timers[_heap[0]].deadline;
+    }
+
+    /**
+     * Arms or re-arms timer <id>
+     *
+     * @param id the timer id
+     * @param deadline the TSC value of the first expiration
+     * @param period the period in cycles (0 = one-shot)
+     */
+    void arm(uint id, timevalue_t deadline, timevalue_t period) {
+        Entry &t = _timers[id];
+        t.deadline = deadline;
+        t.period = period;
+        t.count = 0;
+        if(t.pos == NONE)
+            insert(id);
+        else
+            update(t.pos);
+    }
+    /**
+     * Cancels timer <id>, if it is armed
+     *
+     * @param id the timer id
+     */
+    void cancel(uint id) {
+        if(_timers[id].pos != NONE)
+            remove(_timers[id].pos);
+    }
+
+    /**
+     * Handles all timers whose deadline is not after <now>. That is, it puts the expirations into
+     * the ring, re-arms periodic timers and notifies the client once at the end.
+     *
+     * @param now the current TSC value
+     * @return the number of delivered expirations
+     */
+    size_t expire(timevalue_t now);
+
+private:
+    TimerSet(const TimerSet&);
+    TimerSet& operator=(const TimerSet&);
+
+    bool less(size_t a, size_t b) const {
+        return _timers[_heap[a]].deadline < _timers[_heap[b]].deadline;
+    }
+    void place(size_t pos, uint32_t id) {
+        _heap[pos] = id;
+        _timers[id].pos = pos;
+    }
+    void swap(size_t a, size_t b) {
+        uint32_t id = _heap[a];
+        place(a, _heap[b]);
+        place(b, id);
+    }
+    void insert(uint32_t id) {
+        place(_size, id);
+        sift_up(_size++);
+    }
+    void remove(size_t pos) {
+        _timers[_heap[pos]].pos = NONE;
+        if(--_size != pos) {
+            place(pos, _heap[_size]);
+            update(pos);
+        }
+    }
+    void update(size_t pos) {
+        if(pos > 0 && less(pos, (pos - 1) / 2))
+            sift_up(pos);
+        else
+            sift_down(pos);
+    }
+    void sift_up(size_t pos) {
+        while(pos > 0) {
+            size_t parent = (pos - 1) / 2;
+            if(!less(pos, parent))
+                break;
+            swap(pos, parent);
+            pos = parent;
+        }
+    }
+    void sift_down(size_t pos) {
+        while(1) {
+            size_t min = pos, left = pos * 2 + 1, right = left + 1;
+            if(left < _size && less(left, min))
+                min = left;
+            if(right < _size && less(right, min))
+                min = right;
+            if(min == pos)
+                break;
+            swap(pos, min);
+            pos = min;
+        }
+    }
+
+    TimerRing *_ring;
+    cpu_t _cpu;
+    size_t _count;
+    size_t _size;
+    Entry *_timers;
+    uint32_t *_heap;
+    timevalue_t _retry;
+};
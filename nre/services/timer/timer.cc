@@ -32,18 +32,22 @@ public:
     // take care that we do the allocation of ClientData only from the corresponding CPU
     explicit TimerSessionData(Service *s, size_t id, portal_func func)
         : ServiceSession(s, id, func), _sms(new Sm*[CPU::count()]),
-          _data(new HostTimer::ClientData*[CPU::count()]()) {
+          _data(new HostTimer::ClientData*[CPU::count()]()),
+          _timers(new HostTimer::ClientData*[CPU::count()]()), _ring(), _count() {
         for(auto it = CPU::begin(); it != CPU::end(); ++it)
             _sms[it->log_id()] = new Sm(0);
     }
     // deletion is ok here because it doesn't touch shared data.
     virtual ~TimerSessionData() {
         for(auto it = CPU::begin(); it != CPU::end(); ++it) {
+            delete _timers[it->log_id()];
             delete _data[it->log_id()];
             delete _sms[it->log_id()];
         }
+        delete _ring;
         delete[] _sms;
         delete[] _data;
+        delete[] _timers;
     }
 
     Sm &sm(cpu_t cpu) {
@@ -56,15 +60,42 @@ public:
         return _data[cpu];
     }
 
+    void init_timers(DataSpace *ds, Sm *sm, size_t count) {
+        if(_ring != nullptr)
+            throw Exception(E_EXISTS, "Timers already initialized");
+        if(count == 0 || count > nre::Timer::MAX_TIMERS)
+            VTHROW(Exception, E_ARGS_INVALID, "Invalid number of timers (" << count << ")");
+        _ring = new TimerRing(ds, sm);
+        _ring->prod().stats(service()->stats_ring("expiries", _ring->prod().rblength()));
+        _count = count;
+    }
+    HostTimer::ClientData *timers(cpu_t cpu, uint tid) {
+        assert(CPU::current().log_id() == cpu);
+        if(_ring == nullptr)
+            throw Exception(E_ARGS_INVALID, "Timers not initialized");
+        if(tid >= _count)
+            VTHROW(Exception, E_ARGS_INVALID, "Invalid timer id " << tid);
+        if(_timers[cpu] == nullptr) {
+            _timers[cpu] = new HostTimer::ClientData(id(), cpu, timer->get_percpu(cpu), nullptr,
+                                                     new TimerSet(_ring, cpu, _count));
+        }
+        return _timers[cpu];
+    }
+
 private:
     Sm **_sms;
     HostTimer::ClientData **_data;
+    HostTimer::ClientData **_timers;
+    TimerRing *_ring;
+    size_t _count;
 };
 
 class TimerService : public Service {
 public:
     explicit TimerService(const char *name)
         : Service(name, CPUSet(CPUSet::ALL), reinterpret_cast<portal_func>(portal)) {
+        // we want to accept a dataspace and a semaphore for the expiry ring
+        accept_delegates(1);
     }
 
 private:
@@ -103,6 +134,46 @@ void TimerService::portal(TimerSessionData *sess) {
             }
             break;
 
+            case nre::Timer::INIT_TIMERS: {
+                capsel_t dssel = uf.get_delegated(0).offset();
+                capsel_t smsel = uf.get_delegated(0).offset();
+                size_t count;
+                uf >> count;
+                uf.finish_input();
+
+                LOG(TIMER_DETAIL, "TIMER: (" << sess->id() << ") Initializing "
+                                             << count << " timers\n");
+                sess->init_timers(new DataSpace(dssel), new Sm(smsel, false), count);
+                uf.accept_delegates();
+                uf << E_SUCCESS;
+            }
+            break;
+
+            case nre::Timer::ARM_TIMER: {
+                uint id;
+                timevalue_t deadline, period;
+                uf >> id >> deadline >> period;
+                uf.finish_input();
+
+                cpu_t cpu = CPU::current().log_id();
+                LOG(TIMER_DETAIL, "TIMER: (" << sess->id() << ") Arming timer " << id << " for "
+                                             << fmt(deadline, "#x") << " period "
+                                             << period << " on " << cpu << "\n");
+                timer->arm_timer(sess->timers(cpu, id), id, deadline, period);
+                uf << E_SUCCESS;
+            }
+            break;
+
+            case nre::Timer::CANCEL_TIMER: {
+                uint id;
+                uf >> id;
+                uf.finish_input();
+
+                timer->cancel_timer(sess->timers(CPU::current().log_id(), id), id);
+                uf << E_SUCCESS;
+            }
+            break;
+
             case nre::Timer::GET_TIME: {
                 uf.finish_input();
 
@@ -117,6 +188,7 @@ void TimerService::portal(TimerSessionData *sess) {
         }
     }
     catch(const Exception &e) {
+        Syscalls::revoke(uf.delegation_window(), true);
         uf.clear();
         uf << e;
     }
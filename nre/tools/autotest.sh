@@ -2,6 +2,8 @@
 QEMU=qemu-system-x86_64
 QEMU_FLAGS="-display none"
 timeout=120
+# the allowed slowdown of the ipcbench medians compared to the baseline, in percent
+ipcbench_tolerance=${IPCBENCH_TOLERANCE:-20}
 
 builds="debug release"
 targets="x86_32 x86_64"
@@ -9,6 +11,7 @@ compilers="gcc clang"
 
 usage() {
     echo "Usage: $0 (run|check-all) [-b <builds>] [-t <targets] [-c <compilers>]" 1>&2
+    echo "       $0 baseline <ipcbench-log>..." 1>&2
     exit 1
 }
 
@@ -44,7 +47,7 @@ wait_for() {
         while [ $waittime -lt $timeout ]; do
             sleep 1
             waittime=$((waittime + 1))
-            if [ "`check_result $1`" = "" ]; then
+            if [ "`check_finished $1`" = "" ]; then
                 run=false
                 waittime=$timeout
             fi
@@ -55,6 +58,20 @@ wait_for() {
     done
 }
 
+# prints nothing if the run is finished, i.e. if its result can be checked
+check_finished() {
+    test=`echo $1 | sed -e 's/.*-\(.*\)\.txt$/\1/'`
+    if [ "$test" = "ipcbench" ]; then
+        # don't compare with the baseline here; a slower run is finished as well
+        chk1=`grep "bin/apps/ipcbench': Pd terminated with exit code 0" $1`
+        if [ "$chk1" = "" ]; then
+            echo $1: RUNNING
+        fi
+    else
+        check_result $1
+    fi
+}
+
 check_result() {
     test=`echo $1 | sed -e 's/.*-\(.*\)\.txt$/\1/'`
     if [ "$test" = "test" ]; then
@@ -69,6 +86,19 @@ check_result() {
         if [ "$chk1" = "" ]; then
             echo $1: FAILED
         fi
+    elif [ "$test" = "ipcbench" ]; then
+        chk1=`grep "bin/apps/ipcbench': Pd terminated with exit code 0" $1`
+        if [ "$chk1" = "" ]; then
+            echo $1: FAILED
+        else
+            compare_baseline $1
+        fi
+    elif [ "$test" = "bootdeps" ]; then
+        # root prints the timeline as soon as the boot is finished
+        chk1=`grep "Boot timeline" $1`
+        if [ "$chk1" = "" ]; then
+            echo $1: FAILED
+        fi
     elif [ "$test" = "disktest_nocheck" ]; then
         chk1=`grep FAILED $1`
         chk2=`grep "bin/apps/disktest no-check': Pd terminated with exit code 0" $1`
@@ -83,6 +113,33 @@ check_result() {
     fi
 }
 
+# prints "<name> <median>" for all benchmarks in the given ipcbench log
+ipcbench_medians() {
+    sed -n -e 's/.*ipcbench: name=\([^ ]*\) .* p50=\([0-9]*\) .*/\1 \2/p' $1
+}
+
+# the baseline depends on the configuration, which is part of the log file name
+baseline_file() {
+    config=`echo $1 | sed -e 's/.*-\([^-]*-[^-]*-[^-]*\)-[^-]*-ipcbench\.txt$/\1/'`
+    echo tools/baselines/ipcbench-$config.txt
+}
+
+compare_baseline() {
+    baseline=`baseline_file $1`
+    if [ ! -f $baseline ]; then
+        return
+    fi
+    ipcbench_medians $1 | while read name median; do
+        base=`grep "^$name " $baseline | cut -d ' ' -f 2`
+        if [ "$base" = "" ]; then
+            continue
+        fi
+        if [ $((median * 100)) -gt $((base * (100 + ipcbench_tolerance))) ]; then
+            echo "$1: SLOWER: $name p50=$median baseline=$base"
+        fi
+    done
+}
+
 run_in_qemu() {
     echo "Executing boot/$1 in qemu..."
     logfile="build/logs/`date --iso-8601=seconds`-$NRE_TARGET-$NRE_BUILD-$NRE_CC-qemu-$1.txt"
@@ -161,6 +218,8 @@ test_config() {
     submit_job run_in_qemu test
     submit_job run_in_qemu disktest_nocheck
     submit_job run_in_qemu escape
+    submit_job run_in_qemu ipcbench
+    submit_job run_in_qemu bootdeps
     submit_job run_in_bochs unittests
     submit_job run_in_bochs test
     submit_job run_in_bochs disktest_nocheck
@@ -181,7 +240,14 @@ set -m
 trap sigusr1 USR1
 trap sigint INT
 
-if [ "$cmd" = "check-all" ]; then
+if [ "$cmd" = "baseline" ]; then
+    mkdir -p tools/baselines
+    for f in "$@"; do
+        baseline=`baseline_file $f`
+        ipcbench_medians $f > $baseline
+        echo "Wrote `wc -l < $baseline` medians from $f to $baseline"
+    done
+elif [ "$cmd" = "check-all" ]; then
     for f in build/logs/*; do
         check_result $f
     done